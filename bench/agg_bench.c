@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "agg.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Cost per input row of GROUP BY queries over a cached table, with the
+// default memory budget and with one small enough to make the larger ones
+// spill. The result of every query is checked to be the same under both
+// budgets. "GROUP BY g1k, z" groups like "GROUP BY g1k" (z is always 0)
+// but goes through the general table instead of the INT key one.
+
+#define BENCH_PATH "agg_bench.db"
+#define POOL_FRAMES 65536
+#define SMALL_WORK_MEM (256u << 10)
+
+static const char* QUERIES[] = {
+  "SELECT count(*), sum(a), max(a) FROM t",
+  "SELECT g10, count(*), sum(a) FROM t GROUP BY g10",
+  "SELECT g1k, count(*), sum(a) FROM t GROUP BY g1k",
+  "SELECT g1k, z, count(*), sum(a) FROM t GROUP BY g1k, z",
+  "SELECT g100k, count(*), sum(a), min(a) FROM t GROUP BY g100k",
+  "SELECT s1k, count(*), avg(a) FROM t GROUP BY s1k",
+  "SELECT s100k, count(*), sum(a) FROM t GROUP BY s100k",
+};
+
+static const ColumnDef COLS[7] = {
+  { .col = "a", .type = COL_INT },
+  { .col = "g10", .type = COL_INT },
+  { .col = "g1k", .type = COL_INT },
+  { .col = "g100k", .type = COL_INT },
+  { .col = "z", .type = COL_INT },
+  { .col = "s1k", .type = COL_TEXT },
+  { .col = "s100k", .type = COL_TEXT },
+};
+
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  (void)i;
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", rand() % 1000);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 10);
+  int k = rand() % 1000;
+  snprintf(vals[2], BENCH_VALUE_LEN, "%d", k);
+  int m = rand() % 100000;
+  snprintf(vals[3], BENCH_VALUE_LEN, "%d", m);
+  snprintf(vals[4], BENCH_VALUE_LEN, "0");
+  snprintf(vals[5], BENCH_VALUE_LEN, "key-%d", k);
+  snprintf(vals[6], BENCH_VALUE_LEN, "key-%d", m);
+  for (int c = 0; c < 7; c++) out[c] = vals[c];
+}
+
+static void agg_stats(const Operator* plan, void* arg) {
+  exec_hash_agg_stats(plan->child, arg);
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 1000000;
+  int reps = argc > 2 ? atoi(argv[2]) : 3;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  srand(7);
+  bench_load(bp, &cat, "t", COLS, 7, nrows, fill);
+
+  printf("%d rows, best of %d, ns per input row; small budget %u KB\n", nrows, reps,
+         SMALL_WORK_MEM >> 10);
+  printf("%-62s %7s %9s %9s %9s %9s\n", "query", "groups", "default", "spilled", "small",
+         "spilled");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    double best[2] = { 1e30, 1e30 };
+    uint64_t sums[2];
+    long groups[2];
+    HashAggStats st[2];
+
+    for (int m = 0; m < 2; m++) {
+      for (int r = 0; r < reps; r++) {
+        double secs;
+        groups[m] = bench_run(bp, &cat, QUERIES[q], m ? SMALL_WORK_MEM : 0, false, &secs,
+                              &sums[m], agg_stats, &st[m]);
+        if (groups[m] < 0) return 1;
+        if (secs < best[m]) best[m] = secs;
+      }
+    }
+    if (groups[0] != groups[1] || sums[0] != sums[1]) {
+      printf("%s: results differ between budgets\n", QUERIES[q]);
+      return 1;
+    }
+
+    printf("%-62s %7ld %9.1f %9llu %9.1f %9llu\n", QUERIES[q], groups[0],
+           best[0] * 1e9 / nrows, (unsigned long long)st[0].spilled_rows,
+           best[1] * 1e9 / nrows, (unsigned long long)st[1].spilled_rows);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
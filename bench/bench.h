@@ -0,0 +1,123 @@
+#pragma once
+#include "catalog.h"
+#include "cursor.h"
+#include "heap.h"
+#include "planner.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Helpers shared by the programs in bench/: a clock, a loader for tables
+// of generated rows, a checksum of result rows and runners that take a
+// query to its end through the planner or a cursor.
+
+#define BENCH_VALUE_LEN 64
+
+/** @brief Writes the values of row i into vals and points out at them, or at NULL. */
+typedef void (*BenchFill)(int i, char vals[][BENCH_VALUE_LEN], const char** out);
+
+/** @brief Called on a plan that ran to its end, before it is closed. */
+typedef void (*BenchInspect)(const Operator* plan, void* arg);
+
+// Monotonic time in seconds.
+static inline double now_sec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Creates a table and bulk loads nrows rows written by fill; returns the
+// average encoded row size in bytes.
+static inline double bench_load(BufferPool* bp, Catalog* cat, const char* name,
+                                const ColumnDef* cols, int ncols, int nrows, BenchFill fill) {
+  uint32_t heap_h;
+  catalog_create_table(bp, cat, name, cols, ncols, &heap_h);
+  HeapFile hf = heap_open(bp, heap_h);
+
+  HeapBulkLoad bl;
+  heap_bulk_begin(&hf, &bl, NULL, NULL);
+  static char buf[CATALOG_MAX_COLS][BENCH_VALUE_LEN];
+  const char* vals[CATALOG_MAX_COLS];
+  long bytes = 0;
+  for (int i = 0; i < nrows; i++) {
+    fill(i, buf, vals);
+    uint8_t enc[2048];
+    int len = row_encode(bp, cols, ncols, vals, ncols, enc, sizeof(enc));
+    if (len <= 0) continue;
+    heap_bulk_insert(bp, &bl, enc, (uint16_t)len);
+    bytes += len;
+  }
+  heap_bulk_end(bp, &bl);
+  return nrows ? (double)bytes / nrows : 0;
+}
+
+// Checksum of one output row.
+static inline uint64_t row_sum(const Tuple* t) {
+  uint64_t h = 0;
+  for (int i = 0; i < t->ncols; i++) {
+    const RowField* v = &t->vals[i];
+    uint64_t x = v->is_null ? 0x9e37 : v->type == COL_INT ? (uint64_t)(uint32_t)v->i32 : 0;
+    if (!v->is_null && v->type == COL_TEXT) {
+      for (uint32_t j = 0; j < v->text_len; j++) x = x * 131 + v->text[j];
+    }
+    h = (h ^ x) * 0x100000001b3ull;
+  }
+  return h;
+}
+
+// Plans a query and reads it a row at a time; returns the number of rows,
+// or -1 on failure. sum is the checksum of the rows, which depends on their
+// order when ordered is set. inspect, if not NULL, sees the plan at the end.
+static inline long bench_run(BufferPool* bp, Catalog* cat, const char* sql, size_t work_mem,
+                             bool ordered, double* secs, uint64_t* sum, BenchInspect inspect,
+                             void* arg) {
+  Arena arena;
+  arena_init(&arena);
+  ExecCtx ctx = { .bp = bp, .cat = cat, .arena = &arena, .work_mem = work_mem };
+  Stmt* s = parse_statement(&arena, sql, ctx.err, sizeof(ctx.err));
+  Operator* plan = s ? plan_select(&ctx, &s->select) : NULL;
+  if (!plan) {
+    printf("%s\n", ctx.err);
+    arena_free(&arena);
+    return -1;
+  }
+
+  double t0 = now_sec();
+  Tuple t;
+  long n = 0;
+  int r = -1;
+  *sum = 0;
+  if (plan->open(plan)) {
+    while ((r = plan->next(plan, &t)) > 0) {
+      *sum = ordered ? (*sum ^ row_sum(&t)) * 0x100000001b3ull : *sum + row_sum(&t);
+      n++;
+    }
+  }
+  *secs = now_sec() - t0;
+  if (inspect) inspect(plan, arg);
+  plan->close(plan);
+  if (r < 0) {
+    printf("%s\n", ctx.err);
+    n = -1;
+  }
+  arena_free(&arena);
+  return n;
+}
+
+// Reads a query to its end through a cursor; returns its rows, or -1 on
+// failure.
+static inline long bench_fetch_all(BufferPool* bp, Catalog* cat, const char* sql) {
+  char err[256];
+  Cursor* c = cursor_open(bp, cat, sql, 0, err, sizeof(err));
+  if (!c) {
+    printf("%s\n", err);
+    return -1;
+  }
+  Batch b;
+  long rows = 0;
+  int r;
+  while ((r = cursor_fetch_batch(c, &b)) > 0) rows += b.nsel;
+  if (r < 0) printf("%s\n", cursor_error(c));
+  cursor_close(c);
+  return r < 0 ? -1 : rows;
+}
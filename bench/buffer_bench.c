@@ -0,0 +1,56 @@
+#include "bench.h"
+#include "buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// bp_fetch_page + bp_unpin_page latency as the pool capacity grows. The
+// resident set is capped so the 1M-frame pool fits in memory; misses still
+// probe the page table of the full-size pool.
+
+#define BENCH_PATH "buffer_bench.db"
+#define MAX_RESIDENT 16384
+
+int main(int argc, char** argv) {
+  int nops = argc > 1 ? atoi(argv[1]) : 2000000;
+  static const int caps[] = { 32, 256, 1024, 8192, 65536, 262144, 1048576 };
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+
+  uint32_t* pids = malloc(sizeof(uint32_t) * (size_t)nops);
+
+  printf("%10s %10s %14s %14s\n", "capacity", "resident", "miss ns/op", "hit ns/op");
+  for (size_t c = 0; c < sizeof(caps) / sizeof(caps[0]); c++) {
+    int cap = caps[c];
+    int resident = cap < MAX_RESIDENT ? cap : MAX_RESIDENT;
+
+    BufferPool* bp = bp_create(dm, cap);
+    if (!bp) break;
+
+    double t0 = now_sec();
+    for (int i = 0; i < resident; i++) {
+      bp_fetch_page(bp, (uint32_t)i, LATCH_SHARED);
+      bp_unpin_page(bp, (uint32_t)i, false);
+    }
+    double miss_ns = (now_sec() - t0) * 1e9 / resident;
+
+    srand(7);
+    for (int i = 0; i < nops; i++) pids[i] = (uint32_t)(rand() % resident);
+
+    t0 = now_sec();
+    for (int i = 0; i < nops; i++) {
+      bp_fetch_page(bp, pids[i], LATCH_SHARED);
+      bp_unpin_page(bp, pids[i], false);
+    }
+    double hit_ns = (now_sec() - t0) * 1e9 / nops;
+
+    printf("%10d %10d %14.1f %14.1f\n", cap, resident, miss_ns, hit_ns);
+    bp_destroy(bp);
+  }
+
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  free(pids);
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "buffer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Read-only fetch throughput of a shared buffer pool as threads are added.
+// Every thread pins random resident pages with a shared latch, so the only
+// contention is on page table partitions and frame metadata.
+
+#define BENCH_PATH "concurrent_bench.db"
+#define POOL_FRAMES 65536
+#define RESIDENT 16384
+#define MAX_THREADS 64
+
+typedef struct {
+  BufferPool* bp;
+  int ops;
+  unsigned seed;
+} Worker;
+
+static void* run_worker(void* arg) {
+  Worker* w = arg;
+  unsigned x = w->seed;
+  for (int i = 0; i < w->ops; i++) {
+    x = x * 1103515245u + 12345u;
+    uint32_t pid = (x >> 8) % RESIDENT;
+    bp_fetch_page(w->bp, pid, LATCH_SHARED);
+    bp_unpin_page(w->bp, pid, false);
+  }
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  int ops = argc > 1 ? atoi(argv[1]) : 2000000;
+  int cores = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (cores > MAX_THREADS) cores = MAX_THREADS;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  for (uint32_t pid = 0; pid < RESIDENT; pid++) {
+    bp_fetch_page(bp, pid, LATCH_SHARED);
+    bp_unpin_page(bp, pid, false);
+  }
+
+  printf("%d threads max, %d resident pages, %d fetches per thread\n", cores, RESIDENT, ops);
+  printf("%8s %14s %10s\n", "threads", "fetches/s", "speedup");
+
+  double base = 0;
+  for (int n = 1; n <= cores; n *= 2) {
+    pthread_t tids[MAX_THREADS];
+    Worker w[MAX_THREADS];
+
+    double t0 = now_sec();
+    for (int i = 0; i < n; i++) {
+      w[i] = (Worker){ .bp = bp, .ops = ops, .seed = (unsigned)i * 7919u + 1 };
+      pthread_create(&tids[i], NULL, run_worker, &w[i]);
+    }
+    for (int i = 0; i < n; i++) pthread_join(tids[i], NULL);
+    double rate = (double)ops * n / (now_sec() - t0);
+
+    if (n == 1) base = rate;
+    printf("%8d %14.0f %9.2fx\n", n, rate, rate / base);
+    if (n < cores && n * 2 > cores) n = cores / 2;
+  }
+
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
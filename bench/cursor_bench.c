@@ -0,0 +1,95 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Pages fetched and time taken by queries read through a cursor over a
+// cached table. A LIMIT with or without OFFSET reads only the pages up to
+// its last row; "first batch" fetches one batch of a full scan and closes
+// the cursor, which stops the scan there. The full scans are for scale.
+
+#define BENCH_PATH "cursor_bench.db"
+#define POOL_FRAMES 65536
+
+typedef struct {
+  const char* name;
+  const char* sql;
+  int batches; ///< Batches fetched before closing, 0 for all
+} Query;
+
+static const Query QUERIES[] = {
+  { "limit", "SELECT * FROM t LIMIT 5", 0 },
+  { "limit, offset", "SELECT * FROM t LIMIT 5 OFFSET 100000", 0 },
+  { "filter, limit", "SELECT id FROM t WHERE a < 10 LIMIT 10", 0 },
+  { "first batch", "SELECT * FROM t", 1 },
+  { "top-n", "SELECT * FROM t ORDER BY a LIMIT 5", 0 },
+  { "full scan", "SELECT * FROM t", 0 },
+};
+
+static const ColumnDef COLS[3] = {
+  { .col = "id", .type = COL_INT },
+  { .col = "a", .type = COL_INT },
+  { .col = "s", .type = COL_TEXT },
+};
+
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 1000);
+  snprintf(vals[2], BENCH_VALUE_LEN, "row-%d", i);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+}
+
+static uint64_t fetches(BufferPool* bp) {
+  BufferStats st;
+  bp_stats(bp, &st);
+  return st.hits + st.misses;
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 1000000;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  srand(3);
+  bench_load(bp, &cat, "t", COLS, 3, nrows, fill);
+
+  printf("%d rows\n", nrows);
+  printf("%-14s %-40s %9s %9s %11s\n", "query", "sql", "rows", "pages", "us");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* qq = &QUERIES[q];
+    char err[256];
+    uint64_t before = fetches(bp);
+    double t0 = now_sec();
+
+    Cursor* c = cursor_open(bp, &cat, qq->sql, 0, err, sizeof(err));
+    if (!c) {
+      printf("%s\n", err);
+      return 1;
+    }
+    Batch b;
+    long rows = 0;
+    int batches = 0;
+    int r = 0;
+    while ((qq->batches == 0 || batches < qq->batches) && (r = cursor_fetch_batch(c, &b)) > 0) {
+      rows += b.nsel;
+      batches++;
+    }
+    if (r < 0) {
+      printf("%s\n", cursor_error(c));
+      return 1;
+    }
+    cursor_close(c);
+
+    double secs = now_sec() - t0;
+    printf("%-14s %-40s %9ld %9llu %11.1f\n", qq->name, qq->sql, rows,
+           (unsigned long long)(fetches(bp) - before), secs * 1e6);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
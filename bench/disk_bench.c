@@ -0,0 +1,81 @@
+#include "bench.h"
+#include "disk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Random 8 KiB page read/write throughput: the old stdio DiskManager
+// (fseek + fread/fwrite + fflush per write) against the pread/pwrite one,
+// which defers durability to a single disk_sync.
+
+#define BENCH_PATH "disk_bench.db"
+
+static void stdio_read_page(FILE* f, uint32_t pid, Page* out) {
+  memset(out, 0, sizeof(Page));
+  fseek(f, (long)pid * PAGE_SIZE, SEEK_SET);
+  if (fread(out, PAGE_SIZE, 1, f) != 1) memset(out, 0, sizeof(Page));
+}
+
+static void stdio_write_page(FILE* f, uint32_t pid, const Page* in) {
+  fseek(f, (long)pid * PAGE_SIZE, SEEK_SET);
+  fwrite(in, PAGE_SIZE, 1, f);
+  fflush(f);
+}
+
+static void report(const char* name, int ops, double secs) {
+  printf("  %-22s %9d ops  %8.3f s  %10.0f pages/s  %8.1f MiB/s\n",
+         name, ops, secs, ops / secs, ops * (double)PAGE_SIZE / secs / (1024.0 * 1024.0));
+}
+
+int main(int argc, char** argv) {
+  int npages = argc > 1 ? atoi(argv[1]) : 4096;
+  int nops = argc > 2 ? atoi(argv[2]) : 100000;
+
+  uint32_t* pids = malloc(sizeof(uint32_t) * (size_t)nops);
+  srand(42);
+  for (int i = 0; i < nops; i++) pids[i] = (uint32_t)(rand() % npages);
+
+  Page page;
+  page_init(&page, 0);
+  memset(page.data, 0xAB, sizeof(page.data));
+
+  printf("file: %d pages (%.1f MiB), %d random ops\n",
+         npages, npages * (double)PAGE_SIZE / (1024.0 * 1024.0), nops);
+
+  // stdio baseline
+  unlink(BENCH_PATH);
+  FILE* f = fopen(BENCH_PATH, "w+b");
+  for (int i = 0; i < npages; i++) stdio_write_page(f, (uint32_t)i, &page);
+
+  printf("stdio (fseek/fread/fwrite+fflush):\n");
+  double t0 = now_sec();
+  for (int i = 0; i < nops; i++) stdio_write_page(f, pids[i], &page);
+  fsync(fileno(f));
+  report("random write", nops, now_sec() - t0);
+
+  t0 = now_sec();
+  for (int i = 0; i < nops; i++) stdio_read_page(f, pids[i], &page);
+  report("random read", nops, now_sec() - t0);
+  fclose(f);
+
+  // pread/pwrite DiskManager
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  for (int i = 0; i < npages; i++) disk_alloc_page(dm);
+
+  printf("DiskManager (pread/pwrite + disk_sync):\n");
+  t0 = now_sec();
+  for (int i = 0; i < nops; i++) disk_write_page(dm, pids[i], &page);
+  disk_sync(dm);
+  report("random write", nops, now_sec() - t0);
+
+  t0 = now_sec();
+  for (int i = 0; i < nops; i++) disk_read_page(dm, pids[i], &page);
+  report("random read", nops, now_sec() - t0);
+  disk_close(dm);
+
+  unlink(BENCH_PATH);
+  free(pids);
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "bench.h"
+#include "join.h"
+#include "sql.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Cost per output row of equi-joins between a fact table and dimension
+// tables of several sizes, over a cached database. Each join runs as an
+// in-memory hash join under the default budget, as a hybrid hash join that
+// spills under a small budget, and as a merge join over index scans (the
+// "_ix" copies of the tables have indexes on their join columns, which the
+// planner uses under the small budget). Every plan's result is checked to
+// be the same.
+
+#define BENCH_PATH "join_bench.db"
+#define POOL_FRAMES 65536
+#define SMALL_WORK_MEM (256u << 10)
+
+static const char* QUERIES[][2] = {
+  { "SELECT f.id, d1k.w FROM f JOIN d1k ON f.k1k = d1k.k",
+    "SELECT f_ix.id, d1k_ix.w FROM f_ix JOIN d1k_ix ON f_ix.k1k = d1k_ix.k" },
+  { "SELECT f.id, d100k.w FROM f JOIN d100k ON f.k100k = d100k.k",
+    "SELECT f_ix.id, d100k_ix.w FROM f_ix JOIN d100k_ix ON f_ix.k100k = d100k_ix.k" },
+  { "SELECT f.id, d100k.name FROM f JOIN d100k ON f.k100k = d100k.k",
+    "SELECT f_ix.id, d100k_ix.name FROM f_ix JOIN d100k_ix ON f_ix.k100k = d100k_ix.k" },
+  { "SELECT f.id, d100k.w FROM f JOIN d100k ON f.k100k = d100k.k WHERE d100k.w < 10",
+    "SELECT f_ix.id, d100k_ix.w FROM f_ix JOIN d100k_ix ON f_ix.k100k = d100k_ix.k "
+    "WHERE d100k_ix.w < 10" },
+};
+
+// Fact rows: id and keys into both dimensions.
+static void fill_fact(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 1000);
+  snprintf(vals[2], BENCH_VALUE_LEN, "%d", rand() % 100000);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+}
+
+// Dimension rows: key, a small number and a name.
+static void fill_dim(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 100);
+  snprintf(vals[2], BENCH_VALUE_LEN, "name-%d", i);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+}
+
+typedef struct {
+  HashJoinStats st;
+  char label[16]; ///< "hash" or "merge"
+} JoinInfo;
+
+// Records which join the planner chose and, for a hash join, its stats.
+static void join_stats(const Operator* plan, void* arg) {
+  JoinInfo* info = arg;
+  while (plan && !plan->right) plan = plan->child;
+  bool hash = strncmp(plan->label, "HashJoin", 8) == 0;
+  memset(&info->st, 0, sizeof(info->st));
+  if (hash) exec_hash_join_stats(plan, &info->st);
+  snprintf(info->label, sizeof(info->label), "%s", hash ? "hash" : "merge");
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 1000000;
+  int reps = argc > 2 ? atoi(argv[2]) : 3;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+
+  const ColumnDef fact[3] = {
+    { .col = "id", .type = COL_INT },
+    { .col = "k1k", .type = COL_INT },
+    { .col = "k100k", .type = COL_INT },
+  };
+  const ColumnDef dim[3] = {
+    { .col = "k", .type = COL_INT },
+    { .col = "w", .type = COL_INT },
+    { .col = "name", .type = COL_TEXT },
+  };
+  const char* names[6] = { "f", "d1k", "d100k", "f_ix", "d1k_ix", "d100k_ix" };
+  const int sizes[3] = { nrows, 1000, 100000 };
+  for (int k = 0; k < 6; k++) {
+    srand(11);
+    bench_load(bp, &cat, names[k], k % 3 ? dim : fact, 3, sizes[k % 3],
+               k % 3 ? fill_dim : fill_fact);
+  }
+  sql_exec(bp, &cat, "CREATE INDEX f_ix_k1k ON f_ix (k1k)");
+  sql_exec(bp, &cat, "CREATE INDEX f_ix_k100k ON f_ix (k100k)");
+  sql_exec(bp, &cat, "CREATE INDEX d1k_ix_k ON d1k_ix (k)");
+  sql_exec(bp, &cat, "CREATE INDEX d100k_ix_k ON d100k_ix (k)");
+
+  printf("\n%d fact rows, best of %d, ns per fact row; small budget %u KB\n", nrows, reps,
+         SMALL_WORK_MEM >> 10);
+  printf("%-62s %8s %8s %8s %9s %8s %6s\n", "query", "rows", "default", "small", "spilled",
+         "indexed", "plan");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    double best[3] = { 1e30, 1e30, 1e30 };
+    uint64_t sums[3];
+    long rows[3];
+    JoinInfo info[3];
+
+    for (int m = 0; m < 3; m++) {
+      const char* sql = QUERIES[q][m == 2];
+      for (int r = 0; r < reps; r++) {
+        double secs;
+        rows[m] = bench_run(bp, &cat, sql, m ? SMALL_WORK_MEM : 0, false, &secs, &sums[m],
+                            join_stats, &info[m]);
+        if (rows[m] < 0) return 1;
+        if (secs < best[m]) best[m] = secs;
+      }
+    }
+    if (rows[0] != rows[1] || rows[0] != rows[2] || sums[0] != sums[1] || sums[0] != sums[2]) {
+      printf("%s: results differ between plans\n", QUERIES[q][0]);
+      return 1;
+    }
+
+    printf("%-62s %8ld %8.1f %8.1f %9llu %8.1f %6s\n", QUERIES[q][0], rows[0],
+           best[0] * 1e9 / nrows, best[1] * 1e9 / nrows, (unsigned long long)info[1].st.spilled_rows,
+           best[2] * 1e9 / nrows, info[2].label);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include "bench.h"
+#include "kernels.h"
+#include "catalog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Predicate kernels per instruction set at several selectivities. Each
+// kernel runs over a column of random values in batches of 1024, as the
+// Filter operator calls it, and its mask is turned into a selection vector.
+// Every instruction set's result is checked against the scalar kernels.
+
+#define BATCH 1024
+#define TEXT_STRIDE 24
+
+typedef enum { K_EQ, K_LT, K_BETWEEN, K_IN4, K_IN16, K_PREFIX, K_TEXT_EQ } KernelCase;
+
+typedef struct {
+  int32_t* ints;
+  uint8_t* text;
+  uint32_t* off;
+  uint32_t* len;
+  uint32_t* pid;
+  int n;
+} Column;
+
+// Ints are uniform in [0, 1000). Strings are "k" followed by a number in
+// [0, 1000) and padding, so a prefix or value picks a known fraction.
+static Column make_column(int n) {
+  Column c = { .n = n };
+  c.ints = malloc(sizeof(int32_t) * (size_t)n);
+  c.text = calloc((size_t)n * TEXT_STRIDE + KERNEL_TEXT_PAD, 1);
+  c.off = malloc(sizeof(uint32_t) * (size_t)n);
+  c.len = malloc(sizeof(uint32_t) * (size_t)n);
+  c.pid = malloc(sizeof(uint32_t) * (size_t)n);
+  srand(42);
+  for (int i = 0; i < n; i++) {
+    c.ints[i] = rand() % 1000;
+    // Offsets restart every batch, as in a ColumnVector.
+    c.off[i] = (uint32_t)(i % BATCH) * TEXT_STRIDE;
+    uint8_t* s = c.text + (size_t)(i / BATCH) * BATCH * TEXT_STRIDE + c.off[i];
+    c.len[i] = (uint32_t)snprintf((char*)s, TEXT_STRIDE, "k%03d-some-padding", rand() % 1000);
+    c.pid[i] = INVALID_PID;
+  }
+  return c;
+}
+
+// Runs one kernel over the column; returns the number of rows selected.
+static long run(const Kernels* k, KernelCase kc, const Column* c, int sel_pct,
+                uint64_t* masks) {
+  int32_t list[16];
+  int nlist = kc == K_IN4 ? 4 : 16;
+  // IN lists spread sel_pct% of the domain over nlist values by matching
+  // the rows whose value is one of nlist ranges' starts; for small lists
+  // that caps the selectivity at nlist / 1000.
+  for (int i = 0; i < nlist; i++) list[i] = i * (1000 / nlist);
+
+  // "k" matches every string, "k0" a tenth and "k00" a hundredth.
+  const char* pat = sel_pct >= 100 ? "k" : sel_pct >= 10 ? "k0" : "k00";
+  uint32_t plen = (uint32_t)strlen(pat);
+  char exact[TEXT_STRIDE];
+  uint32_t elen = (uint32_t)snprintf(exact, sizeof(exact), "k%03d-some-padding", 7);
+
+  uint16_t sel[BATCH];
+  long total = 0;
+  for (int base = 0; base < c->n; base += BATCH) {
+    int n = c->n - base < BATCH ? c->n - base : BATCH;
+    uint64_t* mask = masks + base / 64;
+    const int32_t* v = c->ints + base;
+    const uint8_t* text = c->text + (size_t)base * TEXT_STRIDE;
+    switch (kc) {
+      case K_EQ: k->i32_eq(v, n, 7, mask); break;
+      case K_LT: k->i32_range(v, n, INT32_MIN, sel_pct * 10 - 1, mask); break;
+      case K_BETWEEN: k->i32_range(v, n, 100, 100 + sel_pct * 10 - 1, mask); break;
+      case K_IN4:
+      case K_IN16: k->i32_in(v, n, list, nlist, mask); break;
+      case K_PREFIX:
+        k->text_prefix(text, c->off + base, c->len + base, c->pid + base, n,
+                       (const uint8_t*)pat, plen, false, mask);
+        break;
+      case K_TEXT_EQ:
+        k->text_prefix(text, c->off + base, c->len + base, c->pid + base, n,
+                       (const uint8_t*)exact, elen, true, mask);
+        break;
+    }
+    total += kernel_mask_to_sel(mask, n, sel);
+  }
+  return total;
+}
+
+int main(int argc, char** argv) {
+  int n = argc > 1 ? atoi(argv[1]) : 1 << 20;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+  n -= n % 64;
+
+  static const int int_pcts[] = { 1, 10, 50, 90, 0 };
+  static const int text_pcts[] = { 1, 10, 100, 0 };
+  static const int no_pcts[] = { -1, 0 };
+  static const struct { KernelCase kc; const char* name; const int* pcts; } cases[] = {
+    { K_EQ, "int =", no_pcts },
+    { K_LT, "int <", int_pcts },
+    { K_BETWEEN, "int BETWEEN", int_pcts },
+    { K_IN4, "int IN (4 values)", no_pcts },
+    { K_IN16, "int IN (16 values)", no_pcts },
+    { K_PREFIX, "text LIKE prefix", text_pcts },
+    { K_TEXT_EQ, "text =", no_pcts },
+  };
+
+  const Kernels* isas[3];
+  int nisa = 0;
+  for (KernelIsa i = KERNEL_SCALAR; i <= KERNEL_AVX2; i++) {
+    const Kernels* k = kernels_for(i);
+    if (k) isas[nisa++] = k;
+  }
+
+  Column c = make_column(n);
+  size_t words = (size_t)n / 64;
+  uint64_t* expect = malloc(sizeof(uint64_t) * words);
+  uint64_t* got = malloc(sizeof(uint64_t) * words);
+
+  printf("%d values in batches of %d, best of %d, ns per value\n", n, BATCH, reps);
+  printf("%-22s %8s", "kernel", "selected");
+  for (int i = 0; i < nisa; i++) printf(" %10s", isas[i]->name);
+  printf(" %10s\n", "speedup");
+
+  for (size_t ci = 0; ci < sizeof(cases) / sizeof(cases[0]); ci++) {
+    for (const int* p = cases[ci].pcts; *p; p++) {
+      int pct = *p;
+      double best[3];
+      long selected = run(isas[0], cases[ci].kc, &c, pct, expect);
+
+      for (int i = 0; i < nisa; i++) {
+        best[i] = 1e30;
+        for (int r = 0; r < reps; r++) {
+          double t0 = now_sec();
+          long s = run(isas[i], cases[ci].kc, &c, pct, got);
+          double t = now_sec() - t0;
+          if (t < best[i]) best[i] = t;
+          if (s != selected || memcmp(got, expect, sizeof(uint64_t) * words) != 0) {
+            printf("%s: %s differs from scalar\n", cases[ci].name, isas[i]->name);
+            return 1;
+          }
+        }
+      }
+
+      char label[64];
+      if (pct > 0) snprintf(label, sizeof(label), "%s %d%%", cases[ci].name, pct);
+      else snprintf(label, sizeof(label), "%s", cases[ci].name);
+      printf("%-22s %7.1f%%", label, 100.0 * (double)selected / n);
+      for (int i = 0; i < nisa; i++) printf(" %10.2f", best[i] * 1e9 / n);
+      printf(" %9.1fx\n", best[0] / best[nisa - 1]);
+    }
+  }
+
+  free(expect);
+  free(got);
+  free(c.ints);
+  free(c.text);
+  free(c.off);
+  free(c.len);
+  free(c.pid);
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include "bench.h"
+#include "marqdb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Cost per statement of point lookups and inserts run through the library
+// three ways: as text parsed and planned every time, as text served by the
+// plan cache, and as a statement prepared once and re-bound for each run.
+// The lookups go through an index, so parsing and planning are a large
+// part of the text path's cost.
+
+#define BENCH_PATH "prepared_bench.db"
+
+static int fail(Mdb* db) {
+  printf("%s\n", mdb_errmsg(db));
+  return 1;
+}
+
+// Looks up n keys by sending the statement text each time. Returns the sum
+// of the values found, or -1 on failure.
+static long long lookup_text(Mdb* db, int nrows, int n) {
+  long long sum = 0;
+  char sql[96];
+  for (int i = 0; i < n; i++) {
+    snprintf(sql, sizeof(sql), "SELECT v FROM t WHERE id = %d", (i * 7919) % nrows);
+    MdbStmt* s;
+    if (mdb_prepare(db, sql, &s) != MDB_OK) return -1;
+    while (mdb_step(s) == MDB_ROW) sum += mdb_column_int(s, 0);
+    mdb_finalize(s);
+  }
+  return sum;
+}
+
+// Looks up n keys with placeholder text, prepared for each lookup.
+static long long lookup_cached(Mdb* db, int nrows, int n) {
+  long long sum = 0;
+  for (int i = 0; i < n; i++) {
+    MdbStmt* s;
+    if (mdb_prepare(db, "SELECT v FROM t WHERE id = ?", &s) != MDB_OK) return -1;
+    mdb_bind_int(s, 1, (i * 7919) % nrows);
+    while (mdb_step(s) == MDB_ROW) sum += mdb_column_int(s, 0);
+    mdb_finalize(s);
+  }
+  return sum;
+}
+
+// Looks up n keys with one prepared statement.
+static long long lookup_prepared(Mdb* db, int nrows, int n) {
+  long long sum = 0;
+  MdbStmt* s;
+  if (mdb_prepare(db, "SELECT v FROM t WHERE id = ?", &s) != MDB_OK) return -1;
+  for (int i = 0; i < n; i++) {
+    mdb_bind_int(s, 1, (i * 7919) % nrows);
+    while (mdb_step(s) == MDB_ROW) sum += mdb_column_int(s, 0);
+  }
+  mdb_finalize(s);
+  return sum;
+}
+
+static int insert_text(Mdb* db, int first, int n) {
+  char sql[96];
+  for (int i = first; i < first + n; i++) {
+    snprintf(sql, sizeof(sql), "INSERT INTO u VALUES (%d, 'row-%d')", i, i);
+    if (mdb_exec(db, sql) != MDB_OK) return -1;
+  }
+  return 0;
+}
+
+static int insert_prepared(Mdb* db, int first, int n) {
+  MdbStmt* s;
+  if (mdb_prepare(db, "INSERT INTO u VALUES (?, ?)", &s) != MDB_OK) return -1;
+  char name[32];
+  for (int i = first; i < first + n; i++) {
+    mdb_bind_int(s, 1, i);
+    int len = snprintf(name, sizeof(name), "row-%d", i);
+    mdb_bind_text(s, 2, name, len);
+    if (mdb_step(s) != MDB_DONE) return -1;
+  }
+  mdb_finalize(s);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 100000;
+  int n = argc > 2 ? atoi(argv[2]) : 100000;
+
+  unlink(BENCH_PATH);
+  unlink(BENCH_PATH ".wal");
+  Mdb* db;
+  if (mdb_open(BENCH_PATH, &db) != MDB_OK) return 1;
+
+  if (mdb_exec(db, "CREATE TABLE t (id INT, v INT)") != MDB_OK) return fail(db);
+  if (mdb_exec(db, "CREATE TABLE u (id INT, name TEXT)") != MDB_OK) return fail(db);
+  MdbStmt* ins;
+  if (mdb_prepare(db, "INSERT INTO t VALUES (?, ?)", &ins) != MDB_OK) return fail(db);
+  for (int i = 0; i < nrows; i++) {
+    mdb_bind_int(ins, 1, i);
+    mdb_bind_int(ins, 2, i % 1000);
+    if (mdb_step(ins) != MDB_DONE) return fail(db);
+  }
+  mdb_finalize(ins);
+  if (mdb_exec(db, "CREATE INDEX t_id ON t (id)") != MDB_OK) return fail(db);
+
+  printf("\n%d rows, %d statements per run, us per statement\n", nrows, n);
+  printf("%-24s %10s %10s %10s\n", "statement", "text", "cached", "prepared");
+
+  double t0 = now_sec();
+  mdb_set_cache_size(db, 0);
+  long long a = lookup_text(db, nrows, n);
+  double t1 = now_sec();
+  mdb_set_cache_size(db, MDB_PLAN_CACHE_DEFAULT);
+  long long b = lookup_cached(db, nrows, n);
+  double t2 = now_sec();
+  long long c = lookup_prepared(db, nrows, n);
+  double t3 = now_sec();
+  if (a < 0 || b < 0 || c < 0) return fail(db);
+  if (a != b || a != c) {
+    printf("lookups differ: %lld %lld %lld\n", a, b, c);
+    return 1;
+  }
+  printf("%-24s %10.2f %10.2f %10.2f\n", "point lookup", (t1 - t0) * 1e6 / n,
+         (t2 - t1) * 1e6 / n, (t3 - t2) * 1e6 / n);
+
+  t0 = now_sec();
+  mdb_set_cache_size(db, 0);
+  if (insert_text(db, 0, n) < 0) return fail(db);
+  t1 = now_sec();
+  mdb_set_cache_size(db, MDB_PLAN_CACHE_DEFAULT);
+  if (insert_prepared(db, n, n) < 0) return fail(db);
+  t2 = now_sec();
+  printf("%-24s %10.2f %10s %10.2f\n", "insert", (t1 - t0) * 1e6 / n, "-",
+         (t2 - t1) * 1e6 / n);
+
+  MdbCacheStats cs;
+  mdb_cache_stats(db, &cs);
+  printf("plan cache: %llu hits, %llu misses, %d entries\n", (unsigned long long)cs.hits,
+         (unsigned long long)cs.misses, cs.entries);
+
+  mdb_close(db);
+  unlink(BENCH_PATH);
+  unlink(BENCH_PATH ".wal");
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Time to read a cached 16-column table through a cursor, selecting all
+// columns or only a few. Scans decode only the columns a query names, and
+// each is found from its offset in the row, so the last INT column costs
+// no more than the first.
+
+#define BENCH_PATH "project_bench.db"
+#define POOL_FRAMES 65536
+#define NCOLS 16
+
+typedef struct {
+  const char* name;
+  const char* sql;
+} Query;
+
+static const Query QUERIES[] = {
+  { "all columns", "SELECT * FROM t" },
+  { "first column", "SELECT c0 FROM t" },
+  { "last column", "SELECT c14 FROM t" },
+  { "two, filtered", "SELECT c0, c3 FROM t WHERE c2 < 100" },
+  { "sum", "SELECT sum(c2) FROM t" },
+  { "count(*)", "SELECT count(*) FROM t" },
+};
+
+// Even columns are INT and odd ones TEXT of about 20 bytes.
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  for (int c = 0; c < NCOLS; c++) {
+    if (c % 2 == 0) snprintf(vals[c], BENCH_VALUE_LEN, "%d", rand() % 1000);
+    else snprintf(vals[c], BENCH_VALUE_LEN, "value-%d-of-column-%d", i, c);
+    out[c] = vals[c];
+  }
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 500000;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  ColumnDef cols[NCOLS];
+  for (int c = 0; c < NCOLS; c++) {
+    memset(&cols[c], 0, sizeof(cols[c]));
+    snprintf(cols[c].col, sizeof(cols[c].col), "c%d", c);
+    cols[c].type = c % 2 == 0 ? COL_INT : COL_TEXT;
+  }
+  srand(5);
+  bench_load(bp, &cat, "t", cols, NCOLS, nrows, fill);
+
+  // Warms the pool and the allocator before anything is timed.
+  if (bench_fetch_all(bp, &cat, "SELECT * FROM t") < 0) return 1;
+
+  printf("%d rows of %d columns, best of %d runs\n", nrows, NCOLS, reps);
+  printf("%-14s %-40s %9s %11s\n", "query", "sql", "rows", "ms");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* qq = &QUERIES[q];
+    double best = 0;
+    long rows = 0;
+    for (int i = 0; i < reps; i++) {
+      double t0 = now_sec();
+      rows = bench_fetch_all(bp, &cat, qq->sql);
+      if (rows < 0) return 1;
+      double secs = now_sec() - t0;
+      if (i == 0 || secs < best) best = secs;
+    }
+    printf("%-14s %-40s %9ld %11.2f\n", qq->name, qq->sql, rows, best * 1e3);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "catalog.h"
+#include "heap.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Effect of sequential scans on the buffer pool: how much of a hot working
+// set survives one scan of a table much larger than the pool, with the plain
+// heap_scan_next path versus a HeapScan's BufferRing, and how long a scan
+// takes from a cold OS cache with and without read-ahead. The scanned table
+// is loaded together with a second one, so its page chain is made of runs
+// interleaved with the other table's; the jumps between runs are what the
+// kernel's sequential read-ahead does not follow.
+
+#define BENCH_PATH "scan_bench.db"
+#define POOL_FRAMES 256
+#define HOT_PAGES 128
+#define ROW_LEN 200
+
+// Inserts rows round-robin into the heaps until the first has npages pages.
+static void fill(BufferPool* bp, HeapFile* hfs, int nheaps, int npages) {
+  uint8_t row[ROW_LEN];
+  memset(row, 'x', sizeof(row));
+  uint32_t last = INVALID_PID;
+  int pages = 0;
+  while (pages <= npages) {
+    RID rid = heap_insert(bp, &hfs[0], row, sizeof(row));
+    if (rid.page_id == INVALID_PID) return;
+    if (rid.page_id != last) {
+      last = rid.page_id;
+      pages++;
+    }
+    for (int i = 1; i < nheaps; i++) heap_insert(bp, &hfs[i], row, sizeof(row));
+  }
+}
+
+// Fetches every page of the heap once, as a point-lookup workload would.
+static void touch_all(BufferPool* bp, HeapFile* hf) {
+  uint32_t pid = hf->first_data_pid;
+  while (pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+    pid = next;
+  }
+}
+
+static long scan_with_ring(BufferPool* bp, HeapFile* hf, bool read_ahead) {
+  HeapScan scan;
+  uint8_t* out;
+  uint16_t len;
+  long rows = 0;
+
+  heap_scan_begin(bp, hf, &scan);
+  scan.read_ahead = read_ahead;
+  while (heap_scan_step(bp, &scan, &out, &len)) rows++;
+  heap_scan_end(bp, &scan);
+  return rows;
+}
+
+// Hit ratio of re-touching the hot heap after one scan of the cold heap.
+static double hot_hit_ratio(BufferPool* bp, HeapFile* hot, HeapFile* cold, bool ring) {
+  touch_all(bp, hot);
+  touch_all(bp, hot);
+
+  if (ring) scan_with_ring(bp, cold, true);
+  else touch_all(bp, cold);
+
+  BufferStats before, after;
+  bp_stats(bp, &before);
+  touch_all(bp, hot);
+  bp_stats(bp, &after);
+  uint64_t h = after.hits - before.hits, m = after.misses - before.misses;
+  return h + m ? 100.0 * (double)h / (double)(h + m) : 0.0;
+}
+
+static double cold_scan_ms(BufferPool* bp, HeapFile* cold, bool read_ahead) {
+  bp_checkpoint(bp);
+  posix_fadvise(bp->dm->fd, 0, 0, POSIX_FADV_DONTNEED);
+
+  double t0 = now_sec();
+  scan_with_ring(bp, cold, read_ahead);
+  return (now_sec() - t0) * 1e3;
+}
+
+int main(int argc, char** argv) {
+  int cold_pages = argc > 1 ? atoi(argv[1]) : 8192;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+
+  uint32_t hot_h, cold_h[2];
+  HeapFile hot = heap_create(bp, &hot_h);
+  fill(bp, &hot, 1, HOT_PAGES);
+  HeapFile cold[2] = { heap_create(bp, &cold_h[0]), heap_create(bp, &cold_h[1]) };
+  fill(bp, cold, 2, cold_pages);
+  hot = heap_open(bp, hot_h);
+  HeapFile scanned = heap_open(bp, cold_h[0]);
+
+  printf("pool %d frames, hot set %d pages, scanned table %d pages\n",
+         POOL_FRAMES, HOT_PAGES, cold_pages);
+  printf("%-28s %10.1f%%\n", "hot hit ratio, shared clock", hot_hit_ratio(bp, &hot, &scanned, false));
+  printf("%-28s %10.1f%%\n", "hot hit ratio, buffer ring", hot_hit_ratio(bp, &hot, &scanned, true));
+  printf("%-28s %10.1f ms\n", "cold scan, no read-ahead", cold_scan_ms(bp, &scanned, false));
+  printf("%-28s %10.1f ms\n", "cold scan, read-ahead", cold_scan_ms(bp, &scanned, true));
+
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
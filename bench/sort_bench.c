@@ -0,0 +1,94 @@
+#include "bench.h"
+#include "sort.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Cost per input row of ORDER BY queries over a cached table, with the
+// default memory budget and with one small enough to make the full sorts
+// write and merge runs. Every key list ends in the unique id, so the order
+// is total and each query's output is checked to be the same under both
+// budgets. The LIMIT queries keep a bounded heap instead of sorting.
+
+#define BENCH_PATH "sort_bench.db"
+#define POOL_FRAMES 65536
+#define SMALL_WORK_MEM (256u << 10)
+
+static const char* QUERIES[] = {
+  "SELECT id, a FROM t ORDER BY a, id",
+  "SELECT id, a FROM t ORDER BY a DESC, id",
+  "SELECT id, s FROM t ORDER BY s, id",
+  "SELECT id FROM t ORDER BY a, id LIMIT 10",
+  "SELECT id, s FROM t ORDER BY s DESC, id LIMIT 100",
+  "SELECT id FROM t ORDER BY a, id LIMIT 10000",
+};
+
+static const ColumnDef COLS[3] = {
+  { .col = "id", .type = COL_INT },
+  { .col = "a", .type = COL_INT },
+  { .col = "s", .type = COL_TEXT },
+};
+
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 100000);
+  snprintf(vals[2], BENCH_VALUE_LEN, "key-%d", rand() % 100000);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+}
+
+// Stats of the Sort below the projection and limit.
+static void sort_stats(const Operator* plan, void* arg) {
+  while (plan && strncmp(plan->label, "Sort", 4) != 0) plan = plan->child;
+  exec_sort_stats(plan, arg);
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 1000000;
+  int reps = argc > 2 ? atoi(argv[2]) : 3;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  srand(7);
+  bench_load(bp, &cat, "t", COLS, 3, nrows, fill);
+
+  printf("%d rows, best of %d, ns per input row; small budget %u KB\n", nrows, reps,
+         SMALL_WORK_MEM >> 10);
+  printf("%-50s %8s %9s %6s %9s %6s %6s\n", "query", "rows", "default", "runs", "small", "runs",
+         "merges");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    double best[2] = { 1e30, 1e30 };
+    uint64_t sums[2];
+    long rows[2];
+    SortStats st[2];
+
+    for (int m = 0; m < 2; m++) {
+      for (int r = 0; r < reps; r++) {
+        double secs;
+        rows[m] = bench_run(bp, &cat, QUERIES[q], m ? SMALL_WORK_MEM : 0, true, &secs,
+                            &sums[m], sort_stats, &st[m]);
+        if (rows[m] < 0) return 1;
+        if (secs < best[m]) best[m] = secs;
+      }
+    }
+    if (rows[0] != rows[1] || sums[0] != sums[1]) {
+      printf("%s: results differ between budgets\n", QUERIES[q]);
+      return 1;
+    }
+
+    char runs[2][16];
+    for (int m = 0; m < 2; m++) {
+      if (st[m].top_n) snprintf(runs[m], sizeof(runs[m]), "top-n");
+      else snprintf(runs[m], sizeof(runs[m]), "%u", st[m].runs);
+    }
+    printf("%-50s %8ld %9.1f %6s %9.1f %6s %6u\n", QUERIES[q], rows[0], best[0] * 1e9 / nrows,
+           runs[0], best[1] * 1e9 / nrows, runs[1], st[1].merge_passes);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
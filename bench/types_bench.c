@@ -0,0 +1,102 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Size of rows and time of cached queries for the same data stored twice:
+// once in native BIGINT, DOUBLE, BOOL, TIMESTAMP and CHAR columns, once
+// with every column TEXT. Native values are fixed-width and compared as
+// numbers, where TEXT ones are compared byte by byte.
+
+#define BENCH_PATH "types_bench.db"
+#define POOL_FRAMES 65536
+#define NCOLS 6
+
+typedef struct {
+  const char* name;
+  const char* sql; ///< Format with the table name
+} Query;
+
+static const Query QUERIES[] = {
+  { "time range", "SELECT count(*) FROM %s WHERE ts >= '2024-12-01 00:00:00'" },
+  { "bool equal", "SELECT count(*) FROM %s WHERE flag = 'true'" },
+  { "code equal", "SELECT count(*) FROM %s WHERE code = 'k07'" },
+  { "top 10 by time", "SELECT id FROM %s ORDER BY ts LIMIT 10" },
+  { "group by code", "SELECT code, count(*) FROM %s GROUP BY code" },
+};
+
+static const char* NAMES[NCOLS] = { "id", "ts", "amount", "qty", "flag", "code" };
+static const ColumnType NATIVE[NCOLS] = { COL_BIGINT, COL_TIMESTAMP, COL_DOUBLE,
+                                          COL_BIGINT, COL_BOOL, COL_CHAR };
+
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "2024-%02d-%02d %02d:%02d:%02d", 1 + rand() % 12,
+           1 + rand() % 28, rand() % 24, rand() % 60, rand() % 60);
+  snprintf(vals[2], BENCH_VALUE_LEN, "%d.%02d", rand() % 100000, rand() % 100);
+  snprintf(vals[3], BENCH_VALUE_LEN, "%d", rand() % 1000000);
+  snprintf(vals[4], BENCH_VALUE_LEN, "%s", rand() % 2 ? "true" : "false");
+  snprintf(vals[5], BENCH_VALUE_LEN, "k%02d", rand() % 50);
+  for (int c = 0; c < NCOLS; c++) out[c] = vals[c];
+}
+
+// Loads nrows rows into a new table and returns their average size in bytes.
+static double load(BufferPool* bp, Catalog* cat, const char* name, bool native, int nrows) {
+  ColumnDef cols[NCOLS];
+  for (int c = 0; c < NCOLS; c++) {
+    memset(&cols[c], 0, sizeof(cols[c]));
+    snprintf(cols[c].col, sizeof(cols[c].col), "%s", NAMES[c]);
+    cols[c].type = native ? NATIVE[c] : COL_TEXT;
+    if (cols[c].type == COL_CHAR) cols[c].len = 3;
+  }
+  srand(7);
+  return bench_load(bp, cat, name, cols, NCOLS, nrows, fill);
+}
+
+// Best time of reps runs in milliseconds, or -1 on failure.
+static double best_ms(BufferPool* bp, Catalog* cat, const char* sql, int reps) {
+  double best = 0;
+  for (int i = 0; i < reps; i++) {
+    double t0 = now_sec();
+    if (bench_fetch_all(bp, cat, sql) < 0) return -1;
+    double secs = now_sec() - t0;
+    if (i == 0 || secs < best) best = secs;
+  }
+  return best * 1e3;
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 500000;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  double native_bytes = load(bp, &cat, "native", true, nrows);
+  double text_bytes = load(bp, &cat, "text", false, nrows);
+
+  // Warms the pool and the allocator before anything is timed.
+  if (bench_fetch_all(bp, &cat, "SELECT * FROM native") < 0 || bench_fetch_all(bp, &cat, "SELECT * FROM text") < 0) {
+    return 1;
+  }
+
+  printf("%d rows, best of %d runs\n", nrows, reps);
+  printf("row bytes: native %.1f, text %.1f\n", native_bytes, text_bytes);
+  printf("%-16s %11s %11s\n", "query", "native ms", "text ms");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    char sql[256];
+    snprintf(sql, sizeof(sql), QUERIES[q].sql, "native");
+    double native_ms = best_ms(bp, &cat, sql, reps);
+    snprintf(sql, sizeof(sql), QUERIES[q].sql, "text");
+    double text_ms = best_ms(bp, &cat, sql, reps);
+    if (native_ms < 0 || text_ms < 0) return 1;
+    printf("%-16s %11.2f %11.2f\n", QUERIES[q].name, native_ms, text_ms);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include "bench.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+// Cost per row of a filtered scan over a cached table, three ways: decoding
+// each row into a tuple and evaluating the predicate on it, as a
+// row-at-a-time executor does; the vectorized pipeline read a row at a time
+// through next; and the vectorized pipeline read a batch at a time, which
+// is how aggregates consume it.
+
+#define BENCH_PATH "vector_bench.db"
+#define POOL_FRAMES 65536
+
+static const char* QUERIES[] = {
+  "SELECT * FROM t WHERE a < 500",
+  "SELECT * FROM t WHERE a >= 100 AND b < 900",
+  "SELECT * FROM t WHERE a < 10 OR NOT b <> 7",
+};
+
+static const ColumnDef COLS[4] = {
+  { .col = "id", .type = COL_INT },
+  { .col = "a", .type = COL_INT },
+  { .col = "b", .type = COL_INT },
+  { .col = "s", .type = COL_TEXT },
+};
+
+static void fill(int i, char vals[][BENCH_VALUE_LEN], const char** out) {
+  snprintf(vals[0], BENCH_VALUE_LEN, "%d", i);
+  snprintf(vals[1], BENCH_VALUE_LEN, "%d", rand() % 1000);
+  snprintf(vals[2], BENCH_VALUE_LEN, "%d", rand() % 1000);
+  snprintf(vals[3], BENCH_VALUE_LEN, "some text");
+  for (int c = 0; c < 4; c++) out[c] = vals[c];
+}
+
+// Decodes every row into a tuple and evaluates the predicate on it.
+static long run_tuples(ExecCtx* ctx, TableInfo* t, const Expr* where) {
+  HeapScan scan;
+  uint8_t* row;
+  uint16_t len;
+  Tuple tup;
+  long n = 0;
+
+  heap_scan_begin(ctx->bp, &t->hf, &scan);
+  while (heap_scan_step(ctx->bp, &scan, &row, &len)) {
+    row_get_fields(t->cols, t->ncols, row, len, tup.vals);
+    tup.ncols = t->ncols;
+    if (exec_eval(ctx, where, &tup) == 1) n++;
+  }
+  heap_scan_end(ctx->bp, &scan);
+  return n;
+}
+
+static long run_rows(Operator* plan) {
+  Tuple tup;
+  long n = 0;
+  plan->open(plan);
+  while (plan->next(plan, &tup) > 0) n++;
+  plan->close(plan);
+  return n;
+}
+
+static long run_batches(Operator* plan) {
+  Batch b;
+  long n = 0;
+  plan->open(plan);
+  while (plan->next_batch(plan, &b) > 0) n += b.nsel;
+  plan->close(plan);
+  return n;
+}
+
+int main(int argc, char** argv) {
+  int nrows = argc > 1 ? atoi(argv[1]) : 1000000;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+
+  unlink(BENCH_PATH);
+  DiskManager* dm = disk_open(BENCH_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  srand(11);
+  bench_load(bp, &cat, "t", COLS, 4, nrows, fill);
+
+  printf("%d rows, best of %d\n", nrows, reps);
+  printf("%-44s %10s %12s %12s %12s\n", "query", "matches", "tuple ns/row",
+         "next ns/row", "batch ns/row");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    double best[3] = { 1e30, 1e30, 1e30 };
+    long matches = 0;
+
+    for (int r = 0; r < reps; r++) {
+      Arena arena;
+      arena_init(&arena);
+      ExecCtx ctx = { .bp = bp, .cat = &cat, .arena = &arena };
+      Stmt* st = parse_statement(&arena, QUERIES[q], ctx.err, sizeof(ctx.err));
+      Operator* plan = st ? plan_select(&ctx, &st->select) : NULL;
+      if (!plan) {
+        printf("%s\n", ctx.err);
+        return 1;
+      }
+      TableInfo* t = plan_open_table(&ctx, "t");
+
+      double t0 = now_sec();
+      matches = run_tuples(&ctx, t, st->select.where);
+      double t1 = now_sec();
+      long rows = run_rows(plan);
+      double t2 = now_sec();
+      long batched = run_batches(plan);
+      double t3 = now_sec();
+      if (rows != matches || batched != matches) {
+        printf("mismatch: %ld %ld %ld\n", matches, rows, batched);
+        return 1;
+      }
+
+      double times[3] = { t1 - t0, t2 - t1, t3 - t2 };
+      for (int k = 0; k < 3; k++) {
+        if (times[k] < best[k]) best[k] = times[k];
+      }
+      arena_free(&arena);
+    }
+
+    printf("%-44s %10ld %12.1f %12.1f %12.1f\n", QUERIES[q], matches,
+           best[0] * 1e9 / nrows, best[1] * 1e9 / nrows, best[2] * 1e9 / nrows);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(BENCH_PATH);
+  return 0;
+}
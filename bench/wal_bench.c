@@ -0,0 +1,72 @@
+#include "bench.h"
+#include "wal.h"
+#include "page.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Commit throughput of the log manager: concurrent committers sharing
+// fsyncs through group commit, and a single committer batching back-to-back
+// commits with group_commit_size > 1.
+
+#define BENCH_PATH "wal_bench.wal"
+
+typedef struct {
+  LogManager* lm;
+  int commits;
+} Worker;
+
+static void* run_worker(void* arg) {
+  Worker* w = arg;
+  Page before, after;
+  memset(&before, 0, sizeof(before));
+  memset(&after, 0, sizeof(after));
+  WalRange range = { .offset = 64, .len = 100 };
+
+  for (int i = 0; i < w->commits; i++) {
+    after.data[100] = (uint8_t)i;
+    wal_begin(w->lm);
+    wal_log_update(w->lm, 1, (const uint8_t*)&before, (const uint8_t*)&after, &range, 1);
+    wal_commit(w->lm);
+  }
+  return NULL;
+}
+
+static void run(int threads, int group, int commits_per_thread) {
+  unlink(BENCH_PATH);
+  LogManager* lm = wal_open(BENCH_PATH);
+  lm->group_commit_size = group;
+
+  pthread_t tids[64];
+  Worker w = { .lm = lm, .commits = commits_per_thread };
+
+  double t0 = now_sec();
+  for (int i = 0; i < threads; i++) pthread_create(&tids[i], NULL, run_worker, &w);
+  for (int i = 0; i < threads; i++) pthread_join(tids[i], NULL);
+  wal_flush(lm, lm->next_lsn - 1);
+  double secs = now_sec() - t0;
+
+  printf("%8d %8d %10llu %10llu %12.0f %14.1f\n", threads, group,
+         (unsigned long long)lm->commits, (unsigned long long)lm->fsyncs,
+         lm->commits / secs, (double)lm->commits / (double)lm->fsyncs);
+  wal_close(lm);
+}
+
+int main(int argc, char** argv) {
+  int commits = argc > 1 ? atoi(argv[1]) : 500;
+
+  printf("%8s %8s %10s %10s %12s %14s\n",
+         "threads", "group", "commits", "fsyncs", "commits/s", "commits/fsync");
+  static const int threads[] = { 1, 2, 4, 8, 16 };
+  for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+    run(threads[i], 1, commits);
+  }
+  static const int groups[] = { 8, 64 };
+  for (size_t i = 0; i < sizeof(groups) / sizeof(groups[0]); i++) {
+    run(1, groups[i], commits * 8);
+  }
+
+  unlink(BENCH_PATH);
+  return 0;
+}
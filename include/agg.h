@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include "exec.h"
+#include "parser.h"
+
+/**
+ * @brief One aggregate computed by a HashAgg operator.
+ */
+typedef struct {
+  AggFunc func; ///< Aggregate function
+  int col; ///< Input column of the argument, or -1 for COUNT(*)
+  char name[COL_NAME_MAX]; ///< Output column name
+} AggSpec;
+
+/**
+ * @brief Counters of a HashAgg operator's last run.
+ */
+typedef struct {
+  uint64_t groups; ///< Groups emitted
+  uint64_t spilled_rows; ///< Rows written to partition files, counted once per level
+  uint32_t partitions; ///< Partition files aggregated after the input
+} HashAggStats;
+
+/**
+ * @brief Groups rows by key columns and computes aggregates per group.
+ *
+ * Output rows are the key columns followed by the aggregates, in no
+ * particular order. Without keys there is exactly one output row, even
+ * for empty input. NULL keys form a group of their own.
+ *
+ * COUNT is INT. SUM and AVG take INT, BIGINT or DOUBLE; SUM returns the
+ * type of its argument, and a result outside its range is an error. AVG
+ * returns DOUBLE, so the mean of INT values keeps its fraction. MIN and MAX
+ * keep the type of their argument. All but COUNT are NULL for a group
+ * without a non-NULL argument.
+ *
+ * Groups live in an open-addressing hash table; a single INT key gets a
+ * table that compares keys in the slots themselves. Input is consumed a
+ * batch at a time, hashing and probing every row before each aggregate is
+ * updated in one loop. Once the groups fill ctx->work_mem, rows of groups
+ * not yet in the table are written to temporary partition files by hash,
+ * and each partition is aggregated in turn after the table is emitted.
+ *
+ * @param ctx Statement state
+ * @param child Input operator
+ * @param keys Input columns of the group key
+ * @param nkeys Number of key columns, 0 for a single group
+ * @param aggs Aggregates to compute
+ * @param naggs Number of aggregates
+ */
+Operator* exec_hash_agg(ExecCtx* ctx, Operator* child, const int* keys, int nkeys,
+                        const AggSpec* aggs, int naggs);
+
+/**
+ * @brief Reads the counters of a HashAgg operator.
+ */
+void exec_hash_agg_stats(const Operator* op, HashAggStats* out);
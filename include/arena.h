@@ -0,0 +1,41 @@
+#pragma once
+#include <stddef.h>
+
+typedef struct ArenaChunk ArenaChunk;
+
+/**
+ * @brief Bump allocator for memory that lives as long as one statement.
+ *
+ * The AST, the plan and the operators' state are allocated from one arena
+ * and released together with arena_free, so none of them needs its own
+ * destructor.
+ */
+typedef struct {
+  ArenaChunk* head; ///< Chunk currently being filled
+} Arena;
+
+/**
+ * @brief Initializes an empty arena.
+ */
+void arena_init(Arena* a);
+
+/**
+ * @brief Allocates zeroed memory aligned for any type.
+ *
+ * @param a Arena to allocate from
+ * @param n Number of bytes
+ * @return void* The memory, or NULL if out of memory
+ */
+void* arena_alloc(Arena* a, size_t n);
+
+/**
+ * @brief Copies n bytes of a string into the arena and NUL-terminates it.
+ */
+char* arena_strndup(Arena* a, const char* s, size_t n);
+
+/**
+ * @brief Releases everything allocated from the arena.
+ *
+ * The arena is left empty and can be reused.
+ */
+void arena_free(Arena* a);
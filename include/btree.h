@@ -0,0 +1,138 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffer.h"
+#include "catalog.h"
+#include "heap.h"
+#include "freelist.h"
+
+/**
+ * @brief Maximum number of TEXT key bytes stored in the tree.
+ *
+ * Longer values are indexed by their prefix, so lookups on TEXT keys may
+ * return extra candidates that the caller must recheck against the row.
+ */
+#define BTREE_TEXT_KEY_MAX 63
+
+/**
+ * @brief Size of the buffer needed to hold any encoded key.
+ */
+#define BTREE_KEY_MAX (BTREE_TEXT_KEY_MAX + 1)
+
+/**
+ * @brief Handle to a page-based B+ tree secondary index.
+ *
+ * The tree maps (key, RID) pairs to nothing: the RID is part of the key, so
+ * duplicate column values are ordered by RID and every entry is unique.
+ * Leaves are chained left to right for range scans. A meta page holds the
+ * current root so that root splits never touch the catalog.
+ */
+typedef struct {
+  uint32_t meta_pid; ///< Page ID of the tree's meta page
+  uint32_t root_pid; ///< Page ID of the current root node
+  ColumnType key_type; ///< Type of the indexed column
+  uint16_t key_size; ///< Encoded key width in bytes
+  PageRun run; ///< Pages reserved for new nodes
+} BTree;
+
+/**
+ * @brief Position of a range scan inside the leaf level.
+ */
+typedef struct {
+  uint32_t leaf_pid; ///< Current leaf, or INVALID_PID when exhausted
+  int idx; ///< Index of the next entry within the leaf
+  bool has_hi; ///< Whether the scan has an upper bound
+  uint8_t hi[BTREE_KEY_MAX]; ///< Inclusive upper bound on the key
+} BTreeCursor;
+
+/**
+ * @brief Creates an empty B+ tree for keys of the given column type.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param key_type Type of the indexed column
+ * @return uint32_t Page ID of the new tree's meta page
+ */
+uint32_t btree_create(BufferPool* bp, ColumnType key_type);
+
+/**
+ * @brief Opens an existing B+ tree from its meta page.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param meta_pid Page ID of the meta page
+ * @return BTree Handle to the tree
+ */
+BTree btree_open(BufferPool* bp, uint32_t meta_pid);
+
+/**
+ * @brief Empties the tree by installing a fresh root leaf.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bt Tree to reset
+ */
+void btree_reset(BufferPool* bp, BTree* bt);
+
+/**
+ * @brief Encodes a key of a tree on INT or BOOL.
+ */
+void btree_key_int(const BTree* bt, int32_t v, uint8_t* out);
+
+/**
+ * @brief Encodes a key of a tree on BIGINT or TIMESTAMP.
+ */
+void btree_key_i64(const BTree* bt, int64_t v, uint8_t* out);
+
+/**
+ * @brief Encodes a key of a tree on DOUBLE.
+ */
+void btree_key_f64(const BTree* bt, double v, uint8_t* out);
+
+/**
+ * @brief Encodes a TEXT or CHAR key, truncating it to BTREE_TEXT_KEY_MAX bytes.
+ */
+void btree_key_text(const BTree* bt, const char* s, uint32_t len, uint8_t* out);
+
+/**
+ * @brief Inserts a (key, RID) entry, splitting nodes as needed.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bt Tree to insert into
+ * @param key Encoded key
+ * @param rid Row identifier stored with the key
+ */
+void btree_insert(BufferPool* bp, BTree* bt, const uint8_t* key, RID rid);
+
+/**
+ * @brief Removes a (key, RID) entry if present.
+ *
+ * Leaves are allowed to become underfull; they are not merged.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bt Tree to delete from
+ * @param key Encoded key
+ * @param rid Row identifier stored with the key
+ * @return true if the entry was found and removed
+ */
+bool btree_delete(BufferPool* bp, BTree* bt, const uint8_t* key, RID rid);
+
+/**
+ * @brief Positions a cursor for a range scan over [lo, hi].
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bt Tree to scan
+ * @param lo Inclusive lower bound, or NULL to start at the smallest key
+ * @param hi Inclusive upper bound, or NULL for no upper bound
+ * @param cur Cursor to initialize
+ */
+void btree_seek(BufferPool* bp, const BTree* bt, const uint8_t* lo, const uint8_t* hi,
+                BTreeCursor* cur);
+
+/**
+ * @brief Returns the next RID in the cursor's range.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bt Tree being scanned
+ * @param cur Cursor positioned by btree_seek
+ * @param out_rid Output parameter for the RID of the entry
+ * @return true if an entry was produced, false when the range is exhausted
+ */
+bool btree_next(BufferPool* bp, const BTree* bt, BTreeCursor* cur, RID* out_rid);
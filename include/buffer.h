@@ -1,37 +1,132 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <pthread.h>
 #include "disk.h"
 #include "page.h"
+#include "wal.h"
+
+/**
+ * @brief Page latch modes for bp_fetch_page
+ */
+typedef enum {
+  LATCH_SHARED, ///< Read access; any number of threads may hold it at once
+  LATCH_EXCLUSIVE ///< Write access; excludes every other holder
+} LatchMode;
 
 /**
  * @brief Buffer frame structure representing a single page in the buffer pool
  * 
  * Each BufferFrame holds metadata about the page it contains, including its
  * page ID, validity, dirty status, pin count, and reference bit for replacement
- * policies. The actual page data is stored in the 'page' member.
+ * policies. The page data itself lives in a separate array so that the clock
+ * sweep only touches compact frame metadata.
+ *
+ * The pin count and flags are atomics so that hits and the clock sweep need
+ * no lock on the frame. The latch protects the page contents and is held by
+ * whoever has the page pinned, in the mode it was fetched with.
  */
 typedef struct {
   uint32_t page_id; ///< Unique identifier of the page stored in this frame
   bool is_valid; ///< Indicates if the frame contains a valid page
-  bool is_dirty; ///< Indicates if the page has been modified
-  int pin_count; ///< Number of active pins on the page
-  bool refbit; ///< Reference bit used for the clock replacement policy
-  Page page; ///< The actual page data stored in this frame
+  _Atomic bool is_dirty; ///< Indicates if the page has been modified
+  _Atomic int pin_count; ///< Number of active pins on the page
+  _Atomic bool refbit; ///< Reference bit used for the clock replacement policy
+  pthread_rwlock_t latch; ///< Reader/writer latch on the page contents
+  Page* page; ///< The page data stored in this frame
 } BufferFrame;
 
+/**
+ * @brief Page table mapping resident page IDs to frame indices
+ * 
+ * Open-addressing hash table with linear probing and backward-shift deletion
+ * (no tombstones). It doubles whenever its load factor would pass 0.5, so
+ * lookups stay O(1).
+ */
+typedef struct {
+  uint32_t* keys; ///< Page IDs per slot, 0xFFFFFFFF marks an empty slot
+  int* vals; ///< Frame index per slot
+  uint32_t mask; ///< Number of slots minus one
+  uint32_t count; ///< Number of occupied slots
+} PageTable;
+
+/**
+ * @brief Maximum number of page table partitions.
+ */
+#define BP_MAX_PARTITIONS 64
+
+/**
+ * @brief One shard of the page table.
+ * 
+ * A page ID always hashes to the same partition. The partition lock is held
+ * only to look up, pin, insert or remove mappings, never across disk I/O.
+ * Aligned to a cache line so that partitions do not share one.
+ */
+typedef struct {
+  _Alignas(64) pthread_mutex_t mu; ///< Protects the table and the counters below
+  PageTable table; ///< Page ID to frame index lookup table
+  uint64_t hits; ///< Fetches served from a resident frame
+  uint64_t misses; ///< Fetches that read the page from disk
+  uint64_t ring_reuses; ///< Misses that recycled a BufferRing frame
+} BufferPartition;
+
+/**
+ * @brief Buffer pool hit/miss counters, summed over all partitions
+ */
+typedef struct {
+  uint64_t hits; ///< Fetches served from a resident frame
+  uint64_t misses; ///< Fetches that read the page from disk
+  uint64_t ring_reuses; ///< Misses that recycled a BufferRing frame
+} BufferStats;
+
+/**
+ * @brief Maximum number of frames in a BufferRing.
+ */
+#define BP_RING_MAX 16
+
+/**
+ * @brief Small private set of frames recycled by one large sequential scan
+ * 
+ * Pages a scan loads through a ring go into the ring's own frames once the
+ * ring is full, instead of into victims chosen by the shared clock, so a scan
+ * of a table larger than the pool does not evict the hot working set. Pages
+ * that were already resident are used in place and left untouched.
+ */
+typedef struct {
+  int size; ///< Number of frames in the ring (0 disables it)
+  int next; ///< Ring slot to recycle next
+  int frames[BP_RING_MAX]; ///< Frame index per slot, -1 while unused
+  uint32_t pids[BP_RING_MAX]; ///< Page the ring loaded into each slot's frame
+} BufferRing;
+
 /**
  * @brief Buffer pool structure for managing in-memory pages
  * 
  * The BufferPool structure manages a collection of BufferFrames, providing
  * functionality to fetch, unpin, and flush pages. It uses a clock replacement
- * policy to manage page eviction when the pool reaches its capacity.
+ * policy to manage page eviction when the pool reaches its capacity, and a
+ * page table partitioned by page ID to locate resident pages without
+ * scanning the frames.
+ *
+ * All functions are thread-safe. Frames are shared by all partitions; a miss
+ * claims a victim with the lock-free clock sweep, then takes the partition
+ * locks of the old and new page only to swap the mappings, and reads the page
+ * with no lock held while other fetchers of the same page wait on its latch.
+ *
+ * When a LogManager is attached, every dirty unpin logs the bytes changed
+ * since the frame's shadow copy and stamps the record's LSN into the page,
+ * and no dirty page is written before the log is durable up to its LSN.
  */
 typedef struct {
   DiskManager* dm; ///< Associated disk manager for I/O operations
   int capacity; ///< Maximum number of pages in the buffer pool
   BufferFrame* frames; ///< Array of buffer frames
-  int clock_hand; ///< Current position of the clock hand for replacement policy
+  Page* pages; ///< Page data backing the frames, one per frame
+  BufferPartition* parts; ///< Page table partitions
+  uint32_t part_mask; ///< Number of partitions minus one (a power of two)
+  _Atomic uint32_t clock_hand; ///< Current position of the clock hand for replacement policy
+  LogManager* wal; ///< Write-ahead log, or NULL when logging is disabled
+  Page* shadows; ///< Last logged image of each frame (WAL only)
 } BufferPool;
 
 /**
@@ -42,15 +137,38 @@ typedef struct {
  * 
  * @param dm Pointer to the DiskManager for disk I/O operations
  * @param capacity The maximum number of pages the buffer pool can hold
- * @return BufferPool* Pointer to the newly created BufferPool instance
+ * @return BufferPool* Pointer to the newly created BufferPool instance,
+ *                     or NULL if the frame memory cannot be reserved
  */
 BufferPool* bp_create(DiskManager* dm, int capacity);
 
+/**
+ * @brief Enables write-ahead logging for all subsequent page changes.
+ * 
+ * @param bp Pointer to the BufferPool instance
+ * @param lm Log manager that receives the page change records
+ * @return bool false, leaving logging off, if the memory for the last logged
+ *         image of each frame cannot be reserved
+ */
+bool bp_attach_wal(BufferPool* bp, LogManager* lm);
+
+/**
+ * @brief Takes a checkpoint.
+ * 
+ * Writes every dirty page, syncs the database file and, when a log is
+ * attached, discards the log since all of its changes are now durable.
+ * 
+ * @param bp Pointer to the BufferPool instance
+ * @return bool false, keeping the log, if the log has failed so pages could not be written,
+ *         or a page could not be written to or synced in the database file
+ */
+bool bp_checkpoint(BufferPool* bp);
+
 /**
  * @brief Destroys the buffer pool, releasing all associated resources.
  * 
- * This function flushes all dirty pages to disk and frees memory allocated
- * for the buffer pool.
+ * This function takes a checkpoint and frees memory allocated for the
+ * buffer pool.
  * 
  * @param bp Pointer to the BufferPool to be destroyed
  */
@@ -61,20 +179,51 @@ void bp_destroy(BufferPool* bp);
  * 
  * If the requested page is not already in the buffer pool, this function
  * loads it from disk into a buffer frame, potentially evicting another page
- * based on the clock replacement policy.
+ * based on the clock replacement policy. The page is returned pinned and
+ * latched in the requested mode until bp_unpin_page.
+ * 
+ * A thread must not fetch a page it already has pinned.
  * 
  * @param bp Pointer to the BufferPool instance
  * @param page_id The unique identifier of the page to fetch
+ * @param mode LATCH_SHARED to read the page, LATCH_EXCLUSIVE to modify it
+ * @return Page* Pointer to the fetched Page structure, or NULL if every
+ *               frame is pinned
+ */
+Page* bp_fetch_page(BufferPool* bp, uint32_t page_id, LatchMode mode);
+
+/**
+ * @brief Initializes a BufferRing sized for the pool.
+ * 
+ * The ring gets at most a quarter of the pool's frames; pools too small to
+ * spare any get a disabled ring.
+ * 
+ * @param bp Pointer to the BufferPool instance
+ * @param ring Ring to initialize
+ */
+void bp_ring_init(BufferPool* bp, BufferRing* ring);
+
+/**
+ * @brief Fetches a page on behalf of a sequential scan using a BufferRing.
+ * 
+ * Behaves like bp_fetch_page with LATCH_SHARED, except that a miss recycles
+ * the ring's oldest frame when it is still unpinned and unreferenced by
+ * anyone else, and pages loaded this way are not marked as recently used.
+ * 
+ * @param bp Pointer to the BufferPool instance
+ * @param page_id The unique identifier of the page to fetch
+ * @param ring Ring owned by the scan
  * @return Page* Pointer to the fetched Page structure
  */
-Page* bp_fetch_page(BufferPool* bp, uint32_t page_id);
+Page* bp_fetch_page_ring(BufferPool* bp, uint32_t page_id, BufferRing* ring);
 
 /**
  * @brief Unpins a page in the buffer pool, optionally marking it as dirty.
  * 
- * This function decreases the pin count of the specified page, indicating
- * that it is no longer in use. If the 'dirty' flag is set to true, the page
- * is marked as dirty.
+ * This function releases the page latch and decreases the pin count of the
+ * specified page, indicating that it is no longer in use. If the 'dirty'
+ * flag is set to true, the page is marked as dirty; this requires the page
+ * to have been fetched with LATCH_EXCLUSIVE.
  * 
  * @param bp Pointer to the BufferPool instance
  * @param page_id The unique identifier of the page to unpin
@@ -86,8 +235,19 @@ void bp_unpin_page(BufferPool* bp, uint32_t page_id, bool dirty);
  * @brief Flushes all dirty pages in the buffer pool to disk.
  * 
  * This function iterates through all pages in the buffer pool and writes
- * any dirty pages back to disk to ensure data persistence.
+ * any dirty pages back to disk, after forcing the log when one is attached.
+ * The writes are not synced; see bp_checkpoint.
+ * 
+ * @param bp Pointer to the BufferPool instance
+ * @return bool false if the log could not be forced, in which case no page is written,
+ *         or if a page could not be written, which stays dirty
+ */
+bool bp_flush_all(BufferPool* bp);
+
+/**
+ * @brief Reads the buffer pool's hit/miss counters.
  * 
  * @param bp Pointer to the BufferPool instance
+ * @param out Counters summed over all partitions
  */
-void bp_flush_all(BufferPool* bp);
+void bp_stats(BufferPool* bp, BufferStats* out);
@@ -1,22 +1,34 @@
 #pragma once
 #include <stdint.h>
 #include "buffer.h"
+#include "recovery.h"
 
 #define CATALOG_PID 0
 #define CATALOG_MAGIC "MARQDB1"
 #define INVALID_PID 0xFFFFFFFF
 #define TABLE_NAME_MAX 32
 #define COL_NAME_MAX 32
+#define CATALOG_MAX_COLS 16
+
+/**
+ * @brief In-memory cache of per-table catalog metadata (see catalog.c).
+ */
+typedef struct CatalogCache CatalogCache;
 
 /**
  * @brief Represents the catalog structure in the database.
  * 
  * The catalog maintains metadata about the database, including the PID of
- * the heap file header page.
+ * the heap file header page. Table lookups, schemas and index lists are
+ * cached in memory after the first scan of the catalog heaps.
  */
 typedef struct {
   uint32_t catalog_heap_header_pid; ///< PID of the catalog's heap file header page
   uint32_t columns_heap_header_pid; ///< PID of the columns' heap file header page
+  uint32_t indexes_heap_header_pid; ///< PID of the indexes' heap file header page (0 until the first index)
+  CatalogCache* cache; ///< Name-keyed metadata cache, or NULL to always scan
+  uint64_t version; ///< Bumped by every change to a table's entry, columns or indexes
+  RecoveryStats recovery; ///< What crash recovery did when the catalog was opened
 } Catalog;
 
 
@@ -36,20 +48,27 @@ typedef struct {
  * This enum defines the supported data types for table columns.
  */
 typedef enum {
-  COL_INT = 1, ///< Integer column type
-  COL_TEXT = 2 ///< Text column type
+  COL_INT = 1, ///< 32-bit integer column type
+  COL_TEXT = 2, ///< Text column type
+  COL_BIGINT = 3, ///< 64-bit integer column type
+  COL_DOUBLE = 4, ///< Double precision floating point column type
+  COL_BOOL = 5, ///< Boolean column type
+  COL_TIMESTAMP = 6, ///< Timestamp column type, in microseconds since 1970-01-01 UTC
+  COL_CHAR = 7 ///< Fixed-length text column type, padded with spaces
 } ColumnType;
 
 /**
  * @brief Represents an entry for a column in the catalog.
  * 
  * Each entry contains the table name, column name, data type, and ordinal position.
+ * Entries written before len existed are shorter and read as len 0.
  */
 typedef struct {
   char table[TABLE_NAME_MAX]; ///< Name of the table the column belongs to
   char col[COL_NAME_MAX]; ///< Name of the column
   uint8_t type; ///< Data type of the column
   uint8_t ordinal; ///< Ordinal position of the column in the table
+  uint16_t len; ///< Declared length of a CHAR(n) column, 0 for other types
 } ColumnEntry;
 
 /**
@@ -60,19 +79,43 @@ typedef struct {
 typedef struct {
   char col[COL_NAME_MAX]; ///< Name of the column
   ColumnType type; ///< Data type of the column
+  uint16_t len; ///< Declared length of a CHAR(n) column, 0 for other types
+  uint16_t row_off; ///< Where a format 2 row keeps the column, set by row_layout
 } ColumnDef;
 
+/**
+ * @brief Represents a secondary index registered in the catalog.
+ * 
+ * Each entry names the index, the table and column it covers, and the meta
+ * page of its B+ tree.
+ */
+typedef struct {
+  char name[TABLE_NAME_MAX]; ///< Name of the index
+  char table[TABLE_NAME_MAX]; ///< Name of the indexed table
+  char col[COL_NAME_MAX]; ///< Name of the indexed column
+  uint32_t meta_pid; ///< PID of the B+ tree meta page
+} IndexEntry;
+
 /**
   * @brief Opens the catalog from the buffer pool.
   * 
   * This function reads the catalog information from the designated catalog page
   * in the buffer pool and returns a Catalog structure populated with the data.
+  * When the buffer pool has a write-ahead log attached, crash recovery runs
+  * first and its counts are left in the catalog's recovery field.
   * 
   * @param bp Pointer to the BufferPool instance managing memory pages
   * @return Catalog The populated Catalog structure
   */
 Catalog catalog_open(BufferPool* bp);
 
+/**
+ * @brief Releases the in-memory state of a catalog opened with catalog_open.
+ * 
+ * @param c Pointer to the Catalog to close
+ */
+void catalog_close(Catalog* c);
+
 /**
  * @brief Writes the catalog data to the buffer pool.
  * 
@@ -96,7 +139,8 @@ void catalog_write(BufferPool* bp, const Catalog* c);
  * @param out_heap_header_pid Pointer to store the found heap header PID
  * @return true if the table is found, false otherwise
  */
-int catalog_find_table(BufferPool* bp, Catalog* c, const char* name, uint32_t* out_heap_header_pid);
+int catalog_find_table(BufferPool* bp, const Catalog* c, const char* name,
+                       uint32_t* out_heap_header_pid);
 
 /**
  * @brief Creates a new table entry in the catalog.
@@ -110,7 +154,7 @@ int catalog_find_table(BufferPool* bp, Catalog* c, const char* name, uint32_t* o
  * @param cols Array of column definitions for the table
  * @param ncols Number of columns in the table
  * @param out_heap_header_pid Pointer to store the allocated heap header PID
- * @return true if the table was successfully created, false otherwise
+ * @return true if the table was created, false if the name is taken or too long or there are no columns
  */
 int catalog_create_table(BufferPool* bp, Catalog* c,
                           const char* name,
@@ -146,5 +190,38 @@ int  catalog_load_schema(BufferPool* bp, const Catalog* c,
  * @param new_heap_header_pid The new heap header PID to set for the table
  * @return true if the update was successful, false otherwise
  */
-int catalog_update_table_heap(BufferPool* bp, const Catalog* c,
+int catalog_update_table_heap(BufferPool* bp, Catalog* c,
                               const char* name, uint32_t new_heap_header_pid);
+
+/**
+ * @brief Checks whether an index of the given name exists.
+ * 
+ * @param bp Pointer to the BufferPool instance managing memory pages
+ * @param c Pointer to the Catalog structure containing catalog data
+ * @param name The name of the index to look for
+ * @return true if the name is taken, false otherwise
+ */
+int catalog_find_index(BufferPool* bp, const Catalog* c, const char* name);
+
+/**
+ * @brief Registers a secondary index in the catalog.
+ * 
+ * @param bp Pointer to the BufferPool instance managing memory pages
+ * @param c Pointer to the Catalog structure containing catalog data
+ * @param e Index entry to register
+ * @return true if the index was registered, false if the name is taken
+ */
+int catalog_create_index(BufferPool* bp, Catalog* c, const IndexEntry* e);
+
+/**
+ * @brief Loads the indexes defined on a table.
+ * 
+ * @param bp Pointer to the BufferPool instance managing memory pages
+ * @param c Pointer to the Catalog structure containing catalog data
+ * @param table The name of the table whose indexes are to be loaded
+ * @param out Array to store the index entries
+ * @param max Maximum number of entries that can be stored in out
+ * @return int The number of indexes loaded into out
+ */
+int catalog_load_indexes(BufferPool* bp, const Catalog* c, const char* table,
+                         IndexEntry* out, int max);
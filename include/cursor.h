@@ -0,0 +1,65 @@
+#pragma once
+#include <stddef.h>
+#include "catalog.h"
+#include "exec.h"
+
+/**
+ * @brief A SELECT whose rows are pulled by the caller a batch at a time.
+ *
+ * The statement is planned and opened by cursor_open and runs only as far
+ * as batches are fetched, so a caller that stops early never reads the
+ * rest of the table, and nothing buffers the full result.
+ */
+typedef struct {
+  Arena arena; ///< Owner of the statement and its plan
+  ExecCtx ctx; ///< Statement state; ctx.err describes a failed fetch
+  Operator* plan; ///< Root of the plan
+  BatchReader reader; ///< Turns the plan's output into batches
+  bool open; ///< Whether the plan is still open
+} Cursor;
+
+/**
+ * @brief Parses, plans and opens a SELECT.
+ *
+ * @param bp Buffer pool
+ * @param cat Open catalog
+ * @param sql Statement text
+ * @param work_mem Memory an operator may use before spilling, 0 for the default
+ * @param err Buffer for an error message
+ * @param err_cap Capacity of err
+ * @return Cursor* The cursor, or NULL with err set
+ */
+Cursor* cursor_open(BufferPool* bp, Catalog* cat, const char* sql, size_t work_mem, char* err,
+                    size_t err_cap);
+
+/**
+ * @brief Number of columns of each row.
+ */
+int cursor_ncols(const Cursor* c);
+
+/**
+ * @brief Name and type of column i.
+ */
+const ExecColumn* cursor_column(const Cursor* c, int i);
+
+/**
+ * @brief Fetches the next batch of rows.
+ *
+ * The batch's vectors belong to the cursor and stay valid until the next
+ * fetch or cursor_close; its selection vector lists the rows to read.
+ * Out-of-line TEXT is read with row_field_text. Once the rows run out, the
+ * plan is closed at once, releasing its pages.
+ *
+ * @return int 1 for a batch with at least one row, 0 at the end, -1 on failure
+ */
+int cursor_fetch_batch(Cursor* c, Batch* out);
+
+/**
+ * @brief Message describing the last failure of cursor_fetch_batch.
+ */
+const char* cursor_error(const Cursor* c);
+
+/**
+ * @brief Closes the plan if still open and frees the cursor.
+ */
+void cursor_close(Cursor* c);
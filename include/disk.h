@@ -3,14 +3,28 @@
 #include <stdio.h>
 #include "page.h"
 
+/**
+ * @brief Number of pages by which the file's block reservation grows.
+ *
+ * Allocations reserve disk blocks with fallocate this many pages at a time,
+ * so the file grows in large physically contiguous steps instead of one
+ * block allocation per page.
+ */
+#define DISK_EXTENT_PAGES 128
+
 /**
  * @brief Disk manager structure for handling file operations
  * 
  * The DiskManager structure encapsulates file I/O operations for persistent storage.
- * It provides a wrapper around standard file operations for database storage management.
+ * Pages are transferred with positional pread/pwrite on a raw file descriptor, so
+ * there is no shared seek position and no stdio buffering between the caller and
+ * the kernel. Writes are not durable until disk_sync is called.
  */
 typedef struct {
-  FILE* f; ///< File pointer for disk I/O operations */
+  int fd; ///< File descriptor of the database file
+  uint32_t next_pid; ///< Page ID the next allocation hands out
+  uint32_t reserved_end; ///< Pages below this ID have file blocks reserved
+  int io_error; ///< errno of the first failed write or sync; once set, no sync succeeds
 } DiskManager;
 
 /**
@@ -22,15 +36,16 @@ typedef struct {
  * 
  * @param path The file system path to the database file to open or create
  * @return DiskManager* Pointer to the newly created DiskManager instance,
- *                      or nullptr if the operation fails
+ *                      or NULL if the file cannot be opened, with errno
+ *                      saying why
  */
 DiskManager* disk_open(const char* path);
 
 /**
  * @brief Closes the disk manager and releases associated resources.
  * 
- * This function properly shuts down the disk manager, ensuring all pending
- * operations are completed and all resources are released. It should be called
+ * This function properly shuts down the disk manager, syncing all pending
+ * writes to stable storage and releasing all resources. It should be called
  * when the disk manager is no longer needed to prevent resource leaks.
  * 
  * @param dm Pointer to the DiskManager instance to close. Must not be NULL.
@@ -54,28 +69,92 @@ void disk_read_page(DiskManager* dm, uint32_t page_id, Page* out);
  * @brief Writes a page to disk storage
  * 
  * This function writes the contents of a page from memory to the disk at the
- * specified page location. The page data is persisted to the storage device
- * managed by the disk manager.
+ * specified page location. The write reaches the OS page cache only; call
+ * disk_sync to make it durable.
  * 
  * @param dm Pointer to the disk manager that handles disk operations
  * @param page_id The unique identifier of the page to write to disk
  * @param in Pointer to the page containing the data to be written
+ * @return bool false if the write failed; the error is kept in io_error
+ */
+bool disk_write_page(DiskManager* dm, uint32_t page_id, const Page* in);
+
+/**
+ * @brief Writes a run of consecutive pages with a single system call.
+ * 
+ * Used by bulk loads that build whole pages in memory. Like disk_write_page,
+ * the write is not durable until disk_sync.
+ * 
+ * @param dm Pointer to the DiskManager instance
+ * @param first_pid Page ID of the first page of the run
+ * @param pages Array of npages pages, stored contiguously
+ * @param npages Number of pages to write
+ * @return bool false if the write failed; the error is kept in io_error
+ */
+bool disk_write_pages(DiskManager* dm, uint32_t first_pid, const Page* pages, uint32_t npages);
+
+/**
+ * @brief Hints that a run of pages will be read soon.
+ * 
+ * Starts asynchronous kernel read-ahead for the pages so a later
+ * disk_read_page finds them in the OS page cache. Returns immediately.
+ * 
+ * @param dm Pointer to the DiskManager instance
+ * @param first_pid Page ID of the first page of the run
+ * @param npages Number of consecutive pages to prefetch
+ */
+void disk_prefetch(DiskManager* dm, uint32_t first_pid, uint32_t npages);
+
+/**
+ * @brief Makes all previously written pages durable.
+ * 
+ * Issues an fdatasync on the database file. Callers batch page writes and
+ * only sync at commit or checkpoint time. Once a write or sync has failed,
+ * every later sync fails too, as the lost pages cannot be told apart.
+ * 
+ * @param dm Pointer to the DiskManager instance
+ * @return bool true if every page written so far is durable
  */
-void disk_write_page(DiskManager* dm, uint32_t page_id, const Page* in);
+bool disk_sync(DiskManager* dm);
 
 /**
  * @brief Allocates a new page on disk and returns its page ID.
  * 
  * This function allocates a new page in the disk storage managed by the 
- * DiskManager. The allocated page can be used to store data and will be
- * assigned a unique page identifier.
+ * DiskManager and writes an initialized image of it. Page IDs are handed
+ * out in increasing order; disk blocks are reserved DISK_EXTENT_PAGES at a
+ * time ahead of them.
  * 
  * @param dm Pointer to the DiskManager instance that manages the disk storage
- * @return uint32_t The page ID of the newly allocated page, or an error code
- *                  if allocation fails
+ * @return uint32_t The page ID of the newly allocated page
  */
 uint32_t disk_alloc_page(DiskManager* dm);
 
+/**
+ * @brief Allocates a run of consecutive pages.
+ * 
+ * Like disk_alloc_page, but the initialized images of all the pages are
+ * written with a single system call.
+ * 
+ * @param dm Pointer to the DiskManager instance
+ * @param npages Number of pages to allocate
+ * @return uint32_t Page ID of the first page of the run
+ */
+uint32_t disk_alloc_pages(DiskManager* dm, uint32_t npages);
+
+/**
+ * @brief Reserves a run of consecutive page IDs without writing them.
+ * 
+ * For callers that build the pages in memory and write them themselves
+ * with disk_write_pages, before anything refers to them. Pages that are
+ * never written are handed out again after the file is reopened.
+ * 
+ * @param dm Pointer to the DiskManager instance
+ * @param npages Number of pages to reserve
+ * @return uint32_t Page ID of the first page of the run
+ */
+uint32_t disk_reserve_pages(DiskManager* dm, uint32_t npages);
+
 /**
  * @brief Retrieves the total size of the disk file in bytes.
  * 
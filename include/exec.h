@@ -0,0 +1,314 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "arena.h"
+#include "parser.h"
+#include "row.h"
+#include "table.h"
+#include "vector.h"
+
+/**
+ * @brief Maximum number of columns in an operator's output.
+ */
+#define EXEC_MAX_COLS (2 * CATALOG_MAX_COLS)
+
+/**
+ * @brief One column of an operator's output schema.
+ */
+typedef struct {
+  char table[TABLE_NAME_MAX]; ///< Table the column comes from
+  char name[COL_NAME_MAX]; ///< Column name
+  ColumnType type; ///< Data type
+} ExecColumn;
+
+/**
+ * @brief A row flowing between operators.
+ *
+ * Values are RowFields, so a scan hands out the fields of the stored row
+ * without copying them: inline TEXT points into the page, and out-of-line
+ * values stay unread until something needs their bytes. A tuple is only
+ * valid until the next call to the operator that produced it.
+ */
+typedef struct {
+  int ncols; ///< Number of values
+  RowField vals[EXEC_MAX_COLS]; ///< Values in output column order
+  RID rid; ///< Row the values were read from, for base-table scans
+} Tuple;
+
+/**
+ * @brief A batch of rows flowing between vectorized operators.
+ *
+ * Each column is a vector owned by the operator that filled it, valid
+ * until that operator's next call. A filter does not move values: it
+ * narrows the selection vector, the list of rows still in play, and the
+ * operators above only look at the selected rows.
+ */
+typedef struct {
+  int ncols; ///< Number of columns
+  ColumnVector* cols[EXEC_MAX_COLS]; ///< Values in output column order
+  const RID* rids; ///< RID of each row, for base-table scans
+  int count; ///< Rows held by the vectors
+  const uint16_t* sel; ///< Selected rows in ascending order, or NULL for rows 0..nsel-1
+  int nsel; ///< Number of selected rows
+} Batch;
+
+/**
+ * @brief Default memory budget of one hash table, in bytes.
+ */
+#define EXEC_WORK_MEM_DEFAULT (4u << 20)
+
+/**
+ * @brief Most tables one statement opens.
+ */
+#define EXEC_MAX_TABLES 8
+
+/**
+ * @brief State shared by all operators of one statement.
+ */
+typedef struct {
+  BufferPool* bp; ///< Buffer pool for page access
+  Catalog* cat; ///< Open catalog
+  Arena* arena; ///< Owner of the plan and the operators' state
+  size_t work_mem; ///< Memory an operator may use before spilling to disk, 0 for EXEC_WORK_MEM_DEFAULT
+  bool quiet; ///< Leave results and errors to the caller instead of printing them
+  int ntables; ///< Number of entries in tables
+  TableInfo* tables[EXEC_MAX_TABLES]; ///< Tables the plan reads, refreshed when it runs again
+  uint64_t catalog_version; ///< Catalog version the tables were opened at
+  char err[256]; ///< Message describing the first failure
+} ExecCtx;
+
+typedef struct Operator Operator;
+
+/**
+ * @brief A physical operator with an open/next/close interface.
+ *
+ * Plans are trees of operators; each pulls rows from its child on demand,
+ * so a consumer that stops early stops the whole pipeline. Operators are
+ * allocated from the statement's arena. Specific operators embed this
+ * struct as their first member.
+ *
+ * Sequential scans and the filters, projections and limits above them are
+ * vectorized: they also implement next_batch and pass batches of up to
+ * VECTOR_SIZE rows, and their next hands out the rows of those batches one
+ * at a time to row-at-a-time consumers.
+ */
+struct Operator {
+  const char* label; ///< Description shown by EXPLAIN
+  bool (*open)(Operator* op); ///< Prepares to produce rows; false on failure
+  int (*next)(Operator* op, Tuple* out); ///< 1 for a row, 0 at the end, -1 on failure
+  int (*next_batch)(Operator* op, Batch* out); ///< Like next for a batch with at least one selected row; NULL for row-at-a-time operators
+  void (*close)(Operator* op); ///< Releases pins and cursors; safe to call twice
+  ExecCtx* ctx; ///< Statement state
+  Operator* child; ///< Input operator, or NULL for scans; the left input of a join
+  Operator* right; ///< Right input of a join, or NULL
+  int ncols; ///< Number of output columns
+  ExecColumn cols[EXEC_MAX_COLS]; ///< Output schema
+  Batch batch; ///< Batch a vectorized operator is handing out through next
+  int batch_pos; ///< Position in batch's selection of the row next returns
+};
+
+/**
+ * @brief Full scan of a table's heap in page order.
+ *
+ * Vectorized: rows are decoded straight into column vectors a batch at a
+ * time.
+ */
+Operator* exec_seq_scan(ExecCtx* ctx, TableInfo* t);
+
+/**
+ * @brief Scan of the rows whose indexed column lies in [lo, hi].
+ *
+ * Rows come in key order. TEXT keys are prefixes, so the range is a
+ * superset of the matches and a Filter above must recheck the predicate.
+ * The bounds are read when the scan opens, so a plan run again after its
+ * placeholders are re-bound scans the new range; a NULL bound value
+ * matches no rows.
+ *
+ * @param ctx Statement state
+ * @param t Table the index belongs to
+ * @param ix Index to scan
+ * @param lo Inclusive lower bound, or NULL; must live as long as the plan
+ * @param hi Inclusive upper bound, or NULL; must live as long as the plan
+ */
+Operator* exec_index_scan(ExecCtx* ctx, TableInfo* t, TableIndex* ix,
+                          const RowField* lo, const RowField* hi);
+
+/**
+ * @brief Limits a scan to the columns a plan reads.
+ *
+ * The scan still returns every column of the table, but the unwanted ones
+ * are NULL: their bytes are stepped over without being copied, and
+ * decoding stops at the last wanted column. A scan reads all columns until
+ * this is called. Operators other than scans are left alone.
+ *
+ * @param op Scan from exec_seq_scan or exec_index_scan, before it opens
+ * @param want Per column of the scan, whether it is read
+ */
+void exec_scan_columns(Operator* op, const bool* want);
+
+/**
+ * @brief Passes on the rows for which a bound predicate is true.
+ *
+ * Over a vectorized child, the predicate is evaluated a column at a time
+ * over the whole batch and only the selection vector changes.
+ */
+Operator* exec_filter(ExecCtx* ctx, Operator* child, const Expr* pred);
+
+/**
+ * @brief Reorders or drops columns.
+ *
+ * @param ctx Statement state
+ * @param child Input operator
+ * @param map Input position of each output column
+ * @param n Number of output columns
+ */
+Operator* exec_project(ExecCtx* ctx, Operator* child, const int* map, int n);
+
+/**
+ * @brief Skips a number of rows, then stops after a number of rows.
+ *
+ * The input is not read past the last row needed: a sequential scan below
+ * fills its first batch with only that many rows and is ended, unpinning
+ * its page, as soon as the last one has been handed out.
+ *
+ * @param ctx Statement state
+ * @param child Input operator
+ * @param limit Rows to return, or -1 for all
+ * @param offset Rows to skip first
+ */
+Operator* exec_limit(ExecCtx* ctx, Operator* child, int64_t limit, int64_t offset);
+
+/**
+ * @brief Evaluates a bound predicate against a tuple.
+ *
+ * Comparisons involving NULL are unknown, and AND, OR and NOT follow
+ * three-valued logic.
+ *
+ * @return int 1 if true, 0 if false, -1 if unknown
+ */
+int exec_eval(ExecCtx* ctx, const Expr* e, const Tuple* t);
+
+/**
+ * @brief Compares two non-NULL values of the same type, or two numbers.
+ *
+ * TEXT compares byte-wise, shorter first on a common prefix. Out-of-line
+ * values are read only as far as the shorter value. INT, BIGINT and DOUBLE
+ * values compare with each other exactly, by value.
+ *
+ * @return int Negative, zero or positive like memcmp
+ */
+int exec_compare(BufferPool* bp, const RowField* a, const RowField* b);
+
+/**
+ * @brief Prints the operator tree, one operator per line.
+ *
+ * Inputs are indented under the operator that reads them, the left input
+ * of a join first. Vectorized operators are marked "(vectorized)".
+ */
+void exec_explain(const Operator* root);
+
+// ============================================================================
+// Operator helpers
+// ============================================================================
+
+/**
+ * @brief Allocates an operator of the given size and fills in the common fields.
+ *
+ * The output schema is copied from child when there is one.
+ *
+ * @return void* The operator, or NULL with ctx->err set if out of memory
+ */
+void* exec_new_op(ExecCtx* ctx, size_t size, Operator* child);
+
+/**
+ * @brief Formats an EXPLAIN label into the statement's arena.
+ */
+const char* exec_label(ExecCtx* ctx, const char* fmt, ...);
+
+/**
+ * @brief open for operators that only need their child opened.
+ */
+bool exec_open_child(Operator* op);
+
+/**
+ * @brief close for operators that only need their child closed.
+ */
+void exec_close_child(Operator* op);
+
+/**
+ * @brief next for vectorized operators: hands out the selected rows of
+ * the operator's batches one at a time.
+ */
+int exec_batch_next_row(Operator* op, Tuple* out);
+
+/**
+ * @brief Reads an operator's output a batch at a time, whatever its kind.
+ *
+ * A vectorized input hands over its own batches; the rows of a
+ * row-at-a-time input are copied into vectors owned by the reader, so
+ * consumers such as aggregation only need a batch loop.
+ */
+typedef struct {
+  Operator* input; ///< Operator read from
+  bool vecs_ready; ///< Whether vecs have been allocated
+  ColumnVector vecs[EXEC_MAX_COLS]; ///< Batch of a row-at-a-time input
+  RID rids[VECTOR_SIZE]; ///< RIDs of the rows in vecs
+  Tuple pending; ///< Row read but not yet added to a batch
+  bool has_pending; ///< Whether pending holds a row
+} BatchReader;
+
+/**
+ * @brief Starts reading an operator, which the caller opens.
+ */
+void exec_reader_init(BatchReader* r, Operator* input);
+
+/**
+ * @brief Reads the next batch.
+ *
+ * @return int 1 for a batch with at least one selected row, 0 at the end, -1 on failure
+ */
+int exec_reader_next(BatchReader* r, Batch* out);
+
+// ============================================================================
+// Hashing
+// ============================================================================
+
+/**
+ * @brief Hash of a NULL value.
+ */
+#define EXEC_NULL_HASH 0x5bd1e9955bd1e995ull
+
+/**
+ * @brief Scrambles a 64-bit value; also combines the hashes of several columns.
+ */
+static inline uint64_t exec_hash_mix(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ull;
+  x ^= x >> 33;
+  return x;
+}
+
+/**
+ * @brief Hash of an INT value, as exec_hash_value computes it.
+ */
+static inline uint64_t exec_hash_int(int32_t v) {
+  return exec_hash_mix((uint32_t)v);
+}
+
+/**
+ * @brief Hash of row `row` of a vector.
+ *
+ * Equal values hash equally whether they are inline or out of line, as
+ * out-of-line TEXT is read in full.
+ */
+uint64_t exec_hash_value(ExecCtx* ctx, const ColumnVector* v, int row);
+
+/**
+ * @brief Hash of row `row` of an INT, BIGINT or DOUBLE vector by value.
+ *
+ * Equal numbers hash equally whatever their types, so 2, 2 as a BIGINT and
+ * 2.0 hash the same, unlike under exec_hash_value.
+ */
+uint64_t exec_hash_number(const ColumnVector* v, int row);
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffer.h"
+
+/**
+ * @brief Offset of the free list head in the data area of the catalog root.
+ *
+ * Follows the catalog's magic and its three heap header page IDs. A head of
+ * 0 means the list is empty: page 0 is the catalog root and is never free.
+ */
+#define FREELIST_HEAD_OFFSET 20
+
+/**
+ * @brief Largest run of pages reserved for one structure at a time.
+ */
+#define FREELIST_RUN_MAX 64
+
+/**
+ * @brief Contiguous pages reserved for one growing structure.
+ *
+ * Heaps and B+ trees take their new pages from a run of consecutive page
+ * IDs reserved for them alone, so their pages stay physically clustered
+ * even when several structures grow at once. Each new run is twice the
+ * previous one, up to FREELIST_RUN_MAX pages, so small tables stay small.
+ * The owner stores the run in its header page; all zeros means no run.
+ */
+typedef struct {
+  uint32_t next; ///< Next reserved page to hand out
+  uint32_t end; ///< One past the last reserved page
+  uint32_t size; ///< Length of the most recent run
+} PageRun;
+
+/**
+ * @brief Returns a page to the database file's free list.
+ *
+ * Free pages are chained through their next_page_id, newest first, starting
+ * from a head stored in the catalog root page, so the list survives restarts
+ * and its updates are logged like any other page change. Files without a
+ * catalog have no free list and the page is simply leaked.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param pid Page ID of a page no longer referenced by any structure
+ * @return true if the page was added to the list
+ */
+bool freelist_push(BufferPool* bp, uint32_t pid);
+
+/**
+ * @brief Takes a page from the free list.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @return uint32_t Page ID of a freshly initialized page, or INVALID_PID if
+ *         the list is empty
+ */
+uint32_t freelist_pop(BufferPool* bp);
+
+/**
+ * @brief Allocates a page, recycling a free one before growing the file.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @return uint32_t Page ID of a freshly initialized page
+ */
+uint32_t freelist_alloc(BufferPool* bp);
+
+/**
+ * @brief Allocates a page for a structure that owns a PageRun.
+ *
+ * Takes the next page of the run if it has one left, then a page from the
+ * free list, and only then reserves a new run at the end of the file. The
+ * caller must persist the updated run in the same transaction.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param run The structure's reserved run, updated in place
+ * @return uint32_t Page ID of a freshly initialized page
+ */
+uint32_t freelist_alloc_run(BufferPool* bp, PageRun* run);
@@ -0,0 +1,92 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "buffer.h"
+#include "page.h"
+
+/**
+ * @brief Granularity of free-space categories in bytes.
+ *
+ * A page's free space is recorded as floor(free / FSM_CATEGORY_BYTES) in a
+ * single byte, so a category never overstates the space really available.
+ */
+#define FSM_CATEGORY_BYTES 32
+
+/**
+ * @brief Number of data pages one FSM leaf page covers.
+ *
+ * A leaf holds a search hint followed by one category byte per page ID:
+ * leaf n covers page IDs [n * FSM_LEAF_PAGES, (n + 1) * FSM_LEAF_PAGES),
+ * so a page's entry is found without searching.
+ */
+#define FSM_LEAF_PAGES (PAGE_SIZE - sizeof(PageHeader) - sizeof(uint32_t))
+
+/**
+ * @brief Number of leaves one FSM directory page indexes.
+ *
+ * A directory page holds a search hint, the page ID of each leaf (0 until
+ * the leaf is needed) and an upper bound on each leaf's categories. The
+ * root is the first directory page; further ones are chained through
+ * next_page_id and cover the following leaves.
+ */
+#define FSM_DIR_LEAVES ((PAGE_SIZE - sizeof(PageHeader) - sizeof(uint32_t)) / \
+                        (sizeof(uint32_t) + 1))
+
+/**
+ * @brief Allocates and initializes an empty free-space map.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @return uint32_t Page ID of the new FSM root page
+ */
+uint32_t fsm_create(BufferPool* bp);
+
+/**
+ * @brief Checks that a map was written in the current, page-indexed layout.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param fsm_pid Page ID of the FSM root page
+ * @return bool false for a map in the older list layout, which fsm_destroy frees
+ */
+bool fsm_is_current(BufferPool* bp, uint32_t fsm_pid);
+
+/**
+ * @brief Hands every page of a map, in either layout, to the free list.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param fsm_pid Page ID of the FSM root page
+ */
+void fsm_destroy(BufferPool* bp, uint32_t fsm_pid);
+
+/**
+ * @brief Finds a page with at least the requested amount of free space.
+ *
+ * The search starts from where the last one succeeded, and skips leaves
+ * whose bound is below the request. A leaf searched in vain has its bound
+ * lowered, so it is not searched again until a page in it gains space.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param fsm_pid Page ID of the FSM root page
+ * @param needed Number of free bytes required (record plus slot)
+ * @return uint32_t Page ID of a suitable page, or INVALID_PID if none
+ *         qualifies or the request is more than the top category promises
+ */
+uint32_t fsm_find(BufferPool* bp, uint32_t fsm_pid, uint16_t needed);
+
+/**
+ * @brief Records the free space of a page.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param fsm_pid Page ID of the FSM root page
+ * @param page_id Page ID of the tracked data page
+ * @param free_bytes Current free space of the data page in bytes
+ */
+void fsm_set(BufferPool* bp, uint32_t fsm_pid, uint32_t page_id, uint16_t free_bytes);
+
+/**
+ * @brief Drops a page's entry, e.g. when the page leaves its heap.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param fsm_pid Page ID of the FSM root page
+ * @param page_id Page ID of the data page to forget
+ */
+void fsm_remove(BufferPool* bp, uint32_t fsm_pid, uint32_t page_id);
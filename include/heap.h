@@ -3,18 +3,23 @@
 #include <stdbool.h>
 #include "buffer.h"
 #include "page.h"
+#include "freelist.h"
 
 /**
  * @brief Heap file structure representing a collection of pages storing records.
  * 
  * A HeapFile manages a linked list of data pages, starting from a header page.
  * It provides functionality to insert, retrieve, and scan records stored across
- * multiple pages in the database system.
+ * multiple pages in the database system. A free-space map, referenced from the
+ * header page, tracks how much room each data page has left.
  */
 typedef struct {
   uint32_t header_page_id; ///< Page ID of the heap file's header page
   uint32_t first_data_pid; ///< Page ID of the first data page in the heap file
   uint32_t last_data_pid;  ///< Page ID of the last data page in the heap file
+  uint32_t fsm_pid;        ///< Page ID of the free-space map root (0 if not built yet)
+  uint32_t vacuum_pid;     ///< Last page kept by an unfinished heap_vacuum pass (0 if none)
+  PageRun run;             ///< Pages reserved for the heap's growth
 } HeapFile;
 
 /**
@@ -32,7 +37,7 @@ typedef struct {
  * @brief Initializes the heap file's header page.
  * 
  * This function sets up the header page with pointers to the first and last
- * data pages in the heap file.
+ * data pages in the heap file and allocates its free-space map.
  * 
  * @param bp Pointer to the BufferPool for buffer management
  * @param header_pid Page ID of the heap file's header page
@@ -52,18 +57,30 @@ HeapFile heap_bootstrap(BufferPool* bp, uint32_t header_pid, uint32_t first_data
  */
 HeapFile heap_open(BufferPool* bp, uint32_t header_pid);
 
+/**
+ * @brief Re-reads the header of a heap file opened with heap_open.
+ * 
+ * A HeapFile copies the header's page IDs, which move as the heap grows;
+ * this brings a copy kept across statements up to date.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Heap file to update
+ */
+void heap_reload(BufferPool* bp, HeapFile* hf);
+
 /**
  * @brief Inserts a record into the heap file.
  * 
- * This function finds a suitable page with enough free space to store the record.
- * If no such page exists, a new page is allocated. The record is then inserted,
- * and its RID is returned.
+ * This function consults the free-space map to jump straight to a page with
+ * enough free space to store the record. If no such page exists, a new page is
+ * appended to the chain. The record is then inserted, and its RID is returned.
  * 
  * @param bp Pointer to the BufferPool for buffer management
  * @param hf Pointer to the HeapFile where the record will be inserted
  * @param rec Pointer to the record data to be inserted
  * @param len Length of the record in bytes
- * @return RID of the inserted record
+ * @return RID of the inserted record, with page_id INVALID_PID if the record
+ *         cannot fit in a page
  */
 RID heap_insert(BufferPool* bp, HeapFile* hf, const uint8_t* rec, uint16_t len);
 
@@ -96,32 +113,144 @@ bool heap_get(BufferPool* bp, RID rid, uint8_t** out, uint16_t* len);
  */
 bool heap_scan_next(BufferPool* bp, HeapFile* hf, RID* cursor, uint8_t** out, uint16_t* len);
 
+/**
+ * @brief Counts the data pages of a heap file, stopping at a limit.
+ * 
+ * Follows the page chain, so the cost grows with the count; the planner
+ * uses it to compare the sizes of join inputs without reading more of a
+ * large table than the limit.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Heap file to measure
+ * @param max Count at which to stop
+ * @return uint32_t Number of data pages, or max if there are at least that many
+ */
+uint32_t heap_count_pages(BufferPool* bp, const HeapFile* hf, uint32_t max);
+
+/**
+ * @brief State of a large sequential scan over a heap file.
+ * 
+ * Unlike heap_scan_next, a HeapScan keeps its current page pinned between
+ * rows until heap_scan_pause, reads pages through a BufferRing so it does
+ * not flush the hot set out of the pool, and prefetches the pages ahead of
+ * it in the chain.
+ */
+typedef struct {
+  HeapFile hf; ///< Heap file being scanned
+  RID cur; ///< RID of the last record returned
+  Page* page; ///< Pinned current page, or NULL when none is pinned
+  bool done; ///< Whether the end of the heap was reached
+  BufferRing ring; ///< Frames recycled by this scan
+  bool read_ahead; ///< Whether to prefetch upcoming pages
+  uint32_t ra_stride; ///< Page ID step between consecutive pages of the chain
+  uint32_t ra_end; ///< First predicted page not prefetched yet
+} HeapScan;
+
+/**
+ * @brief Starts a sequential scan over the heap file.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Pointer to the HeapFile to scan
+ * @param scan Scan state to initialize
+ */
+void heap_scan_begin(BufferPool* bp, const HeapFile* hf, HeapScan* scan);
+
+/**
+ * @brief Returns the next record of a sequential scan.
+ * 
+ * The record stays valid until the next call or heap_scan_end; its RID is
+ * scan->cur. The caller must not unpin the page.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param scan Scan started with heap_scan_begin
+ * @param out Output parameter that will point to the record data
+ * @param len Output parameter that will hold the length of the record
+ * @return true if a record was returned, false at the end of the heap
+ */
+bool heap_scan_step(BufferPool* bp, HeapScan* scan, uint8_t** out, uint16_t* len);
+
+/**
+ * @brief Returns the next records of a sequential scan that share a page.
+ *
+ * Steps like heap_scan_step to the next record, then reads on along its
+ * page, so a caller can work through a page's rows at once. The records
+ * stay valid until the scan moves on; scan->cur is the RID of the last.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param scan Scan started with heap_scan_begin
+ * @param max Most records to return
+ * @param rows Output array of max pointers to the record data
+ * @param lens Output array of max record lengths
+ * @param rids Output array of max record RIDs
+ * @return Number of records returned, 0 at the end of the heap
+ */
+int heap_scan_page(BufferPool* bp, HeapScan* scan, int max, uint8_t** rows, uint16_t* lens,
+                   RID* rids);
+
+/**
+ * @brief Moves a sequential scan back so it goes on after the record at `after`.
+ *
+ * Used to hand records a caller has read but not consumed back to the scan.
+ * The page is released as by heap_scan_pause.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param scan Scan started with heap_scan_begin
+ * @param after RID of the last record consumed, or INVALID_PID to start over
+ */
+void heap_scan_seek(BufferPool* bp, HeapScan* scan, RID after);
+
+/**
+ * @brief Releases the page a sequential scan has pinned.
+ *
+ * The next heap_scan_step fetches the page again and goes on after
+ * scan->cur, so the scan holds no pin or latch in between and the rows it
+ * returned may be changed. Records returned before the pause are no longer
+ * valid.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param scan Scan started with heap_scan_begin
+ */
+void heap_scan_pause(BufferPool* bp, HeapScan* scan);
+
+/**
+ * @brief Ends a sequential scan, releasing its pinned page.
+ * 
+ * Safe to call after heap_scan_step has returned false or to stop early.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param scan Scan to end
+ */
+void heap_scan_end(BufferPool* bp, HeapScan* scan);
+
 /**
  * @brief Updates a record in place within the heap file.
  * 
- * This function locates the record specified by the RID and updates its
- * data with the new provided data, assuming the new data fits in the
- * existing space.
+ * This function locates the record specified by the RID and replaces its
+ * data, keeping the RID. A larger record is moved within its page, which is
+ * compacted if needed; the update fails if the page cannot hold it.
  * 
  * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Pointer to the HeapFile owning the record
  * @param rid RID of the record to update
  * @param data Pointer to the new record data
  * @param new_len Length of the new record data in bytes
  * @return int 0 on success, -1 on failure
  */
-int heap_update_in_place(BufferPool* bp, RID rid,
+int heap_update_in_place(BufferPool* bp, HeapFile* hf, RID rid,
                          const uint8_t* data, uint16_t new_len);
 
 /**
  * @brief Deletes a record from the heap file.
  * 
- * This function marks the record specified by the RID as deleted.
+ * This function marks the record specified by the RID as deleted and
+ * refreshes the page's entry in the free-space map.
  * 
  * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Pointer to the HeapFile owning the record
  * @param rid RID of the record to delete
  * @return int 0 on success, -1 on failure
  */
-int heap_delete(BufferPool* bp, RID rid);
+int heap_delete(BufferPool* bp, HeapFile* hf, RID rid);
 
 /**
  * @brief Creates a new heap file on the given BufferPool.
@@ -133,4 +262,100 @@ int heap_delete(BufferPool* bp, RID rid);
  * @param out_header_pid Output parameter that will hold the page ID of the new header page
  * @return HeapFile structure representing the newly created heap file
  */
-HeapFile heap_create(BufferPool* bp, uint32_t* out_header_pid);
\ No newline at end of file
+HeapFile heap_create(BufferPool* bp, uint32_t* out_header_pid);
+
+/**
+ * @brief Pages a bulk load fills in memory before writing them out.
+ */
+#define HEAP_BULK_PAGES 128
+
+/**
+ * @brief Called for each row written by a bulk load, once its RID is known.
+ */
+typedef void (*HeapBulkRowFn)(void* ctx, const uint8_t* rec, uint16_t len, RID rid);
+
+/**
+ * @brief State of a bulk load appending rows to a heap file.
+ * 
+ * Rows are packed into private pages, which are written past the end of the
+ * database file in batches of HEAP_BULK_PAGES with one write each and then
+ * linked after the heap's last page. Only the link goes through the buffer
+ * pool and the log; the pages themselves are made durable by the disk_sync
+ * in heap_bulk_end, which must happen before the loading transaction
+ * commits. If the load never commits, recovery undoes the link and the
+ * pages are unreachable.
+ * 
+ * Pages filled by a load are not entered in the free-space map, except for
+ * the last one; the others join it when a delete frees room in them.
+ */
+typedef struct {
+  HeapFile* hf; ///< Heap file being loaded; its last page moves as batches are linked
+  Page* pages; ///< Batch buffer of HEAP_BULK_PAGES pages
+  uint32_t npages; ///< Pages in use in the batch; the last one is being filled
+  HeapBulkRowFn on_row; ///< Optional per-row callback, e.g. for index maintenance
+  void* ctx; ///< Argument passed to on_row
+  uint64_t rows; ///< Rows written to disk so far
+  uint64_t pages_written; ///< Pages written to disk so far
+} HeapBulkLoad;
+
+/**
+ * @brief Starts a bulk load into a heap file.
+ * 
+ * @param hf Heap file to append to; must stay valid until heap_bulk_end
+ * @param bl Load state to initialize
+ * @param on_row Callback invoked for every row as its batch is written, or NULL
+ * @param ctx Argument passed to on_row
+ * @return true on success, false if the batch buffer cannot be allocated
+ */
+bool heap_bulk_begin(HeapFile* hf, HeapBulkLoad* bl, HeapBulkRowFn on_row, void* ctx);
+
+/**
+ * @brief Adds a record to a bulk load.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bl Load started with heap_bulk_begin
+ * @param rec Pointer to the record data
+ * @param len Length of the record in bytes
+ * @return true on success, false if the record cannot fit in a page
+ */
+bool heap_bulk_insert(BufferPool* bp, HeapBulkLoad* bl, const uint8_t* rec, uint16_t len);
+
+/**
+ * @brief Writes the remaining rows of a bulk load and syncs the data file.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param bl Load to finish
+ * @return bool false if a batch could not be written, leaving its rows out
+ *         of the heap, or the file could not be synced
+ */
+bool heap_bulk_end(BufferPool* bp, HeapBulkLoad* bl);
+
+
+/**
+ * @brief Work done by one heap_vacuum call.
+ */
+typedef struct {
+  uint32_t pages_scanned; ///< Pages visited
+  uint32_t pages_compacted; ///< Pages defragmented in place
+  uint32_t pages_freed; ///< Empty pages unlinked and returned to the free list
+  uint64_t bytes_reclaimed; ///< Dead record bytes recovered
+} HeapVacuumStats;
+
+/**
+ * @brief Vacuums the heap in place, a bounded number of pages at a time.
+ * 
+ * Walks the page chain, compacting pages that hold deleted or shrunk
+ * records and unlinking pages that hold none, which go to the file's free
+ * list. Live records keep their RIDs, so indexes need no maintenance. Each
+ * call visits at most max_pages pages and saves its position in the heap
+ * header, so a pass can be spread over many short transactions; the next
+ * call resumes where the previous one stopped. Reset hf->vacuum_pid to 0 to
+ * start a pass from the beginning.
+ * 
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param hf Heap file to vacuum
+ * @param max_pages Maximum number of pages to visit in this call
+ * @param st Output parameter for the work done
+ * @return true if the pass reached the end of the chain
+ */
+bool heap_vacuum(BufferPool* bp, HeapFile* hf, uint32_t max_pages, HeapVacuumStats* st);
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include "exec.h"
+
+/**
+ * @brief Counters of a HashJoin operator's last run.
+ */
+typedef struct {
+  uint64_t build_rows; ///< Rows read from the build input
+  uint64_t probe_rows; ///< Rows read from the probe input
+  uint64_t spilled_rows; ///< Rows written to partition files, counted once per level
+  uint32_t partitions; ///< Partition pairs joined after the inputs
+} HashJoinStats;
+
+/**
+ * @brief Inner equi-join of two inputs through a hash table.
+ *
+ * Output rows are the left input's columns followed by the right input's.
+ * Rows match when every key column of one equals the paired key column of
+ * the other; a NULL key matches nothing.
+ *
+ * The table is built from one input, the build side, which should be the
+ * smaller, and the other input probes it a batch at a time. Build rows are
+ * kept in partitions by hash. When they outgrow ctx->work_mem, the largest
+ * partitions are written to temporary files, and so are the probe rows
+ * that hash to them, while the partitions still in memory are joined as
+ * the probe side streams past. Each spilled pair of files is joined in
+ * turn afterwards, partitioned again by other hash bits if its build rows
+ * still do not fit.
+ *
+ * @param ctx Statement state
+ * @param left Left input
+ * @param right Right input
+ * @param lkeys Key columns of the left input
+ * @param rkeys Key columns of the right input, paired with lkeys
+ * @param nkeys Number of key columns
+ * @param build_left Whether the left input is the build side
+ */
+Operator* exec_hash_join(ExecCtx* ctx, Operator* left, Operator* right, const int* lkeys,
+                         const int* rkeys, int nkeys, bool build_left);
+
+/**
+ * @brief Reads the counters of a HashJoin operator.
+ */
+void exec_hash_join_stats(const Operator* op, HashJoinStats* out);
+
+/**
+ * @brief Inner equi-join of two inputs ordered by an INT key.
+ *
+ * Both inputs must come in ascending order of their key column, as index
+ * scans do, and rows with NULL keys are skipped. The join walks both inputs
+ * once and keeps only the right rows of the current key in memory, so it
+ * never spills. Output rows are the left input's columns followed by the
+ * right input's.
+ *
+ * @param ctx Statement state
+ * @param left Left input
+ * @param right Right input
+ * @param lkey Key column of the left input
+ * @param rkey Key column of the right input
+ */
+Operator* exec_merge_join(ExecCtx* ctx, Operator* left, Operator* right, int lkey, int rkey);
@@ -0,0 +1,80 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Instruction sets the predicate kernels are built for.
+ */
+typedef enum {
+  KERNEL_SCALAR, ///< Portable C
+  KERNEL_SSE42, ///< 128-bit SSE4.2
+  KERNEL_AVX2 ///< 256-bit AVX2
+} KernelIsa;
+
+/**
+ * @brief Predicate kernels for one instruction set.
+ *
+ * Every kernel tests rows 0..n-1 of a column (n at most 65536) and writes
+ * a bitmask with bit i of word i / 64 set when row i matches. Bits from n
+ * up to the end of the last word are cleared. The masks have the layout of
+ * a ColumnVector's null bitmap, so NULLs are removed with one AND NOT per
+ * 64 rows.
+ */
+typedef struct {
+  const char* name; ///< "scalar", "sse4.2" or "avx2"
+
+  /** @brief v[i] == c */
+  void (*i32_eq)(const int32_t* v, int n, int32_t c, uint64_t* mask);
+
+  /** @brief lo <= v[i] <= hi; also serves <, <=, > and >= with an open end at INT32_MIN or INT32_MAX */
+  void (*i32_range)(const int32_t* v, int n, int32_t lo, int32_t hi, uint64_t* mask);
+
+  /** @brief v[i] is one of the nlist values of list, which is sorted and has no duplicates */
+  void (*i32_in)(const int32_t* v, int n, const int32_t* list, int nlist, uint64_t* mask);
+
+  /**
+   * @brief Row i starts with the plen bytes of prefix (and has no more if exact).
+   *
+   * Row i's bytes are text[off[i]] .. text[off[i] + len[i] - 1]. Rows whose
+   * toast_pid is not INVALID_PID are out of line and never match; the
+   * caller checks them separately. The text buffer must be readable for 32
+   * bytes past the end of its last value.
+   */
+  void (*text_prefix)(const uint8_t* text, const uint32_t* off, const uint32_t* len,
+                      const uint32_t* toast_pid, int n, const uint8_t* prefix,
+                      uint32_t plen, bool exact, uint64_t* mask);
+} Kernels;
+
+/**
+ * @brief Bytes a text buffer passed to text_prefix must be readable past its end.
+ */
+#define KERNEL_TEXT_PAD 32
+
+/**
+ * @brief Returns the kernels for an instruction set.
+ *
+ * @param isa Instruction set
+ * @return const Kernels* The kernels, or NULL if this CPU or build lacks the instruction set
+ */
+const Kernels* kernels_for(KernelIsa isa);
+
+/**
+ * @brief Returns the fastest kernels this CPU supports.
+ *
+ * The CPU is probed on the first call.
+ */
+const Kernels* kernels_best(void);
+
+/**
+ * @brief Turns a mask over rows 0..n-1 into a selection vector.
+ *
+ * @return int Number of rows selected
+ */
+int kernel_mask_to_sel(const uint64_t* mask, int n, uint16_t* out);
+
+/**
+ * @brief Keeps the entries of a selection vector whose bits are set in mask.
+ *
+ * @return int Number of rows kept
+ */
+int kernel_mask_select(const uint64_t* mask, const uint16_t* sel, int n, uint16_t* out);
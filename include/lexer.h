@@ -0,0 +1,66 @@
+#pragma once
+#include <stdbool.h>
+
+/**
+ * @brief Kinds of tokens in a SQL statement.
+ *
+ * Keywords are not token kinds of their own: they are TOK_IDENT tokens that
+ * the parser matches case-insensitively with token_is.
+ */
+typedef enum {
+  TOK_EOF, ///< End of the statement text
+  TOK_IDENT, ///< Identifier or keyword
+  TOK_INT, ///< Unsigned integer literal
+  TOK_FLOAT, ///< Unsigned number with a fraction or an exponent
+  TOK_STRING, ///< Quoted string literal, quotes included
+  TOK_LPAREN, ///< (
+  TOK_RPAREN, ///< )
+  TOK_COMMA, ///< ,
+  TOK_SEMI, ///< ;
+  TOK_STAR, ///< *
+  TOK_DOT, ///< .
+  TOK_MINUS, ///< -
+  TOK_EQ, ///< =
+  TOK_NE, ///< <> or !=
+  TOK_LT, ///< <
+  TOK_LE, ///< <=
+  TOK_GT, ///< >
+  TOK_GE, ///< >=
+  TOK_PARAM, ///< ? placeholder for a value bound at execution
+  TOK_ERROR ///< Unterminated string or unexpected character
+} TokenType;
+
+/**
+ * @brief A token, pointing into the statement text.
+ */
+typedef struct {
+  TokenType type; ///< Kind of token
+  const char* start; ///< First byte of the token in the source text
+  int len; ///< Length of the token in bytes
+} Token;
+
+/**
+ * @brief Tokenizer state over a NUL-terminated statement.
+ */
+typedef struct {
+  const char* pos; ///< Next unread byte
+} Lexer;
+
+/**
+ * @brief Starts tokenizing a statement.
+ */
+void lexer_init(Lexer* lx, const char* src);
+
+/**
+ * @brief Returns the next token and advances past it.
+ *
+ * String literals may be quoted with single or double quotes; a doubled
+ * quote character inside stands for one. TOK_EOF is returned at the end
+ * of the text and on every call after that.
+ */
+Token lexer_next(Lexer* lx);
+
+/**
+ * @brief Tests whether a token is the given keyword, ignoring case.
+ */
+bool token_is(const Token* t, const char* keyword);
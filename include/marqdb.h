@@ -0,0 +1,254 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file marqdb.h
+ * @brief Embedding API, built as libmarqdb.a and libmarqdb.so.
+ *
+ * A statement is prepared once, with ? placeholders where values go, and
+ * then run any number of times: each run binds new values and steps
+ * through the result, without parsing or planning the text again. Every
+ * statement that changes data runs as its own transaction.
+ *
+ * mdb_prepare also keeps finalized statements in an LRU cache keyed by
+ * their normalized text, so a caller that sends the same SQL again gets the
+ * cached plan back. A database handle and its statements must be used by
+ * one thread at a time.
+ */
+
+/**
+ * @brief Result codes.
+ */
+enum {
+  MDB_OK = 0, ///< Success
+  MDB_ERROR = 1, ///< Failure; mdb_errmsg describes it
+  MDB_RANGE = 2, ///< Placeholder or column number out of range
+  MDB_ROW = 100, ///< mdb_step has a row ready
+  MDB_DONE = 101 ///< mdb_step has finished the statement
+};
+
+/**
+ * @brief Types of column values.
+ */
+enum {
+  MDB_NULL = 0, ///< NULL
+  MDB_INT = 1, ///< Integer: INT, BIGINT, BOOL as 0 or 1, TIMESTAMP in microseconds
+  MDB_TEXT = 2, ///< Text: TEXT and CHAR(n)
+  MDB_FLOAT = 3 ///< DOUBLE
+};
+
+/**
+ * @brief Buffer pool frames of a database opened by mdb_open.
+ */
+#define MDB_POOL_FRAMES 2048
+
+/**
+ * @brief Statements the plan cache of a new handle keeps.
+ */
+#define MDB_PLAN_CACHE_DEFAULT 64
+
+typedef struct Mdb Mdb;
+typedef struct MdbStmt MdbStmt;
+
+/**
+ * @brief Counters of a handle's plan cache.
+ */
+typedef struct {
+  uint64_t hits; ///< Prepares served from the cache
+  uint64_t misses; ///< Prepares that parsed and planned the text
+  uint64_t evictions; ///< Statements dropped to stay within the capacity
+  int entries; ///< Statements cached now
+} MdbCacheStats;
+
+/**
+ * @brief Opens a database file, creating it if needed.
+ *
+ * The write-ahead log lives next to it in <path>.wal, and crash recovery
+ * runs before the call returns.
+ *
+ * @param path Database file
+ * @param out Receives the handle, or NULL on failure
+ * @return int MDB_OK, or MDB_ERROR with the reason in mdb_errmsg(NULL)
+ */
+int mdb_open(const char* path, Mdb** out);
+
+/**
+ * @brief Closes a handle and frees the statements in its cache.
+ *
+ * Every statement prepared on it must be finalized first.
+ */
+void mdb_close(Mdb* db);
+
+/**
+ * @brief Message describing the handle's last failure.
+ *
+ * With a NULL handle, describes why the calling thread's last mdb_open
+ * failed.
+ */
+const char* mdb_errmsg(const Mdb* db);
+
+/**
+ * @brief Sets how many statements the plan cache keeps, 0 to disable it.
+ */
+void mdb_set_cache_size(Mdb* db, int n);
+
+/**
+ * @brief Reads the plan cache's counters.
+ */
+void mdb_cache_stats(const Mdb* db, MdbCacheStats* out);
+
+/**
+ * @brief Parses and plans one statement, or takes it from the plan cache.
+ *
+ * Placeholders are NULL until bound. EXPLAIN is not supported here.
+ *
+ * @param db Handle
+ * @param sql Statement text
+ * @param out Receives the statement, or NULL on failure
+ * @return int MDB_OK or MDB_ERROR
+ */
+int mdb_prepare(Mdb* db, const char* sql, MdbStmt** out);
+
+/**
+ * @brief Number of ? placeholders of a statement.
+ */
+int mdb_bind_count(const MdbStmt* s);
+
+/**
+ * @brief Binds an integer to placeholder i, counting from 1.
+ *
+ * Binding resets a statement that is part way through its rows. Values
+ * stay bound across runs until replaced. A placeholder compared with a
+ * column takes the column's type, as a value written out would.
+ *
+ * @return int MDB_OK or MDB_RANGE
+ */
+int mdb_bind_int(MdbStmt* s, int i, int32_t v);
+
+/**
+ * @brief Binds a 64-bit integer to placeholder i, counting from 1.
+ *
+ * Against a TIMESTAMP column the integer counts microseconds since
+ * 1970-01-01 UTC.
+ *
+ * @return int MDB_OK, MDB_RANGE, or MDB_ERROR if out of memory
+ */
+int mdb_bind_int64(MdbStmt* s, int i, int64_t v);
+
+/**
+ * @brief Binds a double to placeholder i, counting from 1.
+ *
+ * @return int MDB_OK, MDB_RANGE, or MDB_ERROR if out of memory
+ */
+int mdb_bind_double(MdbStmt* s, int i, double v);
+
+/**
+ * @brief Binds text to placeholder i, counting from 1; the text is copied.
+ *
+ * @param s Statement
+ * @param i Placeholder number
+ * @param text Value
+ * @param len Length of text in bytes, or -1 if it is NUL-terminated
+ * @return int MDB_OK, MDB_RANGE, or MDB_ERROR if out of memory
+ */
+int mdb_bind_text(MdbStmt* s, int i, const char* text, int len);
+
+/**
+ * @brief Binds NULL to placeholder i, counting from 1.
+ *
+ * @return int MDB_OK or MDB_RANGE
+ */
+int mdb_bind_null(MdbStmt* s, int i);
+
+/**
+ * @brief Runs a statement up to its next row.
+ *
+ * A SELECT returns MDB_ROW for each row and then MDB_DONE; other
+ * statements run to completion and return MDB_DONE. Stepping again after
+ * MDB_DONE or MDB_ERROR runs the statement again with the bound values.
+ *
+ * @return int MDB_ROW, MDB_DONE or MDB_ERROR
+ */
+int mdb_step(MdbStmt* s);
+
+/**
+ * @brief Stops a statement part way through its rows, keeping the bound values.
+ */
+void mdb_reset(MdbStmt* s);
+
+/**
+ * @brief Rows inserted, updated or deleted by the statement's last run.
+ */
+int mdb_changes(const MdbStmt* s);
+
+/**
+ * @brief Number of columns of a SELECT's rows, 0 for other statements.
+ */
+int mdb_column_count(const MdbStmt* s);
+
+/**
+ * @brief Name of column i, counting from 0, or NULL if out of range.
+ */
+const char* mdb_column_name(const MdbStmt* s, int i);
+
+/**
+ * @brief Type of column i of the current row, MDB_NULL for a NULL value.
+ */
+int mdb_column_type(const MdbStmt* s, int i);
+
+/**
+ * @brief Column i of the current row as an integer.
+ *
+ * Text is converted as by strtol; NULL reads as 0. Wider values are
+ * truncated; read them with mdb_column_int64.
+ */
+int32_t mdb_column_int(const MdbStmt* s, int i);
+
+/**
+ * @brief Column i of the current row as a 64-bit integer.
+ *
+ * A DOUBLE is truncated toward zero and a TIMESTAMP reads as microseconds
+ * since 1970-01-01 UTC. Text is converted as by strtoll; NULL reads as 0.
+ */
+int64_t mdb_column_int64(const MdbStmt* s, int i);
+
+/**
+ * @brief Column i of the current row as a double.
+ *
+ * Text is converted as by strtod; NULL reads as 0.
+ */
+double mdb_column_double(const MdbStmt* s, int i);
+
+/**
+ * @brief Column i of the current row as NUL-terminated text.
+ *
+ * Other values are formatted as the REPL prints them: integers in
+ * decimal, BOOL as true or false, TIMESTAMP as 'YYYY-MM-DD HH:MM:SS'.
+ * The text stays valid until the next
+ * step, reset or finalize.
+ *
+ * @return const char* The text, or NULL for NULL, out of range or out of memory
+ */
+const char* mdb_column_text(MdbStmt* s, int i);
+
+/**
+ * @brief Length in bytes of column i of the current row as text.
+ */
+int mdb_column_bytes(MdbStmt* s, int i);
+
+/**
+ * @brief Releases a statement, returning it to the plan cache if it has room.
+ *
+ * @return int MDB_OK
+ */
+int mdb_finalize(MdbStmt* s);
+
+/**
+ * @brief Prepares, runs to completion and finalizes one statement.
+ *
+ * Rows of a SELECT are discarded.
+ *
+ * @return int MDB_OK or MDB_ERROR
+ */
+int mdb_exec(Mdb* db, const char* sql);
@@ -4,6 +4,16 @@
 
 #define PAGE_SIZE 8192
 
+/**
+ * @brief Page flag: the slot directory has deleted slots that can be reused.
+ */
+#define PAGE_FREE_SLOTS 0x1
+
+/**
+ * @brief Page flag: a free-space map page in the layout indexed by page ID.
+ */
+#define PAGE_FSM_INDEXED 0x2
+
 /**
  * @brief Page header structure containing metadata for database pages
  * 
@@ -16,7 +26,8 @@ typedef struct {
   uint16_t free_start;  ///< Offset to the start of free space in the page
   uint16_t free_end;    ///< Offset to the end of free space in the page
   uint16_t slot_count;  ///< Number of slots (records) currently in the page
-  uint16_t flags;       ///< Page flags for various page states and properties
+  uint16_t frag_bytes : 13; ///< Bytes of deleted or shrunk records not yet reclaimed by page_compact
+  uint16_t flags : 3;       ///< PAGE_* flag bits
 
   uint32_t next_page_id; ///< ID of the next page in the linked list (0xFFFFFFFF if none)
 } PageHeader;
@@ -81,11 +92,24 @@ void page_init(Page* p, uint32_t page_id);
  */
 bool page_has_space(Page* p, uint16_t record_len);
 
+/**
+ * @brief Returns the number of bytes available for new records and slots.
+ * 
+ * Includes fragmented bytes that page_insert reclaims by compacting the page.
+ * A record of length n fits when n + sizeof(Slot) does not exceed this value.
+ * 
+ * @param p Pointer to the Page to inspect
+ * @return uint16_t Free space in bytes
+ */
+uint16_t page_free_space(Page* p);
+
 /**
  * @brief Inserts a new record into the Page.
  * 
  * This function adds a new record to the Page's data section and updates the
- * corresponding Slot metadata. It assumes that there is enough space available.
+ * corresponding Slot metadata. A deleted slot is reused when there is one.
+ * If the record only fits once the space of deleted and shrunk records is
+ * reclaimed, the page is compacted first.
  * 
  * @param p Pointer to the Page where the record will be inserted
  * @param rec Pointer to the record data to be inserted
@@ -112,10 +136,37 @@ bool page_get(Page* p, int slot_id, uint8_t** out, uint16_t* len);
  * @brief Marks a record in the Page as deleted by its slot ID.
  * 
  * This function updates the Slot metadata to indicate that the record is deleted.
- * The actual data remains in the Page, but it is considered inactive.
+ * The record's bytes are counted in frag_bytes until the page is compacted,
+ * and its slot ID may be reused by a later insert.
  * 
  * @param p Pointer to the Page containing the record
  * @param slot_id The slot ID of the record to delete
  * @return true if the record was successfully marked as deleted, false otherwise
  */
 bool page_delete(Page* p, int slot_id);
+
+/**
+ * @brief Replaces a record, keeping its slot ID.
+ * 
+ * A record that shrinks is overwritten in place. One that grows is moved to
+ * the page's free space, compacting the page if needed.
+ * 
+ * @param p Pointer to the Page containing the record
+ * @param slot_id The slot ID of the record to replace
+ * @param rec Pointer to the new record data
+ * @param len Length of the new record in bytes
+ * @return true on success, false if the slot is not live or the page is too full
+ */
+bool page_update(Page* p, int slot_id, const uint8_t* rec, uint16_t len);
+
+/**
+ * @brief Defragments the Page.
+ * 
+ * Moves live records together at the start of the data area so that all
+ * free and fragmented space becomes one contiguous gap, and trims deleted
+ * slots from the end of the slot directory. Slot IDs of live records do
+ * not change.
+ * 
+ * @param p Pointer to the Page to compact
+ */
+void page_compact(Page* p);
@@ -0,0 +1,273 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "arena.h"
+#include "catalog.h"
+#include "row.h"
+
+// ============================================================================
+// Abstract syntax tree
+// ============================================================================
+
+/**
+ * @brief Kinds of literal values.
+ */
+typedef enum {
+  LIT_NULL, ///< NULL
+  LIT_INT, ///< Integer literal
+  LIT_TEXT, ///< Quoted string literal
+  LIT_FLOAT, ///< Number with a fraction or an exponent
+  LIT_BOOL ///< TRUE or FALSE
+} LiteralKind;
+
+/**
+ * @brief A literal as written in the statement.
+ *
+ * Every literal keeps its text as written, so it can be stored into a
+ * column of any type and is converted the same way as a value inserted
+ * as text. A ? placeholder is a literal whose value is filled in before
+ * each execution; it is NULL until then.
+ */
+typedef struct {
+  LiteralKind kind; ///< Kind of literal
+  int64_t i64; ///< Value of an integer literal, or 0 / 1 for LIT_BOOL
+  const char* text; ///< Unescaped, NUL-terminated text of any literal but NULL
+  uint32_t len; ///< Length of text in bytes
+  int param; ///< Number of the ? placeholder, from 1, or 0 for a value written out
+} Literal;
+
+/**
+ * @brief Kinds of expression nodes.
+ */
+typedef enum {
+  EXPR_COLUMN, ///< Column reference
+  EXPR_LITERAL, ///< Literal value
+  EXPR_CMP, ///< Comparison of two operands
+  EXPR_AND, ///< Conjunction
+  EXPR_OR, ///< Disjunction
+  EXPR_NOT, ///< Negation of the left operand
+  EXPR_BETWEEN, ///< left BETWEEN list[0] AND list[1]
+  EXPR_IN, ///< left IN (list...)
+  EXPR_LIKE, ///< left LIKE right, with % and _ wildcards
+  EXPR_AGG ///< Aggregate function of left, or of the rows for COUNT(*)
+} ExprKind;
+
+/**
+ * @brief Comparison operators.
+ */
+typedef enum {
+  CMP_EQ, ///< =
+  CMP_NE, ///< <> or !=
+  CMP_LT, ///< <
+  CMP_LE, ///< <=
+  CMP_GT, ///< >
+  CMP_GE ///< >=
+} CmpOp;
+
+/**
+ * @brief Aggregate functions.
+ */
+typedef enum {
+  AGG_COUNT_STAR, ///< COUNT(*): number of rows
+  AGG_COUNT, ///< COUNT(col): number of non-NULL values
+  AGG_SUM, ///< SUM(col)
+  AGG_MIN, ///< MIN(col)
+  AGG_MAX, ///< MAX(col)
+  AGG_AVG ///< AVG(col)
+} AggFunc;
+
+/**
+ * @brief A node of an expression tree.
+ *
+ * The parser fills in the syntax; the planner then binds column references
+ * to tuple positions and converts literals to the type they are compared
+ * with, so evaluation does no name lookups or parsing.
+ */
+typedef struct Expr {
+  ExprKind kind; ///< Kind of node
+  CmpOp op; ///< Operator of an EXPR_CMP node
+  AggFunc agg; ///< Function of an EXPR_AGG node
+  struct Expr* left; ///< First operand of CMP, AND, OR, NOT, BETWEEN, IN and LIKE; argument of AGG
+  struct Expr* right; ///< Second operand of CMP, AND and OR; pattern of LIKE
+  struct Expr** list; ///< Bounds of BETWEEN or values of IN
+  int nlist; ///< Number of entries in list
+  const char* table; ///< Qualifier of a column reference, or NULL
+  const char* column; ///< Name of a referenced column
+  const char* alias; ///< Output name of a select item given with AS, or NULL
+  Literal lit; ///< Value of a literal node as written
+  int col_idx; ///< Bound tuple position of a column reference
+  RowField value; ///< Bound value of a literal node
+  ColumnType bind_type; ///< Type a literal is converted to first: that of the column it is compared with
+  int32_t* in_i32; ///< Sorted distinct non-NULL values of an IN list on INT, set by the planner
+  int nin_i32; ///< Number of values in in_i32
+  bool in_has_null; ///< Whether an IN list contains NULL
+} Expr;
+
+/**
+ * @brief Kinds of statements.
+ */
+typedef enum {
+  STMT_CREATE_TABLE,
+  STMT_CREATE_INDEX,
+  STMT_INSERT,
+  STMT_COPY,
+  STMT_SELECT,
+  STMT_UPDATE,
+  STMT_DELETE,
+  STMT_VACUUM
+} StmtKind;
+
+/**
+ * @brief CREATE TABLE name (col type, ...)
+ */
+typedef struct {
+  const char* table; ///< Name of the new table
+  int ncols; ///< Number of columns
+  ColumnDef cols[CATALOG_MAX_COLS]; ///< Column definitions
+} CreateTableStmt;
+
+/**
+ * @brief CREATE INDEX name ON table (col)
+ */
+typedef struct {
+  const char* name; ///< Name of the new index
+  const char* table; ///< Indexed table
+  const char* column; ///< Indexed column
+} CreateIndexStmt;
+
+/**
+ * @brief One parenthesized row of an INSERT.
+ */
+typedef struct {
+  int nvalues; ///< Number of values
+  Literal* values; ///< Values in column order
+} InsertRow;
+
+/**
+ * @brief INSERT INTO table VALUES (...), (...)
+ */
+typedef struct {
+  const char* table; ///< Target table
+  int nrows; ///< Number of rows
+  InsertRow* rows; ///< Rows to insert
+} InsertStmt;
+
+/**
+ * @brief COPY table FROM 'file' [HEADER]
+ */
+typedef struct {
+  const char* table; ///< Target table
+  const char* path; ///< CSV file to load
+  bool header; ///< Whether the first line is a header to skip
+} CopyStmt;
+
+/**
+ * @brief One [INNER] JOIN table ON expr of a SELECT.
+ */
+typedef struct {
+  const char* table; ///< Joined table
+  Expr* on; ///< Join condition
+} JoinClause;
+
+/**
+ * @brief One key of an ORDER BY.
+ */
+typedef struct {
+  Expr* column; ///< Column reference, or the name of a select item
+  bool desc; ///< Whether the order is descending
+} OrderItem;
+
+/**
+ * @brief SELECT * | item, ... FROM table [JOIN table ON expr ...] [WHERE expr]
+ *        [GROUP BY col, ...] [ORDER BY col [ASC|DESC], ...] [LIMIT n] [OFFSET m]
+ */
+typedef struct {
+  const char* table; ///< Source table, the first one when there are joins
+  int njoins; ///< Number of JOIN clauses
+  JoinClause* joins; ///< Tables joined to the source, in order
+  int nitems; ///< Number of select items, 0 for *
+  Expr** items; ///< Column references and aggregates
+  Expr* where; ///< Filter, or NULL
+  int ngroup; ///< Number of GROUP BY columns
+  Expr** group_by; ///< GROUP BY column references
+  int norder; ///< Number of ORDER BY keys
+  OrderItem* order_by; ///< ORDER BY keys, most significant first
+  int64_t limit; ///< Maximum number of rows, or -1 for no limit
+  int64_t offset; ///< Rows skipped before the first one returned
+} SelectStmt;
+
+/**
+ * @brief One col = value assignment of an UPDATE.
+ */
+typedef struct {
+  const char* column; ///< Assigned column
+  Literal value; ///< New value
+} SetClause;
+
+/**
+ * @brief UPDATE table SET col = value, ... [WHERE expr]
+ */
+typedef struct {
+  const char* table; ///< Target table
+  int nsets; ///< Number of assignments
+  SetClause* sets; ///< Assignments
+  Expr* where; ///< Filter, or NULL
+} UpdateStmt;
+
+/**
+ * @brief DELETE FROM table [WHERE expr]
+ */
+typedef struct {
+  const char* table; ///< Target table
+  Expr* where; ///< Filter, or NULL
+} DeleteStmt;
+
+/**
+ * @brief VACUUM table [pages]
+ */
+typedef struct {
+  const char* table; ///< Table to vacuum
+  uint32_t max_pages; ///< Pages for one incremental step, 0 for the whole table
+} VacuumStmt;
+
+/**
+ * @brief A parsed statement.
+ */
+typedef struct {
+  StmtKind kind; ///< Kind of statement, selecting the union member
+  bool explain; ///< Set by an EXPLAIN prefix: show the plan instead of running it
+  int nparams; ///< Number of ? placeholders
+  Literal** params; ///< Placeholders in order of appearance
+  union {
+    CreateTableStmt create_table;
+    CreateIndexStmt create_index;
+    InsertStmt insert;
+    CopyStmt copy;
+    SelectStmt select;
+    UpdateStmt update;
+    DeleteStmt del;
+    VacuumStmt vacuum;
+  };
+} Stmt;
+
+// ============================================================================
+// Parser
+// ============================================================================
+
+/**
+ * @brief Parses one SQL statement.
+ *
+ * A recursive-descent parser over the lexer's tokens. WHERE clauses accept
+ * comparisons of columns and literals, BETWEEN, IN lists and LIKE, combined
+ * with AND, OR, NOT and parentheses. A trailing semicolon is optional. The statement and
+ * everything it points to are allocated from the arena. Wherever a value may
+ * be written, a ? placeholder may stand in for it; st->params lists them.
+ *
+ * @param a Arena that owns the result
+ * @param sql Statement text
+ * @param err Buffer for an error message
+ * @param err_cap Capacity of err
+ * @return Stmt* The statement, or NULL on a syntax error
+ */
+Stmt* parse_statement(Arena* a, const char* sql, char* err, size_t err_cap);
@@ -0,0 +1,94 @@
+#pragma once
+#include "exec.h"
+#include "parser.h"
+
+/**
+ * @brief Opens a table for a statement, allocating it from the arena.
+ *
+ * The table is also listed in ctx->tables, so plan_refresh can re-read it.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param name Table name
+ * @return TableInfo* The table, or NULL if it does not exist
+ */
+TableInfo* plan_open_table(ExecCtx* ctx, const char* name);
+
+/**
+ * @brief Binds an expression to the output columns of an operator.
+ *
+ * Column references are resolved to tuple positions and literals are
+ * converted to the type of the column they are compared with. A literal
+ * that cannot take that type (such as non-numeric text against an INT
+ * column) binds as NULL, so the comparison never matches.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param e Expression to bind in place
+ * @param input Operator whose output the expression is evaluated against
+ * @return true on success, false for unknown or ambiguous columns
+ */
+bool plan_bind_expr(ExecCtx* ctx, Expr* e, const Operator* input);
+
+/**
+ * @brief Plans the access path for a table and an optional filter.
+ *
+ * Uses an index scan when a conjunct of the filter compares an indexed
+ * column with a literal, preferring equality over ranges, and a sequential
+ * scan otherwise. The full filter is applied on top either way. Output
+ * tuples are the table's columns with their RIDs, which UPDATE and DELETE
+ * use to find the rows they change.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param t Open table
+ * @param where Filter to bind and apply, or NULL
+ * @return Operator* Root of the plan, or NULL on failure
+ */
+Operator* plan_scan(ExecCtx* ctx, TableInfo* t, Expr* where);
+
+/**
+ * @brief Plans a SELECT statement.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param st Parsed statement
+ * @return Operator* Root of the plan, or NULL on failure
+ */
+Operator* plan_select(ExecCtx* ctx, SelectStmt* st);
+
+/**
+ * @brief Re-reads the tables of a plan that is about to run again.
+ *
+ * A plan copies each table's heap and index roots when it is built, and
+ * those move as rows are added. While the catalog is unchanged only those
+ * are read again. Returns false if a table is gone or its indexes changed,
+ * in which case the statement must be planned anew.
+ */
+bool plan_refresh(ExecCtx* ctx);
+
+/**
+ * @brief A placeholder of a planned SELECT.
+ */
+typedef struct {
+  Expr* expr; ///< Literal node of the placeholder, NULL if the plan does not read it
+  Expr* in; ///< IN expression whose list holds the placeholder, or NULL
+} PlanParam;
+
+/**
+ * @brief Finds the nodes a planned SELECT reads its placeholders from.
+ *
+ * @param st Statement planned by plan_select
+ * @param out One entry per placeholder of st, in order, zeroed by the caller
+ */
+void plan_params(SelectStmt* st, PlanParam* out);
+
+/**
+ * @brief Converts a placeholder's new value in place in its plan.
+ *
+ * The value takes the type the placeholder was bound with at planning, as
+ * it would had it been written out, so the plan runs with it unchanged; an
+ * IN list holding it is sorted again and index scans seek to it when they
+ * open. Only placeholders whose values changed need converting.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param p Placeholder found by plan_params
+ * @return true on success
+ */
+bool plan_bind_param(ExecCtx* ctx, const PlanParam* p);
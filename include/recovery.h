@@ -0,0 +1,44 @@
+#pragma once
+#include "buffer.h"
+
+/**
+ * @brief What a recovery pass did, for the caller to report.
+ */
+typedef struct {
+  int records; ///< Log records read, 0 when the log was empty
+  int redone; ///< Changes repeated in pages that had not seen them
+  int undone; ///< Changes of uncommitted transactions rolled back
+} RecoveryStats;
+
+/**
+ * @brief Replays the write-ahead log after a crash.
+ * 
+ * Runs an ARIES-style pass over the attached log: analysis finds the
+ * committed transactions, redo repeats history for every logged change not
+ * yet reflected in its page (page LSN < record LSN), and undo rolls back the
+ * changes of transactions that never committed, newest first, using their
+ * before images. Finishes with a checkpoint, leaving an empty log.
+ * 
+ * Must run before anything else fetches pages through the buffer pool. Does
+ * nothing when no log is attached. Prints nothing; the caller decides
+ * whether to report the counts.
+ * 
+ * @param bp Pointer to the BufferPool with an attached LogManager
+ * @param out Receives what the pass did
+ */
+void recovery_run(BufferPool* bp, RecoveryStats* out);
+
+/**
+ * @brief Rolls back what the calling thread's transaction has changed.
+ * 
+ * Forces the log, then restores the before images of the transaction's
+ * changes, newest first, through the buffer pool. The restores are logged
+ * in the same transaction, so committing it afterwards leaves the pages as
+ * they were when it began, and a crash before that commit is undone by
+ * recovery like any other. Pages the transaction allocated are not handed
+ * back. All pages it changed must be unpinned.
+ * 
+ * @param bp Pointer to the BufferPool with an attached LogManager
+ * @return bool false if no log is attached or the log could not be forced
+ */
+bool recovery_rollback(BufferPool* bp);
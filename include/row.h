@@ -1,14 +1,126 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include "catalog.h"
 
+/**
+ * @brief Encoded rows larger than this move their largest TEXT values out of line.
+ *
+ * Keeps at least eight rows on a heap page, so a long value does not cost
+ * a scan that never looks at it a page read per row.
+ */
+#define ROW_TOAST_TARGET (PAGE_SIZE / 8)
+
+/**
+ * @brief Marks a TEXT value as out of line.
+ *
+ * Set in the length prefix of a format 1 field or the start offset of a
+ * format 2 value. The value's bytes are then replaced by its u32 length
+ * and the u32 page ID of its overflow chain. Inline values are always
+ * shorter than this, so rows written before overflow pages existed decode
+ * unchanged.
+ */
+#define ROW_TEXT_EXTERNAL 0x8000
+
+/**
+ * @brief Marks the column count at the start of a row as format 2.
+ *
+ * A format 1 row stores its non-NULL values in column order, each TEXT
+ * behind a u16 length, so reaching a column means walking the ones before
+ * it. A format 2 row stores every fixed-width column first, at an offset
+ * the schema alone decides, with zeros for NULL; then, if there are
+ * variable-length columns, a u16 start offset for each of them, counted
+ * from the start of the row, and the end of the last one; then the
+ * variable-length values back to back. Any column is found without looking
+ * at the others. Rows are written in format 2, and format 1 rows still
+ * decode until they are next updated; they only ever hold INT and TEXT.
+ *
+ * Fixed-width values are little-endian: INT in 4 bytes, BIGINT, TIMESTAMP
+ * and DOUBLE in 8, BOOL in 1, and CHAR(n) in n bytes padded with spaces.
+ * TEXT is the only variable-length type.
+ */
+#define ROW_FORMAT_V2 0x8000
+
+/**
+ * @brief Longest CHAR(n) column.
+ */
+#define ROW_CHAR_MAX 255
+
+/**
+ * @brief How values of a column type are held in a RowField or ColumnVector.
+ */
+typedef enum {
+  VAL_I32, ///< In i32: INT, and BOOL as 0 or 1
+  VAL_I64, ///< In i64: BIGINT, and TIMESTAMP in microseconds
+  VAL_F64, ///< In f64: DOUBLE
+  VAL_TEXT ///< As text: TEXT, and CHAR(n) without its trailing spaces
+} ValueKind;
+
+/**
+ * @brief The representation of a column type's values.
+ */
+static inline ValueKind row_value_kind(ColumnType type) {
+  switch (type) {
+    case COL_INT:
+    case COL_BOOL:
+      return VAL_I32;
+    case COL_BIGINT:
+    case COL_TIMESTAMP:
+      return VAL_I64;
+    case COL_DOUBLE:
+      return VAL_F64;
+    default:
+      return VAL_TEXT;
+  }
+}
+
+/**
+ * @brief Whether a column type holds text, TEXT or CHAR(n).
+ */
+static inline bool row_is_text(ColumnType type) {
+  return type == COL_TEXT || type == COL_CHAR;
+}
+
+/**
+ * @brief Whether a column type is a number, INT, BIGINT or DOUBLE.
+ *
+ * Numbers compare with each other whatever their types, by value.
+ */
+static inline bool row_is_numeric(ColumnType type) {
+  return type == COL_INT || type == COL_BIGINT || type == COL_DOUBLE;
+}
+
+/**
+ * @brief Name of a column type as SQL writes it, such as "BIGINT".
+ */
+const char* row_type_name(ColumnType type);
+
+/**
+ * @brief Works out where format 2 rows keep each column of a schema.
+ *
+ * Sets row_off of every column: the offset of a fixed-width value, or of
+ * a variable-length value's entry in the offset array. Rows can be
+ * encoded with any schema, but only decoded with one laid out by this;
+ * table_open does it for every table.
+ *
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ */
+void row_layout(ColumnDef* cols, int ncols);
+
 /**
  * @brief Encodes a row of data based on the provided column definitions.
- * 
+ *
  * This function takes an array of column definitions and their corresponding
  * string values, encodes them into a binary format, and writes the result
- * into the provided output buffer.
- * 
+ * into the provided output buffer, in format 2. If the row would exceed ROW_TOAST_TARGET,
+ * its largest TEXT values are stored in overflow pages until it fits.
+ * Values are parsed as by row_parse_value, and a CHAR(n) value may not be
+ * longer than n.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages, or NULL to keep
+ *        every value inline
  * @param cols Array of column definitions
  * @param ncols Number of columns
  * @param values Array of string values corresponding to each column
@@ -17,16 +129,53 @@
  * @param out_cap Capacity of the output buffer
  * @return int The length of the encoded row data, or -1 on error
  */
-int row_encode(const ColumnDef* cols, int ncols,
+int row_encode(BufferPool* bp, const ColumnDef* cols, int ncols,
                const char** values, int nvalues,
                uint8_t* out, int out_cap);
 
+/**
+ * @brief Finds the first value row_encode would reject as invalid for its column.
+ *
+ * @param cols Array of column definitions
+ * @param values Values, NULL for a NULL value
+ * @param nvalues Number of values, at most the number of columns
+ * @return int Index of the first invalid value, or -1 if all are valid
+ */
+int row_invalid_value(const ColumnDef* cols, const char** values, int nvalues);
+
+/**
+ * @brief Encodes a copy of a row with some columns replaced.
+ *
+ * The other columns are copied as stored, so out-of-line values that are
+ * not replaced keep their overflow chains and are not read.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data
+ * @param row_len Length of the binary row data
+ * @param idx Ordinals of the columns to replace
+ * @param values New values as text, NULL / "null" for SQL NULL
+ * @param nset Number of columns to replace
+ * @param out Output buffer to write the encoded row data
+ * @param out_cap Capacity of the output buffer
+ * @return int The length of the encoded row data, or -1 on error
+ */
+int row_set_fields(BufferPool* bp, const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len,
+                   const int* idx, const char** values, int nset,
+                   uint8_t* out, int out_cap);
+
 /**
  * @brief Decodes a binary row of data into a human-readable string format.
- * 
+ *
  * This function takes a binary-encoded row and decodes it based on the
  * provided column definitions, producing a textual representation of the row.
- * 
+ * Out-of-line values are read back in full. Like snprintf, the output is
+ * truncated to fit and the full length is returned, so a result of out_cap
+ * or more means the caller should retry with a larger buffer.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages
  * @param cols Array of column definitions
  * @param ncols Number of columns
  * @param row Binary-encoded row data
@@ -35,40 +184,167 @@ int row_encode(const ColumnDef* cols, int ncols,
  * @param out_cap Capacity of the output text buffer
  * @return int The length of the decoded text, or -1 on error
  */
-int row_decode(const ColumnDef* cols, int ncols,
+int row_decode(BufferPool* bp, const ColumnDef* cols, int ncols,
                const uint8_t* row, int row_len,
                char* out_text, int out_cap);
 
 /**
- * @brief Represents a decoded value from a row.
- * 
- * This structure holds the type of the column, a flag indicating if the value
- * is NULL, and the actual value which can be either an integer or a text string.
+ * @brief A single column located inside an encoded row.
+ *
+ * Inline TEXT values point directly into the row bytes and are not
+ * NUL-terminated. Out-of-line values have no text pointer; use
+ * row_field_text to read them. The executor passes values around in this
+ * form too, so a value read from a row is never copied or converted.
  */
 typedef struct {
   ColumnType type; ///< Data type of the column
-  int is_null; ///< Flag indicating if the value is NULL
-  int32_t i32; ///< Integer value (if type is COL_INT)
-  const char* text; ///< Text value (if type is COL_TEXT)
-} DecodedValue;
+  bool is_null; ///< Set for SQL NULL; the other fields are then unset
+  union {
+    int32_t i32; ///< Value of a VAL_I32 type
+    int64_t i64; ///< Value of a VAL_I64 type
+    double f64; ///< Value of a VAL_F64 type
+  };
+  const uint8_t* text; ///< Start of inline text bytes, or NULL if out of line
+  uint32_t text_len; ///< Length of the text in bytes (VAL_TEXT types)
+  uint32_t toast_pid; ///< First overflow page, or INVALID_PID if inline
+} RowField;
 
 /**
- * @brief Decodes a binary row of data into an array of DecodedValue structures.
- * 
- * This function takes a binary-encoded row and decodes it based on the
- * provided column definitions, populating an array of DecodedValue structures
- * with the decoded values.
- * 
+ * @brief Parses a value written as text into a column type.
+ *
+ * Integers must be in range, BOOL is true / false / t / f / 1 / 0 in any
+ * case, and TIMESTAMP is 'YYYY-MM-DD[ HH:MM[:SS[.ffffff]]]' in UTC, with
+ * T also accepted between date and time, or a count of microseconds since
+ * 1970-01-01 written as an integer. Text points into v; a CHAR(n)
+ * value loses its trailing spaces but is not checked against n.
+ *
+ * @param type Column type
+ * @param v NUL-terminated text
+ * @param out Output parameter for the value
+ * @return int 0 on success, -1 if v is not a value of the type
+ */
+int row_parse_value(ColumnType type, const char* v, RowField* out);
+
+/**
+ * @brief Formats a non-NULL value that is not text.
+ *
+ * Integers are written in decimal, BOOL as true or false, DOUBLE with as
+ * many digits as it takes to read back the same value, and TIMESTAMP as
+ * 'YYYY-MM-DD HH:MM:SS' with microseconds only when there are any. Like
+ * snprintf, returns the full length even when out is too small.
+ *
+ * @param v Value of a type other than TEXT and CHAR(n)
+ * @param out Output buffer
+ * @param cap Capacity of out
+ * @return int Length of the text
+ */
+int row_format_value(const RowField* v, char* out, size_t cap);
+
+/**
+ * @brief Reads one column of an encoded row without decoding the others.
+ *
+ * A format 2 row gives the column's position directly; a format 1 row is
+ * walked up to it. Either way predicates can be evaluated against the
+ * binary row directly.
+ *
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data
+ * @param row_len Length of the binary row data
+ * @param idx Ordinal of the column to read
+ * @param out Output parameter for the column value
+ * @return int 1 if the value is present, 0 if it is NULL, -1 on error
+ */
+int row_get_field(const ColumnDef* cols, int ncols,
+                  const uint8_t* row, int row_len,
+                  int idx, RowField* out);
+
+/**
+ * @brief Reads every column of an encoded row in one pass.
+ *
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data
+ * @param row_len Length of the binary row data
+ * @param out Output array of ncols fields
+ * @return int 0 on success, -1 if the row is malformed
+ */
+int row_get_fields(const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len, RowField* out);
+
+/**
+ * @brief Reads the wanted columns of an encoded row in one pass.
+ *
+ * Unwanted columns are not read: a format 2 row is indexed straight to
+ * the wanted ones, and a format 1 row is walked over the others by their
+ * lengths and only as far as column nread - 1. Columns not read come out
+ * as NULL.
+ *
  * @param cols Array of column definitions
  * @param ncols Number of columns
  * @param row Binary-encoded row data
  * @param row_len Length of the binary row data
- * @param out_vals Output array to write the decoded values
- * @param text_scratch Scratch buffer for storing text values
- * @param scratch_cap Capacity of the scratch buffer
- * @return int The number of decoded values, or -1 on error
- */
-int row_decode_values(const ColumnDef* cols, int ncols,
-                      const uint8_t* row, int row_len,
-                      DecodedValue* out_vals,
-                      char* text_scratch, int scratch_cap);
+ * @param want Per column, whether to read it; NULL reads all of them
+ * @param nread Number of leading columns to walk, at most ncols
+ * @param out Output array of ncols fields
+ * @return int 0 on success, -1 if the row is malformed
+ */
+int row_get_wanted(const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len,
+                   const bool* want, int nread, RowField* out);
+
+typedef struct ColumnVector ColumnVector;
+
+/**
+ * @brief Copies one column of a set of encoded rows into a column vector.
+ *
+ * Values go straight from the row bytes into the vector's typed array, a
+ * column at a time, without decoding the rows into RowFields first. If the
+ * vector has no room left for a row's inline TEXT, the rows before it are
+ * kept and the count returned is short.
+ *
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ * @param col Column to copy
+ * @param rows Binary-encoded rows
+ * @param lens Length of each row
+ * @param idx Entries of rows to copy, in order, or NULL for the first n
+ * @param n Number of rows to copy
+ * @param v Vector of the column's type
+ * @param pos Row of the vector the first value goes to
+ * @return int Rows copied, fewer than n if the vector is full, -1 if a row is malformed
+ */
+int row_gather_column(const ColumnDef* cols, int ncols, int col,
+                      uint8_t* const* rows, const uint16_t* lens, const uint16_t* idx, int n,
+                      ColumnVector* v, int pos);
+
+/**
+ * @brief Copies the leading bytes of a TEXT field.
+ *
+ * Out-of-line values are read only as far as the first n bytes.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages
+ * @param f Field located by row_get_field
+ * @param out Output buffer of at least n bytes
+ * @param n Maximum number of bytes to copy
+ * @return uint32_t Number of bytes copied
+ */
+uint32_t row_field_text(BufferPool* bp, const RowField* f, uint8_t* out, uint32_t n);
+
+/**
+ * @brief Frees the overflow chains of a row that is being removed.
+ *
+ * Chains also referenced by keep are left alone, so after an update the old
+ * row can be released against the new one and only replaced values go.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages
+ * @param cols Array of column definitions
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data
+ * @param row_len Length of the binary row data
+ * @param keep Row whose chains must survive, or NULL
+ * @param keep_len Length of keep
+ */
+void row_release(BufferPool* bp, const ColumnDef* cols, int ncols,
+                 const uint8_t* row, int row_len,
+                 const uint8_t* keep, int keep_len);
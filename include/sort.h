@@ -0,0 +1,65 @@
+#pragma once
+#include <stdint.h>
+#include "exec.h"
+
+/**
+ * @brief Fewest runs merged at once, whatever the budget.
+ */
+#define SORT_MIN_FANIN 8
+
+/**
+ * @brief Most runs merged at once.
+ */
+#define SORT_MAX_FANIN 256
+
+/**
+ * @brief One key of a Sort operator.
+ */
+typedef struct {
+  int col; ///< Input column
+  bool desc; ///< Whether the order is descending
+} SortKey;
+
+/**
+ * @brief Counters of a Sort operator's last run.
+ */
+typedef struct {
+  uint64_t rows; ///< Rows read from the input
+  uint32_t runs; ///< Sorted runs written to temporary files
+  uint32_t merge_passes; ///< Merges that wrote a longer run instead of output
+  bool top_n; ///< Whether the rows fit a bounded heap of the limit
+} SortStats;
+
+/**
+ * @brief Orders rows by key columns.
+ *
+ * Keys compare like the predicates do, with NULL after every value in
+ * ascending order and before them in descending order; rows with equal
+ * keys come in no particular order. Each row carries a normalized prefix
+ * of its first key, so most comparisons are one integer compare.
+ *
+ * Rows are copied into memory and sorted there while they fit
+ * ctx->work_mem. Past that, each full memory load is sorted and written
+ * to a temporary file as a run, and the runs are merged with a loser
+ * tree, as many at a time as the budget has read buffers for (at least
+ * SORT_MIN_FANIN); if there are more, groups of them are first merged
+ * into longer runs.
+ *
+ * With a limit, only the best `limit` rows are kept, in a bounded heap
+ * whose worst row is replaced by any better one, so the input is read once
+ * and memory holds `limit` rows. If those outgrow the budget, the sort
+ * falls back to runs and stops after `limit` rows.
+ *
+ * @param ctx Statement state
+ * @param child Input operator
+ * @param keys Sort keys, most significant first
+ * @param nkeys Number of keys, at least 1
+ * @param limit Number of rows wanted, or -1 for all
+ */
+Operator* exec_sort(ExecCtx* ctx, Operator* child, const SortKey* keys, int nkeys,
+                    int64_t limit);
+
+/**
+ * @brief Reads the counters of a Sort operator.
+ */
+void exec_sort_stats(const Operator* op, SortStats* out);
@@ -0,0 +1,93 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "exec.h"
+
+/**
+ * @brief Bytes a SpillReader reads from its file at a time.
+ */
+#define SPILL_READ_BUF (64 * 1024)
+
+/**
+ * @brief Creates a temporary file for rows that do not fit in memory.
+ *
+ * The file is removed when it is closed.
+ *
+ * @return FILE* The file, or NULL with ctx->err set
+ */
+FILE* spill_create(ExecCtx* ctx);
+
+/**
+ * @brief Appends a row of values to a temporary file.
+ *
+ * Inline TEXT is written out in full. Out-of-line values are written as
+ * their length and overflow page, which stay valid for the whole statement.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param f File to append to
+ * @param vals Values of the row
+ * @param n Number of values
+ */
+bool spill_write(ExecCtx* ctx, FILE* f, const RowField* vals, int n);
+
+/**
+ * @brief Appends some columns of one row of a batch to a temporary file.
+ *
+ * @param ctx Statement state; ctx->err is set on failure
+ * @param f File to append to
+ * @param b Batch holding the row
+ * @param row Row of the batch's vectors
+ * @param cols Batch columns to write, in order
+ * @param n Number of columns
+ */
+bool spill_write_row(ExecCtx* ctx, FILE* f, const Batch* b, int row, const int* cols, int n);
+
+/**
+ * @brief Reads the rows of a temporary file back as batches.
+ *
+ * Batches have the layout of the operator the rows came from, with vectors
+ * for the columns that were written only.
+ */
+typedef struct {
+  FILE* f; ///< File being read, or NULL
+  uint8_t* buf; ///< Read buffer of SPILL_READ_BUF bytes
+  size_t pos; ///< Next unread byte of buf
+  size_t len; ///< Bytes in buf
+  int ncols; ///< Columns of the batches produced
+  int nread; ///< Columns stored per row
+  int cols[EXEC_MAX_COLS]; ///< Batch column of each stored value
+  ColumnType types[EXEC_MAX_COLS]; ///< Type of each batch column
+  bool vecs_ready; ///< Whether vecs have been allocated
+  ColumnVector vecs[EXEC_MAX_COLS]; ///< Vectors of the batch columns read
+  uint8_t text[PAGE_SIZE]; ///< Inline TEXT value being read
+} SpillReader;
+
+/**
+ * @brief Describes the rows a reader will read.
+ *
+ * @param r Reader to initialize
+ * @param layout Columns of the batches to produce
+ * @param ncols Number of entries in layout
+ * @param cols Batch column of each value stored per row, as given to spill_write_row
+ * @param n Number of values stored per row
+ */
+void spill_reader_init(SpillReader* r, const ExecColumn* layout, int ncols, const int* cols,
+                       int n);
+
+/**
+ * @brief Starts reading a file from its beginning; the reader takes it over.
+ */
+bool spill_reader_open(ExecCtx* ctx, SpillReader* r, FILE* f);
+
+/**
+ * @brief Reads the next batch of rows.
+ *
+ * @return int 1 for a batch with at least one row, 0 at the end of the file, -1 on failure
+ */
+int spill_reader_next(ExecCtx* ctx, SpillReader* r, Batch* out);
+
+/**
+ * @brief Closes the file being read, if any. Safe to call twice.
+ */
+void spill_reader_close(SpillReader* r);
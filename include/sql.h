@@ -1,202 +1,146 @@
 #pragma once
 #include "catalog.h"
-
-/**
- * @brief Enumeration of filter operations for WHERE clauses
- * 
- * This enumeration defines the types of comparison operations
- * that can be used in SQL WHERE clauses for filtering data.
- */
-typedef enum {
-  OP_EQ, ///< Equal operation
-  OP_LT, ///< Less than operation
-  OP_GT ///< Greater than operation
-} FilterOp;
-
-/**
- * @brief Filter structure for WHERE clause operations
- * 
- * This structure represents a filter condition used in WHERE clauses
- * for querying data with comparison operations.
- */
-typedef struct {
-  char col[COL_NAME_MAX]; ///< Column name to filter on
-  FilterOp op; ///< Filter operation (=, <, >)
-  char value[128]; ///< Filter value to compare against
-} Filter;
+#include "exec.h"
+#include "parser.h"
 
 // String utility functions
 
 /**
  * @brief Trims leading and trailing whitespace from a string in-place
- * 
+ *
  * @param s Pointer to the null-terminated string to trim
  */
 void sql_trim(char* s);
 
 /**
- * @brief Checks if a string starts with a given prefix (case-insensitive)
- * 
- * @param s The string to check
- * @param pref The prefix to search for
- * @return int Non-zero if s starts with pref, 0 otherwise
+ * @brief Parses, plans and runs one SQL statement, printing its results
+ *
+ * Errors are printed rather than returned. With an EXPLAIN prefix, the
+ * plan of a SELECT, UPDATE or DELETE is printed instead of being run.
+ *
+ * @param bp Pointer to the BufferPool
+ * @param cat Pointer to the Catalog
+ * @param sql The statement text
+ * @return int The statement's result as returned by its sql_exec_* function,
+ *         or -1 on a parse or planning error
  */
-int sql_starts_with(const char* s, const char* pref);
+int sql_exec(BufferPool* bp, Catalog* cat, const char* sql);
 
-// SQL parsing functions
+// SQL command execution functions
+//
+// Each prints its outcome, or with ctx->quiet prints nothing and leaves a
+// failure's message in ctx->err for the caller.
 
 /**
- * @brief Extracts an identifier that appears after a keyword in a SQL statement
- * 
- * @param line The SQL command line to parse
- * @param kw The keyword to search for (e.g., "from", "create table")
- * @param out Buffer to store the extracted identifier
- * @param out_sz Size of the output buffer
- * @return int Number of characters extracted, or 0 if parsing failed
+ * @brief Executes a CREATE TABLE command
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement
+ * @return int 1 on success, 0 on failure
  */
-int sql_parse_ident_after(const char* line, const char* kw, char* out, size_t out_sz);
+int sql_exec_create_table(ExecCtx* ctx, const CreateTableStmt* st);
 
 /**
- * @brief Parses column definitions from a CREATE TABLE statement
- * 
- * @param line The CREATE TABLE command line
- * @param cols Array to store parsed column definitions
- * @param max_cols Maximum number of columns that can be stored
- * @return int Number of columns successfully parsed, or 0 on error
+ * @brief Executes a CREATE INDEX command
+ *
+ * Builds a B+ tree over the column from the table's existing rows and
+ * registers it in the catalog. INSERT, UPDATE, DELETE and VACUUM keep it in
+ * sync, and the planner uses it for WHERE filters on the column.
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement
+ * @return int 1 on success, 0 on failure
  */
-int sql_parse_create_columns(const char* line, ColumnDef* cols, int max_cols);
+int sql_exec_create_index(ExecCtx* ctx, const CreateIndexStmt* st);
 
 /**
- * @brief Parses values from an INSERT statement
- * 
- * @param line The INSERT command line
- * @param values Array to store parsed values
- * @param max_vals Maximum number of values that can be stored
- * @return int Number of values successfully parsed, or 0 on error
+ * @brief Executes an INSERT INTO command
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement
+ * @return int Number of rows inserted
+ */
+int sql_exec_insert(ExecCtx* ctx, const InsertStmt* st);
+
+/**
+ * @brief Executes a COPY <table> FROM '<file>' [HEADER] command
+ *
+ * Streams a CSV file into the table through a heap bulk load: rows are
+ * packed into whole pages that are written in large batches and synced once
+ * at the end, instead of going through heap_insert one row at a time.
+ * Lines that do not match the schema are reported and skipped.
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement
+ * @return int 1 on success, 0 on failure
  */
-int sql_parse_insert_values(const char* line, char values[][128], int max_vals);
+int sql_exec_copy(ExecCtx* ctx, const CopyStmt* st);
 
 /**
- * @brief Parses a WHERE clause from a SELECT statement
- * 
- * @param line The SELECT command line containing the WHERE clause
- * @param f Pointer to Filter structure to populate
- * @return int 1 if WHERE clause parsed successfully, 0 if no WHERE clause, -1 on error
+ * @brief Executes a SELECT command
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement, bound in place by the planner
+ * @return int Number of rows returned, or -1 on error
  */
-int sql_parse_where_clause(const char* line, Filter* f);
+int sql_exec_select(ExecCtx* ctx, SelectStmt* st);
 
 /**
- * @brief Tests if a row matches a filter condition
- * 
- * @param f Pointer to the Filter to apply
- * @param linebuf The formatted row string to test
- * @return int Non-zero if row matches filter, 0 otherwise
+ * @brief Executes an UPDATE command
+ *
+ * Matching rows are collected first and then changed, so a row moved by
+ * the update is never visited twice.
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement, bound in place by the planner
+ * @return int Number of rows updated, or -1 on error
  */
-int sql_filter_match(const Filter* f, const char linebuf[]);
+int sql_exec_update(ExecCtx* ctx, UpdateStmt* st);
 
-// SQL command execution functions
+/**
+ * @brief Executes a DELETE command
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement, bound in place by the planner
+ * @return int Number of rows deleted, or -1 on error
+ */
+int sql_exec_delete(ExecCtx* ctx, DeleteStmt* st);
 
 /**
- * @brief Executes a CREATE TABLE command
- * 
- * @param bp Pointer to the BufferPool
- * @param cat Pointer to the Catalog
- * @param line The complete CREATE TABLE command line
+ * @brief Executes a VACUUM <table> [pages] command
+ *
+ * Compacts the table's pages in place and returns empty ones to the free
+ * list. With a page count, runs one bounded step of an incremental pass
+ * that the next VACUUM with a count continues.
+ *
+ * @param ctx Statement state
+ * @param st Parsed statement
  * @return int 1 on success, 0 on failure
  */
-int sql_exec_create_table(BufferPool* bp, Catalog* cat, const char* line);
+int sql_exec_vacuum(ExecCtx* ctx, const VacuumStmt* st);
 
 /**
- * @brief Executes an INSERT INTO command
- * 
- * @param bp Pointer to the BufferPool
- * @param cat Pointer to the Catalog
- * @param line The complete INSERT INTO command line
- * @return int 1 on success, 0 on failure
+ * @brief Starts a statement's transaction when a write-ahead log is attached
  */
-int sql_exec_insert(BufferPool* bp, Catalog* cat, const char* line);
+void sql_statement_begin(BufferPool* bp);
 
 /**
- * @brief Executes a SELECT * command with optional WHERE clause
- * 
- * @param bp Pointer to the BufferPool
- * @param cat Pointer to the Catalog
- * @param line The complete SELECT command line
- * @return int Number of rows returned, or -1 on error
+ * @brief Commits a statement's transaction, checkpointing when the log is full
+ *
+ * @param bp Buffer pool with the log
+ * @param err Receives a message if the commit could not be made durable
+ * @param err_cap Capacity of err
+ * @return bool false if the log could not be written
  */
-int sql_exec_select(BufferPool* bp, Catalog* cat, const char* line);
+bool sql_statement_end(BufferPool* bp, char* err, size_t err_cap);
 
 /**
  * @brief REPL function for SQL commands
- * 
+ *
  * This function implements a Read-Eval-Print Loop (REPL) for processing SQL commands.
  * It interacts with the buffer pool to execute commands such as creating tables,
  * inserting data, and querying data.
- * 
+ *
  * @param bp Pointer to the BufferPool structure
  */
 void repl(BufferPool* bp);
-
-/**
- * @brief Update statement structure for SQL UPDATE commands
- * 
- * This structure represents an UPDATE SQL command, including the target table,
- * the column to set, the new value, and an optional WHERE clause for filtering.
- */
-typedef struct {
-  char table[TABLE_NAME_MAX]; ///< Name of the table to update
-  char set_col[COL_NAME_MAX]; ///< Column name to set
-  char set_value[128]; ///< New value to set
-  int has_where; ///< Flag indicating if a WHERE clause is present
-  Filter where; ///< WHERE clause filter
-} UpdateStmt;
-
-/**
- * @brief Parses an UPDATE SQL statement into an UpdateStmt structure
- * 
- * @param line The complete UPDATE command line
- * @param st Pointer to UpdateStmt structure to populate
- * @return int 1 on successful parse, 0 on failure
- */
-int sql_parse_update(const char* line, UpdateStmt* st);
-
-/**
- * @brief Executes an UPDATE SQL command
- * 
- * @param bp Pointer to the BufferPool
- * @param cat Pointer to the Catalog
- * @param line The complete UPDATE command line
- * @return int Number of rows updated, or -1 on error
- */
-int sql_exec_update(BufferPool* bp, Catalog* cat, const char* line);
-
-/**
- * @brief Delete statement structure for SQL DELETE commands
- * 
- * This structure represents a DELETE SQL command, including the target table
- * and an optional WHERE clause for filtering.
- */
-typedef struct {
-  char table[TABLE_NAME_MAX]; ///< Name of the table to delete from
-  int has_where; ///< Flag indicating if a WHERE clause is present
-  Filter where; ///< WHERE clause filter
-} DeleteStmt;
-
-/**
- * @brief Parses a DELETE SQL statement into a DeleteStmt structure
- * 
- * @param line The complete DELETE command line
- * @param st Pointer to DeleteStmt structure to populate
- * @return int 1 on successful parse, 0 on failure
- */
-int sql_parse_delete(const char* line, DeleteStmt* st);
-
-/**
- * @brief Executes a DELETE SQL command
- * 
- * @param bp Pointer to the BufferPool
- * @param cat Pointer to the Catalog
- * @param line The complete DELETE command line
- * @return int Number of rows deleted, or -1 on error
- */
-int sql_exec_delete(BufferPool* bp, Catalog* cat, const char* line);
@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+#include "btree.h"
+#include "catalog.h"
+#include "heap.h"
+#include "row.h"
+
+/**
+ * @brief Maximum number of indexes opened per table.
+ */
+#define TABLE_MAX_INDEXES 8
+
+/**
+ * @brief A secondary index of an open table.
+ */
+typedef struct {
+  IndexEntry entry; ///< Catalog entry of the index
+  BTree tree; ///< Opened B+ tree
+  int col_idx; ///< Ordinal of the indexed column
+} TableIndex;
+
+/**
+ * @brief A table's heap, schema and indexes, opened once per statement.
+ */
+typedef struct {
+  char name[TABLE_NAME_MAX]; ///< Table name as stored in the catalog
+  HeapFile hf; ///< The table's heap file
+  int ncols; ///< Number of columns
+  ColumnDef cols[CATALOG_MAX_COLS]; ///< Column definitions in ordinal order
+  int nix; ///< Number of indexes
+  TableIndex ixs[TABLE_MAX_INDEXES]; ///< Indexes on the table
+} TableInfo;
+
+/**
+ * @brief Opens a table by name.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param cat Open catalog
+ * @param name Table name
+ * @param out Table to fill in
+ * @return int 1 on success, 0 if the table does not exist, -1 if its
+ *         schema is missing
+ */
+int table_open(BufferPool* bp, Catalog* cat, const char* name, TableInfo* out);
+
+/**
+ * @brief Finds a column by name, ignoring case.
+ *
+ * @return int Ordinal of the column, or -1 if there is none
+ */
+int table_find_column(const ColumnDef* cols, int ncols, const char* name);
+
+/**
+ * @brief Encodes a non-NULL value as a key of an index.
+ *
+ * Out-of-line text is read only as far as the key's prefix.
+ *
+ * @param bp Pointer to the BufferPool for overflow pages
+ * @param ix Index the key is for
+ * @param v Value of the indexed column's type
+ * @param key Output buffer of BTREE_KEY_MAX bytes
+ */
+void table_index_key(BufferPool* bp, const TableIndex* ix, const RowField* v, uint8_t* key);
+
+/**
+ * @brief Adds a row's entry to an index. NULLs are not indexed.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param ix Index to update
+ * @param cols Column definitions of the indexed table
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data
+ * @param len Length of the row
+ * @param rid Row identifier
+ */
+void table_index_insert(BufferPool* bp, TableIndex* ix, const ColumnDef* cols, int ncols,
+                        const uint8_t* row, uint16_t len, RID rid);
+
+/**
+ * @brief Removes a row's entry from an index.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param ix Index to update
+ * @param cols Column definitions of the indexed table
+ * @param ncols Number of columns
+ * @param row Binary-encoded row data as it was indexed
+ * @param len Length of the row
+ * @param rid Row identifier
+ */
+void table_index_delete(BufferPool* bp, TableIndex* ix, const ColumnDef* cols, int ncols,
+                        const uint8_t* row, uint16_t len, RID rid);
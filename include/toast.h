@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+#include "buffer.h"
+
+/**
+ * @brief Value bytes held by one overflow page.
+ */
+#define TOAST_PAGE_BYTES ((uint32_t)sizeof(((Page*)0)->data))
+
+/**
+ * @brief Stores a value out of line in a chain of overflow pages.
+ *
+ * Large TEXT values are kept out of heap pages so rows stay small and a
+ * scan reads only the rows' inline bytes. Each overflow page holds up to
+ * TOAST_PAGE_BYTES of the value from the start of its data area, records
+ * the number used in free_start and links to the next page through
+ * next_page_id. Pages come from the free list, and their writes are logged
+ * like any other page change.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param data Value bytes
+ * @param len Length of the value, at least 1
+ * @return uint32_t Page ID of the first page of the chain
+ */
+uint32_t toast_store(BufferPool* bp, const uint8_t* data, uint32_t len);
+
+/**
+ * @brief Reads the leading bytes of an out-of-line value.
+ *
+ * Only the pages covering the first n bytes are fetched, so comparisons
+ * and index keys that need a prefix do not read the whole chain.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param pid Page ID of the first page of the chain
+ * @param out Output buffer of at least n bytes
+ * @param n Number of bytes to read
+ * @return uint32_t Number of bytes read, less than n if the chain is shorter
+ */
+uint32_t toast_fetch(BufferPool* bp, uint32_t pid, uint8_t* out, uint32_t n);
+
+/**
+ * @brief Returns every page of an out-of-line value to the free list.
+ *
+ * @param bp Pointer to the BufferPool for buffer management
+ * @param pid Page ID of the first page of the chain
+ */
+void toast_release(BufferPool* bp, uint32_t pid);
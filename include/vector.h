@@ -0,0 +1,90 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "arena.h"
+#include "row.h"
+
+/**
+ * @brief Number of rows in a full column vector.
+ */
+#define VECTOR_SIZE 1024
+
+/**
+ * @brief Inline TEXT bytes one column vector can hold.
+ *
+ * A batch of long strings ends early rather than growing the buffer.
+ */
+#define VECTOR_TEXT_BYTES (64 * 1024)
+
+/**
+ * @brief The values of one column for a batch of rows.
+ *
+ * Values are stored by type in plain arrays, so loops over an INT column
+ * touch nothing but an int32_t array and the null bitmap. Inline TEXT
+ * bytes are copied into the vector's own buffer; out-of-line values keep
+ * only their length and overflow page, as in a RowField.
+ */
+typedef struct ColumnVector {
+  ColumnType type; ///< Data type of the column
+  bool has_nulls; ///< Whether any row holds NULL; lets loops skip the bitmap
+  bool has_external; ///< Whether any TEXT value is out of line
+  uint64_t nulls[VECTOR_SIZE / 64]; ///< Bit i set when row i is NULL
+  union {
+    int32_t* i32; ///< Values of a VAL_I32 type, 0 for NULL
+    int64_t* i64; ///< Values of a VAL_I64 type, 0 for NULL
+    double* f64; ///< Values of a VAL_F64 type, 0 for NULL
+  };
+  uint32_t* text_off; ///< Offset of inline bytes in text, 0 for NULL (VAL_TEXT only)
+  uint32_t* text_len; ///< Length of each value in bytes, 0 for NULL (VAL_TEXT only)
+  uint32_t* toast_pid; ///< First overflow page, or INVALID_PID if inline (VAL_TEXT only)
+  uint8_t* text; ///< Inline text bytes, padded for SIMD loads past the end (VAL_TEXT only)
+  uint32_t text_used; ///< Bytes of text in use
+} ColumnVector;
+
+/**
+ * @brief Allocates the arrays of a column vector from an arena.
+ *
+ * @param v Vector to initialize
+ * @param type Column type, which decides the arrays allocated
+ * @param a Arena that owns the arrays
+ * @return true on success, false if out of memory
+ */
+bool vector_init(ColumnVector* v, ColumnType type, Arena* a);
+
+/**
+ * @brief Sets up a vector whose every row is NULL, for a column not read.
+ *
+ * Nothing is allocated; its arrays point at shared zeroed storage, and it
+ * must never be reset or written.
+ */
+void vector_init_null(ColumnVector* v, ColumnType type);
+
+/**
+ * @brief Empties a vector for the next batch.
+ */
+void vector_reset(ColumnVector* v);
+
+/**
+ * @brief Whether row i of a vector is NULL.
+ */
+static inline bool vector_is_null(const ColumnVector* v, int i) {
+  return v->has_nulls && ((v->nulls[i >> 6] >> (i & 63)) & 1u);
+}
+
+/**
+ * @brief Reads row i of a vector as a RowField.
+ *
+ * Inline TEXT points into the vector's buffer and stays valid until the
+ * vector is reset.
+ */
+void vector_get(const ColumnVector* v, int i, RowField* out);
+
+/**
+ * @brief Sets row i of a vector to a value.
+ *
+ * Rows are filled in order after a reset. Inline TEXT is copied into the
+ * vector's buffer; out-of-line values keep their overflow page.
+ *
+ * @return true on success, false if the TEXT bytes do not fit
+ */
+bool vector_set(ColumnVector* v, int i, const RowField* f);
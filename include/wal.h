@@ -0,0 +1,202 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define WAL_MAGIC "MQWAL001"
+
+/**
+ * @brief Log record types.
+ */
+typedef enum {
+  WAL_UPDATE = 1, ///< Byte-range before/after images of one page
+  WAL_COMMIT = 2  ///< Transaction commit marker
+} WalRecordType;
+
+/**
+ * @brief A changed byte range inside a page, as logged in WAL_UPDATE records.
+ */
+typedef struct {
+  uint16_t offset; ///< Offset of the range from the start of the Page
+  uint16_t len;    ///< Length of the range in bytes
+} WalRange;
+
+/**
+ * @brief Decoded view of a log record.
+ *
+ * For WAL_UPDATE records, 'body' points at nranges entries, each laid out as
+ * u16 offset, u16 len, len bytes of before image, len bytes of after image.
+ */
+typedef struct {
+  uint32_t lsn;      ///< Log sequence number of the record
+  uint32_t txn;      ///< Transaction ID (0 for system changes outside a transaction)
+  uint8_t type;      ///< WalRecordType of the record
+  uint16_t nranges;  ///< Number of byte ranges (WAL_UPDATE only)
+  uint32_t page_id;  ///< Page the record applies to (WAL_UPDATE only)
+  const uint8_t* body; ///< Encoded ranges (WAL_UPDATE only)
+} WalRecord;
+
+/**
+ * @brief Write-ahead log manager.
+ *
+ * Records are appended to an in-memory buffer and assigned increasing LSNs.
+ * wal_flush writes and fsyncs the buffer up to a requested LSN; concurrent
+ * callers use a leader/follower protocol so that every commit waiting at the
+ * same time shares a single fsync (group commit).
+ */
+typedef struct LogManager {
+  int fd; ///< File descriptor of the log file
+  uint32_t base_lsn; ///< LSN of the first record in the current log file
+  uint32_t next_lsn; ///< Next LSN to assign
+  uint32_t flushed_lsn; ///< Every record with a lower LSN is durable
+  uint32_t next_txn; ///< Next transaction ID to hand out
+  off_t file_end; ///< Byte offset where the next flushed record is written
+
+  uint8_t* buf; ///< Records appended but not yet handed to a flusher
+  size_t buf_len; ///< Bytes used in buf
+  size_t buf_cap; ///< Capacity of buf
+  uint8_t* flush_buf; ///< Buffer owned by the current flush leader
+  size_t flush_cap; ///< Capacity of flush_buf
+
+  pthread_mutex_t mu; ///< Protects all fields above
+  pthread_cond_t flushed; ///< Signalled when flushed_lsn advances
+  bool flushing; ///< A leader is currently writing and syncing
+  int waiters; ///< Commits waiting for the current flush
+
+  int group_commit_size; ///< Commits acknowledged per fsync without waiting
+  int pending_commits; ///< Commits appended since the last flush
+  int commit_delay_us; ///< Time a leader waits for followers before syncing
+  bool recovering; ///< Suppresses logging while recovery replays the log
+  int io_error; ///< errno of the first failed log write or sync; once set, nothing more becomes durable
+
+  uint64_t commits; ///< Number of committed transactions
+  uint64_t fsyncs; ///< Number of log fsyncs issued
+} LogManager;
+
+/**
+ * @brief Opens (or creates) the write-ahead log at the given path.
+ *
+ * @param path File system path of the log file
+ * @return LogManager* The log manager, or NULL if the file cannot be opened,
+ *         with errno saying why
+ */
+LogManager* wal_open(const char* path);
+
+/**
+ * @brief Flushes the log and releases the log manager.
+ *
+ * @param lm Pointer to the LogManager to close
+ */
+void wal_close(LogManager* lm);
+
+/**
+ * @brief Starts a transaction for the calling thread.
+ *
+ * Page changes logged by this thread are attributed to the returned
+ * transaction until wal_commit is called.
+ *
+ * @param lm Pointer to the LogManager
+ * @return uint32_t The new transaction ID
+ */
+uint32_t wal_begin(LogManager* lm);
+
+/**
+ * @brief Returns the calling thread's active transaction ID (0 if none).
+ */
+uint32_t wal_current_txn(void);
+
+/**
+ * @brief Commits the calling thread's active transaction.
+ *
+ * Appends a commit record and, when group_commit_size is 1, waits until it is
+ * durable. Concurrent committers share one fsync. With a larger
+ * group_commit_size, back-to-back commits are acknowledged immediately and
+ * made durable together every group_commit_size commits. A transaction that
+ * logged no updates finishes without writing or syncing anything.
+ *
+ * @param lm Pointer to the LogManager
+ * @return bool false if the log has failed (see io_error), so the commit
+ *         may not be durable
+ */
+bool wal_commit(LogManager* lm);
+
+/**
+ * @brief Appends an update record describing changed byte ranges of a page.
+ *
+ * @param lm Pointer to the LogManager
+ * @param page_id Page that was changed
+ * @param before Page contents before the change
+ * @param after Page contents after the change
+ * @param ranges Changed byte ranges
+ * @param nranges Number of ranges
+ * @return uint32_t LSN assigned to the record
+ */
+uint32_t wal_log_update(LogManager* lm, uint32_t page_id,
+                        const uint8_t* before, const uint8_t* after,
+                        const WalRange* ranges, int nranges);
+
+/**
+ * @brief Makes every record with LSN <= lsn durable.
+ *
+ * A failed write or sync is recorded in io_error and leaves flushed_lsn
+ * where it was; every later flush then fails too.
+ *
+ * @param lm Pointer to the LogManager
+ * @param lsn LSN that must be on stable storage when this returns
+ * @return bool true if it is, false if the log has failed
+ */
+bool wal_flush(LogManager* lm, uint32_t lsn);
+
+/**
+ * @brief Reports whether a log write or sync has failed; see io_error.
+ */
+bool wal_failed(LogManager* lm);
+
+/**
+ * @brief Reports whether the log has grown past its checkpoint threshold.
+ */
+bool wal_needs_checkpoint(LogManager* lm);
+
+/**
+ * @brief Discards the log after a checkpoint.
+ *
+ * Must only be called once every page change in the log is durable in the
+ * database file. LSNs keep increasing across resets. A log that has failed
+ * is kept as it is.
+ *
+ * @param lm Pointer to the LogManager
+ */
+void wal_reset(LogManager* lm);
+
+/**
+ * @brief Sequential reader over the durable records of a log file.
+ */
+typedef struct {
+  uint8_t* data; ///< Log contents loaded into memory
+  size_t len; ///< Number of bytes loaded
+  size_t pos; ///< Offset of the next record
+} WalReader;
+
+/**
+ * @brief Loads the log for reading.
+ *
+ * @param lm Pointer to the LogManager
+ * @param r Reader to initialize
+ */
+void wal_reader_open(LogManager* lm, WalReader* r);
+
+/**
+ * @brief Decodes the next record; stops at the end or at a torn/corrupt tail.
+ *
+ * @param r Reader positioned by wal_reader_open
+ * @param out Decoded record, valid until wal_reader_close
+ * @return true if a record was decoded, false at end of log
+ */
+bool wal_reader_next(WalReader* r, WalRecord* out);
+
+/**
+ * @brief Releases the memory held by a reader.
+ */
+void wal_reader_close(WalReader* r);
@@ -0,0 +1,679 @@
+#include "agg.h"
+#include "spill.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rows that spill are split into AGG_FANOUT partition files by a slice of
+// AGG_FANOUT_BITS bits from the top of their hash, a different slice at
+// each level, so a partition that still does not fit is split again. Past
+// AGG_MAX_LEVEL the table grows beyond the budget instead.
+#define AGG_FANOUT_BITS 5
+#define AGG_FANOUT (1 << AGG_FANOUT_BITS)
+#define AGG_MAX_LEVEL 6
+
+#define AGG_MIN_SLOTS 256
+
+// Group id of a row written to a partition file.
+#define GID_SPILLED UINT32_MAX
+
+typedef struct {
+  int64_t count; ///< Rows for COUNT(*), non-NULL arguments otherwise
+  int64_t sum; ///< Sum of integer arguments (SUM, AVG)
+  double fsum; ///< Sum of DOUBLE arguments (SUM, AVG)
+  RowField val; ///< Least or greatest argument so far (MIN, MAX)
+  uint8_t* buf; ///< Owned copy of val's bytes when it is inline TEXT
+  uint32_t cap; ///< Capacity of buf
+} AggState;
+
+// A group's hash and aggregate states, followed by its key values.
+typedef struct {
+  uint64_t hash;
+  AggState states[];
+} Group;
+
+// Slot of the general table. The tag holds the hash's upper half, so most
+// mismatches are rejected without touching the group.
+typedef struct {
+  uint32_t tag;
+  uint32_t gid; ///< Group index + 1, 0 for an empty slot
+} AggSlot;
+
+// Slot of the single INT key table, which compares the key in place.
+typedef struct {
+  int32_t key;
+  uint32_t gid; ///< Group index + 1, 0 for an empty slot
+} AggIntSlot;
+
+typedef struct {
+  FILE* f;
+  int level;
+} AggPartition;
+
+typedef struct {
+  Operator base;
+  int nkeys;
+  int keys[EXEC_MAX_COLS];
+  int naggs;
+  AggSpec aggs[EXEC_MAX_COLS];
+  bool int_key; ///< Single INT key, grouped with the AggIntSlot table
+  int nspill;
+  int spill_cols[EXEC_MAX_COLS]; ///< Input columns written to partition files
+  size_t key_off; ///< Offset of the key values in a group
+  size_t group_size;
+  BatchReader reader;
+
+  // Table of the current pass
+  Arena mem; ///< Groups and their key bytes
+  size_t mem_used; ///< Bytes of groups, key and MIN/MAX bytes and slots
+  Group** groups;
+  uint32_t ngroups;
+  uint32_t groups_cap;
+  AggSlot* slots;
+  AggIntSlot* int_slots;
+  uint32_t nslots; ///< Power of two
+  uint32_t null_gid; ///< Group of the NULL key in the INT table + 1, or 0
+  bool spilling; ///< New groups of this pass go to partition files
+
+  // Passes
+  int level; ///< 0 while reading the child, then the level of the partition read
+  SpillReader in; ///< Partition file the current pass reads; in.f is NULL for the child
+  FILE* out[AGG_FANOUT]; ///< Partition files of the next level
+  AggPartition* pending;
+  int npending;
+  int pending_cap;
+  bool built; ///< The current pass has consumed all its input
+  uint32_t emit_pos;
+
+  HashAggStats stats;
+} HashAggOp;
+
+static bool out_of_memory(HashAggOp* a) {
+  snprintf(a->base.ctx->err, sizeof(a->base.ctx->err), "Out of memory.");
+  return false;
+}
+
+static RowField* group_keys(const HashAggOp* a, const Group* g) {
+  return (RowField*)((uint8_t*)g + a->key_off);
+}
+
+static AggState* state(const HashAggOp* a, uint32_t gid, int k) {
+  return &a->groups[gid]->states[k];
+}
+
+// ============================================================================
+// Hash table
+// ============================================================================
+
+static void free_groups(HashAggOp* a) {
+  for (uint32_t g = 0; g < a->ngroups; g++) {
+    for (int k = 0; k < a->naggs; k++) free(a->groups[g]->states[k].buf);
+  }
+  a->ngroups = 0;
+  arena_free(&a->mem);
+}
+
+static bool alloc_slots(HashAggOp* a, uint32_t n) {
+  free(a->slots);
+  free(a->int_slots);
+  a->slots = NULL;
+  a->int_slots = NULL;
+  if (a->int_key) a->int_slots = calloc(n, sizeof(AggIntSlot));
+  else a->slots = calloc(n, sizeof(AggSlot));
+  if (!a->slots && !a->int_slots) return out_of_memory(a);
+  a->nslots = n;
+  return true;
+}
+
+static size_t slot_size(const HashAggOp* a) {
+  return a->int_key ? sizeof(AggIntSlot) : sizeof(AggSlot);
+}
+
+static void insert_slot(HashAggOp* a, uint32_t gid) {
+  const Group* g = a->groups[gid];
+  uint32_t mask = a->nslots - 1;
+  uint32_t i = (uint32_t)g->hash & mask;
+  if (a->int_key) {
+    while (a->int_slots[i].gid) i = (i + 1) & mask;
+    a->int_slots[i].key = group_keys(a, g)[0].i32;
+    a->int_slots[i].gid = gid + 1;
+  } else {
+    while (a->slots[i].gid) i = (i + 1) & mask;
+    a->slots[i].tag = (uint32_t)(g->hash >> 32);
+    a->slots[i].gid = gid + 1;
+  }
+}
+
+static bool grow_slots(HashAggOp* a) {
+  if (!alloc_slots(a, a->nslots * 2)) return false;
+  for (uint32_t g = 0; g < a->ngroups; g++) {
+    if (g + 1 != a->null_gid) insert_slot(a, g);
+  }
+  return true;
+}
+
+// Empties the table for the next pass.
+static bool reset_table(HashAggOp* a) {
+  free_groups(a);
+  a->null_gid = 0;
+  a->spilling = false;
+  a->emit_pos = 0;
+  a->built = false;
+  if (!alloc_slots(a, AGG_MIN_SLOTS)) return false;
+  a->mem_used = (size_t)a->nslots * slot_size(a);
+  return true;
+}
+
+// Creates the group of row `row` of a batch. Returns 1 with *gid set, 0 if
+// the group does not fit in the budget and the row must spill, or -1 on
+// failure.
+static int new_group(HashAggOp* a, uint64_t hash, const Batch* b, int row, uint32_t* gid) {
+  ExecCtx* ctx = a->base.ctx;
+  size_t need = a->group_size + sizeof(Group*);
+  for (int k = 0; k < a->nkeys; k++) {
+    const ColumnVector* v = b->cols[a->keys[k]];
+    if (row_is_text(v->type) && !vector_is_null(v, row) && v->toast_pid[row] == INVALID_PID) {
+      need += (v->text_len[row] + 7) & ~7u;
+    }
+  }
+  bool grow = (a->ngroups + 1) * 2 > a->nslots;
+  if (grow) need += (size_t)a->nslots * slot_size(a);
+
+  size_t budget = ctx->work_mem ? ctx->work_mem : EXEC_WORK_MEM_DEFAULT;
+  bool can_spill = a->nkeys > 0 && a->level < AGG_MAX_LEVEL;
+  if (can_spill && (a->spilling || (a->ngroups > 0 && a->mem_used + need > budget))) {
+    a->spilling = true;
+    return 0;
+  }
+
+  // Existing groups are rehashed before the new one is added, which the
+  // caller then enters in the table.
+  if (grow && !grow_slots(a)) return -1;
+  if (a->ngroups == a->groups_cap) {
+    uint32_t cap = a->groups_cap ? a->groups_cap * 2 : 64;
+    Group** grown = realloc(a->groups, sizeof(Group*) * cap);
+    if (!grown) {
+      out_of_memory(a);
+      return -1;
+    }
+    a->groups = grown;
+    a->groups_cap = cap;
+  }
+
+  Group* g = arena_alloc(&a->mem, a->group_size);
+  if (!g) {
+    out_of_memory(a);
+    return -1;
+  }
+  g->hash = hash;
+  RowField* keys = group_keys(a, g);
+  for (int k = 0; k < a->nkeys; k++) {
+    vector_get(b->cols[a->keys[k]], row, &keys[k]);
+    // Inline bytes are copied, as the batch's buffers are reused; out-of-line
+    // values stay valid for the whole statement.
+    if (row_is_text(keys[k].type) && !keys[k].is_null && keys[k].toast_pid == INVALID_PID) {
+      uint8_t* copy = arena_alloc(&a->mem, keys[k].text_len + 1);
+      if (!copy) {
+        out_of_memory(a);
+        return -1;
+      }
+      memcpy(copy, keys[k].text, keys[k].text_len);
+      keys[k].text = copy;
+    }
+  }
+
+  *gid = a->ngroups;
+  a->groups[a->ngroups++] = g;
+  a->mem_used += need;
+  return 1;
+}
+
+// ============================================================================
+// Partition files
+// ============================================================================
+
+// Appends the key and argument columns of a row to the partition file its
+// hash picks at the next level.
+static bool spill_row(HashAggOp* a, uint64_t hash, const Batch* b, int row) {
+  int shift = 64 - AGG_FANOUT_BITS * (a->level + 1);
+  int part = (int)((hash >> shift) & (AGG_FANOUT - 1));
+  if (!a->out[part] && !(a->out[part] = spill_create(a->base.ctx))) return false;
+  if (!spill_write_row(a->base.ctx, a->out[part], b, row, a->spill_cols, a->nspill)) return false;
+  a->stats.spilled_rows++;
+  return true;
+}
+
+// ============================================================================
+// Grouping and updates
+// ============================================================================
+
+static bool key_equal(ExecCtx* ctx, const RowField* k, const ColumnVector* v, int row) {
+  bool null = vector_is_null(v, row);
+  if (null || k->is_null) return null == k->is_null;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: return k->i32 == v->i32[row];
+    case VAL_I64: return k->i64 == v->i64[row];
+    case VAL_F64: return k->f64 == v->f64[row];
+    case VAL_TEXT: break;
+  }
+  if (k->text_len != v->text_len[row]) return false;
+  RowField f;
+  vector_get(v, row, &f);
+  return exec_compare(ctx->bp, k, &f) == 0;
+}
+
+// Finds or creates the group of each selected row of the batch, a key
+// column at a time for the hashes and then a row at a time for the probes.
+static bool group_rows(HashAggOp* a, const Batch* b, uint32_t* gids) {
+  ExecCtx* ctx = a->base.ctx;
+  uint64_t hashes[VECTOR_SIZE];
+  int n = b->nsel;
+  const uint16_t* sel = b->sel;
+
+  memset(hashes, 0, sizeof(uint64_t) * (size_t)n);
+  for (int k = 0; k < a->nkeys; k++) {
+    const ColumnVector* v = b->cols[a->keys[k]];
+    for (int i = 0; i < n; i++) {
+      int row = sel ? sel[i] : i;
+      hashes[i] = exec_hash_mix(hashes[i] ^ exec_hash_value(ctx, v, row));
+    }
+  }
+
+  for (int i = 0; i < n; i++) {
+    int row = sel ? sel[i] : i;
+    uint64_t h = hashes[i];
+    uint32_t tag = (uint32_t)(h >> 32);
+    uint32_t mask = a->nslots - 1;
+    uint32_t s = (uint32_t)h & mask;
+    uint32_t gid = GID_SPILLED;
+
+    for (; a->slots[s].gid; s = (s + 1) & mask) {
+      if (a->slots[s].tag != tag) continue;
+      const RowField* keys = group_keys(a, a->groups[a->slots[s].gid - 1]);
+      int k = 0;
+      while (k < a->nkeys && key_equal(ctx, &keys[k], b->cols[a->keys[k]], row)) k++;
+      if (k == a->nkeys) {
+        gid = a->slots[s].gid - 1;
+        break;
+      }
+    }
+
+    if (gid == GID_SPILLED) {
+      int r = new_group(a, h, b, row, &gid);
+      if (r < 0) return false;
+      if (r == 0) {
+        gid = GID_SPILLED;
+        if (!spill_row(a, h, b, row)) return false;
+      } else {
+        insert_slot(a, gid);
+      }
+    }
+    gids[i] = gid;
+  }
+  return true;
+}
+
+// group_rows for a single INT key: the probe compares keys in the slots,
+// so finding an existing group reads nothing but the slot array.
+static bool group_int_rows(HashAggOp* a, const Batch* b, uint32_t* gids) {
+  const ColumnVector* v = b->cols[a->keys[0]];
+  int n = b->nsel;
+  const uint16_t* sel = b->sel;
+
+  for (int i = 0; i < n; i++) {
+    int row = sel ? sel[i] : i;
+    bool null = vector_is_null(v, row);
+    int32_t key = v->i32[row];
+    uint64_t h = null ? EXEC_NULL_HASH : exec_hash_int(key);
+    uint32_t gid = GID_SPILLED;
+
+    if (null) {
+      if (a->null_gid) gid = a->null_gid - 1;
+    } else {
+      uint32_t mask = a->nslots - 1;
+      for (uint32_t s = (uint32_t)h & mask; a->int_slots[s].gid; s = (s + 1) & mask) {
+        if (a->int_slots[s].key == key) {
+          gid = a->int_slots[s].gid - 1;
+          break;
+        }
+      }
+    }
+
+    if (gid == GID_SPILLED) {
+      int r = new_group(a, h, b, row, &gid);
+      if (r < 0) return false;
+      if (r == 0) {
+        gid = GID_SPILLED;
+        if (!spill_row(a, h, b, row)) return false;
+      } else if (null) {
+        a->null_gid = gid + 1;
+      } else {
+        insert_slot(a, gid);
+      }
+    }
+    gids[i] = gid;
+  }
+  return true;
+}
+
+// Makes f the MIN or MAX of a group. Inline bytes are copied into the
+// state's own buffer.
+static bool set_extreme(HashAggOp* a, AggState* st, const RowField* f) {
+  st->val = *f;
+  if (!row_is_text(f->type) || f->toast_pid != INVALID_PID) return true;
+  if (f->text_len > st->cap) {
+    uint32_t cap = f->text_len < 16 ? 16 : f->text_len;
+    uint8_t* grown = realloc(st->buf, cap);
+    if (!grown) return out_of_memory(a);
+    a->mem_used += cap - st->cap;
+    st->buf = grown;
+    st->cap = cap;
+  }
+  memcpy(st->buf, f->text, f->text_len);
+  st->val.text = st->buf;
+  return true;
+}
+
+// Runs one aggregate over the batch. Each loop handles one function and
+// one column, and skips spilled rows.
+static bool update(HashAggOp* a, int k, const Batch* b, const uint32_t* gids) {
+  const AggSpec* spec = &a->aggs[k];
+  int n = b->nsel;
+  const uint16_t* sel = b->sel;
+
+  if (spec->func == AGG_COUNT_STAR) {
+    for (int i = 0; i < n; i++) {
+      if (gids[i] != GID_SPILLED) state(a, gids[i], k)->count++;
+    }
+    return true;
+  }
+
+  const ColumnVector* v = b->cols[spec->col];
+  switch (spec->func) {
+    case AGG_COUNT:
+      for (int i = 0; i < n; i++) {
+        int row = sel ? sel[i] : i;
+        if (gids[i] != GID_SPILLED && !vector_is_null(v, row)) state(a, gids[i], k)->count++;
+      }
+      return true;
+
+    case AGG_SUM:
+    case AGG_AVG:
+      for (int i = 0; i < n; i++) {
+        int row = sel ? sel[i] : i;
+        if (gids[i] == GID_SPILLED || vector_is_null(v, row)) continue;
+        AggState* st = state(a, gids[i], k);
+        st->count++;
+        if (v->type == COL_INT) {
+          st->sum += v->i32[row];
+        } else if (v->type == COL_DOUBLE) {
+          st->fsum += v->f64[row];
+        } else if (__builtin_add_overflow(st->sum, v->i64[row], &st->sum)) {
+          snprintf(a->base.ctx->err, sizeof(a->base.ctx->err), "%s is out of BIGINT range.",
+                   spec->name);
+          return false;
+        }
+      }
+      return true;
+
+    case AGG_MIN:
+    case AGG_MAX: {
+      int want = spec->func == AGG_MIN ? -1 : 1;
+      for (int i = 0; i < n; i++) {
+        int row = sel ? sel[i] : i;
+        if (gids[i] == GID_SPILLED || vector_is_null(v, row)) continue;
+        AggState* st = state(a, gids[i], k);
+        if (v->type == COL_INT) {
+          int32_t x = v->i32[row];
+          if (st->count++ == 0 || (want < 0 ? x < st->val.i32 : x > st->val.i32)) {
+            st->val.type = COL_INT;
+            st->val.toast_pid = INVALID_PID;
+            st->val.i32 = x;
+          }
+          continue;
+        }
+        RowField f;
+        vector_get(v, row, &f);
+        if (st->count++ == 0 || exec_compare(a->base.ctx->bp, &f, &st->val) * want > 0) {
+          if (!set_extreme(a, st, &f)) return false;
+        }
+      }
+      return true;
+    }
+
+    default:
+      return true;
+  }
+}
+
+static bool consume(HashAggOp* a, const Batch* b) {
+  uint32_t gids[VECTOR_SIZE];
+  if (a->nkeys == 0) {
+    memset(gids, 0, sizeof(uint32_t) * (size_t)b->nsel);
+  } else if (!(a->int_key ? group_int_rows(a, b, gids) : group_rows(a, b, gids))) {
+    return false;
+  }
+  for (int k = 0; k < a->naggs; k++) {
+    if (!update(a, k, b, gids)) return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// Passes
+// ============================================================================
+
+// Consumes the input of the current pass, then queues the partition files
+// it spilled to.
+static bool build(HashAggOp* a) {
+  Batch b;
+  int r;
+  ExecCtx* ctx = a->base.ctx;
+  while ((r = a->in.f ? spill_reader_next(ctx, &a->in, &b)
+                      : exec_reader_next(&a->reader, &b)) > 0) {
+    if (!consume(a, &b)) return false;
+  }
+  if (r < 0) return false;
+
+  spill_reader_close(&a->in);
+  for (int p = 0; p < AGG_FANOUT; p++) {
+    if (!a->out[p]) continue;
+    if (a->npending == a->pending_cap) {
+      int cap = a->pending_cap ? a->pending_cap * 2 : AGG_FANOUT;
+      AggPartition* grown = realloc(a->pending, sizeof(AggPartition) * (size_t)cap);
+      if (!grown) return out_of_memory(a);
+      a->pending = grown;
+      a->pending_cap = cap;
+    }
+    rewind(a->out[p]);
+    a->pending[a->npending++] = (AggPartition){ a->out[p], a->level + 1 };
+    a->out[p] = NULL;
+    a->stats.partitions++;
+  }
+  a->built = true;
+  return true;
+}
+
+// Starts a pass over the child (in == NULL) or a partition file, which the
+// pass takes over.
+static bool start_pass(HashAggOp* a, FILE* in, int level) {
+  if (in && !spill_reader_open(a->base.ctx, &a->in, in)) return false;
+  if (!reset_table(a)) return false;
+  a->level = level;
+  if (a->nkeys > 0) return true;
+
+  // Without keys there is one group, which exists even for empty input.
+  Batch none = { 0 };
+  uint32_t gid;
+  return new_group(a, 0, &none, 0, &gid) > 0;
+}
+
+static void close_files(HashAggOp* a) {
+  spill_reader_close(&a->in);
+  for (int p = 0; p < AGG_FANOUT; p++) {
+    if (a->out[p]) fclose(a->out[p]);
+    a->out[p] = NULL;
+  }
+  for (int i = 0; i < a->npending; i++) fclose(a->pending[i].f);
+  a->npending = 0;
+}
+
+static bool agg_open(Operator* op) {
+  HashAggOp* a = (HashAggOp*)op;
+  close_files(a);
+  memset(&a->stats, 0, sizeof(a->stats));
+  exec_reader_init(&a->reader, op->child);
+  return exec_open_child(op) && start_pass(a, NULL, 0);
+}
+
+static bool check_int(HashAggOp* a, int k, int64_t v) {
+  if (v >= INT32_MIN && v <= INT32_MAX) return true;
+  snprintf(a->base.ctx->err, sizeof(a->base.ctx->err), "%s is out of INT range.",
+           a->aggs[k].name);
+  return false;
+}
+
+static int emit(HashAggOp* a, const Group* g, Tuple* out) {
+  const RowField* keys = group_keys(a, g);
+  for (int k = 0; k < a->nkeys; k++) out->vals[k] = keys[k];
+
+  for (int k = 0; k < a->naggs; k++) {
+    const AggState* st = &g->states[k];
+    RowField* v = &out->vals[a->nkeys + k];
+    memset(v, 0, sizeof(*v));
+    v->type = a->base.cols[a->nkeys + k].type;
+    v->toast_pid = INVALID_PID;
+    v->is_null = st->count == 0;
+
+    switch (a->aggs[k].func) {
+      case AGG_COUNT_STAR:
+      case AGG_COUNT:
+        if (!check_int(a, k, st->count)) return -1;
+        v->is_null = false;
+        v->i32 = (int32_t)st->count;
+        break;
+      case AGG_SUM:
+        if (v->type == COL_DOUBLE) {
+          v->f64 = st->fsum;
+        } else if (v->type == COL_BIGINT) {
+          v->i64 = st->sum;
+        } else {
+          if (st->count && !check_int(a, k, st->sum)) return -1;
+          v->i32 = (int32_t)st->sum;
+        }
+        break;
+      case AGG_AVG:
+        if (!st->count) break;
+        if (a->base.child->cols[a->aggs[k].col].type == COL_DOUBLE) {
+          v->f64 = st->fsum / (double)st->count;
+        } else {
+          v->f64 = (double)st->sum / (double)st->count;
+        }
+        break;
+      case AGG_MIN:
+      case AGG_MAX:
+        if (st->count) *v = st->val;
+        break;
+    }
+  }
+  out->ncols = a->base.ncols;
+  out->rid = (RID){ INVALID_PID, 0 };
+  return 1;
+}
+
+static int agg_next(Operator* op, Tuple* out) {
+  HashAggOp* a = (HashAggOp*)op;
+  while (1) {
+    if (!a->built && !build(a)) return -1;
+    if (a->emit_pos < a->ngroups) {
+      a->stats.groups++;
+      return emit(a, a->groups[a->emit_pos++], out);
+    }
+    if (a->npending == 0) return 0;
+
+    AggPartition p = a->pending[--a->npending];
+    if (!start_pass(a, p.f, p.level)) return -1;
+  }
+}
+
+static void agg_close(Operator* op) {
+  HashAggOp* a = (HashAggOp*)op;
+  exec_close_child(op);
+  close_files(a);
+  free_groups(a);
+  free(a->slots);
+  free(a->int_slots);
+  free(a->groups);
+  free(a->pending);
+  a->slots = NULL;
+  a->int_slots = NULL;
+  a->groups = NULL;
+  a->groups_cap = 0;
+  a->pending = NULL;
+  a->pending_cap = 0;
+}
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+static void add_spill_col(HashAggOp* a, int col) {
+  for (int c = 0; c < a->nspill; c++) {
+    if (a->spill_cols[c] == col) return;
+  }
+  a->spill_cols[a->nspill++] = col;
+}
+
+Operator* exec_hash_agg(ExecCtx* ctx, Operator* child, const int* keys, int nkeys,
+                        const AggSpec* aggs, int naggs) {
+  if (nkeys + naggs > EXEC_MAX_COLS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many columns selected.");
+    return NULL;
+  }
+  HashAggOp* a = exec_new_op(ctx, sizeof(HashAggOp), NULL);
+  if (!a) return NULL;
+  a->base.child = child;
+  a->nkeys = nkeys;
+  a->naggs = naggs;
+  a->int_key = nkeys == 1 && child->cols[keys[0]].type == COL_INT;
+  arena_init(&a->mem);
+
+  char by[96] = "";
+  size_t used = 0;
+  for (int k = 0; k < nkeys; k++) {
+    a->keys[k] = keys[k];
+    a->base.cols[k] = child->cols[keys[k]];
+    add_spill_col(a, keys[k]);
+    int w = snprintf(by + used, sizeof(by) - used, "%s%s", k ? ", " : " by ",
+                     child->cols[keys[k]].name);
+    if (w > 0) used = used + (size_t)w < sizeof(by) ? used + (size_t)w : sizeof(by) - 1;
+  }
+  for (int k = 0; k < naggs; k++) {
+    a->aggs[k] = aggs[k];
+    ExecColumn* c = &a->base.cols[nkeys + k];
+    memset(c, 0, sizeof(*c));
+    memcpy(c->name, aggs[k].name, sizeof(c->name));
+    // MIN and MAX keep their argument's type, as does SUM, which takes
+    // INT, BIGINT or DOUBLE; AVG is DOUBLE and the counts are INT.
+    bool typed = aggs[k].func != AGG_COUNT_STAR && aggs[k].func != AGG_COUNT;
+    if (aggs[k].func == AGG_AVG) c->type = COL_DOUBLE;
+    else c->type = typed ? child->cols[aggs[k].col].type : COL_INT;
+    if (aggs[k].col >= 0) add_spill_col(a, aggs[k].col);
+  }
+  a->base.ncols = nkeys + naggs;
+  spill_reader_init(&a->in, child->cols, child->ncols, a->spill_cols, a->nspill);
+
+  a->key_off = (offsetof(Group, states) + sizeof(AggState) * (size_t)naggs + 7) & ~(size_t)7;
+  a->group_size = a->key_off + sizeof(RowField) * (size_t)nkeys;
+
+  a->base.label = exec_label(ctx, "HashAgg%s%s", by, a->int_key ? " (int key)" : "");
+  a->base.open = agg_open;
+  a->base.next = agg_next;
+  a->base.close = agg_close;
+  return &a->base;
+}
+
+void exec_hash_agg_stats(const Operator* op, HashAggStats* out) {
+  *out = ((const HashAggOp*)op)->stats;
+}
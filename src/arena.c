@@ -0,0 +1,56 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE 16384
+#define ARENA_ALIGN 16
+
+struct ArenaChunk {
+  ArenaChunk* next;
+  size_t used;
+  size_t cap;
+  _Alignas(ARENA_ALIGN) unsigned char data[];
+};
+
+void arena_init(Arena* a) {
+  a->head = NULL;
+}
+
+void* arena_alloc(Arena* a, size_t n) {
+  n = (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+  ArenaChunk* c = a->head;
+  if (!c || c->cap - c->used < n) {
+    // Oversized requests get a chunk of their own.
+    size_t cap = n > ARENA_CHUNK_SIZE ? n : ARENA_CHUNK_SIZE;
+    c = malloc(sizeof(ArenaChunk) + cap);
+    if (!c) return NULL;
+    c->used = 0;
+    c->cap = cap;
+    c->next = a->head;
+    a->head = c;
+  }
+
+  void* p = c->data + c->used;
+  c->used += n;
+  memset(p, 0, n);
+  return p;
+}
+
+char* arena_strndup(Arena* a, const char* s, size_t n) {
+  char* p = arena_alloc(a, n + 1);
+  if (!p) return NULL;
+  memcpy(p, s, n);
+  p[n] = 0;
+  return p;
+}
+
+void arena_free(Arena* a) {
+  ArenaChunk* c = a->head;
+  while (c) {
+    ArenaChunk* next = c->next;
+    free(c);
+    c = next;
+  }
+  a->head = NULL;
+}
@@ -0,0 +1,420 @@
+#include "btree.h"
+#include "freelist.h"
+#include "row.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BTREE_MAX_DEPTH 32
+#define NODE_HDR 8
+#define RID_BYTES 6
+
+// Node layout inside Page.data:
+//   [0]    u8  is_leaf
+//   [2..4] u16 number of entries
+//   [4..8] u32 leaf: right sibling / internal: leftmost child
+//   [8..]  entries: leaf     = key | rid
+//                   internal = key | rid | child  (child holds keys >= separator)
+//
+// Meta page layout inside Page.data:
+//   [0..4] u32 root page ID, [4] u8 key type, [6..8] u16 key size,
+//   [8..20] PageRun of pages reserved for new nodes
+
+// ============================================================================
+// Node accessors
+// ============================================================================
+
+static bool node_is_leaf(const Page* p) { return p->data[0] != 0; }
+
+static uint16_t node_count(const Page* p) {
+  uint16_t n;
+  memcpy(&n, p->data + 2, sizeof(n));
+  return n;
+}
+
+static void node_set_count(Page* p, uint16_t n) { memcpy(p->data + 2, &n, sizeof(n)); }
+
+static uint32_t node_link(const Page* p) {
+  uint32_t v;
+  memcpy(&v, p->data + 4, sizeof(v));
+  return v;
+}
+
+static void node_set_link(Page* p, uint32_t v) { memcpy(p->data + 4, &v, sizeof(v)); }
+
+static size_t entry_size(const BTree* bt, bool leaf) {
+  return bt->key_size + RID_BYTES + (leaf ? 0 : sizeof(uint32_t));
+}
+
+static int node_capacity(const BTree* bt, bool leaf) {
+  return (int)((sizeof(((Page*)0)->data) - NODE_HDR) / entry_size(bt, leaf));
+}
+
+static uint8_t* entry_at(const BTree* bt, Page* p, int i) {
+  return p->data + NODE_HDR + (size_t)i * entry_size(bt, node_is_leaf(p));
+}
+
+static RID entry_rid(const BTree* bt, const uint8_t* e) {
+  RID rid;
+  memcpy(&rid.page_id, e + bt->key_size, sizeof(uint32_t));
+  memcpy(&rid.slot_id, e + bt->key_size + 4, sizeof(uint16_t));
+  return rid;
+}
+
+static uint32_t entry_child(const BTree* bt, const uint8_t* e) {
+  uint32_t c;
+  memcpy(&c, e + bt->key_size + RID_BYTES, sizeof(c));
+  return c;
+}
+
+static void init_node(Page* p, bool leaf) {
+  memset(p->data, 0, NODE_HDR);
+  p->data[0] = leaf ? 1 : 0;
+  node_set_link(p, INVALID_PID);
+}
+
+static void write_meta(BufferPool* bp, const BTree* bt);
+
+// Takes the page from the tree's own run so that nodes stay clustered.
+static uint32_t new_node(BufferPool* bp, BTree* bt, bool leaf) {
+  uint32_t pid = freelist_alloc_run(bp, &bt->run);
+  write_meta(bp, bt);
+
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  init_node(p, leaf);
+  bp_unpin_page(bp, pid, true);
+  return pid;
+}
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+// Numbers are stored in their native form and compared as such.
+#define COMPARE_AS(T)            \
+  do {                           \
+    T x, y;                      \
+    memcpy(&x, a, sizeof(x));    \
+    memcpy(&y, b, sizeof(y));    \
+    return (x > y) - (x < y);    \
+  } while (0)
+
+static int compare_keys(const BTree* bt, const uint8_t* a, const uint8_t* b) {
+  switch (row_value_kind(bt->key_type)) {
+    case VAL_I32: COMPARE_AS(int32_t);
+    case VAL_I64: COMPARE_AS(int64_t);
+    case VAL_F64: COMPARE_AS(double);
+    case VAL_TEXT: break;
+  }
+
+  int la = a[0], lb = b[0];
+  int c = memcmp(a + 1, b + 1, (size_t)(la < lb ? la : lb));
+  if (c != 0) return c;
+  return (la > lb) - (la < lb);
+}
+
+static int compare_rids(RID a, RID b) {
+  if (a.page_id != b.page_id) return a.page_id < b.page_id ? -1 : 1;
+  return (a.slot_id > b.slot_id) - (a.slot_id < b.slot_id);
+}
+
+static int compare_entry(const BTree* bt, const uint8_t* e, const uint8_t* key, RID rid) {
+  int c = compare_keys(bt, e, key);
+  if (c != 0) return c;
+  return compare_rids(entry_rid(bt, e), rid);
+}
+
+void btree_key_int(const BTree* bt, int32_t v, uint8_t* out) {
+  memset(out, 0, bt->key_size);
+  memcpy(out, &v, sizeof(v));
+}
+
+void btree_key_i64(const BTree* bt, int64_t v, uint8_t* out) {
+  memset(out, 0, bt->key_size);
+  memcpy(out, &v, sizeof(v));
+}
+
+void btree_key_f64(const BTree* bt, double v, uint8_t* out) {
+  if (v == 0) v = 0; // -0.0 sorts with 0.0
+  memset(out, 0, bt->key_size);
+  memcpy(out, &v, sizeof(v));
+}
+
+void btree_key_text(const BTree* bt, const char* s, uint32_t len, uint8_t* out) {
+  if (len > BTREE_TEXT_KEY_MAX) len = BTREE_TEXT_KEY_MAX;
+  memset(out, 0, bt->key_size);
+  out[0] = (uint8_t)len;
+  memcpy(out + 1, s, len);
+}
+
+// Number of entries strictly less than (key, rid).
+static int lower_bound(const BTree* bt, Page* p, const uint8_t* key, RID rid) {
+  int lo = 0, hi = node_count(p);
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (compare_entry(bt, entry_at(bt, p, mid), key, rid) < 0) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo;
+}
+
+// Child of an internal node that covers (key, rid).
+static uint32_t child_for(const BTree* bt, Page* p, const uint8_t* key, RID rid, int* out_pos) {
+  int lo = 0, hi = node_count(p);
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (compare_entry(bt, entry_at(bt, p, mid), key, rid) <= 0) lo = mid + 1;
+    else hi = mid;
+  }
+  if (out_pos) *out_pos = lo;
+  return lo == 0 ? node_link(p) : entry_child(bt, entry_at(bt, p, lo - 1));
+}
+
+// ============================================================================
+// Create / open
+// ============================================================================
+
+static void write_meta(BufferPool* bp, const BTree* bt) {
+  Page* p = bp_fetch_page(bp, bt->meta_pid, LATCH_EXCLUSIVE);
+  memcpy(p->data + 0, &bt->root_pid, sizeof(uint32_t));
+  p->data[4] = (uint8_t)bt->key_type;
+  memcpy(p->data + 6, &bt->key_size, sizeof(uint16_t));
+  memcpy(p->data + 8, &bt->run, sizeof(PageRun));
+  bp_unpin_page(bp, bt->meta_pid, true);
+}
+
+uint32_t btree_create(BufferPool* bp, ColumnType key_type) {
+  BTree bt = {
+    .meta_pid = freelist_alloc(bp),
+    .key_type = key_type
+  };
+  switch (row_value_kind(key_type)) {
+    case VAL_I32: bt.key_size = sizeof(int32_t); break;
+    case VAL_I64: bt.key_size = sizeof(int64_t); break;
+    case VAL_F64: bt.key_size = sizeof(double); break;
+    case VAL_TEXT: bt.key_size = BTREE_KEY_MAX; break;
+  }
+  bt.root_pid = new_node(bp, &bt, true);
+  write_meta(bp, &bt);
+  return bt.meta_pid;
+}
+
+BTree btree_open(BufferPool* bp, uint32_t meta_pid) {
+  BTree bt = { .meta_pid = meta_pid };
+  Page* p = bp_fetch_page(bp, meta_pid, LATCH_SHARED);
+  memcpy(&bt.root_pid, p->data + 0, sizeof(uint32_t));
+  bt.key_type = (ColumnType)p->data[4];
+  memcpy(&bt.key_size, p->data + 6, sizeof(uint16_t));
+  memcpy(&bt.run, p->data + 8, sizeof(PageRun));
+  bp_unpin_page(bp, meta_pid, false);
+  return bt;
+}
+
+void btree_reset(BufferPool* bp, BTree* bt) {
+  bt->root_pid = new_node(bp, bt, true);
+  write_meta(bp, bt);
+}
+
+// ============================================================================
+// Insert
+// ============================================================================
+
+static void put_entry(const BTree* bt, uint8_t* e, const uint8_t* key, RID rid,
+                      bool leaf, uint32_t child) {
+  memcpy(e, key, bt->key_size);
+  memcpy(e + bt->key_size, &rid.page_id, sizeof(uint32_t));
+  memcpy(e + bt->key_size + 4, &rid.slot_id, sizeof(uint16_t));
+  if (!leaf) memcpy(e + bt->key_size + RID_BYTES, &child, sizeof(uint32_t));
+}
+
+static void insert_at(const BTree* bt, Page* p, int pos, const uint8_t* key, RID rid, uint32_t child) {
+  bool leaf = node_is_leaf(p);
+  size_t es = entry_size(bt, leaf);
+  uint16_t n = node_count(p);
+
+  uint8_t* e = entry_at(bt, p, pos);
+  memmove(e + es, e, (size_t)(n - pos) * es);
+  put_entry(bt, e, key, rid, leaf, child);
+  node_set_count(p, n + 1);
+}
+
+// Moves the upper half of a full node into a new right sibling. Returns the
+// sibling's page ID and copies the separator that must go into the parent.
+static uint32_t split_node(BufferPool* bp, BTree* bt, Page* p,
+                           uint8_t* sep_key, RID* sep_rid) {
+  bool leaf = node_is_leaf(p);
+  size_t es = entry_size(bt, leaf);
+  uint16_t n = node_count(p);
+  int mid = n / 2;
+
+  uint32_t right_pid = new_node(bp, bt, leaf);
+  Page* r = bp_fetch_page(bp, right_pid, LATCH_EXCLUSIVE);
+
+  uint8_t* m = entry_at(bt, p, mid);
+  memcpy(sep_key, m, bt->key_size);
+  *sep_rid = entry_rid(bt, m);
+
+  if (leaf) {
+    // Leaf: the separator is copied up and stays as the sibling's first entry.
+    memcpy(entry_at(bt, r, 0), m, (size_t)(n - mid) * es);
+    node_set_count(r, (uint16_t)(n - mid));
+    node_set_link(r, node_link(p));
+    node_set_link(p, right_pid);
+  } else {
+    // Internal: the separator moves up; its child becomes the sibling's leftmost.
+    node_set_link(r, entry_child(bt, m));
+    memcpy(entry_at(bt, r, 0), m + es, (size_t)(n - mid - 1) * es);
+    node_set_count(r, (uint16_t)(n - mid - 1));
+  }
+  node_set_count(p, (uint16_t)mid);
+
+  bp_unpin_page(bp, right_pid, true);
+  return right_pid;
+}
+
+void btree_insert(BufferPool* bp, BTree* bt, const uint8_t* key, RID rid) {
+  uint32_t path[BTREE_MAX_DEPTH];
+  int depth = 0;
+
+  uint32_t pid = bt->root_pid;
+  while (1) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    if (node_is_leaf(p)) {
+      bp_unpin_page(bp, pid, false);
+      break;
+    }
+    path[depth++] = pid;
+    uint32_t child = child_for(bt, p, key, rid, NULL);
+    bp_unpin_page(bp, pid, false);
+    pid = child;
+  }
+
+  // Insert into the leaf, then push separators up while nodes overflow.
+  uint8_t cur_key[BTREE_KEY_MAX];
+  RID cur_rid = rid;
+  uint32_t cur_child = INVALID_PID;
+  memcpy(cur_key, key, bt->key_size);
+
+  while (1) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+    bool leaf = node_is_leaf(p);
+    int pos = leaf ? lower_bound(bt, p, cur_key, cur_rid) : 0;
+    if (!leaf) child_for(bt, p, cur_key, cur_rid, &pos);
+
+    insert_at(bt, p, pos, cur_key, cur_rid, cur_child);
+
+    if (node_count(p) < node_capacity(bt, leaf)) {
+      bp_unpin_page(bp, pid, true);
+      return;
+    }
+
+    uint8_t sep_key[BTREE_KEY_MAX];
+    RID sep_rid;
+    uint32_t right = split_node(bp, bt, p, sep_key, &sep_rid);
+    bp_unpin_page(bp, pid, true);
+
+    if (depth == 0) {
+      // The root split: grow the tree by one level.
+      uint32_t root = new_node(bp, bt, false);
+      Page* r = bp_fetch_page(bp, root, LATCH_EXCLUSIVE);
+      node_set_link(r, pid);
+      insert_at(bt, r, 0, sep_key, sep_rid, right);
+      bp_unpin_page(bp, root, true);
+
+      bt->root_pid = root;
+      write_meta(bp, bt);
+      return;
+    }
+
+    pid = path[--depth];
+    memcpy(cur_key, sep_key, bt->key_size);
+    cur_rid = sep_rid;
+    cur_child = right;
+  }
+}
+
+// ============================================================================
+// Delete
+// ============================================================================
+
+bool btree_delete(BufferPool* bp, BTree* bt, const uint8_t* key, RID rid) {
+  uint32_t pid = bt->root_pid;
+
+  while (1) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+    if (!node_is_leaf(p)) {
+      uint32_t child = child_for(bt, p, key, rid, NULL);
+      bp_unpin_page(bp, pid, false);
+      pid = child;
+      continue;
+    }
+
+    int pos = lower_bound(bt, p, key, rid);
+    uint16_t n = node_count(p);
+    if (pos >= n || compare_entry(bt, entry_at(bt, p, pos), key, rid) != 0) {
+      bp_unpin_page(bp, pid, false);
+      return false;
+    }
+
+    size_t es = entry_size(bt, true);
+    uint8_t* e = entry_at(bt, p, pos);
+    memmove(e, e + es, (size_t)(n - pos - 1) * es);
+    node_set_count(p, n - 1);
+    bp_unpin_page(bp, pid, true);
+    return true;
+  }
+}
+
+// ============================================================================
+// Range scans
+// ============================================================================
+
+void btree_seek(BufferPool* bp, const BTree* bt, const uint8_t* lo, const uint8_t* hi,
+                BTreeCursor* cur) {
+  static const RID min_rid = { 0, 0 };
+  memset(cur, 0, sizeof(*cur));
+  if (hi) {
+    cur->has_hi = true;
+    memcpy(cur->hi, hi, bt->key_size);
+  }
+
+  uint32_t pid = bt->root_pid;
+  while (1) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    if (node_is_leaf(p)) {
+      cur->leaf_pid = pid;
+      cur->idx = lo ? lower_bound(bt, p, lo, min_rid) : 0;
+      bp_unpin_page(bp, pid, false);
+      return;
+    }
+
+    uint32_t child = lo ? child_for(bt, p, lo, min_rid, NULL) : node_link(p);
+    bp_unpin_page(bp, pid, false);
+    pid = child;
+  }
+}
+
+bool btree_next(BufferPool* bp, const BTree* bt, BTreeCursor* cur, RID* out_rid) {
+  while (cur->leaf_pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, cur->leaf_pid, LATCH_SHARED);
+
+    if (cur->idx < node_count(p)) {
+      uint8_t* e = entry_at(bt, p, cur->idx);
+      if (cur->has_hi && compare_keys(bt, e, cur->hi) > 0) {
+        bp_unpin_page(bp, cur->leaf_pid, false);
+        cur->leaf_pid = INVALID_PID;
+        return false;
+      }
+
+      *out_rid = entry_rid(bt, e);
+      cur->idx++;
+      bp_unpin_page(bp, cur->leaf_pid, false);
+      return true;
+    }
+
+    uint32_t next = node_link(p);
+    bp_unpin_page(bp, cur->leaf_pid, false);
+    cur->leaf_pid = next;
+    cur->idx = 0;
+  }
+  return false;
+}
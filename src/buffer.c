@@ -2,112 +2,468 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
 
 #define INVALID_PID 0xFFFFFFFF
 
-static int find_frame(BufferPool* bp, uint32_t pid) {
-  for (int i = 0; i < bp->capacity; i++) {
-    if (bp->frames[i].is_valid && bp->frames[i].page_id == pid) {
-      return i;
-    }
+static uint32_t pt_hash(uint32_t pid) {
+  pid ^= pid >> 16;
+  pid *= 0x85EBCA6Bu;
+  pid ^= pid >> 13;
+  pid *= 0xC2B2AE35u;
+  pid ^= pid >> 16;
+  return pid;
+}
+
+static void pt_init(PageTable* t, int capacity) {
+  uint32_t n = 16;
+  while (n < (uint32_t)capacity * 2) n <<= 1;
+
+  t->keys = malloc(sizeof(uint32_t) * n);
+  t->vals = malloc(sizeof(int) * n);
+  t->mask = n - 1;
+  t->count = 0;
+  memset(t->keys, 0xFF, sizeof(uint32_t) * n);
+}
+
+static void pt_free(PageTable* t) {
+  free(t->keys);
+  free(t->vals);
+}
+
+static int pt_lookup(const PageTable* t, uint32_t pid) {
+  uint32_t i = pt_hash(pid) & t->mask;
+  while (t->keys[i] != INVALID_PID) {
+    if (t->keys[i] == pid) return t->vals[i];
+    i = (i + 1) & t->mask;
   }
   return -1;
 }
 
+static void pt_insert(PageTable* t, uint32_t pid, int frame);
+
+// Partitions are sized for an even share of the frames; one that ends up
+// holding more grows instead of overflowing.
+static void pt_grow(PageTable* t) {
+  PageTable old = *t;
+  pt_init(t, (int)(old.mask + 1));
+  for (uint32_t i = 0; i <= old.mask; i++) {
+    if (old.keys[i] != INVALID_PID) pt_insert(t, old.keys[i], old.vals[i]);
+  }
+  pt_free(&old);
+}
+
+static void pt_insert(PageTable* t, uint32_t pid, int frame) {
+  if ((t->count + 1) * 2 > t->mask + 1) pt_grow(t);
+
+  uint32_t i = pt_hash(pid) & t->mask;
+  while (t->keys[i] != INVALID_PID && t->keys[i] != pid) {
+    i = (i + 1) & t->mask;
+  }
+  if (t->keys[i] == INVALID_PID) t->count++;
+  t->keys[i] = pid;
+  t->vals[i] = frame;
+}
+
+static void pt_remove(PageTable* t, uint32_t pid) {
+  uint32_t i = pt_hash(pid) & t->mask;
+  while (t->keys[i] != pid) {
+    if (t->keys[i] == INVALID_PID) return;
+    i = (i + 1) & t->mask;
+  }
+
+  // Backward-shift deletion: pull later entries of the probe run into the
+  // hole unless that would move them before their home slot.
+  uint32_t hole = i;
+  uint32_t j = i;
+  while (1) {
+    j = (j + 1) & t->mask;
+    if (t->keys[j] == INVALID_PID) break;
+
+    uint32_t home = pt_hash(t->keys[j]) & t->mask;
+    if (((j - home) & t->mask) >= ((j - hole) & t->mask)) {
+      t->keys[hole] = t->keys[j];
+      t->vals[hole] = t->vals[j];
+      hole = j;
+    }
+  }
+  t->keys[hole] = INVALID_PID;
+  t->count--;
+}
+
+static BufferPartition* partition_of(BufferPool* bp, uint32_t pid) {
+  // The low hash bits pick the slot inside a partition, so use high ones here.
+  return &bp->parts[(pt_hash(pid) >> 24) & bp->part_mask];
+}
+
+#define WAL_MAX_RANGES 32
+#define WAL_RANGE_GAP 8
+
+// Collects the byte ranges in which 'cur' differs from 'old'. Ranges closer
+// than WAL_RANGE_GAP bytes are merged; past WAL_MAX_RANGES the last range is
+// stretched to cover the remaining changes.
+static int diff_page(const uint8_t* old, const uint8_t* cur, WalRange* out) {
+  int n = 0;
+  size_t i = 0;
+
+  while (i < PAGE_SIZE) {
+    while (i + 8 <= PAGE_SIZE && memcmp(old + i, cur + i, 8) == 0) i += 8;
+    while (i < PAGE_SIZE && old[i] == cur[i]) i++;
+    if (i >= PAGE_SIZE) break;
+
+    size_t start = i;
+    size_t last = i;
+    while (i < PAGE_SIZE && i - last <= WAL_RANGE_GAP) {
+      if (old[i] != cur[i]) last = i;
+      i++;
+    }
+
+    if (n == WAL_MAX_RANGES) {
+      out[n - 1].len = (uint16_t)(last + 1 - out[n - 1].offset);
+    } else {
+      out[n].offset = (uint16_t)start;
+      out[n].len = (uint16_t)(last + 1 - start);
+      n++;
+    }
+  }
+  return n;
+}
+
+// Logs the changes made to a frame since it was last logged and stamps the
+// record's LSN into the page header. The shadow copy is the page image as of
+// the previous log record (or as read from disk).
+static void log_frame_changes(BufferPool* bp, int idx) {
+  Page* page = bp->frames[idx].page;
+  Page* shadow = &bp->shadows[idx];
+
+  if (!bp->wal->recovering) {
+    WalRange ranges[WAL_MAX_RANGES];
+    int n = diff_page((const uint8_t*)shadow, (const uint8_t*)page, ranges);
+    if (n == 0) return;
+
+    page->hdr.lsn = wal_log_update(bp->wal, bp->frames[idx].page_id,
+                                   (const uint8_t*)shadow, (const uint8_t*)page, ranges, n);
+  }
+  memcpy(shadow, page, sizeof(Page));
+}
+
+// Pins an unpinned frame for reuse. Succeeds only if nobody holds or takes
+// a pin concurrently: hits pin under the partition lock, evictions recheck
+// the count under the same lock before dropping the mapping.
+static bool try_claim(BufferFrame* f) {
+  int expected = 0;
+  return atomic_compare_exchange_strong(&f->pin_count, &expected, 1);
+}
+
 static int pick_victim(BufferPool* bp) {
-  int scanned = 0;
-  while (scanned < bp->capacity * 2) {
-    int i = bp->clock_hand;
+  // Once the log or the file has failed, dirty pages can no longer be
+  // written out.
+  bool clean_only = (bp->wal && wal_failed(bp->wal)) || bp->dm->io_error;
+  uint32_t limit = (uint32_t)bp->capacity * 4;
+  for (uint32_t scanned = 0; scanned < limit; scanned++) {
+    uint32_t i = atomic_fetch_add(&bp->clock_hand, 1) % (uint32_t)bp->capacity;
     BufferFrame* f = &bp->frames[i];
 
-    if (!f->is_valid) {
-      bp->clock_hand = (i + 1) % bp->capacity;
-      return i;
+    if (atomic_load(&f->pin_count) != 0) continue;
+    if (clean_only && atomic_load(&f->is_dirty)) continue;
+    if (f->is_valid && atomic_exchange(&f->refbit, false)) continue;
+    if (try_claim(f)) return (int)i;
+  }
+
+  return -1;
+}
+
+// Writes a frame's page if it is dirty. The caller has the frame pinned; the
+// shared latch keeps writers out while the image is written. Fails, leaving
+// the page dirty, if the log its changes need cannot be made durable or the
+// page cannot be written.
+static bool write_back(BufferPool* bp, BufferFrame* f) {
+  if (!atomic_load(&f->is_dirty)) return true;
+
+  bool ok = true;
+  pthread_rwlock_rdlock(&f->latch);
+  if (atomic_exchange(&f->is_dirty, false)) {
+    ok = (!bp->wal || wal_flush(bp->wal, f->page->hdr.lsn)) &&
+         disk_write_page(bp->dm, f->page_id, f->page);
+    if (!ok) atomic_store(&f->is_dirty, true);
+  }
+  pthread_rwlock_unlock(&f->latch);
+  return ok;
+}
+
+// Detaches the page currently in a claimed frame from the page table. Fails,
+// dropping the claim, if someone else pinned the page in the meantime or it
+// could not be written.
+static bool evict(BufferPool* bp, BufferFrame* f) {
+  while (f->is_valid) {
+    if (!write_back(bp, f)) {
+      atomic_fetch_sub(&f->pin_count, 1);
+      return false;
     }
 
-    if (f->pin_count == 0) {
-      if (f->refbit) {
-        f->refbit = false;
-      } else {
-        bp->clock_hand = (i + 1) % bp->capacity;
-        return i;
+    BufferPartition* part = partition_of(bp, f->page_id);
+    pthread_mutex_lock(&part->mu);
+    if (atomic_load(&f->pin_count) != 1) {
+      pthread_mutex_unlock(&part->mu);
+      atomic_fetch_sub(&f->pin_count, 1);
+      return false;
+    }
+    // Dirtied again by a writer that pinned it during the write: go around.
+    if (!atomic_load(&f->is_dirty)) {
+      pt_remove(&part->table, f->page_id);
+      f->is_valid = false;
+    }
+    pthread_mutex_unlock(&part->mu);
+  }
+  return true;
+}
+
+// Takes a frame for a new page: the ring's oldest frame when it can be
+// recycled, otherwise a clock victim. The frame is returned pinned, empty
+// and unmapped.
+static int take_frame(BufferPool* bp, BufferRing* ring, bool* from_ring) {
+  while (1) {
+    int idx = -1;
+    *from_ring = false;
+
+    if (ring && ring->size > 0 && ring->frames[ring->next] >= 0) {
+      BufferFrame* f = &bp->frames[ring->frames[ring->next]];
+      // Someone else re-referenced or replaced the page: leave it to the clock.
+      if (f->is_valid && f->page_id == ring->pids[ring->next] &&
+          !atomic_load(&f->refbit) && try_claim(f)) {
+        idx = ring->frames[ring->next];
+        *from_ring = true;
       }
     }
 
-    bp->clock_hand = (i + 1) % bp->capacity;
-    scanned++;
+    if (idx < 0) idx = pick_victim(bp);
+    if (idx < 0) return -1;
+    if (evict(bp, &bp->frames[idx])) return idx;
+  }
+}
+
+// Pins a resident page. The caller holds the partition lock.
+static int pin_resident(BufferPartition* part, BufferFrame* frames, uint32_t page_id, bool ring) {
+  int idx = pt_lookup(&part->table, page_id);
+  if (idx < 0) return -1;
+
+  BufferFrame* f = &frames[idx];
+  atomic_fetch_add(&f->pin_count, 1);
+  // A scan passing over a resident page must not make it look hot.
+  if (!ring && !atomic_load_explicit(&f->refbit, memory_order_relaxed)) {
+    atomic_store(&f->refbit, true);
   }
+  part->hits++;
+  return idx;
+}
 
-  return -1;
+static void latch(BufferFrame* f, LatchMode mode) {
+  if (mode == LATCH_EXCLUSIVE) pthread_rwlock_wrlock(&f->latch);
+  else pthread_rwlock_rdlock(&f->latch);
+}
+
+static Page* fetch_page(BufferPool* bp, uint32_t page_id, BufferRing* ring, LatchMode mode) {
+  BufferPartition* part = partition_of(bp, page_id);
+
+  pthread_mutex_lock(&part->mu);
+  int idx = pin_resident(part, bp->frames, page_id, ring != NULL);
+  pthread_mutex_unlock(&part->mu);
+
+  if (idx >= 0) {
+    // Waits here while another thread is still reading the page in.
+    latch(&bp->frames[idx], mode);
+    return bp->frames[idx].page;
+  }
+
+  bool from_ring;
+  int victim = take_frame(bp, ring, &from_ring);
+  // Every frame is pinned.
+  if (victim < 0) return NULL;
+  BufferFrame* f = &bp->frames[victim];
+
+  pthread_mutex_lock(&part->mu);
+  idx = pin_resident(part, bp->frames, page_id, ring != NULL);
+  if (idx >= 0) {
+    // Another thread loaded the page while we were evicting: hand the frame
+    // back empty and use theirs.
+    pthread_mutex_unlock(&part->mu);
+    atomic_fetch_sub(&f->pin_count, 1);
+    latch(&bp->frames[idx], mode);
+    return bp->frames[idx].page;
+  }
+
+  // Publish the mapping with the latch held so concurrent fetchers of this
+  // page wait for the read below instead of seeing a half-loaded frame.
+  pthread_rwlock_wrlock(&f->latch);
+  f->page_id = page_id;
+  f->is_valid = true;
+  atomic_store(&f->is_dirty, false);
+  atomic_store(&f->refbit, ring == NULL);
+  pt_insert(&part->table, page_id, victim);
+  part->misses++;
+  if (from_ring) part->ring_reuses++;
+  pthread_mutex_unlock(&part->mu);
+
+  disk_read_page(bp->dm, page_id, f->page);
+  if (bp->wal) memcpy(&bp->shadows[victim], f->page, sizeof(Page));
+
+  if (ring && ring->size > 0) {
+    ring->frames[ring->next] = victim;
+    ring->pids[ring->next] = page_id;
+    ring->next = (ring->next + 1) % ring->size;
+  }
+
+  if (mode == LATCH_SHARED) {
+    pthread_rwlock_unlock(&f->latch);
+    pthread_rwlock_rdlock(&f->latch);
+  }
+  return f->page;
+}
+
+static int partition_count(int capacity) {
+  int n = 1;
+  while (n < BP_MAX_PARTITIONS && n * 2 * 64 <= capacity) n *= 2;
+  return n;
 }
 
 BufferPool* bp_create(DiskManager* dm, int capacity) {
+  // Page memory is reserved lazily: a large pool only commits the frames it
+  // actually loads, and the array is page-aligned for the kernel.
+  void* pages = mmap(NULL, sizeof(Page) * (size_t)capacity, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (pages == MAP_FAILED) return NULL;
+
   BufferPool* bp = calloc(1, sizeof(*bp));
   bp->dm = dm;
   bp->capacity = capacity;
   bp->frames = calloc(capacity, sizeof(BufferFrame));
-  bp->clock_hand = 0;
+  bp->pages = pages;
+  atomic_init(&bp->clock_hand, 0);
+
+  int nparts = partition_count(capacity);
+  bp->parts = aligned_alloc(64, sizeof(BufferPartition) * (size_t)nparts);
+  memset(bp->parts, 0, sizeof(BufferPartition) * (size_t)nparts);
+  bp->part_mask = (uint32_t)nparts - 1;
+  for (int i = 0; i < nparts; i++) {
+    pthread_mutex_init(&bp->parts[i].mu, NULL);
+    pt_init(&bp->parts[i].table, capacity / nparts);
+  }
 
   for (int i = 0; i < capacity; i++) {
     bp->frames[i].page_id = INVALID_PID;
+    bp->frames[i].page = &bp->pages[i];
+    pthread_rwlock_init(&bp->frames[i].latch, NULL);
   }
   return bp;
 }
 
-void bp_flush_all(BufferPool* bp) {
+bool bp_attach_wal(BufferPool* bp, LogManager* lm) {
+  bp->shadows = mmap(NULL, sizeof(Page) * (size_t)bp->capacity, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (bp->shadows == MAP_FAILED) {
+    bp->shadows = NULL;
+    return false;
+  }
+
+  for (int i = 0; i < bp->capacity; i++) {
+    if (bp->frames[i].is_valid) memcpy(&bp->shadows[i], bp->frames[i].page, sizeof(Page));
+  }
+  bp->wal = lm;
+  return true;
+}
+
+bool bp_flush_all(BufferPool* bp) {
+  // WAL-before-data: every logged change must be durable before any page
+  // carrying it reaches the database file.
+  if (bp->wal && !wal_flush(bp->wal, bp->wal->next_lsn - 1)) return false;
+
   for (int i = 0; i < bp->capacity; i++) {
     BufferFrame* f = &bp->frames[i];
-    if (f->is_valid && f->is_dirty) {
-      disk_write_page(bp->dm, f->page_id, &f->page);
-      f->is_dirty = false;
-    }
+    if (!atomic_load(&f->is_dirty)) continue;
+
+    // Pin the frame through its mapping so it cannot be evicted mid-write.
+    uint32_t pid = f->page_id;
+    if (pid == INVALID_PID) continue;
+    BufferPartition* part = partition_of(bp, pid);
+    pthread_mutex_lock(&part->mu);
+    bool pinned = f->is_valid && f->page_id == pid && pt_lookup(&part->table, pid) == i;
+    if (pinned) atomic_fetch_add(&f->pin_count, 1);
+    pthread_mutex_unlock(&part->mu);
+    if (!pinned) continue;
+
+    bool ok = write_back(bp, f);
+    atomic_fetch_sub(&f->pin_count, 1);
+    if (!ok) return false;
   }
+  return true;
+}
+
+bool bp_checkpoint(BufferPool* bp) {
+  // The log is only discarded once every change in it is in the file.
+  if (!bp_flush_all(bp) || !disk_sync(bp->dm)) return false;
+  if (bp->wal) wal_reset(bp->wal);
+  return true;
 }
 
 void bp_destroy(BufferPool* bp) {
   if (!bp) return;
-  bp_flush_all(bp);
+  bp_checkpoint(bp);
+  for (uint32_t i = 0; i <= bp->part_mask; i++) {
+    pthread_mutex_destroy(&bp->parts[i].mu);
+    pt_free(&bp->parts[i].table);
+  }
+  free(bp->parts);
+  for (int i = 0; i < bp->capacity; i++) pthread_rwlock_destroy(&bp->frames[i].latch);
+  if (bp->shadows) munmap(bp->shadows, sizeof(Page) * (size_t)bp->capacity);
+  munmap(bp->pages, sizeof(Page) * (size_t)bp->capacity);
   free(bp->frames);
   free(bp);
 }
 
-Page* bp_fetch_page(BufferPool* bp, uint32_t page_id) {
-  int idx = find_frame(bp, page_id);
-  if (idx >= 0) {
-    BufferFrame* f = &bp->frames[idx];
-    f->pin_count++;
-    f->refbit = true;
-    return &f->page;
-  }
-
-  int victim = pick_victim(bp);
-  if (victim < 0) {
-    fprintf(stderr, "BufferPool full: all pages pinned\n");
-    return NULL;
-  }
-
-  BufferFrame* f = &bp->frames[victim];
+Page* bp_fetch_page(BufferPool* bp, uint32_t page_id, LatchMode mode) {
+  return fetch_page(bp, page_id, NULL, mode);
+}
 
-  if (f->is_valid && f->is_dirty) {
-    disk_write_page(bp->dm, f->page_id, &f->page);
+void bp_ring_init(BufferPool* bp, BufferRing* ring) {
+  int size = bp->capacity / 4;
+  ring->size = size < BP_RING_MAX ? size : BP_RING_MAX;
+  ring->next = 0;
+  for (int i = 0; i < BP_RING_MAX; i++) {
+    ring->frames[i] = -1;
+    ring->pids[i] = INVALID_PID;
   }
+}
 
-  disk_read_page(bp->dm, page_id, &f->page);
-
-  f->page_id = page_id;
-  f->is_valid = true;
-  f->is_dirty = false;
-  f->pin_count = 1;
-  f->refbit = true;
-
-  return &f->page;
+Page* bp_fetch_page_ring(BufferPool* bp, uint32_t page_id, BufferRing* ring) {
+  return fetch_page(bp, page_id, ring, LATCH_SHARED);
 }
 
 void bp_unpin_page(BufferPool* bp, uint32_t page_id, bool dirty) {
-  int idx = find_frame(bp, page_id);
+  BufferPartition* part = partition_of(bp, page_id);
+  pthread_mutex_lock(&part->mu);
+  int idx = pt_lookup(&part->table, page_id);
+  pthread_mutex_unlock(&part->mu);
   if (idx < 0) return;
 
+  // The page is pinned, so its mapping cannot change under us.
   BufferFrame* f = &bp->frames[idx];
-  if (dirty) f->is_dirty = true;
-  if (f->pin_count > 0) f->pin_count--;
+  if (dirty) {
+    atomic_store(&f->is_dirty, true);
+    if (bp->wal) log_frame_changes(bp, idx);
+  }
+  pthread_rwlock_unlock(&f->latch);
+  atomic_fetch_sub(&f->pin_count, 1);
+}
+
+void bp_stats(BufferPool* bp, BufferStats* out) {
+  memset(out, 0, sizeof(*out));
+  for (uint32_t i = 0; i <= bp->part_mask; i++) {
+    BufferPartition* part = &bp->parts[i];
+    pthread_mutex_lock(&part->mu);
+    out->hits += part->hits;
+    out->misses += part->misses;
+    out->ring_reuses += part->ring_reuses;
+    pthread_mutex_unlock(&part->mu);
+  }
 }
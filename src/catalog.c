@@ -1,8 +1,137 @@
 #include "catalog.h"
 #include "disk.h"
 #include "heap.h"
+#include "recovery.h"
+#include <stddef.h>
 #include <string.h>
-#include <stdio.h>
+#include <stdlib.h>
+
+// ============================================================================
+// Metadata Cache
+// ============================================================================
+
+#define CACHE_MAX_COLS 64
+#define CACHE_MAX_INDEXES 16
+
+/**
+ * Cached metadata of one table. Each part is filled in lazily by the first
+ * lookup that scans for it; -1 counts mean "not cached yet".
+ */
+typedef struct {
+  char name[TABLE_NAME_MAX];
+  bool used;
+  bool has_heap;
+  uint32_t heap_header_pid;
+  int ncols;
+  ColumnDef cols[CACHE_MAX_COLS];
+  int nindexes;
+  IndexEntry indexes[CACHE_MAX_INDEXES];
+} CacheEntry;
+
+/**
+ * Open-addressing hash table keyed by table name. Tables are never dropped,
+ * so entries are only ever invalidated in place, never removed.
+ */
+struct CatalogCache {
+  CacheEntry* slots;
+  uint32_t mask;
+  uint32_t count;
+};
+
+static uint32_t name_hash(const char* name) {
+  uint32_t h = 2166136261u;
+  for (const char* p = name; *p; p++) {
+    h ^= (uint8_t)*p;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static CatalogCache* cache_create(void) {
+  CatalogCache* cc = calloc(1, sizeof(CatalogCache));
+  if (!cc) return NULL;
+  cc->slots = calloc(16, sizeof(CacheEntry));
+  if (!cc->slots) {
+    free(cc);
+    return NULL;
+  }
+  cc->mask = 15;
+  return cc;
+}
+
+static void cache_destroy(CatalogCache* cc) {
+  if (!cc) return;
+  free(cc->slots);
+  free(cc);
+}
+
+static CacheEntry* cache_probe(CacheEntry* slots, uint32_t mask, const char* name) {
+  uint32_t i = name_hash(name) & mask;
+  while (slots[i].used && strncmp(slots[i].name, name, TABLE_NAME_MAX) != 0) {
+    i = (i + 1) & mask;
+  }
+  return &slots[i];
+}
+
+static bool cache_grow(CatalogCache* cc) {
+  uint32_t new_size = (cc->mask + 1) * 2;
+  CacheEntry* grown = calloc(new_size, sizeof(CacheEntry));
+  if (!grown) return false;
+
+  for (uint32_t i = 0; i <= cc->mask; i++) {
+    if (!cc->slots[i].used) continue;
+    *cache_probe(grown, new_size - 1, cc->slots[i].name) = cc->slots[i];
+  }
+  free(cc->slots);
+  cc->slots = grown;
+  cc->mask = new_size - 1;
+  return true;
+}
+
+// Returns the table's entry, or NULL if it is not cached (and 'create' is
+// false, or the cache cannot grow).
+static CacheEntry* cache_get(CatalogCache* cc, const char* name, bool create) {
+  if (!cc || strlen(name) >= TABLE_NAME_MAX) return NULL;
+
+  CacheEntry* e = cache_probe(cc->slots, cc->mask, name);
+  if (e->used) return e;
+  if (!create) return NULL;
+
+  // Keep the load factor at or below one half.
+  if ((cc->count + 1) * 2 > cc->mask + 1) {
+    if (!cache_grow(cc)) return NULL;
+    e = cache_probe(cc->slots, cc->mask, name);
+  }
+
+  memset(e, 0, sizeof(*e));
+  strncpy(e->name, name, TABLE_NAME_MAX - 1);
+  e->used = true;
+  e->ncols = -1;
+  e->nindexes = -1;
+  cc->count++;
+  return e;
+}
+
+// Returns the entry of a table the catalog holds, creating it once the
+// table is found, or NULL. Names of missing tables never get an entry.
+static CacheEntry* cache_get_table(BufferPool* bp, const Catalog* c, const char* name) {
+  CacheEntry* e = cache_get(c->cache, name, false);
+  uint32_t heap_h_pid;
+  if (!e && catalog_find_table(bp, c, name, &heap_h_pid)) e = cache_get(c->cache, name, false);
+  return e;
+}
+
+static void cache_invalidate(CatalogCache* cc, const char* name) {
+  CacheEntry* e = cache_get(cc, name, false);
+  if (!e) return;
+  e->has_heap = false;
+  e->ncols = -1;
+  e->nindexes = -1;
+}
+
+// ============================================================================
+// Catalog Pages
+// ============================================================================
 
 static void write_magic(Page* p) {
   memset(p->data, 0, 8);
@@ -10,15 +139,18 @@ static void write_magic(Page* p) {
 }
 
 void catalog_write(BufferPool* bp, const Catalog* c) {
-  Page* p = bp_fetch_page(bp, CATALOG_PID);
+  Page* p = bp_fetch_page(bp, CATALOG_PID, LATCH_EXCLUSIVE);
   write_magic(p);
   memcpy(p->data + 8, &c->catalog_heap_header_pid, sizeof(uint32_t));
   memcpy(p->data + 12, &c->columns_heap_header_pid, sizeof(uint32_t));
+  memcpy(p->data + 16, &c->indexes_heap_header_pid, sizeof(uint32_t));
   bp_unpin_page(bp, CATALOG_PID, true);
 }
 
 Catalog catalog_open(BufferPool* bp) {
   Catalog c = {0};
+  recovery_run(bp, &c.recovery);
+
   long size = disk_file_size(bp->dm);
 
   if (size == 0) {
@@ -32,23 +164,43 @@ Catalog catalog_open(BufferPool* bp) {
     uint32_t c_d = disk_alloc_page(bp->dm);
     heap_bootstrap(bp, c_h, c_d);
 
+    uint32_t i_h = disk_alloc_page(bp->dm);
+    uint32_t i_d = disk_alloc_page(bp->dm);
+    heap_bootstrap(bp, i_h, i_d);
+
     c.catalog_heap_header_pid = t_h;
     c.columns_heap_header_pid = c_h;
+    c.indexes_heap_header_pid = i_h;
     catalog_write(bp, &c);
+    c.cache = cache_create();
     return c;
   }
 
-  Page* p = bp_fetch_page(bp, CATALOG_PID);
+  Page* p = bp_fetch_page(bp, CATALOG_PID, LATCH_SHARED);
 
   memcpy(&c.catalog_heap_header_pid, p->data + 8, sizeof(uint32_t));
   memcpy(&c.columns_heap_header_pid, p->data + 12, sizeof(uint32_t));
+  memcpy(&c.indexes_heap_header_pid, p->data + 16, sizeof(uint32_t));
   bp_unpin_page(bp, CATALOG_PID, false);
+  c.cache = cache_create();
   return c;
 }
 
-int catalog_find_table(BufferPool* bp, Catalog* c, const char* name, uint32_t* out_heap_header_pid) {
+void catalog_close(Catalog* c) {
+  cache_destroy(c->cache);
+  c->cache = NULL;
+}
+
+int catalog_find_table(BufferPool* bp, const Catalog* c, const char* name,
+                       uint32_t* out_heap_header_pid) {
   if (c->catalog_heap_header_pid == INVALID_PID) return 0;
 
+  CacheEntry* ce = cache_get(c->cache, name, false);
+  if (ce && ce->has_heap) {
+    *out_heap_header_pid = ce->heap_header_pid;
+    return 1;
+  }
+
   HeapFile cat_hf = heap_open(bp, c->catalog_heap_header_pid);
   
   RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
@@ -67,6 +219,12 @@ int catalog_find_table(BufferPool* bp, Catalog* c, const char* name, uint32_t* o
 
     e.name[TABLE_NAME_MAX - 1] = 0;
     if (strncmp(e.name, name, TABLE_NAME_MAX) == 0) {
+      // Misses are not cached, so creating a table needs no bookkeeping here.
+      ce = cache_get(c->cache, name, true);
+      if (ce) {
+        ce->has_heap = true;
+        ce->heap_header_pid = e.heap_header_pid;
+      }
       *out_heap_header_pid = e.heap_header_pid;
       return 1;
     }
@@ -99,6 +257,7 @@ static int insert_column_entries(BufferPool* bp, const Catalog* c,
     strncpy(ce.col, cols[i].col, COL_NAME_MAX - 1);
     ce.type = (uint8_t)cols[i].type;
     ce.ordinal = (uint8_t)i;
+    ce.len = cols[i].len;
 
     heap_insert(bp, &col_hf, (uint8_t*)&ce, (uint16_t)sizeof(ColumnEntry));
   }
@@ -109,35 +268,27 @@ int catalog_create_table(BufferPool* bp, Catalog* c,
                           const char* name,
                           const ColumnDef* cols, int ncols,
                           uint32_t* out_heap_header_pid) {
-  if (strlen(name) >= TABLE_NAME_MAX) {
-    fprintf(stderr, "Table name too long (max %d)\n", TABLE_NAME_MAX - 1);
-    return 0;
-  }
-  if (ncols <= 0) {
-    fprintf(stderr, "Table must have at least one column\n");
-    return 0;
-  }
+  if (strlen(name) >= TABLE_NAME_MAX || ncols <= 0) return 0;
 
   uint32_t existing;
-  if (catalog_find_table(bp, c, name, &existing)) {
-    fprintf(stderr, "Table '%s' already exists in catalog\n", name);
-    return 0;
-  }
+  if (catalog_find_table(bp, c, name, &existing)) return 0;
 
-  uint32_t heap_h_pid = disk_alloc_page(bp->dm);
-  uint32_t heap_d_pid = disk_alloc_page(bp->dm);
+  uint32_t heap_h_pid = freelist_alloc(bp);
+  uint32_t heap_d_pid = freelist_alloc(bp);
   heap_bootstrap(bp, heap_h_pid, heap_d_pid);
 
   insert_table_entry(bp, c, name, heap_h_pid);
   insert_column_entries(bp, c, name, cols, ncols);
+  cache_invalidate(c->cache, name);
+  c->version++;
 
   *out_heap_header_pid = heap_h_pid;
   return 1;
 }
 
-int catalog_load_schema(BufferPool* bp, const Catalog* c,
-                        const char* table,
-                        ColumnDef* out_cols, int max_cols) {
+static int scan_schema(BufferPool* bp, const Catalog* c,
+                       const char* table,
+                       ColumnDef* out_cols, int max_cols) {
   if (c->columns_heap_header_pid == INVALID_PID) return 0;
 
   HeapFile col_hf = heap_open(bp, c->columns_heap_header_pid);
@@ -150,13 +301,15 @@ int catalog_load_schema(BufferPool* bp, const Catalog* c,
   int tmpn = 0;
 
   while (heap_scan_next(bp, &col_hf, &cur, &out, &len)) {
-    if (len < sizeof(ColumnEntry)) {
+    // Entries from before len was added end just ahead of it.
+    if (len < offsetof(ColumnEntry, len)) {
       bp_unpin_page(bp, cur.page_id, false);
       continue;
     }
 
     ColumnEntry ce;
-    memcpy(&ce, out, sizeof(ce));
+    memset(&ce, 0, sizeof(ce));
+    memcpy(&ce, out, len < sizeof(ce) ? len : sizeof(ce));
     bp_unpin_page(bp, cur.page_id, false);
 
     ce.table[TABLE_NAME_MAX - 1] = 0;
@@ -168,6 +321,7 @@ int catalog_load_schema(BufferPool* bp, const Catalog* c,
     memset(&cd, 0, sizeof(cd));
     strncpy(cd.col, ce.col, COL_NAME_MAX - 1);
     cd.type = (ColumnType)ce.type;
+    cd.len = ce.len;
 
     if (tmpn < (int)(sizeof(tmp)/sizeof(tmp[0]))) {
       tmp[ce.ordinal] = cd;
@@ -182,7 +336,31 @@ int catalog_load_schema(BufferPool* bp, const Catalog* c,
   return found;
 }
 
-int catalog_update_table_heap(BufferPool* bp, const Catalog* c,
+int catalog_load_schema(BufferPool* bp, const Catalog* c,
+                        const char* table,
+                        ColumnDef* out_cols, int max_cols) {
+  CacheEntry* ce = cache_get(c->cache, table, false);
+  if (!ce || ce->ncols < 0) {
+    ColumnDef cols[CACHE_MAX_COLS];
+    int n = scan_schema(bp, c, table, cols, CACHE_MAX_COLS);
+    if (n <= 0) return n;
+
+    ce = cache_get_table(bp, c, table);
+    if (!ce) {
+      if (n > max_cols) n = max_cols;
+      memcpy(out_cols, cols, sizeof(ColumnDef) * (size_t)n);
+      return n;
+    }
+    ce->ncols = n;
+    memcpy(ce->cols, cols, sizeof(ColumnDef) * (size_t)n);
+  }
+
+  int n = ce->ncols < max_cols ? ce->ncols : max_cols;
+  memcpy(out_cols, ce->cols, sizeof(ColumnDef) * (size_t)n);
+  return n;
+}
+
+int catalog_update_table_heap(BufferPool* bp, Catalog* c,
                               const char* name, uint32_t new_heap_header_pid) {
   if (c->catalog_heap_header_pid == INVALID_PID) return 0;
   
@@ -197,17 +375,101 @@ int catalog_update_table_heap(BufferPool* bp, const Catalog* c,
       continue;
     }
 
-    CatalogEntry* e = (CatalogEntry*)out;
-    e->name[TABLE_NAME_MAX - 1] = 0;
+    CatalogEntry e;
+    memcpy(&e, out, sizeof(CatalogEntry));
+    bp_unpin_page(bp, cur.page_id, false);
 
-    if (strncmp(e->name, name, TABLE_NAME_MAX) == 0) {
-        e->heap_header_pid = new_heap_header_pid;
-        bp_unpin_page(bp, cur.page_id, true);
-        return 1;
+    e.name[TABLE_NAME_MAX - 1] = 0;
+    if (strncmp(e.name, name, TABLE_NAME_MAX) == 0) {
+      // The scan only holds the page for reading; rewrite the entry in place.
+      e.heap_header_pid = new_heap_header_pid;
+      if (heap_update_in_place(bp, &cat_hf, cur, (const uint8_t*)&e, sizeof(e)) < 0) return 0;
+      cache_invalidate(c->cache, name);
+      c->version++;
+      return 1;
     }
+  }
+  
+  return 0;
+}
+
+int catalog_find_index(BufferPool* bp, const Catalog* c, const char* name) {
+  if (c->indexes_heap_header_pid == 0) return 0;
 
+  HeapFile idx_hf = heap_open(bp, c->indexes_heap_header_pid);
+  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
+  uint8_t* out;
+  uint16_t len;
+
+  while (heap_scan_next(bp, &idx_hf, &cur, &out, &len)) {
+    int taken = len >= sizeof(IndexEntry) &&
+                strncmp(((IndexEntry*)out)->name, name, TABLE_NAME_MAX) == 0;
     bp_unpin_page(bp, cur.page_id, false);
+    if (taken) return 1;
   }
-  
   return 0;
-}
\ No newline at end of file
+}
+
+int catalog_create_index(BufferPool* bp, Catalog* c, const IndexEntry* e) {
+  if (catalog_find_index(bp, c, e->name)) return 0;
+
+  if (c->indexes_heap_header_pid == 0) {
+    // Databases created before indexes existed have no index heap yet.
+    uint32_t i_h = freelist_alloc(bp);
+    uint32_t i_d = freelist_alloc(bp);
+    heap_bootstrap(bp, i_h, i_d);
+    c->indexes_heap_header_pid = i_h;
+    catalog_write(bp, c);
+  }
+
+  HeapFile idx_hf = heap_open(bp, c->indexes_heap_header_pid);
+  heap_insert(bp, &idx_hf, (const uint8_t*)e, (uint16_t)sizeof(IndexEntry));
+  cache_invalidate(c->cache, e->table);
+  c->version++;
+  return 1;
+}
+
+static int scan_indexes(BufferPool* bp, const Catalog* c, const char* table,
+                        IndexEntry* out_entries, int max) {
+  if (c->indexes_heap_header_pid == 0) return 0;
+
+  HeapFile idx_hf = heap_open(bp, c->indexes_heap_header_pid);
+  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
+  uint8_t* out;
+  uint16_t len;
+  int found = 0;
+
+  while (heap_scan_next(bp, &idx_hf, &cur, &out, &len)) {
+    if (len < sizeof(IndexEntry)) {
+      bp_unpin_page(bp, cur.page_id, false);
+      continue;
+    }
+
+    IndexEntry e;
+    memcpy(&e, out, sizeof(e));
+    bp_unpin_page(bp, cur.page_id, false);
+
+    e.table[TABLE_NAME_MAX - 1] = 0;
+    if (strncmp(e.table, table, TABLE_NAME_MAX) == 0 && found < max) {
+      out_entries[found++] = e;
+    }
+  }
+  return found;
+}
+
+int catalog_load_indexes(BufferPool* bp, const Catalog* c, const char* table,
+                         IndexEntry* out_entries, int max) {
+  CacheEntry* ce = cache_get_table(bp, c, table);
+  if (!ce) return scan_indexes(bp, c, table, out_entries, max);
+
+  if (ce->nindexes < 0) {
+    // A table with more indexes than fit stays uncached and is scanned each time.
+    int n = scan_indexes(bp, c, table, ce->indexes, CACHE_MAX_INDEXES);
+    if (n == CACHE_MAX_INDEXES) return scan_indexes(bp, c, table, out_entries, max);
+    ce->nindexes = n;
+  }
+
+  int n = ce->nindexes < max ? ce->nindexes : max;
+  memcpy(out_entries, ce->indexes, sizeof(IndexEntry) * (size_t)n);
+  return n;
+}
@@ -0,0 +1,60 @@
+#include "cursor.h"
+#include "planner.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Cursor* cursor_open(BufferPool* bp, Catalog* cat, const char* sql, size_t work_mem, char* err,
+                    size_t err_cap) {
+  Cursor* c = calloc(1, sizeof(Cursor));
+  if (!c) {
+    snprintf(err, err_cap, "Out of memory.");
+    return NULL;
+  }
+  arena_init(&c->arena);
+  c->ctx = (ExecCtx){ .bp = bp, .cat = cat, .arena = &c->arena, .work_mem = work_mem };
+
+  Stmt* st = parse_statement(&c->arena, sql, c->ctx.err, sizeof(c->ctx.err));
+  if (st && (st->kind != STMT_SELECT || st->explain)) {
+    snprintf(c->ctx.err, sizeof(c->ctx.err), "A cursor needs a SELECT.");
+    st = NULL;
+  }
+  c->plan = st ? plan_select(&c->ctx, &st->select) : NULL;
+  if (c->plan && c->plan->open(c->plan)) {
+    c->open = true;
+    exec_reader_init(&c->reader, c->plan);
+    return c;
+  }
+
+  snprintf(err, err_cap, "%s", c->ctx.err);
+  cursor_close(c);
+  return NULL;
+}
+
+int cursor_ncols(const Cursor* c) {
+  return c->plan->ncols;
+}
+
+const ExecColumn* cursor_column(const Cursor* c, int i) {
+  return &c->plan->cols[i];
+}
+
+int cursor_fetch_batch(Cursor* c, Batch* out) {
+  if (!c->open) return 0;
+  int r = exec_reader_next(&c->reader, out);
+  if (r <= 0) {
+    c->plan->close(c->plan);
+    c->open = false;
+  }
+  return r;
+}
+
+const char* cursor_error(const Cursor* c) {
+  return c->ctx.err;
+}
+
+void cursor_close(Cursor* c) {
+  if (!c) return;
+  if (c->open) c->plan->close(c->plan);
+  arena_free(&c->arena);
+  free(c);
+}
@@ -2,50 +2,139 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 DiskManager* disk_open(const char* path) {
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return NULL;
+
   DiskManager* dm = calloc(1, sizeof(*dm));
-  dm->f = fopen(path, "r+b");
-  if (!dm->f) dm->f = fopen(path, "w+b");
+  if (!dm) {
+    close(fd);
+    errno = ENOMEM;
+    return NULL;
+  }
+  dm->fd = fd;
+  dm->next_pid = (uint32_t)(disk_file_size(dm) / PAGE_SIZE);
+  dm->reserved_end = dm->next_pid;
   return dm;
 }
 
 void disk_close(DiskManager* dm) {
   if (!dm) return;
-  fclose(dm->f);
+  disk_sync(dm);
+  close(dm->fd);
   free(dm);
 }
 
 void disk_read_page(DiskManager* dm, uint32_t pid, Page* out) {
-  memset(out, 0, sizeof(Page));
-  fseek(dm->f, (long)pid * PAGE_SIZE, SEEK_SET);
-  fread(out, PAGE_SIZE, 1, dm->f);
+  off_t off = (off_t)pid * PAGE_SIZE;
+  size_t done = 0;
+
+  while (done < PAGE_SIZE) {
+    ssize_t n = pread(dm->fd, (uint8_t*)out + done, PAGE_SIZE - done, off + (off_t)done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += (size_t)n;
+  }
+
+  // Reading past EOF yields a zeroed page, same as a freshly allocated one.
+  if (done < PAGE_SIZE) memset((uint8_t*)out + done, 0, PAGE_SIZE - done);
 }
 
-void disk_write_page(DiskManager* dm, uint32_t pid, const Page* in) {
-  fseek(dm->f, (long)pid * PAGE_SIZE, SEEK_SET);
-  fwrite(in, PAGE_SIZE, 1, dm->f);
-  fflush(dm->f);
+// Records the first failed write or sync; see DiskManager.io_error.
+static bool fail_io(DiskManager* dm, int err) {
+  if (!dm->io_error) dm->io_error = err;
+  return false;
 }
 
-uint32_t disk_alloc_page(DiskManager* dm) {
-  fseek(dm->f, 0, SEEK_END);
-  long size = ftell(dm->f);
-  uint32_t pid = (uint32_t)(size / PAGE_SIZE);
+static bool write_run(DiskManager* dm, uint32_t pid, const void* buf, size_t bytes) {
+  off_t off = (off_t)pid * PAGE_SIZE;
+  size_t done = 0;
 
-  Page p;
-  page_init(&p, pid);
-  disk_write_page(dm, pid, &p);
-  return pid;
+  // Recovery may write back pages allocated before a crash past the end
+  // recorded at open; never hand them out again.
+  uint32_t end = pid + (uint32_t)(bytes / PAGE_SIZE);
+  if (end > dm->next_pid) dm->next_pid = end;
+
+  while (done < bytes) {
+    ssize_t n = pwrite(dm->fd, (const uint8_t*)buf + done, bytes - done, off + (off_t)done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return fail_io(dm, n < 0 ? errno : ENOSPC);
+    done += (size_t)n;
+  }
+  return true;
 }
 
-long disk_file_size(DiskManager* dm) {
-  long cur = ftell(dm->f);
-  if (cur < 0) cur = 0;
+bool disk_write_page(DiskManager* dm, uint32_t pid, const Page* in) {
+  return write_run(dm, pid, in, PAGE_SIZE);
+}
+
+bool disk_write_pages(DiskManager* dm, uint32_t first_pid, const Page* pages, uint32_t npages) {
+  return write_run(dm, first_pid, pages, (size_t)npages * PAGE_SIZE);
+}
+
+bool disk_sync(DiskManager* dm) {
+  if (fdatasync(dm->fd) != 0) return fail_io(dm, errno);
+  // A failed write may have been dropped by the kernel; a later successful
+  // sync does not make it durable.
+  return dm->io_error == 0;
+}
+
+// Makes sure file blocks exist for all pages below end_pid, growing the
+// reservation a whole extent at a time. The blocks are allocated past EOF
+// (FALLOC_FL_KEEP_SIZE), so the file size keeps tracking the pages actually
+// written. Filesystems without fallocate just allocate blocks on write.
+static void reserve_space(DiskManager* dm, uint32_t end_pid) {
+  if (end_pid <= dm->reserved_end) return;
+
+  uint32_t new_end = dm->reserved_end + DISK_EXTENT_PAGES;
+  if (new_end < end_pid) new_end = end_pid;
+  fallocate(dm->fd, FALLOC_FL_KEEP_SIZE, (off_t)dm->reserved_end * PAGE_SIZE,
+            (off_t)(new_end - dm->reserved_end) * PAGE_SIZE);
+  dm->reserved_end = new_end;
+}
+
+uint32_t disk_reserve_pages(DiskManager* dm, uint32_t npages) {
+  uint32_t first = dm->next_pid;
+  reserve_space(dm, first + npages);
+  dm->next_pid += npages;
+  return first;
+}
+
+uint32_t disk_alloc_pages(DiskManager* dm, uint32_t npages) {
+  uint32_t first = disk_reserve_pages(dm, npages);
 
-  fseek(dm->f, 0, SEEK_END);
-  long size = ftell(dm->f);
+  Page one;
+  Page* pages = npages == 1 ? &one : malloc((size_t)npages * sizeof(Page));
+  if (!pages) {
+    for (uint32_t i = 0; i < npages; i++) {
+      page_init(&one, first + i);
+      disk_write_page(dm, first + i, &one);
+    }
+    return first;
+  }
 
-  fseek(dm->f, cur, SEEK_SET);
-  return size;
-}
\ No newline at end of file
+  for (uint32_t i = 0; i < npages; i++) page_init(&pages[i], first + i);
+  disk_write_pages(dm, first, pages, npages);
+  if (pages != &one) free(pages);
+  return first;
+}
+
+uint32_t disk_alloc_page(DiskManager* dm) {
+  return disk_alloc_pages(dm, 1);
+}
+
+void disk_prefetch(DiskManager* dm, uint32_t first_pid, uint32_t npages) {
+  if (npages == 0) return;
+  posix_fadvise(dm->fd, (off_t)first_pid * PAGE_SIZE, (off_t)npages * PAGE_SIZE,
+                POSIX_FADV_WILLNEED);
+}
+
+long disk_file_size(DiskManager* dm) {
+  struct stat st;
+  if (fstat(dm->fd, &st) != 0) return 0;
+  return (long)st.st_size;
+}
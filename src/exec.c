@@ -0,0 +1,1333 @@
+#include "exec.h"
+#include "kernels.h"
+#include "toast.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Operator helpers
+// ============================================================================
+
+void* exec_new_op(ExecCtx* ctx, size_t size, Operator* child) {
+  Operator* op = arena_alloc(ctx->arena, size);
+  if (!op) {
+    snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+    return NULL;
+  }
+  op->ctx = ctx;
+  op->child = child;
+  if (child) {
+    op->ncols = child->ncols;
+    memcpy(op->cols, child->cols, sizeof(ExecColumn) * (size_t)child->ncols);
+  }
+  return op;
+}
+
+const char* exec_label(ExecCtx* ctx, const char* fmt, ...) {
+  char buf[128];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n >= (int)sizeof(buf)) n = sizeof(buf) - 1;
+  const char* s = arena_strndup(ctx->arena, buf, (size_t)n);
+  return s ? s : "";
+}
+
+static void table_columns(Operator* op, const TableInfo* t) {
+  op->ncols = t->ncols;
+  for (int i = 0; i < t->ncols; i++) {
+    ExecColumn* c = &op->cols[i];
+    memcpy(c->table, t->name, sizeof(c->table));
+    memcpy(c->name, t->cols[i].col, sizeof(c->name));
+    c->type = t->cols[i].type;
+  }
+}
+
+bool exec_open_child(Operator* op) {
+  op->batch.nsel = 0;
+  op->batch_pos = 0;
+  return op->child->open(op->child);
+}
+
+void exec_close_child(Operator* op) {
+  op->child->close(op->child);
+}
+
+// Decodes the wanted columns of a stored row into a tuple of the table's
+// columns.
+static int decode_row(Operator* op, const TableInfo* t, const bool* want, int nread,
+                      const uint8_t* row, uint16_t len, RID rid, Tuple* out) {
+  if (row_get_wanted(t->cols, t->ncols, row, len, want, nread, out->vals) < 0) {
+    snprintf(op->ctx->err, sizeof(op->ctx->err), "Corrupt row in table '%s'.", t->name);
+    return -1;
+  }
+  out->ncols = t->ncols;
+  out->rid = rid;
+  return 1;
+}
+
+int exec_batch_next_row(Operator* op, Tuple* out) {
+  Batch* b = &op->batch;
+  while (op->batch_pos >= b->nsel) {
+    int r = op->next_batch(op, b);
+    if (r <= 0) return r;
+    op->batch_pos = 0;
+  }
+
+  int row = b->sel ? b->sel[op->batch_pos] : op->batch_pos;
+  op->batch_pos++;
+  for (int i = 0; i < b->ncols; i++) vector_get(b->cols[i], row, &out->vals[i]);
+  out->ncols = b->ncols;
+  out->rid = b->rids ? b->rids[row] : (RID){ INVALID_PID, 0 };
+  return 1;
+}
+
+void exec_reader_init(BatchReader* r, Operator* input) {
+  r->input = input;
+  r->has_pending = false;
+}
+
+// Copies the values of a tuple into row pos of the vectors. A row whose
+// TEXT does not fit is left for the next batch; bytes already copied for
+// it are dropped when the vectors are reset.
+static bool set_row(ColumnVector* vecs, const Tuple* t, int pos) {
+  for (int i = 0; i < t->ncols; i++) {
+    if (!vector_set(&vecs[i], pos, &t->vals[i])) return false;
+  }
+  return true;
+}
+
+int exec_reader_next(BatchReader* r, Batch* out) {
+  Operator* in = r->input;
+  if (in->next_batch) return in->next_batch(in, out);
+
+  ExecCtx* ctx = in->ctx;
+  if (!r->vecs_ready) {
+    for (int i = 0; i < in->ncols; i++) {
+      if (!vector_init(&r->vecs[i], in->cols[i].type, ctx->arena)) {
+        snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+        return -1;
+      }
+    }
+    r->vecs_ready = true;
+  }
+  for (int i = 0; i < in->ncols; i++) vector_reset(&r->vecs[i]);
+
+  int n = 0;
+  while (n < VECTOR_SIZE) {
+    if (!r->has_pending) {
+      int rr = in->next(in, &r->pending);
+      if (rr < 0) return -1;
+      if (rr == 0) break;
+      r->has_pending = true;
+    }
+    if (!set_row(r->vecs, &r->pending, n)) {
+      if (n > 0) break;
+      snprintf(ctx->err, sizeof(ctx->err), "Row too large for a batch.");
+      return -1;
+    }
+    r->rids[n++] = r->pending.rid;
+    r->has_pending = false;
+  }
+  if (n == 0) return 0;
+
+  out->ncols = in->ncols;
+  for (int i = 0; i < in->ncols; i++) out->cols[i] = &r->vecs[i];
+  out->rids = r->rids;
+  out->count = n;
+  out->sel = NULL;
+  out->nsel = n;
+  return 1;
+}
+
+// ============================================================================
+// SeqScan
+// ============================================================================
+
+typedef struct FilterOp FilterOp;
+
+static int vec_select(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                      const uint16_t* sel, int n, uint16_t* out);
+
+typedef struct {
+  Operator base;
+  TableInfo* table;
+  HeapScan scan;
+  bool active;
+  bool done; ///< The heap has no more rows
+  int first_batch; ///< Rows in the first batch; later batches double up to VECTOR_SIZE
+  int batch_rows; ///< Most rows in the next batch
+  bool want[CATALOG_MAX_COLS]; ///< Columns read; the others are NULL
+  int nread; ///< One past the last wanted column
+  bool vecs_ready;
+  ColumnVector vecs[CATALOG_MAX_COLS];
+  ColumnVector* vec_ptrs[CATALOG_MAX_COLS];
+  RID rids[VECTOR_SIZE];
+  const FilterOp* filter; ///< Filter whose predicate the scan applies, or NULL
+  const Expr* pred; ///< Predicate of filter
+  bool pred_want[CATALOG_MAX_COLS]; ///< Columns the predicate reads
+  int pred_nread; ///< One past the last column the predicate reads
+  ColumnVector pred_vecs[CATALOG_MAX_COLS]; ///< Predicate columns of a page's rows; the others NULL
+  ColumnVector* pred_ptrs[CATALOG_MAX_COLS];
+  uint8_t* page_rows[VECTOR_SIZE]; ///< Rows of the page being read
+  uint16_t page_lens[VECTOR_SIZE];
+  RID page_rids[VECTOR_SIZE];
+  uint16_t matches[VECTOR_SIZE]; ///< Rows of the page that pass the predicate
+} SeqScanOp;
+
+static bool seq_open(Operator* op) {
+  SeqScanOp* s = (SeqScanOp*)op;
+  heap_scan_begin(op->ctx->bp, &s->table->hf, &s->scan);
+  s->active = true;
+  s->done = false;
+  s->batch_rows = s->first_batch;
+  op->batch.nsel = 0;
+  op->batch_pos = 0;
+  return true;
+}
+
+// Vectors are allocated on first use, as the scan's 64 KB per TEXT column
+// are wasted on plans that never get this far. Columns not read get an
+// all-NULL vector with nothing allocated.
+static bool seq_init_vectors(SeqScanOp* s) {
+  TableInfo* t = s->table;
+  for (int i = 0; i < t->ncols; i++) {
+    s->vec_ptrs[i] = NULL;
+    if (!s->want[i]) {
+      vector_init_null(&s->vecs[i], t->cols[i].type);
+      continue;
+    }
+    if (!vector_init(&s->vecs[i], t->cols[i].type, s->base.ctx->arena)) {
+      snprintf(s->base.ctx->err, sizeof(s->base.ctx->err), "Out of memory.");
+      return false;
+    }
+    s->vec_ptrs[i] = &s->vecs[i];
+  }
+  for (int i = 0; s->filter && i < t->ncols; i++) {
+    s->pred_ptrs[i] = NULL;
+    if (!s->pred_want[i]) {
+      vector_init_null(&s->pred_vecs[i], t->cols[i].type);
+      continue;
+    }
+    if (!vector_init(&s->pred_vecs[i], t->cols[i].type, s->base.ctx->arena)) {
+      snprintf(s->base.ctx->err, sizeof(s->base.ctx->err), "Out of memory.");
+      return false;
+    }
+    s->pred_ptrs[i] = &s->pred_vecs[i];
+  }
+  s->vecs_ready = true;
+  return true;
+}
+
+// Adds the rows of the scan's next page to the batch, which holds *n rows,
+// a column at a time. With a filter, the predicate is tested first on
+// vectors of only the columns it reads, and only the rows that pass are
+// copied. Rows that do not fit go back to the scan for the next batch.
+// Returns 1 if the batch has room for more, 0 if it is full or the heap
+// has ended, -1 on error.
+static int seq_read_page(SeqScanOp* s, int* n) {
+  ExecCtx* ctx = s->base.ctx;
+  TableInfo* t = s->table;
+  RID before = s->scan.cur;
+  int m = heap_scan_page(ctx->bp, &s->scan, VECTOR_SIZE, s->page_rows, s->page_lens,
+                         s->page_rids);
+  if (m == 0) {
+    s->done = true;
+    return 0;
+  }
+
+  const uint16_t* rows = NULL;
+  int k = m;
+  if (s->filter) {
+    // The TEXT of one page always fits in a vector.
+    for (int c = 0; c < s->pred_nread; c++) {
+      if (!s->pred_ptrs[c]) continue;
+      vector_reset(&s->pred_vecs[c]);
+      if (row_gather_column(t->cols, t->ncols, c, s->page_rows, s->page_lens, NULL, m,
+                            &s->pred_vecs[c], 0) != m) {
+        goto corrupt;
+      }
+    }
+    Batch b = { .ncols = t->ncols, .rids = s->page_rids, .count = m, .nsel = m };
+    for (int c = 0; c < t->ncols; c++) b.cols[c] = &s->pred_vecs[c];
+    k = vec_select(s->filter, s->pred, false, &b, NULL, m, s->matches);
+    rows = s->matches;
+  }
+
+  // A TEXT column that fills up cuts the batch short for the columns after
+  // it; the values the ones before it copied past the cut are ignored.
+  int fit = k < s->batch_rows - *n ? k : s->batch_rows - *n;
+  for (int c = 0; c < s->nread && fit > 0; c++) {
+    if (!s->vec_ptrs[c]) continue;
+    fit = row_gather_column(t->cols, t->ncols, c, s->page_rows, s->page_lens, rows, fit,
+                            s->vec_ptrs[c], *n);
+    if (fit < 0) goto corrupt;
+  }
+  if (fit == 0 && k > 0 && *n == 0) goto corrupt;
+
+  for (int j = 0; j < fit; j++) s->rids[*n + j] = s->page_rids[rows ? rows[j] : j];
+  *n += fit;
+  if (fit < k) {
+    int i = rows ? rows[fit] : fit;
+    heap_scan_seek(ctx->bp, &s->scan, i ? s->page_rids[i - 1] : before);
+    return 0;
+  }
+  return *n < s->batch_rows;
+
+corrupt:
+  snprintf(ctx->err, sizeof(ctx->err), "Corrupt row in table '%s'.", t->name);
+  return -1;
+}
+
+static int seq_next_batch(Operator* op, Batch* out) {
+  SeqScanOp* s = (SeqScanOp*)op;
+  TableInfo* t = s->table;
+  if (!s->active || s->done) return 0;
+  if (!s->vecs_ready && !seq_init_vectors(s)) return -1;
+
+  for (int i = 0; i < s->nread; i++) {
+    if (s->want[i]) vector_reset(&s->vecs[i]);
+  }
+
+  int n = 0;
+  int r;
+  do {
+    r = seq_read_page(s, &n);
+  } while (r > 0);
+  // No page stays pinned between batches, so the caller may write to the
+  // table while the scan is open.
+  heap_scan_pause(op->ctx->bp, &s->scan);
+  if (r < 0) return -1;
+  if (n == 0) return 0;
+  if (s->batch_rows < VECTOR_SIZE) {
+    s->batch_rows = s->batch_rows * 2 < VECTOR_SIZE ? s->batch_rows * 2 : VECTOR_SIZE;
+  }
+
+  out->ncols = t->ncols;
+  for (int i = 0; i < t->ncols; i++) out->cols[i] = &s->vecs[i];
+  out->rids = s->rids;
+  out->count = n;
+  out->sel = NULL;
+  out->nsel = n;
+  return 1;
+}
+
+static void seq_close(Operator* op) {
+  SeqScanOp* s = (SeqScanOp*)op;
+  if (!s->active) return;
+  heap_scan_end(op->ctx->bp, &s->scan);
+  s->active = false;
+}
+
+Operator* exec_seq_scan(ExecCtx* ctx, TableInfo* t) {
+  SeqScanOp* s = exec_new_op(ctx, sizeof(SeqScanOp), NULL);
+  if (!s) return NULL;
+  s->table = t;
+  s->first_batch = VECTOR_SIZE;
+  for (int i = 0; i < t->ncols; i++) s->want[i] = true;
+  s->nread = t->ncols;
+  s->base.label = exec_label(ctx, "SeqScan %s", t->name);
+  s->base.open = seq_open;
+  s->base.next = exec_batch_next_row;
+  s->base.next_batch = seq_next_batch;
+  s->base.close = seq_close;
+  table_columns(&s->base, t);
+  return &s->base;
+}
+
+// ============================================================================
+// IndexScan
+// ============================================================================
+
+typedef struct {
+  Operator base;
+  TableInfo* table;
+  TableIndex* ix;
+  const RowField* lo_val; ///< Lower bound, or NULL
+  const RowField* hi_val; ///< Upper bound, or NULL
+  bool want[CATALOG_MAX_COLS]; ///< Columns read; the others are NULL
+  int nread; ///< One past the last wanted column
+  bool empty; ///< Whether a bound is NULL, so no row matches
+  uint8_t lo[BTREE_KEY_MAX];
+  uint8_t hi[BTREE_KEY_MAX];
+  BTreeCursor cur;
+  uint8_t row[PAGE_SIZE]; ///< Copy of the current row; its page is not kept pinned
+} IndexScanOp;
+
+static bool index_open(Operator* op) {
+  IndexScanOp* s = (IndexScanOp*)op;
+  s->empty = (s->lo_val && s->lo_val->is_null) || (s->hi_val && s->hi_val->is_null);
+  if (s->empty) return true;
+  // A placeholder bound to a number of another type than the column, such
+  // as 2.5 for an INT, does not bound the scan; the filter above checks it.
+  ValueKind kind = row_value_kind(s->ix->tree.key_type);
+  bool lo = s->lo_val && row_value_kind(s->lo_val->type) == kind;
+  bool hi = s->hi_val && row_value_kind(s->hi_val->type) == kind;
+  if (lo) table_index_key(op->ctx->bp, s->ix, s->lo_val, s->lo);
+  if (hi) table_index_key(op->ctx->bp, s->ix, s->hi_val, s->hi);
+  btree_seek(op->ctx->bp, &s->ix->tree, lo ? s->lo : NULL, hi ? s->hi : NULL, &s->cur);
+  return true;
+}
+
+static int index_next(Operator* op, Tuple* out) {
+  IndexScanOp* s = (IndexScanOp*)op;
+  BufferPool* bp = op->ctx->bp;
+  RID rid;
+  if (s->empty) return 0;
+  while (btree_next(bp, &s->ix->tree, &s->cur, &rid)) {
+    Page* p = bp_fetch_page(bp, rid.page_id, LATCH_SHARED);
+    uint8_t* row;
+    uint16_t len;
+    bool ok = page_get(p, rid.slot_id, &row, &len);
+    if (ok) memcpy(s->row, row, len);
+    bp_unpin_page(bp, rid.page_id, false);
+    if (ok) return decode_row(op, s->table, s->want, s->nread, s->row, len, rid, out);
+  }
+  return 0;
+}
+
+static void index_close(Operator* op) {
+  (void)op;
+}
+
+Operator* exec_index_scan(ExecCtx* ctx, TableInfo* t, TableIndex* ix,
+                          const RowField* lo, const RowField* hi) {
+  IndexScanOp* s = exec_new_op(ctx, sizeof(IndexScanOp), NULL);
+  if (!s) return NULL;
+  s->table = t;
+  s->ix = ix;
+  s->lo_val = lo;
+  s->hi_val = hi;
+  for (int i = 0; i < t->ncols; i++) s->want[i] = true;
+  s->nread = t->ncols;
+  s->base.label = exec_label(ctx, "IndexScan %s using %s", t->name, ix->entry.name);
+  s->base.open = index_open;
+  s->base.next = index_next;
+  s->base.close = index_close;
+  table_columns(&s->base, t);
+  return &s->base;
+}
+
+// ============================================================================
+// Column pruning
+// ============================================================================
+
+// Copies want into a scan's mask and returns the number of columns read.
+static int set_want(const TableInfo* t, const bool* want, bool* mask, int* nread) {
+  int n = 0;
+  *nread = 0;
+  for (int i = 0; i < t->ncols; i++) {
+    mask[i] = want[i];
+    if (!want[i]) continue;
+    n++;
+    *nread = i + 1;
+  }
+  return n;
+}
+
+void exec_scan_columns(Operator* op, const bool* want) {
+  TableInfo* t;
+  const char* label;
+  int n;
+  if (op->open == seq_open) {
+    SeqScanOp* s = (SeqScanOp*)op;
+    t = s->table;
+    n = set_want(t, want, s->want, &s->nread);
+    label = exec_label(op->ctx, "SeqScan %s", t->name);
+  } else if (op->open == index_open) {
+    IndexScanOp* s = (IndexScanOp*)op;
+    t = s->table;
+    n = set_want(t, want, s->want, &s->nread);
+    label = exec_label(op->ctx, "IndexScan %s using %s", t->name, s->ix->entry.name);
+  } else {
+    return;
+  }
+  op->label = n < t->ncols ? exec_label(op->ctx, "%s (%d of %d columns)", label, n, t->ncols)
+                           : label;
+}
+
+// ============================================================================
+// Filter
+// ============================================================================
+
+struct FilterOp {
+  Operator base;
+  const Expr* pred;
+  const Kernels* kernels; ///< Predicate kernels for this CPU
+  bool pushed; ///< Whether the scan below applies pred itself
+  uint16_t sel[VECTOR_SIZE]; ///< Selection vector of the current batch
+};
+
+static int filter_next(Operator* op, Tuple* out) {
+  FilterOp* f = (FilterOp*)op;
+  int r;
+  while ((r = op->child->next(op->child, out)) > 0) {
+    if (exec_eval(op->ctx, f->pred, out) == 1) return 1;
+  }
+  return r;
+}
+
+static int filter_next_batch(Operator* op, Batch* out) {
+  FilterOp* f = (FilterOp*)op;
+  if (f->pushed) return op->child->next_batch(op->child, out);
+  int r;
+  while ((r = op->child->next_batch(op->child, out)) > 0) {
+    int n = vec_select(f, f->pred, false, out, out->sel, out->nsel, f->sel);
+    if (n > 0) {
+      out->sel = f->sel;
+      out->nsel = n;
+      return 1;
+    }
+  }
+  return r;
+}
+
+// Marks the columns e reads and sets *nread one past the last.
+static void pred_columns(const Expr* e, bool* cols, int* nread) {
+  if (!e) return;
+  if (e->kind == EXPR_COLUMN) {
+    cols[e->col_idx] = true;
+    if (e->col_idx >= *nread) *nread = e->col_idx + 1;
+    return;
+  }
+  pred_columns(e->left, cols, nread);
+  pred_columns(e->right, cols, nread);
+  for (int i = 0; i < e->nlist; i++) pred_columns(e->list[i], cols, nread);
+}
+
+Operator* exec_filter(ExecCtx* ctx, Operator* child, const Expr* pred) {
+  FilterOp* f = exec_new_op(ctx, sizeof(FilterOp), child);
+  if (!f) return NULL;
+  f->pred = pred;
+  f->kernels = kernels_best();
+  f->base.label = "Filter";
+  f->base.open = exec_open_child;
+  f->base.next = filter_next;
+  f->base.close = exec_close_child;
+  if (child->next_batch) {
+    f->base.next = exec_batch_next_row;
+    f->base.next_batch = filter_next_batch;
+  }
+  if (child->open == seq_open) {
+    SeqScanOp* s = (SeqScanOp*)child;
+    s->filter = f;
+    s->pred = pred;
+    pred_columns(pred, s->pred_want, &s->pred_nread);
+    f->pushed = true;
+  }
+  return &f->base;
+}
+
+// ============================================================================
+// Project
+// ============================================================================
+
+typedef struct {
+  Operator base;
+  int map[EXEC_MAX_COLS];
+  Tuple in;
+} ProjectOp;
+
+static int project_next(Operator* op, Tuple* out) {
+  ProjectOp* p = (ProjectOp*)op;
+  int r = op->child->next(op->child, &p->in);
+  if (r <= 0) return r;
+
+  for (int i = 0; i < op->ncols; i++) out->vals[i] = p->in.vals[p->map[i]];
+  out->ncols = op->ncols;
+  out->rid = p->in.rid;
+  return 1;
+}
+
+static int project_next_batch(Operator* op, Batch* out) {
+  ProjectOp* p = (ProjectOp*)op;
+  int r = op->child->next_batch(op->child, out);
+  if (r <= 0) return r;
+
+  ColumnVector* in[EXEC_MAX_COLS];
+  memcpy(in, out->cols, sizeof(ColumnVector*) * (size_t)out->ncols);
+  for (int i = 0; i < op->ncols; i++) out->cols[i] = in[p->map[i]];
+  out->ncols = op->ncols;
+  return 1;
+}
+
+Operator* exec_project(ExecCtx* ctx, Operator* child, const int* map, int n) {
+  ProjectOp* p = exec_new_op(ctx, sizeof(ProjectOp), NULL);
+  if (!p) return NULL;
+  p->base.child = child;
+  p->base.ncols = n;
+  for (int i = 0; i < n; i++) {
+    p->map[i] = map[i];
+    p->base.cols[i] = child->cols[map[i]];
+  }
+  p->base.label = "Project";
+  p->base.open = exec_open_child;
+  p->base.next = project_next;
+  p->base.close = exec_close_child;
+  if (child->next_batch) {
+    p->base.next = exec_batch_next_row;
+    p->base.next_batch = project_next_batch;
+  }
+  return &p->base;
+}
+
+// ============================================================================
+// Limit
+// ============================================================================
+
+typedef struct {
+  Operator base;
+  int64_t limit; ///< Rows to return, or -1 for all
+  int64_t offset;
+  int64_t skipped;
+  int64_t produced;
+  uint16_t sel[VECTOR_SIZE]; ///< Selection of a batch the offset ends in
+} LimitOp;
+
+static bool limit_open(Operator* op) {
+  LimitOp* l = (LimitOp*)op;
+  l->skipped = 0;
+  l->produced = 0;
+  return exec_open_child(op);
+}
+
+static bool limit_reached(const LimitOp* l) {
+  return l->limit >= 0 && l->produced >= l->limit;
+}
+
+static int limit_next(Operator* op, Tuple* out) {
+  LimitOp* l = (LimitOp*)op;
+  if (limit_reached(l)) {
+    exec_close_child(op);
+    return 0;
+  }
+  int r;
+  for (; l->skipped < l->offset; l->skipped++) {
+    if ((r = op->child->next(op->child, out)) <= 0) return r;
+  }
+  r = op->child->next(op->child, out);
+  if (r > 0) l->produced++;
+  return r;
+}
+
+// Ends the scan under a vectorized pipeline once the limit is reached, so
+// its page is unpinned right away. The batches already handed out live in
+// the scan's vectors, which stay valid.
+static void stop_scan(Operator* op) {
+  while (op->next_batch && op->child) op = op->child;
+  if (op->next_batch == seq_next_batch) seq_close(op);
+}
+
+static int limit_next_batch(Operator* op, Batch* out) {
+  LimitOp* l = (LimitOp*)op;
+  if (limit_reached(l)) return 0;
+  int r;
+  while ((r = op->child->next_batch(op->child, out)) > 0) {
+    int64_t skip = l->offset - l->skipped;
+    if (skip >= out->nsel) {
+      l->skipped += out->nsel;
+      continue;
+    }
+    if (skip > 0) {
+      if (out->sel) {
+        out->sel += skip;
+      } else {
+        for (int i = 0; i < out->nsel - skip; i++) l->sel[i] = (uint16_t)(skip + i);
+        out->sel = l->sel;
+      }
+      out->nsel -= (int)skip;
+      l->skipped += skip;
+    }
+    break;
+  }
+  if (r <= 0) return r;
+
+  if (l->limit >= 0 && out->nsel > l->limit - l->produced) {
+    out->nsel = (int)(l->limit - l->produced);
+  }
+  l->produced += out->nsel;
+  if (limit_reached(l)) stop_scan(op->child);
+  return 1;
+}
+
+// Asks the scan under a pipeline for no more rows than the limit needs in
+// its first batch. Later batches double in size, so a filter that drops
+// rows costs a few small batches at worst.
+static void size_first_batch(Operator* op, int64_t rows) {
+  while (op->next_batch && op->child) op = op->child;
+  if (op->next_batch != seq_next_batch) return;
+  SeqScanOp* s = (SeqScanOp*)op;
+  s->first_batch = rows < 1 ? 1 : rows < VECTOR_SIZE ? (int)rows : VECTOR_SIZE;
+}
+
+Operator* exec_limit(ExecCtx* ctx, Operator* child, int64_t limit, int64_t offset) {
+  LimitOp* l = exec_new_op(ctx, sizeof(LimitOp), child);
+  if (!l) return NULL;
+  l->limit = limit;
+  l->offset = offset;
+  if (limit < 0) {
+    l->base.label = exec_label(ctx, "Offset %lld", (long long)offset);
+  } else if (offset > 0) {
+    l->base.label = exec_label(ctx, "Limit %lld offset %lld", (long long)limit, (long long)offset);
+  } else {
+    l->base.label = exec_label(ctx, "Limit %lld", (long long)limit);
+  }
+  l->base.open = limit_open;
+  l->base.next = limit_next;
+  l->base.close = exec_close_child;
+  if (child->next_batch) {
+    l->base.next = exec_batch_next_row;
+    l->base.next_batch = limit_next_batch;
+    if (limit >= 0) size_first_batch(child, limit > INT64_MAX - offset ? INT64_MAX : limit + offset);
+  }
+  return &l->base;
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+static int64_t int_of(const RowField* v) {
+  return row_value_kind(v->type) == VAL_I32 ? v->i32 : v->i64;
+}
+
+// Compares an integer with a double exactly, where converting the integer
+// would round it past 2^53.
+static int compare_int_double(int64_t i, double d) {
+  if (d >= 0x1p63) return -1;
+  if (d < -0x1p63) return 1;
+  int64_t t = (int64_t)d;
+  if (i != t) return (i > t) - (i < t);
+  double frac = d - (double)t;
+  return (frac < 0) - (frac > 0);
+}
+
+// Compares numbers held in different ways by value.
+static int compare_numbers(const RowField* a, const RowField* b) {
+  if (row_value_kind(b->type) == VAL_F64) return compare_int_double(int_of(a), b->f64);
+  if (row_value_kind(a->type) == VAL_F64) return -compare_int_double(int_of(b), a->f64);
+  int64_t x = int_of(a);
+  int64_t y = int_of(b);
+  return (x > y) - (x < y);
+}
+
+int exec_compare(BufferPool* bp, const RowField* a, const RowField* b) {
+  ValueKind kind = row_value_kind(a->type);
+  if (kind != row_value_kind(b->type)) return compare_numbers(a, b);
+  switch (kind) {
+    case VAL_I32: return (a->i32 > b->i32) - (a->i32 < b->i32);
+    case VAL_I64: return (a->i64 > b->i64) - (a->i64 < b->i64);
+    case VAL_F64: return (a->f64 > b->f64) - (a->f64 < b->f64);
+    case VAL_TEXT: break;
+  }
+
+  uint32_t n = a->text_len < b->text_len ? a->text_len : b->text_len;
+  int c;
+  if (a->toast_pid == INVALID_PID && b->toast_pid == INVALID_PID) {
+    c = memcmp(a->text, b->text, n);
+  } else {
+    uint8_t* buf = malloc(2 * (size_t)n + 1);
+    if (!buf) return 0;
+    row_field_text(bp, a, buf, n);
+    row_field_text(bp, b, buf + n, n);
+    c = memcmp(buf, buf + n, n);
+    free(buf);
+  }
+  if (c == 0) c = (a->text_len > b->text_len) - (a->text_len < b->text_len);
+  return c;
+}
+
+static const RowField* operand(const Expr* e, const Tuple* t) {
+  return e->kind == EXPR_COLUMN ? &t->vals[e->col_idx] : &e->value;
+}
+
+// Applies a comparison operator to two values under three-valued logic.
+static int compare_values(ExecCtx* ctx, CmpOp op, const RowField* a, const RowField* b) {
+  if (a->is_null || b->is_null) return -1;
+  ValueKind kind = row_value_kind(a->type);
+  if (kind != row_value_kind(b->type) && (kind == VAL_TEXT || row_value_kind(b->type) == VAL_TEXT)) {
+    return -1;
+  }
+
+  // Equal text needs equal lengths, which rejects most rows without
+  // reading out-of-line values.
+  if (kind == VAL_TEXT && a->text_len != b->text_len) {
+    if (op == CMP_EQ) return 0;
+    if (op == CMP_NE) return 1;
+  }
+
+  int c = exec_compare(ctx->bp, a, b);
+  switch (op) {
+    case CMP_EQ: return c == 0;
+    case CMP_NE: return c != 0;
+    case CMP_LT: return c < 0;
+    case CMP_LE: return c <= 0;
+    case CMP_GT: return c > 0;
+    case CMP_GE: return c >= 0;
+  }
+  return -1;
+}
+
+static int eval_cmp(ExecCtx* ctx, const Expr* e, const Tuple* t) {
+  return compare_values(ctx, e->op, operand(e->left, t), operand(e->right, t));
+}
+
+static int and3(int l, int r) {
+  if (l == 0 || r == 0) return 0;
+  return (l == 1 && r == 1) ? 1 : -1;
+}
+
+static int eval_between(ExecCtx* ctx, const Expr* e, const Tuple* t) {
+  const RowField* v = operand(e->left, t);
+  int lo = compare_values(ctx, CMP_GE, v, operand(e->list[0], t));
+  if (lo == 0) return 0;
+  return and3(lo, compare_values(ctx, CMP_LE, v, operand(e->list[1], t)));
+}
+
+// True on a match; otherwise unknown if the value or any list entry is NULL.
+static int eval_in(ExecCtx* ctx, const Expr* e, const Tuple* t) {
+  const RowField* v = operand(e->left, t);
+  if (v->is_null) return -1;
+  int r = 0;
+  for (int i = 0; i < e->nlist; i++) {
+    int c = compare_values(ctx, CMP_EQ, v, &e->list[i]->value);
+    if (c == 1) return 1;
+    if (c < 0) r = -1;
+  }
+  return r;
+}
+
+// Splits a LIKE pattern that is plain text, optionally followed by %s,
+// into the text's length and whether the match must be exact. Returns
+// false for patterns with other wildcards.
+static bool like_prefix(const RowField* pat, uint32_t* plen, bool* exact) {
+  uint32_t i = 0;
+  while (i < pat->text_len && pat->text[i] != '%' && pat->text[i] != '_') i++;
+  *plen = i;
+  *exact = i == pat->text_len;
+  for (uint32_t j = i; j < pat->text_len; j++) {
+    if (pat->text[j] != '%') return false;
+  }
+  return true;
+}
+
+// Matches s against a pattern where % stands for any run of bytes and _
+// for any one byte. On a mismatch after a %, the % is retried one byte
+// further on, so no input is scanned more than twice per %.
+static bool like_match(const uint8_t* s, uint32_t n, const uint8_t* p, uint32_t m) {
+  uint32_t i = 0, j = 0;
+  uint32_t star = UINT32_MAX, star_i = 0;
+  while (i < n) {
+    if (j < m && p[j] == '%') {
+      star = j++;
+      star_i = i;
+    } else if (j < m && (p[j] == '_' || p[j] == s[i])) {
+      i++;
+      j++;
+    } else if (star != UINT32_MAX) {
+      j = star + 1;
+      i = ++star_i;
+    } else {
+      return false;
+    }
+  }
+  while (j < m && p[j] == '%') j++;
+  return j == m;
+}
+
+// Matches a value against a LIKE pattern. Out-of-line values are read only
+// as far as a prefix pattern needs.
+static int like_value(ExecCtx* ctx, const RowField* v, const RowField* pat) {
+  if (v->is_null || pat->is_null || !row_is_text(v->type)) return -1;
+
+  uint32_t plen;
+  bool exact;
+  bool simple = like_prefix(pat, &plen, &exact);
+  if (simple && (exact ? v->text_len != plen : v->text_len < plen)) return 0;
+
+  uint32_t need = simple ? plen : v->text_len;
+  if (v->toast_pid == INVALID_PID) {
+    if (simple) return memcmp(v->text, pat->text, plen) == 0;
+    return like_match(v->text, v->text_len, pat->text, pat->text_len);
+  }
+
+  uint8_t* buf = malloc((size_t)need + 1);
+  if (!buf) return -1;
+  row_field_text(ctx->bp, v, buf, need);
+  bool r = simple ? memcmp(buf, pat->text, plen) == 0
+                  : like_match(buf, need, pat->text, pat->text_len);
+  free(buf);
+  return r;
+}
+
+int exec_eval(ExecCtx* ctx, const Expr* e, const Tuple* t) {
+  int l, r;
+  switch (e->kind) {
+    case EXPR_CMP:
+      return eval_cmp(ctx, e, t);
+    case EXPR_BETWEEN:
+      return eval_between(ctx, e, t);
+    case EXPR_IN:
+      return eval_in(ctx, e, t);
+    case EXPR_LIKE:
+      return like_value(ctx, operand(e->left, t), operand(e->right, t));
+    case EXPR_AND:
+      l = exec_eval(ctx, e->left, t);
+      if (l == 0) return 0;
+      return and3(l, exec_eval(ctx, e->right, t));
+    case EXPR_OR:
+      l = exec_eval(ctx, e->left, t);
+      if (l == 1) return 1;
+      r = exec_eval(ctx, e->right, t);
+      if (r == 1) return 1;
+      return (l == 0 && r == 0) ? 0 : -1;
+    case EXPR_NOT:
+      l = exec_eval(ctx, e->left, t);
+      return l < 0 ? -1 : !l;
+    default:
+      return -1;
+  }
+}
+
+// ============================================================================
+// Vectorized predicates
+// ============================================================================
+
+// The operator that is true exactly where op is false; NULLs stay unknown.
+static CmpOp negate_cmp(CmpOp op) {
+  switch (op) {
+    case CMP_EQ: return CMP_NE;
+    case CMP_NE: return CMP_EQ;
+    case CMP_LT: return CMP_GE;
+    case CMP_LE: return CMP_GT;
+    case CMP_GT: return CMP_LE;
+    case CMP_GE: return CMP_LT;
+  }
+  return op;
+}
+
+// The operator for the same comparison with its operands swapped.
+static CmpOp swap_cmp(CmpOp op) {
+  switch (op) {
+    case CMP_LT: return CMP_GT;
+    case CMP_LE: return CMP_GE;
+    case CMP_GT: return CMP_LT;
+    case CMP_GE: return CMP_LE;
+    default: return op;
+  }
+}
+
+// Kernels test every row of the batch, so a selection that has already
+// dropped most of them is cheaper to test row by row.
+static bool use_kernels(const Batch* b, const uint16_t* sel, int n) {
+  return !sel || n * 4 >= b->count;
+}
+
+// Turns a kernel's mask into the selected rows where the predicate (or its
+// negation) is true. NULL rows are never selected either way.
+static int select_mask(const ColumnVector* v, uint64_t* mask, bool negate, const Batch* b,
+                       const uint16_t* sel, int n, uint16_t* out) {
+  int words = ((sel ? b->count : n) + 63) / 64;
+  for (int w = 0; w < words; w++) {
+    if (negate) mask[w] = ~mask[w];
+    if (v->has_nulls) mask[w] &= ~v->nulls[w];
+  }
+  return sel ? kernel_mask_select(mask, sel, n, out) : kernel_mask_to_sel(mask, n, out);
+}
+
+// Evaluates any predicate row by row, for the shapes the kernels do not
+// cover.
+static int select_rows(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                       const uint16_t* sel, int n, uint16_t* out) {
+  Tuple t;
+  t.ncols = b->ncols;
+  int want = negate ? 0 : 1;
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    int row = sel ? sel[i] : i;
+    for (int c = 0; c < b->ncols; c++) vector_get(b->cols[c], row, &t.vals[c]);
+    if (exec_eval(f->base.ctx, e, &t) == want) out[k++] = (uint16_t)row;
+  }
+  return k;
+}
+
+// Writes the selected rows where INT column v compares true with c to out,
+// for selections too sparse for the kernels. The comparison is branch-free,
+// so the loop runs without mispredictions whatever the selectivity.
+#define SELECT_INT(CMP)                         \
+  do {                                          \
+    for (int i = 0; i < n; i++) {               \
+      uint16_t r = sel[i];                      \
+      out[k] = r;                               \
+      k += vals[r] CMP c;                       \
+    }                                           \
+  } while (0)
+
+// Drops the NULL rows from the k rows of out.
+static int drop_nulls(const ColumnVector* v, uint16_t* out, int k) {
+  if (!v->has_nulls) return k;
+  int m = 0;
+  for (int i = 0; i < k; i++) {
+    if (!vector_is_null(v, out[i])) out[m++] = out[i];
+  }
+  return m;
+}
+
+static int select_int_sparse(const ColumnVector* v, CmpOp op, int32_t c,
+                             const uint16_t* sel, int n, uint16_t* out) {
+  const int32_t* vals = v->i32;
+  int k = 0;
+  switch (op) {
+    case CMP_EQ: SELECT_INT(==); break;
+    case CMP_NE: SELECT_INT(!=); break;
+    case CMP_LT: SELECT_INT(<); break;
+    case CMP_LE: SELECT_INT(<=); break;
+    case CMP_GT: SELECT_INT(>); break;
+    case CMP_GE: SELECT_INT(>=); break;
+  }
+
+  return drop_nulls(v, out, k);
+}
+
+// Writes the selected rows (or 0..n-1) where a BIGINT, TIMESTAMP or DOUBLE
+// column compares true with c. There are no kernels for 8-byte values, but
+// the loop is branch-free like SELECT_INT and reads only the value array.
+#define SELECT_WIDE(CMP)                                \
+  do {                                                  \
+    for (int i = 0; i < n; i++) {                       \
+      uint16_t r = sel ? sel[i] : (uint16_t)i;          \
+      out[k] = r;                                       \
+      k += vals[r] CMP c;                               \
+    }                                                   \
+  } while (0)
+
+#define DEFINE_SELECT_WIDE(NAME, T, FIELD)                                              \
+  static int NAME(const ColumnVector* v, CmpOp op, T c, const uint16_t* sel, int n,     \
+                  uint16_t* out) {                                                      \
+    const T* vals = v->FIELD;                                                           \
+    int k = 0;                                                                          \
+    switch (op) {                                                                       \
+      case CMP_EQ: SELECT_WIDE(==); break;                                              \
+      case CMP_NE: SELECT_WIDE(!=); break;                                              \
+      case CMP_LT: SELECT_WIDE(<); break;                                               \
+      case CMP_LE: SELECT_WIDE(<=); break;                                              \
+      case CMP_GT: SELECT_WIDE(>); break;                                               \
+      case CMP_GE: SELECT_WIDE(>=); break;                                              \
+    }                                                                                   \
+    return drop_nulls(v, out, k);                                                       \
+  }
+
+DEFINE_SELECT_WIDE(select_i64_cmp, int64_t, i64)
+DEFINE_SELECT_WIDE(select_f64_cmp, double, f64)
+
+// Runs select_i64_cmp or select_f64_cmp for a value of the column's type.
+static int select_wide_cmp(const ColumnVector* v, CmpOp op, const RowField* c,
+                           const uint16_t* sel, int n, uint16_t* out) {
+  if (row_value_kind(v->type) == VAL_F64) return select_f64_cmp(v, op, c->f64, sel, n, out);
+  return select_i64_cmp(v, op, c->i64, sel, n, out);
+}
+
+// Runs the range kernel for lo <= v <= hi, or its negation.
+static int select_int_range(const FilterOp* f, const ColumnVector* v, int32_t lo, int32_t hi,
+                            bool negate, const Batch* b, const uint16_t* sel, int n,
+                            uint16_t* out) {
+  uint64_t mask[VECTOR_SIZE / 64];
+  f->kernels->i32_range(v->i32, sel ? b->count : n, lo, hi, mask);
+  return select_mask(v, mask, negate, b, sel, n, out);
+}
+
+static int select_int_cmp(const FilterOp* f, const ColumnVector* v, CmpOp op, int32_t c,
+                          const Batch* b, const uint16_t* sel, int n, uint16_t* out) {
+  if (!use_kernels(b, sel, n)) return select_int_sparse(v, op, c, sel, n, out);
+
+  int m = sel ? b->count : n;
+  uint64_t mask[VECTOR_SIZE / 64];
+  switch (op) {
+    case CMP_EQ:
+    case CMP_NE:
+      f->kernels->i32_eq(v->i32, m, c, mask);
+      return select_mask(v, mask, op == CMP_NE, b, sel, n, out);
+    case CMP_LT:
+      if (c == INT32_MIN) return 0;
+      return select_int_range(f, v, INT32_MIN, c - 1, false, b, sel, n, out);
+    case CMP_LE:
+      return select_int_range(f, v, INT32_MIN, c, false, b, sel, n, out);
+    case CMP_GT:
+      if (c == INT32_MAX) return 0;
+      return select_int_range(f, v, c + 1, INT32_MAX, false, b, sel, n, out);
+    case CMP_GE:
+      return select_int_range(f, v, c, INT32_MAX, false, b, sel, n, out);
+  }
+  return 0;
+}
+
+// Runs the text kernel, then checks out-of-line values by reading just the
+// prefix's bytes from their overflow pages.
+static int select_text_prefix(const FilterOp* f, const ColumnVector* v, const RowField* pat,
+                              uint32_t plen, bool exact, bool negate, const Batch* b,
+                              const uint16_t* sel, int n, uint16_t* out) {
+  int m = sel ? b->count : n;
+  uint64_t mask[VECTOR_SIZE / 64];
+  f->kernels->text_prefix(v->text, v->text_off, v->text_len, v->toast_pid, m,
+                          pat->text, plen, exact, mask);
+
+  if (v->has_external) {
+    uint8_t* buf = malloc((size_t)plen + 1);
+    for (int k = 0; buf && k < n; k++) {
+      int i = sel ? sel[k] : k;
+      if (v->toast_pid[i] == INVALID_PID) continue;
+      if (exact ? v->text_len[i] != plen : v->text_len[i] < plen) continue;
+      if (toast_fetch(f->base.ctx->bp, v->toast_pid[i], buf, plen) != plen) continue;
+      if (memcmp(buf, pat->text, plen) == 0) mask[i >> 6] |= 1ull << (i & 63);
+    }
+    free(buf);
+  }
+  return select_mask(v, mask, negate, b, sel, n, out);
+}
+
+static int select_cmp(const FilterOp* f, CmpOp op, const Expr* e, const Batch* b,
+                      const uint16_t* sel, int n, uint16_t* out) {
+  const Expr* l = e->left;
+  const Expr* r = e->right;
+  if (l->kind == EXPR_LITERAL && r->kind == EXPR_COLUMN) {
+    const Expr* tmp = l;
+    l = r;
+    r = tmp;
+    op = swap_cmp(op);
+  }
+
+  if (l->kind == EXPR_COLUMN && r->kind == EXPR_LITERAL) {
+    const ColumnVector* v = b->cols[l->col_idx];
+    if (r->value.is_null) return 0;
+    // A number of another type, such as 2.5 for an INT, is compared by
+    // value in the loop below.
+    if (r->value.type == v->type) {
+      ValueKind kind = row_value_kind(v->type);
+      if (kind == VAL_I32) return select_int_cmp(f, v, op, r->value.i32, b, sel, n, out);
+      if (kind == VAL_I64 || kind == VAL_F64) {
+        return select_wide_cmp(v, op, &r->value, sel, n, out);
+      }
+      if ((op == CMP_EQ || op == CMP_NE) && use_kernels(b, sel, n)) {
+        return select_text_prefix(f, v, &r->value, r->value.text_len, true, op == CMP_NE,
+                                  b, sel, n, out);
+      }
+    }
+  }
+
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    int row = sel ? sel[i] : i;
+    RowField a, c;
+    if (l->kind == EXPR_COLUMN) vector_get(b->cols[l->col_idx], row, &a);
+    else a = l->value;
+    if (r->kind == EXPR_COLUMN) vector_get(b->cols[r->col_idx], row, &c);
+    else c = r->value;
+    if (compare_values(f->base.ctx, op, &a, &c) == 1) out[k++] = (uint16_t)row;
+  }
+  return k;
+}
+
+static int select_between(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                          const uint16_t* sel, int n, uint16_t* out) {
+  const Expr* lo = e->list[0];
+  const Expr* hi = e->list[1];
+  // The kernels need bounds of the column's type, not numbers of another.
+  const ColumnVector* v = e->left->kind == EXPR_COLUMN ? b->cols[e->left->col_idx] : NULL;
+  if (!v || lo->kind != EXPR_LITERAL || hi->kind != EXPR_LITERAL || lo->value.is_null ||
+      hi->value.is_null || lo->value.type != v->type || hi->value.type != v->type) {
+    return select_rows(f, e, negate, b, sel, n, out);
+  }
+
+  ValueKind kind = row_value_kind(v->type);
+  if (kind == VAL_I32 && use_kernels(b, sel, n)) {
+    return select_int_range(f, v, lo->value.i32, hi->value.i32, negate, b, sel, n, out);
+  }
+
+  // 8-byte values are narrowed by the lower bound, then the upper.
+  if (!negate && (kind == VAL_I64 || kind == VAL_F64)) {
+    uint16_t above[VECTOR_SIZE];
+    int na = select_wide_cmp(v, CMP_GE, &lo->value, sel, n, above);
+    return na ? select_wide_cmp(v, CMP_LE, &hi->value, above, na, out) : 0;
+  }
+  return select_rows(f, e, negate, b, sel, n, out);
+}
+
+static int select_in(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                     const uint16_t* sel, int n, uint16_t* out) {
+  // NOT IN a list with a NULL is never true.
+  if (negate && e->in_has_null) return 0;
+  if (e->in_i32 && use_kernels(b, sel, n)) {
+    const ColumnVector* v = b->cols[e->left->col_idx];
+    int m = sel ? b->count : n;
+    uint64_t mask[VECTOR_SIZE / 64];
+    f->kernels->i32_in(v->i32, m, e->in_i32, e->nin_i32, mask);
+    return select_mask(v, mask, negate, b, sel, n, out);
+  }
+  return select_rows(f, e, negate, b, sel, n, out);
+}
+
+static int select_like(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                       const uint16_t* sel, int n, uint16_t* out) {
+  uint32_t plen;
+  bool exact;
+  const RowField* pat = &e->right->value;
+  if (e->left->kind == EXPR_COLUMN && e->right->kind == EXPR_LITERAL && !pat->is_null &&
+      like_prefix(pat, &plen, &exact) && use_kernels(b, sel, n)) {
+    return select_text_prefix(f, b->cols[e->left->col_idx], pat, plen, exact, negate,
+                              b, sel, n, out);
+  }
+  return select_rows(f, e, negate, b, sel, n, out);
+}
+
+// Rows of sel (or 0..n-1) that are not in the ascending list a.
+static int select_minus(const uint16_t* sel, int n, const uint16_t* a, int na, uint16_t* out) {
+  int k = 0, j = 0;
+  for (int i = 0; i < n; i++) {
+    uint16_t row = sel ? sel[i] : (uint16_t)i;
+    while (j < na && a[j] < row) j++;
+    if (j < na && a[j] == row) continue;
+    out[k++] = row;
+  }
+  return k;
+}
+
+// Merges two disjoint ascending lists.
+static int select_union(const uint16_t* a, int na, const uint16_t* c, int nc, uint16_t* out) {
+  int i = 0, j = 0, k = 0;
+  while (i < na && j < nc) out[k++] = a[i] < c[j] ? a[i++] : c[j++];
+  while (i < na) out[k++] = a[i++];
+  while (j < nc) out[k++] = c[j++];
+  return k;
+}
+
+// Writes the selected rows for which the predicate (or its negation) is
+// true to out, in ascending order. NOT is pushed down with De Morgan's
+// laws, which hold under three-valued logic, so every node only ever
+// selects the rows where it is true. AND narrows the selection for its
+// right side; OR evaluates its right side only on the rows its left side
+// did not select.
+static int vec_select(const FilterOp* f, const Expr* e, bool negate, const Batch* b,
+                      const uint16_t* sel, int n, uint16_t* out) {
+  switch (e->kind) {
+    case EXPR_CMP:
+      return select_cmp(f, negate ? negate_cmp(e->op) : e->op, e, b, sel, n, out);
+
+    case EXPR_BETWEEN:
+      return select_between(f, e, negate, b, sel, n, out);
+
+    case EXPR_IN:
+      return select_in(f, e, negate, b, sel, n, out);
+
+    case EXPR_LIKE:
+      return select_like(f, e, negate, b, sel, n, out);
+
+    case EXPR_NOT:
+      return vec_select(f, e->left, !negate, b, sel, n, out);
+
+    case EXPR_AND:
+    case EXPR_OR: {
+      uint16_t left[VECTOR_SIZE];
+      int nl = vec_select(f, e->left, negate, b, sel, n, left);
+      if ((e->kind == EXPR_AND) != negate) {
+        return nl ? vec_select(f, e->right, negate, b, left, nl, out) : 0;
+      }
+
+      uint16_t rest[VECTOR_SIZE], right[VECTOR_SIZE];
+      int nrest = select_minus(sel, n, left, nl, rest);
+      int nr = nrest ? vec_select(f, e->right, negate, b, rest, nrest, right) : 0;
+      return select_union(left, nl, right, nr, out);
+    }
+
+    default:
+      return 0;
+  }
+}
+
+// ============================================================================
+// Hashing
+// ============================================================================
+
+static uint64_t hash_bytes(const uint8_t* s, uint32_t n) {
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+  uint64_t w;
+  for (; n >= 8; s += 8, n -= 8) {
+    memcpy(&w, s, 8);
+    h = (h ^ w) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  w = 0;
+  memcpy(&w, s, n);
+  return exec_hash_mix(h ^ w);
+}
+
+uint64_t exec_hash_value(ExecCtx* ctx, const ColumnVector* v, int row) {
+  if (vector_is_null(v, row)) return EXEC_NULL_HASH;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: return exec_hash_int(v->i32[row]);
+    case VAL_I64: return exec_hash_mix((uint64_t)v->i64[row]);
+    case VAL_F64: {
+      // -0.0 equals 0.0, so it hashes the same.
+      double d = v->f64[row] == 0 ? 0 : v->f64[row];
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      return exec_hash_mix(bits);
+    }
+    case VAL_TEXT: break;
+  }
+
+  uint32_t len = v->text_len[row];
+  if (v->toast_pid[row] == INVALID_PID) return hash_bytes(v->text + v->text_off[row], len);
+
+  uint8_t* buf = malloc(len ? len : 1);
+  if (!buf) return 0;
+  uint32_t n = toast_fetch(ctx->bp, v->toast_pid[row], buf, len);
+  uint64_t h = hash_bytes(buf, n);
+  free(buf);
+  return h;
+}
+
+uint64_t exec_hash_number(const ColumnVector* v, int row) {
+  if (vector_is_null(v, row)) return EXEC_NULL_HASH;
+  int64_t i;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32:
+      i = v->i32[row];
+      break;
+    case VAL_I64:
+      i = v->i64[row];
+      break;
+    default: {
+      // A double with a fraction equals no integer, so any hash will do.
+      double d = v->f64[row];
+      if (!(d >= -0x1p63 && d < 0x1p63) || d != (double)(int64_t)d) {
+        uint64_t bits;
+        memcpy(&bits, &d, sizeof(bits));
+        return exec_hash_mix(bits);
+      }
+      i = (int64_t)d;
+    }
+  }
+  return exec_hash_mix((uint64_t)i);
+}
+
+// ============================================================================
+// EXPLAIN
+// ============================================================================
+
+static void explain(const Operator* op, int depth) {
+  for (; op; op = op->child, depth++) {
+    printf("%*s%s%s\n", depth * 2, "", op->label, op->next_batch ? " (vectorized)" : "");
+    if (op->right) {
+      explain(op->child, depth + 1);
+      explain(op->right, depth + 1);
+      return;
+    }
+  }
+}
+
+void exec_explain(const Operator* root) {
+  explain(root, 0);
+}
@@ -0,0 +1,81 @@
+#include "freelist.h"
+#include "catalog.h"
+#include <string.h>
+
+static bool has_catalog(const Page* root) {
+  return memcmp(root->data, CATALOG_MAGIC, strlen(CATALOG_MAGIC)) == 0;
+}
+
+static uint32_t read_head(const Page* root) {
+  uint32_t head;
+  memcpy(&head, root->data + FREELIST_HEAD_OFFSET, sizeof(head));
+  return head;
+}
+
+static void write_head(Page* root, uint32_t head) {
+  memcpy(root->data + FREELIST_HEAD_OFFSET, &head, sizeof(head));
+}
+
+bool freelist_push(BufferPool* bp, uint32_t pid) {
+  if (pid == CATALOG_PID) return false;
+
+  // The root stays latched exclusively for the whole operation, which
+  // serializes all list updates.
+  Page* root = bp_fetch_page(bp, CATALOG_PID, LATCH_EXCLUSIVE);
+  if (!has_catalog(root)) {
+    bp_unpin_page(bp, CATALOG_PID, false);
+    return false;
+  }
+  uint32_t head = read_head(root);
+
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  page_init(p, pid);
+  p->hdr.next_page_id = head ? head : INVALID_PID;
+  bp_unpin_page(bp, pid, true);
+
+  write_head(root, pid);
+  bp_unpin_page(bp, CATALOG_PID, true);
+  return true;
+}
+
+uint32_t freelist_pop(BufferPool* bp) {
+  if (disk_file_size(bp->dm) == 0) return INVALID_PID;
+
+  Page* root = bp_fetch_page(bp, CATALOG_PID, LATCH_EXCLUSIVE);
+  uint32_t head = has_catalog(root) ? read_head(root) : 0;
+  if (head == 0) {
+    bp_unpin_page(bp, CATALOG_PID, false);
+    return INVALID_PID;
+  }
+
+  Page* p = bp_fetch_page(bp, head, LATCH_EXCLUSIVE);
+  uint32_t next = p->hdr.next_page_id;
+  page_init(p, head);
+  bp_unpin_page(bp, head, true);
+
+  write_head(root, next == INVALID_PID ? 0 : next);
+  bp_unpin_page(bp, CATALOG_PID, true);
+  return head;
+}
+
+uint32_t freelist_alloc(BufferPool* bp) {
+  uint32_t pid = freelist_pop(bp);
+  if (pid != INVALID_PID) return pid;
+  return disk_alloc_page(bp->dm);
+}
+
+uint32_t freelist_alloc_run(BufferPool* bp, PageRun* run) {
+  if (run->next < run->end) return run->next++;
+
+  uint32_t pid = freelist_pop(bp);
+  if (pid != INVALID_PID) return pid;
+
+  uint32_t size = run->size ? run->size * 2 : 1;
+  if (size > FREELIST_RUN_MAX) size = FREELIST_RUN_MAX;
+
+  pid = disk_alloc_pages(bp->dm, size);
+  run->next = pid + 1;
+  run->end = pid + size;
+  run->size = size;
+  return pid;
+}
@@ -0,0 +1,204 @@
+#include "fsm.h"
+#include "freelist.h"
+#include <string.h>
+
+#define INVALID_PID 0xFFFFFFFF
+
+// Largest category; it only promises FSM_CATEGORY_BYTES * 255 bytes.
+#define FSM_TOP_CATEGORY 255
+
+typedef struct {
+  uint32_t hint; ///< Root only: leaf number of the last successful search
+  uint32_t leaf[FSM_DIR_LEAVES]; ///< Page ID of each leaf, 0 if it has none yet
+  uint8_t max[FSM_DIR_LEAVES]; ///< No category in the leaf is above this
+} FsmDir;
+
+typedef struct {
+  uint32_t hint; ///< Slot of the last page found
+  uint8_t cat[FSM_LEAF_PAGES]; ///< Category of each page ID the leaf covers
+} FsmLeaf;
+
+_Static_assert(sizeof(FsmDir) <= sizeof(((Page*)0)->data), "FSM directory overflows a page");
+_Static_assert(sizeof(FsmLeaf) <= sizeof(((Page*)0)->data), "FSM leaf overflows a page");
+
+static FsmDir* as_dir(Page* p) {
+  return (FsmDir*)p->data;
+}
+
+static FsmLeaf* as_leaf(Page* p) {
+  return (FsmLeaf*)p->data;
+}
+
+static uint8_t category_of(uint16_t free_bytes) {
+  uint16_t cat = free_bytes / FSM_CATEGORY_BYTES;
+  return (uint8_t)(cat > FSM_TOP_CATEGORY ? FSM_TOP_CATEGORY : cat);
+}
+
+// Allocates a zeroed FSM page.
+static uint32_t new_page(BufferPool* bp) {
+  uint32_t pid = freelist_alloc(bp);
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  p->hdr.flags |= PAGE_FSM_INDEXED;
+  bp_unpin_page(bp, pid, true);
+  return pid;
+}
+
+uint32_t fsm_create(BufferPool* bp) {
+  return new_page(bp);
+}
+
+bool fsm_is_current(BufferPool* bp, uint32_t fsm_pid) {
+  Page* p = bp_fetch_page(bp, fsm_pid, LATCH_SHARED);
+  bool current = (p->hdr.flags & PAGE_FSM_INDEXED) != 0;
+  bp_unpin_page(bp, fsm_pid, false);
+  return current;
+}
+
+void fsm_destroy(BufferPool* bp, uint32_t fsm_pid) {
+  uint32_t pid = fsm_pid;
+  while (pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint32_t leaves[FSM_DIR_LEAVES];
+    int nleaves = 0;
+    if (p->hdr.flags & PAGE_FSM_INDEXED) {
+      for (size_t e = 0; e < FSM_DIR_LEAVES; e++) {
+        if (as_dir(p)->leaf[e]) leaves[nleaves++] = as_dir(p)->leaf[e];
+      }
+    }
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+
+    for (int i = 0; i < nleaves; i++) freelist_push(bp, leaves[i]);
+    freelist_push(bp, pid);
+    pid = next;
+  }
+}
+
+// Page ID of the n-th directory page, extending the chain up to it if
+// 'create' is set. Returns INVALID_PID if it does not exist.
+static uint32_t dir_page(BufferPool* bp, uint32_t fsm_pid, uint32_t n, bool create) {
+  uint32_t pid = fsm_pid;
+  for (; n > 0; n--) {
+    Page* p = bp_fetch_page(bp, pid, create ? LATCH_EXCLUSIVE : LATCH_SHARED);
+    uint32_t next = p->hdr.next_page_id;
+    bool grew = false;
+    if (next == INVALID_PID && create) {
+      next = new_page(bp);
+      p->hdr.next_page_id = next;
+      grew = true;
+    }
+    bp_unpin_page(bp, pid, grew);
+    if (next == INVALID_PID) return INVALID_PID;
+    pid = next;
+  }
+  return pid;
+}
+
+static void set_category(BufferPool* bp, uint32_t fsm_pid, uint32_t page_id, uint8_t cat) {
+  uint32_t leafno = page_id / FSM_LEAF_PAGES;
+  uint32_t slot = page_id % FSM_LEAF_PAGES;
+  uint32_t e = leafno % FSM_DIR_LEAVES;
+
+  // A page forgotten before its leaf exists needs no entry.
+  uint32_t dir_pid = dir_page(bp, fsm_pid, leafno / FSM_DIR_LEAVES, cat > 0);
+  if (dir_pid == INVALID_PID) return;
+
+  Page* d = bp_fetch_page(bp, dir_pid, LATCH_EXCLUSIVE);
+  FsmDir* dir = as_dir(d);
+  bool dir_dirty = false;
+  if (dir->leaf[e] == 0) {
+    if (cat == 0) {
+      bp_unpin_page(bp, dir_pid, false);
+      return;
+    }
+    dir->leaf[e] = new_page(bp);
+    dir_dirty = true;
+  }
+
+  uint32_t leaf_pid = dir->leaf[e];
+  Page* l = bp_fetch_page(bp, leaf_pid, LATCH_EXCLUSIVE);
+  bool changed = as_leaf(l)->cat[slot] != cat;
+  as_leaf(l)->cat[slot] = cat;
+  bp_unpin_page(bp, leaf_pid, changed);
+
+  // The bound only ever rises here; searches lower it when it is stale.
+  if (cat > dir->max[e]) {
+    dir->max[e] = cat;
+    dir_dirty = true;
+  }
+  bp_unpin_page(bp, dir_pid, dir_dirty);
+}
+
+void fsm_set(BufferPool* bp, uint32_t fsm_pid, uint32_t page_id, uint16_t free_bytes) {
+  set_category(bp, fsm_pid, page_id, category_of(free_bytes));
+}
+
+void fsm_remove(BufferPool* bp, uint32_t fsm_pid, uint32_t page_id) {
+  set_category(bp, fsm_pid, page_id, 0);
+}
+
+// Searches entry e of a latched directory page for a page of category
+// 'want' or above, starting at the leaf's hint. A failed search lowers the
+// entry's bound to the leaf's real maximum. Hints and exact bounds are
+// only advice, so changing them does not dirty the pages.
+static uint32_t search_leaf(BufferPool* bp, FsmDir* dir, uint32_t dir_no, uint32_t e,
+                            uint8_t want) {
+  if (dir->leaf[e] == 0 || dir->max[e] < want) return INVALID_PID;
+
+  uint32_t leaf_pid = dir->leaf[e];
+  Page* l = bp_fetch_page(bp, leaf_pid, LATCH_EXCLUSIVE);
+  FsmLeaf* leaf = as_leaf(l);
+  uint32_t start = leaf->hint < FSM_LEAF_PAGES ? leaf->hint : 0;
+  uint8_t max = 0;
+  for (uint32_t k = 0; k < FSM_LEAF_PAGES; k++) {
+    uint32_t slot = start + k < FSM_LEAF_PAGES ? start + k : start + k - FSM_LEAF_PAGES;
+    uint8_t cat = leaf->cat[slot];
+    if (cat >= want) {
+      leaf->hint = slot;
+      bp_unpin_page(bp, leaf_pid, false);
+      return ((dir_no * (uint32_t)FSM_DIR_LEAVES) + e) * (uint32_t)FSM_LEAF_PAGES + slot;
+    }
+    if (cat > max) max = cat;
+  }
+  bp_unpin_page(bp, leaf_pid, false);
+  dir->max[e] = max;
+  return INVALID_PID;
+}
+
+uint32_t fsm_find(BufferPool* bp, uint32_t fsm_pid, uint16_t needed) {
+  // Categories round down, so a request above what the top one promises
+  // could be handed a page it does not fit in; it takes a fresh page.
+  uint32_t want = ((uint32_t)needed + FSM_CATEGORY_BYTES - 1) / FSM_CATEGORY_BYTES;
+  if (want == 0) want = 1;
+  if (want > FSM_TOP_CATEGORY) return INVALID_PID;
+
+  Page* root = bp_fetch_page(bp, fsm_pid, LATCH_EXCLUSIVE);
+  FsmDir* rdir = as_dir(root);
+
+  // Most searches end in the leaf of the last page found.
+  uint32_t hint = rdir->hint;
+  uint32_t found = INVALID_PID;
+  if (hint < FSM_DIR_LEAVES) found = search_leaf(bp, rdir, 0, hint, (uint8_t)want);
+  if (found != INVALID_PID) {
+    bp_unpin_page(bp, fsm_pid, false);
+    return found;
+  }
+
+  uint32_t pid = fsm_pid;
+  for (uint32_t dir_no = 0; pid != INVALID_PID; dir_no++) {
+    Page* d = dir_no == 0 ? root : bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+    FsmDir* dir = as_dir(d);
+    for (uint32_t e = 0; e < FSM_DIR_LEAVES && found == INVALID_PID; e++) {
+      if (dir_no == 0 && e == hint) continue;
+      found = search_leaf(bp, dir, dir_no, e, (uint8_t)want);
+      if (found != INVALID_PID) rdir->hint = dir_no * (uint32_t)FSM_DIR_LEAVES + e;
+    }
+    uint32_t next = d->hdr.next_page_id;
+    if (dir_no != 0) bp_unpin_page(bp, pid, false);
+    if (found != INVALID_PID) break;
+    pid = next;
+  }
+
+  bp_unpin_page(bp, fsm_pid, false);
+  return found;
+}
@@ -1,29 +1,97 @@
 #include "heap.h"
 #include "page.h"
+#include "fsm.h"
+#include "freelist.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define INVALID_PID 0xFFFFFFFF
 
 static void write_header(BufferPool* bp, HeapFile* hf) {
-  Page* p = bp_fetch_page(bp, hf->header_page_id);
+  Page* p = bp_fetch_page(bp, hf->header_page_id, LATCH_EXCLUSIVE);
 
   memcpy(p->data + 0, &hf->first_data_pid, sizeof(uint32_t));
   memcpy(p->data + 4, &hf->last_data_pid,  sizeof(uint32_t));
+  memcpy(p->data + 8, &hf->fsm_pid,        sizeof(uint32_t));
+  memcpy(p->data + 12, &hf->vacuum_pid,    sizeof(uint32_t));
+  memcpy(p->data + 16, &hf->run,           sizeof(PageRun));
 
   bp_unpin_page(bp, hf->header_page_id, true);
 }
 
+// Heaps written before the free-space map existed have fsm_pid == 0 in their
+// header (page 0 is always the catalog root). Build the map from the page
+// chain once, on the first insert that needs it.
+static void build_fsm(BufferPool* bp, HeapFile* hf) {
+  hf->fsm_pid = fsm_create(bp);
+
+  uint32_t pid = hf->first_data_pid;
+  while (pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint16_t free_bytes = page_free_space(p);
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+
+    fsm_set(bp, hf->fsm_pid, pid, free_bytes);
+    pid = next;
+  }
+
+  write_header(bp, hf);
+}
+
+static void note_free_space(BufferPool* bp, HeapFile* hf, uint32_t pid, uint16_t free_bytes) {
+  if (hf->fsm_pid == 0) return;
+  fsm_set(bp, hf->fsm_pid, pid, free_bytes);
+}
+
+// Allocates a fresh data page from the heap's run, links it after the
+// current last page and registers it in the free-space map.
+static uint32_t append_page(BufferPool* bp, HeapFile* hf) {
+  uint32_t new_pid = freelist_alloc_run(bp, &hf->run);
+
+  Page* last = bp_fetch_page(bp, hf->last_data_pid, LATCH_EXCLUSIVE);
+  last->hdr.next_page_id = new_pid;
+  bp_unpin_page(bp, hf->last_data_pid, true);
+
+  hf->last_data_pid = new_pid;
+  write_header(bp, hf);
+
+  Page* p = bp_fetch_page(bp, new_pid, LATCH_SHARED);
+  uint16_t free_bytes = page_free_space(p);
+  bp_unpin_page(bp, new_pid, false);
+  note_free_space(bp, hf, new_pid, free_bytes);
+
+  return new_pid;
+}
+
 HeapFile heap_bootstrap(BufferPool* bp, uint32_t header_pid, uint32_t first_data_pid) {
   HeapFile hf = {
     .header_page_id = header_pid,
     .first_data_pid = first_data_pid,
-    .last_data_pid  = first_data_pid
+    .last_data_pid  = first_data_pid,
+    .fsm_pid        = fsm_create(bp)
   };
+
+  Page* p = bp_fetch_page(bp, first_data_pid, LATCH_SHARED);
+  uint16_t free_bytes = page_free_space(p);
+  bp_unpin_page(bp, first_data_pid, false);
+  fsm_set(bp, hf.fsm_pid, first_data_pid, free_bytes);
+
   write_header(bp, &hf);
   return hf;
 }
 
+static void read_header(BufferPool* bp, HeapFile* hf) {
+  Page* p = bp_fetch_page(bp, hf->header_page_id, LATCH_SHARED);
+  memcpy(&hf->first_data_pid, p->data + 0, sizeof(uint32_t));
+  memcpy(&hf->last_data_pid, p->data + 4, sizeof(uint32_t));
+  memcpy(&hf->fsm_pid, p->data + 8, sizeof(uint32_t));
+  memcpy(&hf->vacuum_pid, p->data + 12, sizeof(uint32_t));
+  memcpy(&hf->run, p->data + 16, sizeof(PageRun));
+  bp_unpin_page(bp, hf->header_page_id, false);
+}
+
 HeapFile heap_open(BufferPool* bp, uint32_t header_pid) {
   HeapFile hf = {0};
   hf.header_page_id = header_pid;
@@ -33,22 +101,21 @@ HeapFile heap_open(BufferPool* bp, uint32_t header_pid) {
   if (size == 0) {
     uint32_t header_pid = disk_alloc_page(bp->dm);
     uint32_t data_pid = disk_alloc_page(bp->dm);
+    return heap_bootstrap(bp, header_pid, data_pid);
+  }
 
-    hf.header_page_id = header_pid;
-    hf.first_data_pid = data_pid;
-    hf.last_data_pid = data_pid;
+  read_header(bp, &hf);
 
+  // Maps in the older list layout cost a scan per lookup; drop them and
+  // let the first insert build one in the current layout.
+  if (hf.fsm_pid != 0 && !fsm_is_current(bp, hf.fsm_pid)) {
+    fsm_destroy(bp, hf.fsm_pid);
+    hf.fsm_pid = 0;
     write_header(bp, &hf);
-    return hf;
   }
 
-  Page* p = bp_fetch_page(bp, hf.header_page_id);
-  memcpy(&hf.first_data_pid, p->data + 0, sizeof(uint32_t));
-  memcpy(&hf.last_data_pid, p->data + 4, sizeof(uint32_t));
-  bp_unpin_page(bp, hf.header_page_id, false);
-
   if (hf.first_data_pid == 0 && hf.last_data_pid == 0) {
-    uint32_t data_pid = disk_alloc_page(bp->dm);
+    uint32_t data_pid = freelist_alloc(bp);
     hf.first_data_pid = data_pid;
     hf.last_data_pid = data_pid;
     write_header(bp, &hf);
@@ -57,38 +124,45 @@ HeapFile heap_open(BufferPool* bp, uint32_t header_pid) {
   return hf;
 }
 
-RID heap_insert(BufferPool* bp, HeapFile* hf, const uint8_t* rec, uint16_t len) {
-  uint32_t pid = hf->last_data_pid;
-
-  while (1) {
-    Page* p = bp_fetch_page(bp, pid);
+void heap_reload(BufferPool* bp, HeapFile* hf) {
+  read_header(bp, hf);
+}
 
-    int slot = page_insert(p, rec, len);
-    if (slot >= 0) {
-      bp_unpin_page(bp, pid, true);
-      return (RID){ .page_id = pid, .slot_id = (uint16_t)slot };
-    }
+// Inserts into page 'pid' and records its new free space. Returns a RID
+// with INVALID_PID if the record does not fit.
+static RID insert_into(BufferPool* bp, HeapFile* hf, uint32_t pid, const uint8_t* rec,
+                       uint16_t len) {
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  int slot = page_insert(p, rec, len);
+  uint16_t free_bytes = page_free_space(p);
+  bp_unpin_page(bp, pid, slot >= 0);
+
+  note_free_space(bp, hf, pid, free_bytes);
+  if (slot < 0) return (RID){ .page_id = INVALID_PID, .slot_id = 0 };
+  return (RID){ .page_id = pid, .slot_id = (uint16_t)slot };
+}
 
-    if (p->hdr.next_page_id != INVALID_PID) {
-      uint32_t next = p->hdr.next_page_id;
-      bp_unpin_page(bp, pid, false);
-      pid = next;
-      continue;
-    }
+RID heap_insert(BufferPool* bp, HeapFile* hf, const uint8_t* rec, uint16_t len) {
+  if ((size_t)len + sizeof(Slot) > sizeof(((Page*)0)->data)) {
+    return (RID){ .page_id = INVALID_PID, .slot_id = 0 };
+  }
 
-    uint32_t new_pid = disk_alloc_page(bp->dm);
-    p->hdr.next_page_id = new_pid;
-    bp_unpin_page(bp, pid, true);
+  if (hf->fsm_pid == 0) build_fsm(bp, hf);
 
-    hf->last_data_pid = new_pid;
-    write_header(bp, hf);
+  uint16_t needed = (uint16_t)(len + sizeof(Slot));
 
-    pid = new_pid;
+  // The page the map offers holds at least 'needed' bytes by its count; if
+  // the record still does not go in, a fresh page takes it.
+  uint32_t pid = fsm_find(bp, hf->fsm_pid, needed);
+  if (pid != INVALID_PID) {
+    RID rid = insert_into(bp, hf, pid, rec, len);
+    if (rid.page_id != INVALID_PID) return rid;
   }
+  return insert_into(bp, hf, append_page(bp, hf), rec, len);
 }
 
 bool heap_get(BufferPool* bp, RID rid, uint8_t** out, uint16_t* len) {
-  Page* p = bp_fetch_page(bp, rid.page_id);
+  Page* p = bp_fetch_page(bp, rid.page_id, LATCH_SHARED);
   bool ok = page_get(p, rid.slot_id, out, len);
   bp_unpin_page(bp, rid.page_id, false);
   return ok;
@@ -107,7 +181,7 @@ bool heap_scan_next(BufferPool* bp, HeapFile* hf, RID* cursor, uint8_t** out, ui
   }
 
   while (pid != INVALID_PID) {
-    Page* p = bp_fetch_page(bp, pid);
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
 
     for (; slot < p->hdr.slot_count; slot++) {
       if (page_get(p, slot, out, len)) {
@@ -126,59 +200,322 @@ bool heap_scan_next(BufferPool* bp, HeapFile* hf, RID* cursor, uint8_t** out, ui
   return false;
 }
 
-int heap_update_in_place(BufferPool* bp, RID rid, const uint8_t* data, uint16_t new_len) {
-  Page* p = bp_fetch_page(bp, rid.page_id);
-  if (!p) return -1;
+uint32_t heap_count_pages(BufferPool* bp, const HeapFile* hf, uint32_t max) {
+  uint32_t n = 0;
+  uint32_t pid = hf->first_data_pid;
+  while (pid != INVALID_PID && n < max) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+    pid = next;
+    n++;
+  }
+  return n;
+}
 
-  if (rid.slot_id >= p->hdr.slot_count) {
-    bp_unpin_page(bp, rid.page_id, false);
-    return -1;
+// Pages prefetched ahead of a sequential scan.
+#define HEAP_READAHEAD_PAGES 32
+
+void heap_scan_begin(BufferPool* bp, const HeapFile* hf, HeapScan* scan) {
+  memset(scan, 0, sizeof(*scan));
+  scan->hf = *hf;
+  scan->cur.page_id = INVALID_PID;
+  scan->read_ahead = true;
+  bp_ring_init(bp, &scan->ring);
+}
+
+// Called when the scan enters 'pid', whose successor is 'next'. Heaps grow
+// in runs of consecutive pages, which the kernel's own sequential read-ahead
+// handles better than explicit hints, so those steps are left alone. A
+// one-off jump, such as into the next run, is prefetched on its own. Heaps
+// written before runs existed advance by a constant stride when several
+// tables grew together; once the same stride repeats, the pages it predicts
+// are prefetched in a sliding window of HEAP_READAHEAD_PAGES, refilled once
+// half of it is consumed.
+static void scan_read_ahead(BufferPool* bp, HeapScan* scan, uint32_t pid, uint32_t next) {
+  if (!scan->read_ahead || next == INVALID_PID) return;
+
+  uint32_t stride = next > pid ? next - pid : 0;
+  bool steady = stride > 1 && stride == scan->ra_stride;
+  scan->ra_stride = stride;
+  if (stride == 1) return;
+
+  if (!steady) {
+    disk_prefetch(bp->dm, next, 1);
+    scan->ra_end = 0;
+    return;
   }
 
-  Slot* s = slot_at(p, rid.slot_id);
+  if (scan->ra_end < next) scan->ra_end = next;
+  if (scan->ra_end > next + stride * (HEAP_READAHEAD_PAGES / 2)) return;
 
-  if (s->deleted || s->len == 0) {
-    bp_unpin_page(bp, rid.page_id, false);
-    return -1;
+  uint32_t to = next + stride * HEAP_READAHEAD_PAGES;
+  for (uint32_t p = scan->ra_end; p < to; p += stride) disk_prefetch(bp->dm, p, 1);
+  scan->ra_end = to;
+}
+
+bool heap_scan_step(BufferPool* bp, HeapScan* scan, uint8_t** out, uint16_t* len) {
+  uint32_t pid;
+  uint16_t slot;
+
+  if (scan->done) return false;
+  if (scan->cur.page_id == INVALID_PID) {
+    pid = scan->hf.first_data_pid;
+    slot = 0;
+  } else {
+    // Resumes after the last row, fetching its page again if the scan was
+    // paused.
+    pid = scan->cur.page_id;
+    slot = scan->cur.slot_id + 1;
   }
 
-  if (new_len > s->len) {
-    bp_unpin_page(bp, rid.page_id, false);
-    return -1;
+  while (pid != INVALID_PID) {
+    Page* p = scan->page;
+    if (!p) {
+      p = bp_fetch_page_ring(bp, pid, &scan->ring);
+      if (!p) break;
+      scan->page = p;
+      if (slot == 0) scan_read_ahead(bp, scan, pid, p->hdr.next_page_id);
+    }
+
+    for (; slot < p->hdr.slot_count; slot++) {
+      if (page_get(p, slot, out, len)) {
+        scan->cur.page_id = pid;
+        scan->cur.slot_id = slot;
+        return true;
+      }
+    }
+
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+    scan->page = NULL;
+    pid = next;
+    slot = 0;
   }
 
-  if ((uint32_t)s->offset + new_len > sizeof(p->data)) {
-    bp_unpin_page(bp, rid.page_id, false);
-    return -1;
+  scan->done = true;
+  return false;
+}
+
+int heap_scan_page(BufferPool* bp, HeapScan* scan, int max, uint8_t** rows, uint16_t* lens,
+                   RID* rids) {
+  if (max <= 0 || !heap_scan_step(bp, scan, &rows[0], &lens[0])) return 0;
+  rids[0] = scan->cur;
+
+  Page* p = scan->page;
+  int n = 1;
+  for (int slot = scan->cur.slot_id + 1; n < max && slot < p->hdr.slot_count; slot++) {
+    if (!page_get(p, slot, &rows[n], &lens[n])) continue;
+    scan->cur.slot_id = (uint16_t)slot;
+    rids[n++] = scan->cur;
   }
+  return n;
+}
+
+void heap_scan_seek(BufferPool* bp, HeapScan* scan, RID after) {
+  heap_scan_pause(bp, scan);
+  scan->cur = after;
+  scan->done = false;
+}
 
-  memcpy(p->data + s->offset, data, new_len);
+void heap_scan_pause(BufferPool* bp, HeapScan* scan) {
+  heap_scan_end(bp, scan);
+}
 
-  s->len = new_len;
+void heap_scan_end(BufferPool* bp, HeapScan* scan) {
+  if (!scan->page) return;
+  bp_unpin_page(bp, scan->cur.page_id, false);
+  scan->page = NULL;
+}
+
+int heap_update_in_place(BufferPool* bp, HeapFile* hf, RID rid, const uint8_t* data, uint16_t new_len) {
+  Page* p = bp_fetch_page(bp, rid.page_id, LATCH_EXCLUSIVE);
+  if (!p) return -1;
+
+  if (!page_update(p, rid.slot_id, data, new_len)) {
+    bp_unpin_page(bp, rid.page_id, false);
+    return -1;
+  }
+  uint16_t free_bytes = page_free_space(p);
 
   bp_unpin_page(bp, rid.page_id, true);
+  note_free_space(bp, hf, rid.page_id, free_bytes);
   return 0;
 }
 
-int heap_delete(BufferPool* bp, RID rid) {
-  Page* p = bp_fetch_page(bp, rid.page_id);
+int heap_delete(BufferPool* bp, HeapFile* hf, RID rid) {
+  Page* p = bp_fetch_page(bp, rid.page_id, LATCH_EXCLUSIVE);
   if (!p) return -1;
 
   if (!page_delete(p, rid.slot_id)) {
     bp_unpin_page(bp, rid.page_id, false);
     return -1;
   }
+  uint16_t free_bytes = page_free_space(p);
 
   bp_unpin_page(bp, rid.page_id, true);
+  note_free_space(bp, hf, rid.page_id, free_bytes);
   return 0;
 }
 
 HeapFile heap_create(BufferPool* bp, uint32_t* out_header_pid) {
-  uint32_t header_pid = disk_alloc_page(bp->dm);
-  uint32_t data_pid = disk_alloc_page(bp->dm);
+  uint32_t header_pid = freelist_alloc(bp);
+  uint32_t data_pid = freelist_alloc(bp);
 
   HeapFile hf = heap_bootstrap(bp, header_pid, data_pid);
 
   if (out_header_pid) *out_header_pid = header_pid;
   return hf;
-}
\ No newline at end of file
+}
+
+bool heap_bulk_begin(HeapFile* hf, HeapBulkLoad* bl, HeapBulkRowFn on_row, void* ctx) {
+  memset(bl, 0, sizeof(*bl));
+  bl->pages = malloc((size_t)HEAP_BULK_PAGES * sizeof(Page));
+  if (!bl->pages) return false;
+  bl->hf = hf;
+  bl->on_row = on_row;
+  bl->ctx = ctx;
+  return true;
+}
+
+// Writes the batch as one run at the end of the file and links it after the
+// heap's current last page. Pages that could not be written are dropped
+// instead; heap_bulk_end reports the failure.
+static bool bulk_flush(BufferPool* bp, HeapBulkLoad* bl) {
+  if (bl->npages == 0) return true;
+
+  HeapFile* hf = bl->hf;
+  uint32_t n = bl->npages;
+  uint32_t first = disk_reserve_pages(bp->dm, n);
+
+  for (uint32_t i = 0; i < n; i++) {
+    bl->pages[i].hdr.page_id = first + i;
+    bl->pages[i].hdr.next_page_id = i + 1 < n ? first + i + 1 : INVALID_PID;
+  }
+  if (!disk_write_pages(bp->dm, first, bl->pages, n)) {
+    bl->npages = 0;
+    return false;
+  }
+
+  Page* last = bp_fetch_page(bp, hf->last_data_pid, LATCH_EXCLUSIVE);
+  last->hdr.next_page_id = first;
+  bp_unpin_page(bp, hf->last_data_pid, true);
+
+  hf->last_data_pid = first + n - 1;
+  write_header(bp, hf);
+
+  for (uint32_t i = 0; i < n; i++) {
+    Page* p = &bl->pages[i];
+    for (uint16_t slot = 0; slot < p->hdr.slot_count; slot++) {
+      uint8_t* rec;
+      uint16_t len;
+      if (!page_get(p, slot, &rec, &len)) continue;
+      if (bl->on_row) bl->on_row(bl->ctx, rec, len, (RID){ .page_id = first + i, .slot_id = slot });
+      bl->rows++;
+    }
+  }
+
+  bl->pages_written += n;
+  bl->npages = 0;
+  return true;
+}
+
+bool heap_bulk_insert(BufferPool* bp, HeapBulkLoad* bl, const uint8_t* rec, uint16_t len) {
+  if ((size_t)len + sizeof(Slot) > sizeof(((Page*)0)->data)) return false;
+
+  if (bl->npages > 0 && page_insert(&bl->pages[bl->npages - 1], rec, len) >= 0) return true;
+
+  if (bl->npages == HEAP_BULK_PAGES) bulk_flush(bp, bl);
+  Page* p = &bl->pages[bl->npages++];
+  page_init(p, 0);
+  return page_insert(p, rec, len) >= 0;
+}
+
+bool heap_bulk_end(BufferPool* bp, HeapBulkLoad* bl) {
+  if (bl->npages > 0) {
+    uint16_t free_bytes = page_free_space(&bl->pages[bl->npages - 1]);
+    if (bulk_flush(bp, bl)) note_free_space(bp, bl->hf, bl->hf->last_data_pid, free_bytes);
+  }
+
+  free(bl->pages);
+  bl->pages = NULL;
+  return disk_sync(bp->dm);
+}
+
+static bool page_is_empty(Page* p) {
+  for (int i = 0; i < p->hdr.slot_count; i++) {
+    if (!slot_at(p, i)->deleted) return false;
+  }
+  return true;
+}
+
+// Pages written before frag_bytes existed may hold dead records that the
+// counter does not know about.
+static bool page_has_dead_bytes(Page* p) {
+  if (p->hdr.frag_bytes > 0) return true;
+  for (int i = 0; i < p->hdr.slot_count; i++) {
+    Slot* s = slot_at(p, i);
+    if (s->deleted && s->len > 0) return true;
+  }
+  return false;
+}
+
+// Removes 'pid' from the chain, given its predecessor and successor, and
+// hands it to the file's free list.
+static void release_page(BufferPool* bp, HeapFile* hf, uint32_t prev, uint32_t pid, uint32_t next) {
+  Page* p = bp_fetch_page(bp, prev, LATCH_EXCLUSIVE);
+  p->hdr.next_page_id = next;
+  bp_unpin_page(bp, prev, true);
+
+  if (hf->last_data_pid == pid) hf->last_data_pid = prev;
+  if (hf->fsm_pid != 0) fsm_remove(bp, hf->fsm_pid, pid);
+  freelist_push(bp, pid);
+}
+
+bool heap_vacuum(BufferPool* bp, HeapFile* hf, uint32_t max_pages, HeapVacuumStats* st) {
+  memset(st, 0, sizeof(*st));
+
+  // 'prev' is the last page kept so far. The first page is never released,
+  // so a pass that starts from the beginning only compacts it.
+  uint32_t prev = hf->vacuum_pid ? hf->vacuum_pid : INVALID_PID;
+  uint32_t pid = hf->first_data_pid;
+  if (prev != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, prev, LATCH_SHARED);
+    pid = p->hdr.next_page_id;
+    bp_unpin_page(bp, prev, false);
+  }
+
+  while (pid != INVALID_PID && st->pages_scanned < max_pages) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+    uint32_t next = p->hdr.next_page_id;
+    st->pages_scanned++;
+
+    if (prev != INVALID_PID && page_is_empty(p)) {
+      st->bytes_reclaimed += p->hdr.free_start;
+      bp_unpin_page(bp, pid, false);
+      release_page(bp, hf, prev, pid, next);
+      st->pages_freed++;
+    } else {
+      bool dirty = page_has_dead_bytes(p);
+      if (dirty) {
+        // Measured on the page itself, as frag_bytes misses the deleted
+        // records of pages written before it was kept.
+        uint16_t used = (uint16_t)(p->hdr.free_start + (sizeof(p->data) - p->hdr.free_end));
+        page_compact(p);
+        st->bytes_reclaimed +=
+            (uint16_t)(used - p->hdr.free_start - (sizeof(p->data) - p->hdr.free_end));
+        st->pages_compacted++;
+      }
+      uint16_t free_bytes = page_free_space(p);
+      bp_unpin_page(bp, pid, dirty);
+      if (dirty) note_free_space(bp, hf, pid, free_bytes);
+      prev = pid;
+    }
+    pid = next;
+  }
+
+  bool done = pid == INVALID_PID;
+  hf->vacuum_pid = done || prev == INVALID_PID ? 0 : prev;
+  write_header(bp, hf);
+  return done;
+}
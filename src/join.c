@@ -0,0 +1,767 @@
+#include "join.h"
+#include "spill.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Build rows are kept in JOIN_FANOUT partitions by a slice of
+// JOIN_FANOUT_BITS bits from the top of their hash, a different slice at
+// each level, so a spilled partition that still does not fit is split
+// again. Past JOIN_MAX_LEVEL the table grows beyond the budget instead.
+#define JOIN_FANOUT_BITS 5
+#define JOIN_FANOUT (1 << JOIN_FANOUT_BITS)
+#define JOIN_MAX_LEVEL 6
+
+#define JOIN_MIN_BUCKETS 64
+
+// A build row: its hash, the next row of its bucket and its values, packed
+// as a NULL bitmap and a fixed-size slot per column followed by the inline
+// TEXT bytes. An INT slot holds the value; a TEXT slot holds the length,
+// the overflow page and the offset of the inline bytes in the row.
+typedef struct {
+  uint64_t hash;
+  uint32_t next; ///< Index + 1 of the next row in the bucket, 0 at the end
+  uint8_t data[];
+} JoinRow;
+
+typedef struct {
+  uint32_t len;
+  uint32_t toast_pid;
+  uint32_t off;
+} JoinText;
+
+typedef struct {
+  Arena mem; ///< Rows and their inline TEXT bytes
+  JoinRow** rows;
+  uint32_t nrows;
+  uint32_t cap;
+  size_t bytes; ///< Memory charged for the rows
+  FILE* build; ///< Build rows once the partition has spilled, NULL while it is in memory
+  FILE* probe; ///< Probe rows of a spilled partition
+} JoinPartition;
+
+typedef struct {
+  FILE* build;
+  FILE* probe;
+  int level;
+} JoinPending;
+
+// A probe row whose partition is in memory and whose bucket is not empty.
+typedef struct {
+  int row; ///< Row of the probe batch
+  uint64_t hash;
+  uint32_t head; ///< First build row of the bucket + 1
+} JoinProbe;
+
+typedef struct {
+  Operator base;
+  Operator* build_op;
+  Operator* probe_op;
+  bool build_left;
+  int nkeys;
+  int bkeys[EXEC_MAX_COLS]; ///< Key columns of the build input
+  int pkeys[EXEC_MAX_COLS]; ///< Key columns of the probe input
+  bool widen[EXEC_MAX_COLS]; ///< Whether a key joins numbers of different types, hashed by value
+  int all_cols[EXEC_MAX_COLS]; ///< 0, 1, 2, ...: every column is spilled
+  uint32_t col_off[EXEC_MAX_COLS]; ///< Offset of each build column's slot in a row
+  uint32_t fixed_size; ///< Size of a build row without its TEXT bytes
+  BatchReader build_reader;
+  BatchReader probe_reader;
+  SpillReader build_in; ///< Build file of the current pass; build_in.f is NULL for the child
+  SpillReader probe_in; ///< Probe file of the current pass; probe_in.f is NULL for the child
+
+  // Table of the current pass
+  int level;
+  JoinPartition parts[JOIN_FANOUT];
+  size_t mem_used;
+  JoinRow** rows; ///< Rows of the partitions in memory, indexed by the buckets
+  uint32_t rows_cap;
+  uint32_t* heads; ///< First row of each bucket + 1
+  uint32_t nbuckets; ///< Power of two
+  bool built; ///< The build input of the current pass has been consumed
+  bool probed; ///< The probe input of the current pass has been consumed
+
+  // Probing
+  Batch batch; ///< Probe batch being joined
+  JoinProbe probes[VECTOR_SIZE];
+  int nprobes;
+  int cur; ///< Entry of probes being matched
+  uint32_t match; ///< Next build row to compare with it + 1
+
+  JoinPending* pending;
+  int npending;
+  int pending_cap;
+  HashJoinStats stats;
+} HashJoinOp;
+
+static bool out_of_memory(ExecCtx* ctx) {
+  snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+  return false;
+}
+
+// Sets the output schema to the left input's columns followed by the right's.
+static bool join_columns(ExecCtx* ctx, Operator* op, const Operator* left, const Operator* right) {
+  if (left->ncols + right->ncols > EXEC_MAX_COLS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many columns in the join.");
+    return false;
+  }
+  op->ncols = left->ncols + right->ncols;
+  memcpy(op->cols, left->cols, sizeof(ExecColumn) * (size_t)left->ncols);
+  memcpy(op->cols + left->ncols, right->cols, sizeof(ExecColumn) * (size_t)right->ncols);
+  return true;
+}
+
+// Formats "a.x = b.y AND ..." for EXPLAIN.
+static void key_list(const Operator* left, const Operator* right, const int* lkeys,
+                     const int* rkeys, int nkeys, char* buf, size_t cap) {
+  size_t used = 0;
+  buf[0] = 0;
+  for (int k = 0; k < nkeys; k++) {
+    const ExecColumn* l = &left->cols[lkeys[k]];
+    const ExecColumn* r = &right->cols[rkeys[k]];
+    int w = snprintf(buf + used, cap - used, "%s%s.%s = %s.%s", k ? " AND " : "", l->table,
+                     l->name, r->table, r->name);
+    if (w > 0) used = used + (size_t)w < cap ? used + (size_t)w : cap - 1;
+  }
+}
+
+// ============================================================================
+// Partitions
+// ============================================================================
+
+static int partition_of(const HashJoinOp* j, uint64_t hash) {
+  int shift = 64 - JOIN_FANOUT_BITS * (j->level + 1);
+  return (int)((hash >> shift) & (JOIN_FANOUT - 1));
+}
+
+static void free_partition(JoinPartition* p) {
+  arena_free(&p->mem);
+  p->nrows = 0;
+  p->bytes = 0;
+}
+
+static void close_partition_files(JoinPartition* p) {
+  if (p->build) fclose(p->build);
+  if (p->probe) fclose(p->probe);
+  p->build = NULL;
+  p->probe = NULL;
+}
+
+static void row_value(const HashJoinOp* j, const JoinRow* r, int c, RowField* out) {
+  const uint8_t* slot = r->data + j->col_off[c];
+  out->type = j->build_op->cols[c].type;
+  out->is_null = (r->data[c >> 3] >> (c & 7)) & 1u;
+  out->toast_pid = INVALID_PID;
+  if (out->is_null) return;
+  switch (row_value_kind(out->type)) {
+    case VAL_I32: memcpy(&out->i32, slot, 4); return;
+    case VAL_I64: memcpy(&out->i64, slot, 8); return;
+    case VAL_F64: memcpy(&out->f64, slot, 8); return;
+    case VAL_TEXT: break;
+  }
+  JoinText t;
+  memcpy(&t, slot, sizeof(t));
+  out->text_len = t.len;
+  out->toast_pid = t.toast_pid;
+  out->text = t.toast_pid == INVALID_PID ? r->data + t.off : NULL;
+}
+
+static void row_values(const HashJoinOp* j, const JoinRow* r, RowField* out) {
+  for (int c = 0; c < j->build_op->ncols; c++) row_value(j, r, c, &out[c]);
+}
+
+// Packs row `row` of a build batch into a partition in memory. Inline bytes
+// are copied, as the batch's buffers are reused; out-of-line values stay
+// valid for the whole statement.
+static bool add_row(HashJoinOp* j, JoinPartition* p, uint64_t hash, const Batch* b, int row) {
+  ExecCtx* ctx = j->base.ctx;
+  int ncols = j->build_op->ncols;
+  if (p->nrows == p->cap) {
+    uint32_t cap = p->cap ? p->cap * 2 : 64;
+    JoinRow** grown = realloc(p->rows, sizeof(JoinRow*) * cap);
+    if (!grown) return out_of_memory(ctx);
+    p->rows = grown;
+    p->cap = cap;
+  }
+
+  RowField vals[EXEC_MAX_COLS];
+  uint32_t size = j->fixed_size;
+  for (int c = 0; c < ncols; c++) {
+    vector_get(b->cols[c], row, &vals[c]);
+    const RowField* v = &vals[c];
+    if (!v->is_null && row_is_text(v->type) && v->toast_pid == INVALID_PID) size += v->text_len;
+  }
+
+  JoinRow* r = arena_alloc(&p->mem, size);
+  if (!r) return out_of_memory(ctx);
+  r->hash = hash;
+  uint32_t off = j->fixed_size - (uint32_t)offsetof(JoinRow, data);
+  for (int c = 0; c < ncols; c++) {
+    const RowField* v = &vals[c];
+    uint8_t* slot = r->data + j->col_off[c];
+    if (v->is_null) {
+      r->data[c >> 3] |= (uint8_t)(1u << (c & 7));
+    } else if (!row_is_text(v->type)) {
+      memcpy(slot, &v->i32, row_value_kind(v->type) == VAL_I32 ? 4 : 8);
+    } else {
+      JoinText t = { v->text_len, v->toast_pid, off };
+      memcpy(slot, &t, sizeof(t));
+      if (v->toast_pid == INVALID_PID) {
+        memcpy(r->data + off, v->text, v->text_len);
+        off += v->text_len;
+      }
+    }
+  }
+
+  // Charged on top of the row: its pointers in the partition and in the
+  // table, and its share of the bucket array.
+  size_t bytes = ((size + 15) & ~(size_t)15) + sizeof(JoinRow*) * 2 + sizeof(uint32_t) * 2;
+  p->rows[p->nrows++] = r;
+  p->bytes += bytes;
+  j->mem_used += bytes;
+  return true;
+}
+
+// Writes the rows of the largest partition in memory to its build file and
+// frees them. Returns false on failure or when nothing is left to spill.
+static bool spill_largest(HashJoinOp* j, bool* spilled) {
+  ExecCtx* ctx = j->base.ctx;
+  JoinPartition* p = NULL;
+  for (int i = 0; i < JOIN_FANOUT; i++) {
+    JoinPartition* q = &j->parts[i];
+    if (!q->build && q->nrows > 0 && (!p || q->bytes > p->bytes)) p = q;
+  }
+  *spilled = p != NULL;
+  if (!p) return true;
+
+  if (!(p->build = spill_create(ctx))) return false;
+  RowField vals[EXEC_MAX_COLS];
+  for (uint32_t i = 0; i < p->nrows; i++) {
+    row_values(j, p->rows[i], vals);
+    if (!spill_write(ctx, p->build, vals, j->build_op->ncols)) return false;
+  }
+  j->stats.spilled_rows += p->nrows;
+  j->mem_used -= p->bytes;
+  free_partition(p);
+  return true;
+}
+
+// Keeps the partitions in memory within the budget, unless the level is too
+// deep to split them further.
+static bool enforce_budget(HashJoinOp* j) {
+  ExecCtx* ctx = j->base.ctx;
+  size_t budget = ctx->work_mem ? ctx->work_mem : EXEC_WORK_MEM_DEFAULT;
+  if (j->level >= JOIN_MAX_LEVEL) return true;
+  while (j->mem_used > budget) {
+    bool spilled;
+    if (!spill_largest(j, &spilled)) return false;
+    if (!spilled) break;
+  }
+  return true;
+}
+
+// ============================================================================
+// Build
+// ============================================================================
+
+// Hashes the key columns of the selected rows, a column at a time. Rows
+// with a NULL key get no hash, as they match nothing.
+static void hash_keys(HashJoinOp* j, const Batch* b, const int* keys, uint64_t* hashes,
+                      bool* null) {
+  ExecCtx* ctx = j->base.ctx;
+  int n = b->nsel;
+  memset(hashes, 0, sizeof(uint64_t) * (size_t)n);
+  memset(null, 0, sizeof(bool) * (size_t)n);
+  for (int k = 0; k < j->nkeys; k++) {
+    const ColumnVector* v = b->cols[keys[k]];
+    bool widen = j->widen[k];
+    for (int i = 0; i < n; i++) {
+      int row = b->sel ? b->sel[i] : i;
+      if (vector_is_null(v, row)) null[i] = true;
+      else if (widen) hashes[i] = exec_hash_mix(hashes[i] ^ exec_hash_number(v, row));
+      else hashes[i] = exec_hash_mix(hashes[i] ^ exec_hash_value(ctx, v, row));
+    }
+  }
+}
+
+static bool build_batch(HashJoinOp* j, const Batch* b) {
+  ExecCtx* ctx = j->base.ctx;
+  uint64_t hashes[VECTOR_SIZE];
+  bool null[VECTOR_SIZE];
+  hash_keys(j, b, j->bkeys, hashes, null);
+
+  for (int i = 0; i < b->nsel; i++) {
+    if (null[i]) continue;
+    int row = b->sel ? b->sel[i] : i;
+    JoinPartition* p = &j->parts[partition_of(j, hashes[i])];
+    if (p->build) {
+      if (!spill_write_row(ctx, p->build, b, row, j->all_cols, j->build_op->ncols)) return false;
+      j->stats.spilled_rows++;
+      continue;
+    }
+    if (!add_row(j, p, hashes[i], b, row) || !enforce_budget(j)) return false;
+  }
+  return true;
+}
+
+// Chains the rows of the partitions in memory into buckets by the low bits
+// of their hash; the partition number comes from the high bits.
+static bool build_table(HashJoinOp* j) {
+  uint32_t n = 0;
+  for (int i = 0; i < JOIN_FANOUT; i++) n += j->parts[i].nrows;
+
+  uint32_t nbuckets = JOIN_MIN_BUCKETS;
+  while (nbuckets < n) nbuckets *= 2;
+  if (nbuckets != j->nbuckets) {
+    free(j->heads);
+    j->heads = malloc(sizeof(uint32_t) * nbuckets);
+    if (!j->heads) {
+      j->nbuckets = 0;
+      return out_of_memory(j->base.ctx);
+    }
+    j->nbuckets = nbuckets;
+  }
+  memset(j->heads, 0, sizeof(uint32_t) * nbuckets);
+  if (n > j->rows_cap) {
+    JoinRow** grown = realloc(j->rows, sizeof(JoinRow*) * n);
+    if (!grown) return out_of_memory(j->base.ctx);
+    j->rows = grown;
+    j->rows_cap = n;
+  }
+
+  uint32_t mask = nbuckets - 1;
+  uint32_t k = 0;
+  for (int i = 0; i < JOIN_FANOUT; i++) {
+    const JoinPartition* p = &j->parts[i];
+    for (uint32_t r = 0; r < p->nrows; r++, k++) {
+      JoinRow* row = p->rows[r];
+      uint32_t* head = &j->heads[row->hash & mask];
+      j->rows[k] = row;
+      row->next = *head;
+      *head = k + 1;
+    }
+  }
+  return true;
+}
+
+static bool build(HashJoinOp* j) {
+  ExecCtx* ctx = j->base.ctx;
+  Batch b;
+  int r;
+  while ((r = j->build_in.f ? spill_reader_next(ctx, &j->build_in, &b)
+                            : exec_reader_next(&j->build_reader, &b)) > 0) {
+    if (j->level == 0) j->stats.build_rows += (uint64_t)b.nsel;
+    if (!build_batch(j, &b)) return false;
+  }
+  if (r < 0) return false;
+  spill_reader_close(&j->build_in);
+  if (!build_table(j)) return false;
+
+  // Without build rows nothing can match, so the probe input is not read.
+  bool any = false;
+  for (int i = 0; i < JOIN_FANOUT; i++) any |= j->parts[i].nrows > 0 || j->parts[i].build;
+  j->probed = !any;
+  j->built = true;
+  return true;
+}
+
+// ============================================================================
+// Probe
+// ============================================================================
+
+static bool key_equal(const HashJoinOp* j, const JoinRow* r, int k, int row) {
+  const ColumnVector* v = j->batch.cols[j->pkeys[k]];
+  RowField bv, pv;
+  row_value(j, r, j->bkeys[k], &bv);
+  if (j->widen[k]) {
+    vector_get(v, row, &pv);
+    return exec_compare(j->base.ctx->bp, &bv, &pv) == 0;
+  }
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: return bv.i32 == v->i32[row];
+    case VAL_I64: return bv.i64 == v->i64[row];
+    case VAL_F64: return bv.f64 == v->f64[row];
+    case VAL_TEXT: break;
+  }
+  if (bv.text_len != v->text_len[row]) return false;
+  vector_get(v, row, &pv);
+  return exec_compare(j->base.ctx->bp, &bv, &pv) == 0;
+}
+
+// Reads the next probe batch. Rows of spilled partitions go to their probe
+// files; the others are looked up in the buckets, and those whose bucket is
+// not empty become the batch's probes.
+static int probe_batch(HashJoinOp* j) {
+  ExecCtx* ctx = j->base.ctx;
+  Batch* b = &j->batch;
+  uint64_t hashes[VECTOR_SIZE];
+  bool null[VECTOR_SIZE];
+
+  while (1) {
+    int r = j->probe_in.f ? spill_reader_next(ctx, &j->probe_in, b)
+                          : exec_reader_next(&j->probe_reader, b);
+    if (r <= 0) return r;
+    if (j->level == 0) j->stats.probe_rows += (uint64_t)b->nsel;
+
+    hash_keys(j, b, j->pkeys, hashes, null);
+    uint32_t mask = j->nbuckets - 1;
+    j->nprobes = 0;
+    for (int i = 0; i < b->nsel; i++) {
+      if (null[i]) continue;
+      int row = b->sel ? b->sel[i] : i;
+      JoinPartition* p = &j->parts[partition_of(j, hashes[i])];
+      if (p->build) {
+        if (!p->probe && !(p->probe = spill_create(ctx))) return -1;
+        if (!spill_write_row(ctx, p->probe, b, row, j->all_cols, j->probe_op->ncols)) return -1;
+        j->stats.spilled_rows++;
+        continue;
+      }
+      uint32_t head = j->heads[hashes[i] & mask];
+      if (head) j->probes[j->nprobes++] = (JoinProbe){ row, hashes[i], head };
+    }
+    j->cur = -1;
+    j->match = 0;
+    if (j->nprobes > 0) return 1;
+  }
+}
+
+static void emit(HashJoinOp* j, const JoinRow* br, int row, Tuple* out) {
+  int nb = j->build_op->ncols;
+  int np = j->probe_op->ncols;
+  RowField* bvals = out->vals + (j->build_left ? 0 : np);
+  RowField* pvals = out->vals + (j->build_left ? nb : 0);
+  row_values(j, br, bvals);
+  for (int c = 0; c < np; c++) vector_get(j->batch.cols[c], row, &pvals[c]);
+  out->ncols = j->base.ncols;
+  out->rid = (RID){ INVALID_PID, 0 };
+}
+
+// Returns the next joined row of the current pass, 0 once its probe input
+// is exhausted.
+static int probe_next(HashJoinOp* j, Tuple* out) {
+  while (!j->probed) {
+    if (j->match) {
+      const JoinProbe* pr = &j->probes[j->cur];
+      const JoinRow* br = j->rows[j->match - 1];
+      j->match = br->next;
+      if (br->hash != pr->hash) continue;
+      int k = 0;
+      while (k < j->nkeys && key_equal(j, br, k, pr->row)) k++;
+      if (k < j->nkeys) continue;
+      emit(j, br, pr->row, out);
+      return 1;
+    }
+    if (j->cur + 1 < j->nprobes) {
+      j->match = j->probes[++j->cur].head;
+      continue;
+    }
+    int r = probe_batch(j);
+    if (r < 0) return -1;
+    if (r == 0) {
+      spill_reader_close(&j->probe_in);
+      j->probed = true;
+    }
+  }
+  return 0;
+}
+
+// ============================================================================
+// Passes
+// ============================================================================
+
+// Queues the spilled partitions of the finished pass. A partition without
+// probe rows has nothing to join.
+static bool queue_spilled(HashJoinOp* j) {
+  for (int i = 0; i < JOIN_FANOUT; i++) {
+    JoinPartition* p = &j->parts[i];
+    if (!p->build) continue;
+    if (!p->probe) {
+      close_partition_files(p);
+      continue;
+    }
+    if (j->npending == j->pending_cap) {
+      int cap = j->pending_cap ? j->pending_cap * 2 : JOIN_FANOUT;
+      JoinPending* grown = realloc(j->pending, sizeof(JoinPending) * (size_t)cap);
+      if (!grown) return out_of_memory(j->base.ctx);
+      j->pending = grown;
+      j->pending_cap = cap;
+    }
+    j->pending[j->npending++] = (JoinPending){ p->build, p->probe, j->level + 1 };
+    p->build = NULL;
+    p->probe = NULL;
+    j->stats.partitions++;
+  }
+  return true;
+}
+
+// Starts a pass over the children, or over a pair of partition files,
+// which the pass takes over.
+static bool start_pass(HashJoinOp* j, const JoinPending* in) {
+  ExecCtx* ctx = j->base.ctx;
+  for (int i = 0; i < JOIN_FANOUT; i++) {
+    free_partition(&j->parts[i]);
+    close_partition_files(&j->parts[i]);
+  }
+  j->mem_used = 0;
+  j->built = false;
+  j->probed = false;
+  j->nprobes = 0;
+  j->cur = -1;
+  j->match = 0;
+  j->level = in ? in->level : 0;
+  if (!in) return true;
+
+  bool ok = spill_reader_open(ctx, &j->build_in, in->build);
+  if (!spill_reader_open(ctx, &j->probe_in, in->probe)) ok = false;
+  return ok;
+}
+
+static void close_files(HashJoinOp* j) {
+  spill_reader_close(&j->build_in);
+  spill_reader_close(&j->probe_in);
+  for (int i = 0; i < JOIN_FANOUT; i++) close_partition_files(&j->parts[i]);
+  for (int i = 0; i < j->npending; i++) {
+    fclose(j->pending[i].build);
+    fclose(j->pending[i].probe);
+  }
+  j->npending = 0;
+}
+
+static bool hash_join_open(Operator* op) {
+  HashJoinOp* j = (HashJoinOp*)op;
+  close_files(j);
+  memset(&j->stats, 0, sizeof(j->stats));
+  exec_reader_init(&j->build_reader, j->build_op);
+  exec_reader_init(&j->probe_reader, j->probe_op);
+  return op->child->open(op->child) && op->right->open(op->right) && start_pass(j, NULL);
+}
+
+static int hash_join_next(Operator* op, Tuple* out) {
+  HashJoinOp* j = (HashJoinOp*)op;
+  while (1) {
+    if (!j->built && !build(j)) return -1;
+    int r = probe_next(j, out);
+    if (r != 0) return r;
+
+    if (!queue_spilled(j)) return -1;
+    if (j->npending == 0) return 0;
+    JoinPending p = j->pending[--j->npending];
+    if (!start_pass(j, &p)) return -1;
+  }
+}
+
+static void hash_join_close(Operator* op) {
+  HashJoinOp* j = (HashJoinOp*)op;
+  op->child->close(op->child);
+  op->right->close(op->right);
+  close_files(j);
+  for (int i = 0; i < JOIN_FANOUT; i++) {
+    free_partition(&j->parts[i]);
+    free(j->parts[i].rows);
+    j->parts[i].rows = NULL;
+    j->parts[i].cap = 0;
+  }
+  free(j->rows);
+  free(j->heads);
+  free(j->pending);
+  j->rows = NULL;
+  j->rows_cap = 0;
+  j->heads = NULL;
+  j->nbuckets = 0;
+  j->pending = NULL;
+  j->pending_cap = 0;
+}
+
+Operator* exec_hash_join(ExecCtx* ctx, Operator* left, Operator* right, const int* lkeys,
+                         const int* rkeys, int nkeys, bool build_left) {
+  HashJoinOp* j = exec_new_op(ctx, sizeof(HashJoinOp), left);
+  if (!j || !join_columns(ctx, &j->base, left, right)) return NULL;
+  j->base.right = right;
+  j->build_left = build_left;
+  j->build_op = build_left ? left : right;
+  j->probe_op = build_left ? right : left;
+  j->nkeys = nkeys;
+  memcpy(j->bkeys, build_left ? lkeys : rkeys, sizeof(int) * (size_t)nkeys);
+  memcpy(j->pkeys, build_left ? rkeys : lkeys, sizeof(int) * (size_t)nkeys);
+  for (int k = 0; k < nkeys; k++) {
+    j->widen[k] = row_value_kind(j->build_op->cols[j->bkeys[k]].type) !=
+                  row_value_kind(j->probe_op->cols[j->pkeys[k]].type);
+  }
+  for (int c = 0; c < EXEC_MAX_COLS; c++) j->all_cols[c] = c;
+  uint32_t off = (uint32_t)(j->build_op->ncols + 7) / 8;
+  for (int c = 0; c < j->build_op->ncols; c++) {
+    off = (off + 3) & ~3u;
+    j->col_off[c] = off;
+    switch (row_value_kind(j->build_op->cols[c].type)) {
+      case VAL_I32: off += 4; break;
+      case VAL_I64:
+      case VAL_F64: off += 8; break;
+      case VAL_TEXT: off += (uint32_t)sizeof(JoinText); break;
+    }
+  }
+  j->fixed_size = (uint32_t)offsetof(JoinRow, data) + off;
+  for (int i = 0; i < JOIN_FANOUT; i++) arena_init(&j->parts[i].mem);
+  spill_reader_init(&j->build_in, j->build_op->cols, j->build_op->ncols, j->all_cols,
+                    j->build_op->ncols);
+  spill_reader_init(&j->probe_in, j->probe_op->cols, j->probe_op->ncols, j->all_cols,
+                    j->probe_op->ncols);
+
+  char on[160];
+  key_list(left, right, lkeys, rkeys, nkeys, on, sizeof(on));
+  j->base.label = exec_label(ctx, "HashJoin on %s (build %s)", on, build_left ? "left" : "right");
+  j->base.open = hash_join_open;
+  j->base.next = hash_join_next;
+  j->base.close = hash_join_close;
+  return &j->base;
+}
+
+void exec_hash_join_stats(const Operator* op, HashJoinStats* out) {
+  *out = ((const HashJoinOp*)op)->stats;
+}
+
+// ============================================================================
+// MergeJoin
+// ============================================================================
+
+typedef struct {
+  Operator base;
+  int lkey;
+  int rkey;
+  Tuple left; ///< Current left row
+  bool has_left;
+  Tuple right; ///< Next right row not yet in a group
+  bool has_right;
+  bool has_group; ///< Whether group holds the right rows of the current key
+  int32_t group_key;
+  RowField* group; ///< Right rows of group_key, right->ncols values each
+  uint32_t ngroup;
+  uint32_t group_cap;
+  uint32_t gpos; ///< Next group row to pair with the left row
+  Arena text; ///< Inline TEXT bytes of the group
+} MergeJoinOp;
+
+// Reads the next row of an input into *t. Returns 1, 0 at the end, or -1.
+static int advance(Operator* in, Tuple* t, bool* has) {
+  int r = in->next(in, t);
+  *has = r > 0;
+  return r;
+}
+
+// Copies the right rows of the current key into the group, leaving the
+// first row of the next key in m->right.
+static int collect_group(MergeJoinOp* m) {
+  Operator* right = m->base.right;
+  int n = right->ncols;
+  m->ngroup = 0;
+  arena_free(&m->text);
+  m->group_key = m->right.vals[m->rkey].i32;
+
+  while (m->has_right && !m->right.vals[m->rkey].is_null &&
+         m->right.vals[m->rkey].i32 == m->group_key) {
+    if (m->ngroup == m->group_cap) {
+      uint32_t cap = m->group_cap ? m->group_cap * 2 : 16;
+      RowField* grown = realloc(m->group, sizeof(RowField) * (size_t)n * cap);
+      if (!grown) {
+        out_of_memory(m->base.ctx);
+        return -1;
+      }
+      m->group = grown;
+      m->group_cap = cap;
+    }
+    RowField* vals = m->group + (size_t)m->ngroup * (size_t)n;
+    memcpy(vals, m->right.vals, sizeof(RowField) * (size_t)n);
+    for (int c = 0; c < n; c++) {
+      RowField* v = &vals[c];
+      if (v->is_null || !row_is_text(v->type) || v->toast_pid != INVALID_PID) continue;
+      uint8_t* copy = arena_alloc(&m->text, v->text_len + 1);
+      if (!copy) {
+        out_of_memory(m->base.ctx);
+        return -1;
+      }
+      memcpy(copy, v->text, v->text_len);
+      v->text = copy;
+    }
+    m->ngroup++;
+    if (advance(right, &m->right, &m->has_right) < 0) return -1;
+  }
+  m->has_group = true;
+  m->gpos = 0;
+  return 1;
+}
+
+static bool merge_join_open(Operator* op) {
+  MergeJoinOp* m = (MergeJoinOp*)op;
+  m->has_group = false;
+  if (!op->child->open(op->child) || !op->right->open(op->right)) return false;
+  return advance(op->child, &m->left, &m->has_left) >= 0 &&
+         advance(op->right, &m->right, &m->has_right) >= 0;
+}
+
+static int merge_join_next(Operator* op, Tuple* out) {
+  MergeJoinOp* m = (MergeJoinOp*)op;
+  Operator* left = op->child;
+  Operator* right = op->right;
+
+  while (1) {
+    if (m->has_group) {
+      if (m->gpos < m->ngroup) {
+        int nl = left->ncols;
+        memcpy(out->vals, m->left.vals, sizeof(RowField) * (size_t)nl);
+        memcpy(out->vals + nl, m->group + (size_t)m->gpos * (size_t)right->ncols,
+               sizeof(RowField) * (size_t)right->ncols);
+        out->ncols = op->ncols;
+        out->rid = (RID){ INVALID_PID, 0 };
+        m->gpos++;
+        return 1;
+      }
+      // The left row has met the whole group; the next one may share its key.
+      if (advance(left, &m->left, &m->has_left) < 0) return -1;
+      m->gpos = 0;
+      const RowField* k = &m->left.vals[m->lkey];
+      if (m->has_left && !k->is_null && k->i32 == m->group_key) continue;
+      m->has_group = false;
+    }
+
+    if (!m->has_left || !m->has_right) return 0;
+    const RowField* lk = &m->left.vals[m->lkey];
+    const RowField* rk = &m->right.vals[m->rkey];
+    int r;
+    if (lk->is_null || (!rk->is_null && lk->i32 < rk->i32)) {
+      r = advance(left, &m->left, &m->has_left);
+    } else if (rk->is_null || lk->i32 > rk->i32) {
+      r = advance(right, &m->right, &m->has_right);
+    } else {
+      r = collect_group(m);
+    }
+    if (r < 0) return -1;
+  }
+}
+
+static void merge_join_close(Operator* op) {
+  MergeJoinOp* m = (MergeJoinOp*)op;
+  op->child->close(op->child);
+  op->right->close(op->right);
+  arena_free(&m->text);
+  free(m->group);
+  m->group = NULL;
+  m->group_cap = 0;
+  m->has_group = false;
+}
+
+Operator* exec_merge_join(ExecCtx* ctx, Operator* left, Operator* right, int lkey, int rkey) {
+  MergeJoinOp* m = exec_new_op(ctx, sizeof(MergeJoinOp), left);
+  if (!m || !join_columns(ctx, &m->base, left, right)) return NULL;
+  m->base.right = right;
+  m->lkey = lkey;
+  m->rkey = rkey;
+  arena_init(&m->text);
+
+  char on[160];
+  key_list(left, right, &lkey, &rkey, 1, on, sizeof(on));
+  m->base.label = exec_label(ctx, "MergeJoin on %s", on);
+  m->base.open = merge_join_open;
+  m->base.next = merge_join_next;
+  m->base.close = merge_join_close;
+  return &m->base;
+}
@@ -0,0 +1,362 @@
+#include "kernels.h"
+#include "catalog.h"
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNELS_X86 1
+#include <immintrin.h>
+#else
+#define KERNELS_X86 0
+#endif
+
+// Number of list values an IN kernel compares one by one; longer lists are
+// binary searched.
+#define IN_LINEAR_MAX 16
+
+static int mask_words(int n) {
+  return (n + 63) / 64;
+}
+
+// ============================================================================
+// Scalar
+// ============================================================================
+
+// The scalar kernels build each 64-bit word in a register from branch-free
+// comparisons, which the compiler is free to vectorize for the baseline ISA.
+
+static void scalar_i32_eq(const int32_t* v, int n, int32_t c, uint64_t* mask) {
+  for (int w = 0; w < mask_words(n); w++) {
+    int base = w * 64;
+    int end = n - base < 64 ? n - base : 64;
+    uint64_t bits = 0;
+    for (int j = 0; j < end; j++) bits |= (uint64_t)(v[base + j] == c) << j;
+    mask[w] = bits;
+  }
+}
+
+// lo <= x <= hi as one unsigned comparison of the distance from lo.
+static void scalar_i32_range(const int32_t* v, int n, int32_t lo, int32_t hi, uint64_t* mask) {
+  if (lo > hi) {
+    memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+    return;
+  }
+  uint32_t span = (uint32_t)hi - (uint32_t)lo;
+  for (int w = 0; w < mask_words(n); w++) {
+    int base = w * 64;
+    int end = n - base < 64 ? n - base : 64;
+    uint64_t bits = 0;
+    for (int j = 0; j < end; j++) {
+      bits |= (uint64_t)((uint32_t)v[base + j] - (uint32_t)lo <= span) << j;
+    }
+    mask[w] = bits;
+  }
+}
+
+static bool in_sorted(const int32_t* list, int nlist, int32_t x) {
+  int lo = 0, hi = nlist;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (list[mid] < x) lo = mid + 1;
+    else hi = mid;
+  }
+  return lo < nlist && list[lo] == x;
+}
+
+// Short lists are compared in full, branch-free; longer ones are binary
+// searched.
+static void scalar_i32_in(const int32_t* v, int n, const int32_t* list, int nlist, uint64_t* mask) {
+  if (nlist > IN_LINEAR_MAX) {
+    memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+    for (int i = 0; i < n; i++) {
+      if (in_sorted(list, nlist, v[i])) mask[i >> 6] |= 1ull << (i & 63);
+    }
+    return;
+  }
+  for (int w = 0; w < mask_words(n); w++) {
+    int base = w * 64;
+    int end = n - base < 64 ? n - base : 64;
+    uint64_t bits = 0;
+    for (int j = 0; j < end; j++) {
+      int32_t x = v[base + j];
+      int hit = 0;
+      for (int k = 0; k < nlist; k++) hit |= x == list[k];
+      bits |= (uint64_t)hit << j;
+    }
+    mask[w] = bits;
+  }
+}
+
+static bool prefix_candidate(const uint32_t* len, const uint32_t* toast_pid, int i,
+                             uint32_t plen, bool exact) {
+  if (toast_pid[i] != INVALID_PID) return false;
+  return exact ? len[i] == plen : len[i] >= plen;
+}
+
+static void scalar_text_prefix(const uint8_t* text, const uint32_t* off, const uint32_t* len,
+                               const uint32_t* toast_pid, int n, const uint8_t* prefix,
+                               uint32_t plen, bool exact, uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  for (int i = 0; i < n; i++) {
+    if (!prefix_candidate(len, toast_pid, i, plen, exact)) continue;
+    if (memcmp(text + off[i], prefix, plen) == 0) mask[i >> 6] |= 1ull << (i & 63);
+  }
+}
+
+static const Kernels scalar_kernels = {
+  .name = "scalar",
+  .i32_eq = scalar_i32_eq,
+  .i32_range = scalar_i32_range,
+  .i32_in = scalar_i32_in,
+  .text_prefix = scalar_text_prefix,
+};
+
+#if KERNELS_X86
+
+// The SIMD kernels compare 4 or 8 values at a time and move the lane
+// results into the mask with movemask; the last n % 4 or n % 8 rows go
+// through the scalar loop. Each function is compiled for its instruction
+// set only, so the rest of the build keeps the baseline ISA and these are
+// only called after the CPU has been checked.
+
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+static void tail_bits(const int32_t* v, int from, int n, uint64_t* mask,
+                      int32_t lo, int32_t hi) {
+  uint32_t span = (uint32_t)hi - (uint32_t)lo;
+  for (int i = from; i < n; i++) {
+    if ((uint32_t)v[i] - (uint32_t)lo <= span) mask[i >> 6] |= 1ull << (i & 63);
+  }
+}
+
+static void tail_in(const int32_t* v, int from, int n, const int32_t* list, int nlist,
+                    uint64_t* mask) {
+  for (int i = from; i < n; i++) {
+    if (in_sorted(list, nlist, v[i])) mask[i >> 6] |= 1ull << (i & 63);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// SSE4.2
+// ----------------------------------------------------------------------------
+
+TARGET_SSE42 static void sse42_i32_range(const int32_t* v, int n, int32_t lo, int32_t hi,
+                                         uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  if (lo > hi) return;
+
+  __m128i lov = _mm_set1_epi32(lo);
+  __m128i span = _mm_set1_epi32((int32_t)((uint32_t)hi - (uint32_t)lo));
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i d = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(v + i)), lov);
+    __m128i in = _mm_cmpeq_epi32(_mm_min_epu32(d, span), d);
+    uint64_t bits = (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(in));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_bits(v, i, n, mask, lo, hi);
+}
+
+TARGET_SSE42 static void sse42_i32_eq(const int32_t* v, int n, int32_t c, uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  __m128i cv = _mm_set1_epi32(c);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(v + i)), cv);
+    uint64_t bits = (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(eq));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_bits(v, i, n, mask, c, c);
+}
+
+TARGET_SSE42 static void sse42_i32_in(const int32_t* v, int n, const int32_t* list, int nlist,
+                                      uint64_t* mask) {
+  if (nlist > IN_LINEAR_MAX) {
+    scalar_i32_in(v, n, list, nlist, mask);
+    return;
+  }
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  __m128i lv[IN_LINEAR_MAX];
+  for (int k = 0; k < nlist; k++) lv[k] = _mm_set1_epi32(list[k]);
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(v + i));
+    __m128i any = _mm_setzero_si128();
+    for (int k = 0; k < nlist; k++) any = _mm_or_si128(any, _mm_cmpeq_epi32(x, lv[k]));
+    uint64_t bits = (uint64_t)_mm_movemask_ps(_mm_castsi128_ps(any));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_in(v, i, n, list, nlist, mask);
+}
+
+// Compares the first plen bytes with PCMPESTRI's equal-each mode: with
+// negative polarity the carry flag is set when any of them differ.
+TARGET_SSE42 static void sse42_text_prefix(const uint8_t* text, const uint32_t* off,
+                                           const uint32_t* len, const uint32_t* toast_pid,
+                                           int n, const uint8_t* prefix, uint32_t plen,
+                                           bool exact, uint64_t* mask) {
+  if (plen > 16) {
+    scalar_text_prefix(text, off, len, toast_pid, n, prefix, plen, exact, mask);
+    return;
+  }
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  uint8_t pad[16] = { 0 };
+  memcpy(pad, prefix, plen);
+  __m128i p = _mm_loadu_si128((const __m128i*)pad);
+  const int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH | _SIDD_NEGATIVE_POLARITY;
+
+  for (int i = 0; i < n; i++) {
+    if (!prefix_candidate(len, toast_pid, i, plen, exact)) continue;
+    __m128i s = _mm_loadu_si128((const __m128i*)(text + off[i]));
+    if (!_mm_cmpestrc(p, (int)plen, s, (int)plen, mode)) mask[i >> 6] |= 1ull << (i & 63);
+  }
+}
+
+static const Kernels sse42_kernels = {
+  .name = "sse4.2",
+  .i32_eq = sse42_i32_eq,
+  .i32_range = sse42_i32_range,
+  .i32_in = sse42_i32_in,
+  .text_prefix = sse42_text_prefix,
+};
+
+// ----------------------------------------------------------------------------
+// AVX2
+// ----------------------------------------------------------------------------
+
+TARGET_AVX2 static void avx2_i32_eq(const int32_t* v, int n, int32_t c, uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  __m256i cv = _mm256_set1_epi32(c);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(v + i)), cv);
+    uint64_t bits = (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_bits(v, i, n, mask, c, c);
+}
+
+TARGET_AVX2 static void avx2_i32_range(const int32_t* v, int n, int32_t lo, int32_t hi,
+                                       uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  if (lo > hi) return;
+
+  __m256i lov = _mm256_set1_epi32(lo);
+  __m256i span = _mm256_set1_epi32((int32_t)((uint32_t)hi - (uint32_t)lo));
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(v + i)), lov);
+    __m256i in = _mm256_cmpeq_epi32(_mm256_min_epu32(d, span), d);
+    uint64_t bits = (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(in));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_bits(v, i, n, mask, lo, hi);
+}
+
+TARGET_AVX2 static void avx2_i32_in(const int32_t* v, int n, const int32_t* list, int nlist,
+                                    uint64_t* mask) {
+  if (nlist > IN_LINEAR_MAX) {
+    scalar_i32_in(v, n, list, nlist, mask);
+    return;
+  }
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  __m256i lv[IN_LINEAR_MAX];
+  for (int k = 0; k < nlist; k++) lv[k] = _mm256_set1_epi32(list[k]);
+
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(v + i));
+    __m256i any = _mm256_setzero_si256();
+    for (int k = 0; k < nlist; k++) any = _mm256_or_si256(any, _mm256_cmpeq_epi32(x, lv[k]));
+    uint64_t bits = (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(any));
+    mask[i >> 6] |= bits << (i & 63);
+  }
+  tail_in(v, i, n, list, nlist, mask);
+}
+
+// Compares up to 32 bytes at once; longer prefixes check the rest with memcmp.
+TARGET_AVX2 static void avx2_text_prefix(const uint8_t* text, const uint32_t* off,
+                                         const uint32_t* len, const uint32_t* toast_pid,
+                                         int n, const uint8_t* prefix, uint32_t plen,
+                                         bool exact, uint64_t* mask) {
+  memset(mask, 0, sizeof(uint64_t) * (size_t)mask_words(n));
+  uint32_t head = plen < 32 ? plen : 32;
+  uint8_t pad[32] = { 0 };
+  memcpy(pad, prefix, head);
+  __m256i p = _mm256_loadu_si256((const __m256i*)pad);
+  uint32_t want = head == 32 ? 0xFFFFFFFFu : (1u << head) - 1;
+
+  for (int i = 0; i < n; i++) {
+    if (!prefix_candidate(len, toast_pid, i, plen, exact)) continue;
+    const uint8_t* s = text + off[i];
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)s), p);
+    if (((uint32_t)_mm256_movemask_epi8(eq) & want) != want) continue;
+    if (plen > 32 && memcmp(s + 32, prefix + 32, plen - 32) != 0) continue;
+    mask[i >> 6] |= 1ull << (i & 63);
+  }
+}
+
+static const Kernels avx2_kernels = {
+  .name = "avx2",
+  .i32_eq = avx2_i32_eq,
+  .i32_range = avx2_i32_range,
+  .i32_in = avx2_i32_in,
+  .text_prefix = avx2_text_prefix,
+};
+
+#endif
+
+// ============================================================================
+// Dispatch
+// ============================================================================
+
+const Kernels* kernels_for(KernelIsa isa) {
+  switch (isa) {
+    case KERNEL_SCALAR:
+      return &scalar_kernels;
+#if KERNELS_X86
+    case KERNEL_SSE42:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2") ? &sse42_kernels : NULL;
+    case KERNEL_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") ? &avx2_kernels : NULL;
+#endif
+    default:
+      return NULL;
+  }
+}
+
+const Kernels* kernels_best(void) {
+  const Kernels* k = kernels_for(KERNEL_AVX2);
+  if (!k) k = kernels_for(KERNEL_SSE42);
+  return k ? k : &scalar_kernels;
+}
+
+// ============================================================================
+// Masks and selection vectors
+// ============================================================================
+
+int kernel_mask_to_sel(const uint64_t* mask, int n, uint16_t* out) {
+  int k = 0;
+  for (int w = 0; w < mask_words(n); w++) {
+    uint64_t bits = mask[w];
+    if (n - w * 64 < 64) bits &= (1ull << (n - w * 64)) - 1;
+    while (bits) {
+      out[k++] = (uint16_t)(w * 64 + __builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+  return k;
+}
+
+int kernel_mask_select(const uint64_t* mask, const uint16_t* sel, int n, uint16_t* out) {
+  int k = 0;
+  for (int i = 0; i < n; i++) {
+    uint16_t r = sel[i];
+    out[k] = r;
+    k += (int)((mask[r >> 6] >> (r & 63)) & 1u);
+  }
+  return k;
+}
@@ -0,0 +1,103 @@
+#include "lexer.h"
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+void lexer_init(Lexer* lx, const char* src) {
+  lx->pos = src;
+}
+
+static Token make(TokenType type, const char* start, const char* end) {
+  Token t = { .type = type, .start = start, .len = (int)(end - start) };
+  return t;
+}
+
+Token lexer_next(Lexer* lx) {
+  const char* p = lx->pos;
+  while (*p && isspace((unsigned char)*p)) p++;
+  const char* start = p;
+
+  if (*p == 0) {
+    lx->pos = p;
+    return make(TOK_EOF, p, p);
+  }
+
+  if (isalpha((unsigned char)*p) || *p == '_') {
+    while (isalnum((unsigned char)*p) || *p == '_') p++;
+    lx->pos = p;
+    return make(TOK_IDENT, start, p);
+  }
+
+  if (isdigit((unsigned char)*p)) {
+    TokenType type = TOK_INT;
+    while (isdigit((unsigned char)*p)) p++;
+    if (*p == '.' && isdigit((unsigned char)p[1])) {
+      type = TOK_FLOAT;
+      for (p++; isdigit((unsigned char)*p); p++) {}
+    }
+    if (*p == 'e' || *p == 'E') {
+      const char* e = p + 1;
+      if (*e == '+' || *e == '-') e++;
+      if (isdigit((unsigned char)*e)) {
+        type = TOK_FLOAT;
+        for (p = e; isdigit((unsigned char)*p); p++) {}
+      }
+    }
+    lx->pos = p;
+    return make(type, start, p);
+  }
+
+  if (*p == '\'' || *p == '"') {
+    char q = *p++;
+    while (*p) {
+      if (*p == q && p[1] == q) {
+        p += 2;
+      } else if (*p == q) {
+        lx->pos = p + 1;
+        return make(TOK_STRING, start, p + 1);
+      } else {
+        p++;
+      }
+    }
+    lx->pos = p;
+    return make(TOK_ERROR, start, p);
+  }
+
+  TokenType type;
+  int n = 1;
+  switch (*p) {
+    case '(': type = TOK_LPAREN; break;
+    case ')': type = TOK_RPAREN; break;
+    case ',': type = TOK_COMMA; break;
+    case ';': type = TOK_SEMI; break;
+    case '*': type = TOK_STAR; break;
+    case '.': type = TOK_DOT; break;
+    case '-': type = TOK_MINUS; break;
+    case '?': type = TOK_PARAM; break;
+    case '=': type = TOK_EQ; break;
+    case '<':
+      if (p[1] == '=') { type = TOK_LE; n = 2; }
+      else if (p[1] == '>') { type = TOK_NE; n = 2; }
+      else type = TOK_LT;
+      break;
+    case '>':
+      if (p[1] == '=') { type = TOK_GE; n = 2; }
+      else type = TOK_GT;
+      break;
+    case '!':
+      if (p[1] == '=') { type = TOK_NE; n = 2; }
+      else type = TOK_ERROR;
+      break;
+    default:
+      type = TOK_ERROR;
+      break;
+  }
+
+  lx->pos = p + n;
+  return make(type, start, p + n);
+}
+
+bool token_is(const Token* t, const char* keyword) {
+  return t->type == TOK_IDENT && (size_t)t->len == strlen(keyword) &&
+         strncasecmp(t->start, keyword, (size_t)t->len) == 0;
+}
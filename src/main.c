@@ -1,13 +1,35 @@
 #include "sql.h"
+#include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 int main() {
   DiskManager* dm = disk_open("test.db");
+  if (!dm) {
+    fprintf(stderr, "Cannot open test.db: %s\n", strerror(errno));
+    return 1;
+  }
+
+  LogManager* lm = wal_open("test.db.wal");
+  if (!lm) {
+    fprintf(stderr, "Cannot open test.db.wal: %s\n", strerror(errno));
+    disk_close(dm);
+    return 1;
+  }
+
   BufferPool* bp = bp_create(dm, 32);
+  if (!bp || !bp_attach_wal(bp, lm)) {
+    fprintf(stderr, "Cannot reserve memory for the buffer pool.\n");
+    if (bp) bp_destroy(bp);
+    wal_close(lm);
+    disk_close(dm);
+    return 1;
+  }
 
   repl(bp);
 
   bp_destroy(bp);
+  wal_close(lm);
   disk_close(dm);
   
   return 0;
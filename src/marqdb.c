@@ -0,0 +1,627 @@
+#include "marqdb.h"
+#include "lexer.h"
+#include "planner.h"
+#include "sql.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A value bound to a placeholder. Text is owned here, and the placeholder's
+// literal points at it.
+typedef struct {
+  int type; ///< MDB_NULL, MDB_INT, MDB_FLOAT or MDB_TEXT
+  int64_t i64; ///< Value of an integer
+  char* text; ///< Text, or a number written out
+  uint32_t len; ///< Length of text in bytes
+  uint32_t cap; ///< Capacity of text
+  bool changed; ///< Whether the plan has yet to see this value
+} BoundValue;
+
+// Text of a column handed out by mdb_column_text.
+typedef struct {
+  char* buf; ///< NUL-terminated text
+  uint32_t cap; ///< Capacity of buf
+} ColumnText;
+
+struct MdbStmt {
+  Mdb* db;
+  char* sql; ///< Text as prepared, for planning it again
+  char* key; ///< Normalized text, or NULL if the statement is not cacheable
+  uint64_t hash; ///< Hash of key
+  Arena arena; ///< Owner of the statement and its plan
+  Arena scratch; ///< Allocations of one run of a statement planned as it runs
+  ExecCtx ctx; ///< Statement state
+  Stmt* st; ///< Parsed statement
+  Operator* plan; ///< Plan of a SELECT, NULL for other statements
+  PlanParam* params; ///< Where the plan reads each placeholder, NULL for other statements
+  int nparams; ///< Number of placeholders
+  BoundValue* binds; ///< Values of the placeholders
+  bool running; ///< Whether the plan is open part way through its rows
+  bool has_row; ///< Whether row holds the current row
+  int changes; ///< Rows changed by the last run
+  Tuple row; ///< Current row of a SELECT
+  ColumnText text[EXEC_MAX_COLS]; ///< Text handed out for the current row
+  MdbStmt* prev; ///< Newer entry of the plan cache
+  MdbStmt* next; ///< Older entry of the plan cache
+};
+
+struct Mdb {
+  DiskManager* dm; ///< Database file
+  LogManager* lm; ///< Write-ahead log
+  BufferPool* bp; ///< Buffer pool over the file
+  Catalog cat; ///< Open catalog
+  char err[256]; ///< Message describing the last failure
+  int cache_cap; ///< Most statements kept in the plan cache
+  int ncached; ///< Statements in the plan cache
+  MdbStmt* mru; ///< Most recently finalized cached statement
+  MdbStmt* lru; ///< Least recently finalized cached statement
+  MdbCacheStats stats; ///< Plan cache counters
+};
+
+// Why the calling thread's last mdb_open failed, as there is no handle to
+// keep it in.
+static _Thread_local char open_err[256];
+
+static void set_error(Mdb* db, const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(db->err, sizeof(db->err), fmt, ap);
+  va_end(ap);
+}
+
+// ============================================================================
+// Database handle
+// ============================================================================
+
+int mdb_open(const char* path, Mdb** out) {
+  *out = NULL;
+  open_err[0] = 0;
+  Mdb* db = calloc(1, sizeof(Mdb));
+  size_t n = strlen(path);
+  char* wal_path = malloc(n + 5);
+  if (!db || !wal_path) {
+    free(db);
+    free(wal_path);
+    snprintf(open_err, sizeof(open_err), "Out of memory.");
+    return MDB_ERROR;
+  }
+  db->cache_cap = MDB_PLAN_CACHE_DEFAULT;
+  memcpy(wal_path, path, n);
+  memcpy(wal_path + n, ".wal", 5);
+
+  if (!(db->dm = disk_open(path))) {
+    snprintf(open_err, sizeof(open_err), "Cannot open '%s': %s.", path, strerror(errno));
+  } else if (!(db->lm = wal_open(wal_path))) {
+    snprintf(open_err, sizeof(open_err), "Cannot open '%s': %s.", wal_path, strerror(errno));
+  } else if (!(db->bp = bp_create(db->dm, MDB_POOL_FRAMES)) || !bp_attach_wal(db->bp, db->lm)) {
+    snprintf(open_err, sizeof(open_err), "Cannot reserve memory for the buffer pool.");
+  } else {
+    db->cat = catalog_open(db->bp);
+    if (db->cat.catalog_heap_header_pid != INVALID_PID) {
+      free(wal_path);
+      *out = db;
+      return MDB_OK;
+    }
+    catalog_close(&db->cat);
+    snprintf(open_err, sizeof(open_err), "Cannot open the catalog of '%s'.", path);
+  }
+  free(wal_path);
+  if (db->bp) bp_destroy(db->bp);
+  if (db->lm) wal_close(db->lm);
+  if (db->dm) disk_close(db->dm);
+  free(db);
+  return MDB_ERROR;
+}
+
+static void stmt_free(MdbStmt* s);
+
+void mdb_close(Mdb* db) {
+  if (!db) return;
+  while (db->mru) {
+    MdbStmt* s = db->mru;
+    db->mru = s->next;
+    stmt_free(s);
+  }
+  catalog_close(&db->cat);
+  bp_destroy(db->bp);
+  wal_close(db->lm);
+  disk_close(db->dm);
+  free(db);
+}
+
+const char* mdb_errmsg(const Mdb* db) {
+  return db ? db->err : open_err;
+}
+
+// ============================================================================
+// Plan cache
+// ============================================================================
+
+// Rewrites a statement as its tokens separated by single spaces, without a
+// trailing semicolon, so texts that differ only in layout share an entry.
+// Letter case is kept: table names are case-sensitive. Returns NULL for
+// text the lexer rejects, which is never cached.
+static char* normalize(const char* sql) {
+  char* out = malloc(2 * strlen(sql) + 1);
+  if (!out) return NULL;
+
+  Lexer lx;
+  lexer_init(&lx, sql);
+  size_t w = 0;
+  Token t = lexer_next(&lx);
+  while (t.type != TOK_EOF) {
+    Token next = lexer_next(&lx);
+    if (t.type == TOK_ERROR) {
+      free(out);
+      return NULL;
+    }
+    if (t.type != TOK_SEMI || next.type != TOK_EOF) {
+      if (w) out[w++] = ' ';
+      memcpy(out + w, t.start, (size_t)t.len);
+      w += (size_t)t.len;
+    }
+    t = next;
+  }
+  out[w] = 0;
+  return out;
+}
+
+static uint64_t key_hash(const char* key) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (const char* p = key; *p; p++) h = (h ^ (uint8_t)*p) * 0x100000001b3ull;
+  return h;
+}
+
+static void cache_unlink(Mdb* db, MdbStmt* s) {
+  if (s->prev) s->prev->next = s->next;
+  else db->mru = s->next;
+  if (s->next) s->next->prev = s->prev;
+  else db->lru = s->prev;
+  s->prev = s->next = NULL;
+  db->ncached--;
+}
+
+// Takes a cached statement with the given key out of the cache.
+static MdbStmt* cache_take(Mdb* db, const char* key, uint64_t hash) {
+  for (MdbStmt* s = db->mru; s; s = s->next) {
+    if (s->hash == hash && strcmp(s->key, key) == 0) {
+      cache_unlink(db, s);
+      return s;
+    }
+  }
+  return NULL;
+}
+
+static void cache_trim(Mdb* db) {
+  while (db->ncached > db->cache_cap) {
+    MdbStmt* s = db->lru;
+    cache_unlink(db, s);
+    stmt_free(s);
+    db->stats.evictions++;
+  }
+}
+
+// Keeps a finalized statement as the most recent entry. A second copy of a
+// statement already cached is freed instead.
+static void cache_put(Mdb* db, MdbStmt* s) {
+  for (MdbStmt* c = db->mru; c; c = c->next) {
+    if (c->hash == s->hash && strcmp(c->key, s->key) == 0) {
+      stmt_free(s);
+      return;
+    }
+  }
+  s->prev = NULL;
+  s->next = db->mru;
+  if (db->mru) db->mru->prev = s;
+  else db->lru = s;
+  db->mru = s;
+  db->ncached++;
+  cache_trim(db);
+}
+
+void mdb_set_cache_size(Mdb* db, int n) {
+  db->cache_cap = n > 0 ? n : 0;
+  cache_trim(db);
+}
+
+void mdb_cache_stats(const Mdb* db, MdbCacheStats* out) {
+  *out = db->stats;
+  out->entries = db->ncached;
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+static void stmt_free(MdbStmt* s) {
+  if (s->running) s->plan->close(s->plan);
+  if (s->binds) {
+    for (int i = 0; i < s->nparams; i++) free(s->binds[i].text);
+    free(s->binds);
+  }
+  for (int i = 0; i < EXEC_MAX_COLS; i++) free(s->text[i].buf);
+  arena_free(&s->arena);
+  arena_free(&s->scratch);
+  free(s->sql);
+  free(s->key);
+  free(s);
+}
+
+// Points a placeholder's literal at its bound value.
+static void apply_bind(MdbStmt* s, int i) {
+  BoundValue* v = &s->binds[i];
+  Literal* lit = s->st->params[i];
+  switch (v->type) {
+    case MDB_INT: lit->kind = LIT_INT; break;
+    case MDB_FLOAT: lit->kind = LIT_FLOAT; break;
+    case MDB_TEXT: lit->kind = LIT_TEXT; break;
+    default: lit->kind = LIT_NULL; break;
+  }
+  lit->i64 = v->i64;
+  lit->text = v->text;
+  lit->len = v->len;
+  v->changed = true;
+}
+
+// Parses the statement and plans a SELECT. Placeholders keep their bound
+// values, so this can run again when the plan goes stale.
+static bool stmt_plan(MdbStmt* s) {
+  Mdb* db = s->db;
+  arena_free(&s->arena);
+  s->ctx = (ExecCtx){ .bp = db->bp, .cat = &db->cat, .arena = &s->arena, .quiet = true };
+  s->plan = NULL;
+  s->params = NULL;
+
+  s->st = parse_statement(&s->arena, s->sql, s->ctx.err, sizeof(s->ctx.err));
+  if (!s->st) {
+    set_error(db, "%s", s->ctx.err);
+    return false;
+  }
+  if (s->st->explain) {
+    set_error(db, "EXPLAIN is not supported through the library.");
+    return false;
+  }
+
+  if (!s->binds) {
+    s->binds = calloc((size_t)s->st->nparams + 1, sizeof(BoundValue));
+    if (!s->binds) {
+      set_error(db, "Out of memory.");
+      return false;
+    }
+    s->nparams = s->st->nparams;
+  }
+  for (int i = 0; i < s->nparams; i++) apply_bind(s, i);
+
+  if (s->st->kind == STMT_SELECT) {
+    s->plan = plan_select(&s->ctx, &s->st->select);
+    s->params = s->plan ? arena_alloc(&s->arena, sizeof(PlanParam) * (size_t)(s->nparams + 1)) : NULL;
+    if (!s->params) {
+      set_error(db, "%s", s->plan ? "Out of memory." : s->ctx.err);
+      s->plan = NULL;
+      return false;
+    }
+    // Planning bound every value as it stands.
+    plan_params(&s->st->select, s->params);
+    for (int i = 0; i < s->nparams; i++) s->binds[i].changed = false;
+  }
+  return true;
+}
+
+int mdb_prepare(Mdb* db, const char* sql, MdbStmt** out) {
+  *out = NULL;
+  char* key = normalize(sql);
+  uint64_t hash = key ? key_hash(key) : 0;
+
+  MdbStmt* s = key ? cache_take(db, key, hash) : NULL;
+  if (s) {
+    free(key);
+    db->stats.hits++;
+    for (int i = 0; i < s->nparams; i++) mdb_bind_null(s, i + 1);
+    s->changes = 0;
+    *out = s;
+    return MDB_OK;
+  }
+  db->stats.misses++;
+
+  s = calloc(1, sizeof(MdbStmt));
+  if (!s || !(s->sql = strdup(sql))) {
+    free(s);
+    free(key);
+    set_error(db, "Out of memory.");
+    return MDB_ERROR;
+  }
+  s->db = db;
+  s->key = key;
+  s->hash = hash;
+  arena_init(&s->arena);
+  arena_init(&s->scratch);
+  if (!stmt_plan(s)) {
+    stmt_free(s);
+    return MDB_ERROR;
+  }
+  *out = s;
+  return MDB_OK;
+}
+
+int mdb_bind_count(const MdbStmt* s) {
+  return s->nparams;
+}
+
+static BoundValue* bind_slot(MdbStmt* s, int i) {
+  if (i < 1 || i > s->nparams) return NULL;
+  mdb_reset(s);
+  return &s->binds[i - 1];
+}
+
+static bool bind_reserve(BoundValue* v, uint32_t n) {
+  if (n + 1 <= v->cap) return true;
+  uint32_t cap = v->cap ? v->cap : 16;
+  while (cap < n + 1) cap *= 2;
+  char* grown = realloc(v->text, cap);
+  if (!grown) return false;
+  v->text = grown;
+  v->cap = cap;
+  return true;
+}
+
+int mdb_bind_int(MdbStmt* s, int i, int32_t x) {
+  return mdb_bind_int64(s, i, x);
+}
+
+int mdb_bind_int64(MdbStmt* s, int i, int64_t x) {
+  BoundValue* v = bind_slot(s, i);
+  if (!v) return MDB_RANGE;
+  if (!bind_reserve(v, 20)) {
+    set_error(s->db, "Out of memory.");
+    return MDB_ERROR;
+  }
+  v->type = MDB_INT;
+  v->i64 = x;
+  v->len = (uint32_t)snprintf(v->text, v->cap, "%lld", (long long)x);
+  apply_bind(s, i - 1);
+  return MDB_OK;
+}
+
+int mdb_bind_double(MdbStmt* s, int i, double x) {
+  BoundValue* v = bind_slot(s, i);
+  if (!v) return MDB_RANGE;
+  if (!bind_reserve(v, 32)) {
+    set_error(s->db, "Out of memory.");
+    return MDB_ERROR;
+  }
+  // Written with enough digits to read back as the same double.
+  v->type = MDB_FLOAT;
+  v->len = (uint32_t)snprintf(v->text, v->cap, "%.17g", x);
+  apply_bind(s, i - 1);
+  return MDB_OK;
+}
+
+int mdb_bind_text(MdbStmt* s, int i, const char* text, int len) {
+  BoundValue* v = bind_slot(s, i);
+  if (!v) return MDB_RANGE;
+  uint32_t n = len < 0 ? (uint32_t)strlen(text) : (uint32_t)len;
+  if (!bind_reserve(v, n)) {
+    set_error(s->db, "Out of memory.");
+    return MDB_ERROR;
+  }
+  v->type = MDB_TEXT;
+  memcpy(v->text, text, n);
+  v->text[n] = 0;
+  v->len = n;
+  apply_bind(s, i - 1);
+  return MDB_OK;
+}
+
+int mdb_bind_null(MdbStmt* s, int i) {
+  BoundValue* v = bind_slot(s, i);
+  if (!v) return MDB_RANGE;
+  v->type = MDB_NULL;
+  apply_bind(s, i - 1);
+  return MDB_OK;
+}
+
+// Opens a SELECT's plan for a run, planning it again if a table it reads
+// gained or lost an index since. Values bound since the last run are
+// converted into the plan; the rest are already there.
+static int select_start(MdbStmt* s) {
+  s->ctx.err[0] = 0;
+  if ((!s->plan || !plan_refresh(&s->ctx)) && !stmt_plan(s)) return MDB_ERROR;
+  bool ok = true;
+  for (int i = 0; ok && i < s->nparams; i++) {
+    if (!s->binds[i].changed) continue;
+    ok = plan_bind_param(&s->ctx, &s->params[i]);
+    s->binds[i].changed = !ok;
+  }
+  if (!ok || !s->plan->open(s->plan)) {
+    s->plan->close(s->plan);
+    set_error(s->db, "%s", s->ctx.err);
+    return MDB_ERROR;
+  }
+  s->running = true;
+  return MDB_OK;
+}
+
+// Runs a statement other than a SELECT. These are planned as they run, from
+// an arena emptied every time, so a run costs no more than the last one.
+static int run_statement(MdbStmt* s) {
+  ExecCtx* ctx = &s->ctx;
+  Stmt* st = s->st;
+  arena_free(&s->scratch);
+  ctx->arena = &s->scratch;
+  ctx->ntables = 0;
+  ctx->err[0] = 0;
+
+  sql_statement_begin(ctx->bp);
+  int r = 0;
+  switch (st->kind) {
+    case STMT_CREATE_TABLE: sql_exec_create_table(ctx, &st->create_table); break;
+    case STMT_CREATE_INDEX: sql_exec_create_index(ctx, &st->create_index); break;
+    case STMT_INSERT: r = sql_exec_insert(ctx, &st->insert); break;
+    case STMT_COPY: r = sql_exec_copy(ctx, &st->copy); break;
+    case STMT_UPDATE: r = sql_exec_update(ctx, &st->update); break;
+    case STMT_DELETE: r = sql_exec_delete(ctx, &st->del); break;
+    case STMT_VACUUM: sql_exec_vacuum(ctx, &st->vacuum); break;
+    default: break;
+  }
+  // A statement that failed already says why; otherwise a failed commit does.
+  char err[sizeof(ctx->err)];
+  if (!sql_statement_end(ctx->bp, err, sizeof(err)) && !ctx->err[0]) {
+    snprintf(ctx->err, sizeof(ctx->err), "%s", err);
+  }
+
+  ctx->arena = &s->arena;
+  s->changes = st->kind == STMT_COPY || r < 0 ? 0 : r;
+  if (ctx->err[0]) {
+    set_error(s->db, "%s", ctx->err);
+    return MDB_ERROR;
+  }
+  return MDB_DONE;
+}
+
+int mdb_step(MdbStmt* s) {
+  s->has_row = false;
+  if (s->st->kind != STMT_SELECT) return run_statement(s);
+
+  if (!s->running && select_start(s) != MDB_OK) return MDB_ERROR;
+  int r = s->plan->next(s->plan, &s->row);
+  if (r > 0) {
+    s->has_row = true;
+    return MDB_ROW;
+  }
+
+  s->plan->close(s->plan);
+  s->running = false;
+  if (r < 0) {
+    set_error(s->db, "%s", s->ctx.err);
+    return MDB_ERROR;
+  }
+  return MDB_DONE;
+}
+
+void mdb_reset(MdbStmt* s) {
+  if (s->running) s->plan->close(s->plan);
+  s->running = false;
+  s->has_row = false;
+}
+
+int mdb_changes(const MdbStmt* s) {
+  return s->changes;
+}
+
+int mdb_finalize(MdbStmt* s) {
+  if (!s) return MDB_OK;
+  mdb_reset(s);
+  Mdb* db = s->db;
+  if (s->key && db->cache_cap > 0) cache_put(db, s);
+  else stmt_free(s);
+  return MDB_OK;
+}
+
+int mdb_exec(Mdb* db, const char* sql) {
+  MdbStmt* s;
+  if (mdb_prepare(db, sql, &s) != MDB_OK) return MDB_ERROR;
+  int r;
+  while ((r = mdb_step(s)) == MDB_ROW) {}
+  mdb_finalize(s);
+  return r == MDB_DONE ? MDB_OK : MDB_ERROR;
+}
+
+// ============================================================================
+// Columns
+// ============================================================================
+
+int mdb_column_count(const MdbStmt* s) {
+  return s->plan ? s->plan->ncols : 0;
+}
+
+const char* mdb_column_name(const MdbStmt* s, int i) {
+  if (i < 0 || i >= mdb_column_count(s)) return NULL;
+  return s->plan->cols[i].name;
+}
+
+static const RowField* column(const MdbStmt* s, int i) {
+  if (!s->has_row || i < 0 || i >= s->row.ncols) return NULL;
+  return &s->row.vals[i];
+}
+
+int mdb_column_type(const MdbStmt* s, int i) {
+  const RowField* v = column(s, i);
+  if (!v || v->is_null) return MDB_NULL;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32:
+    case VAL_I64: return MDB_INT;
+    case VAL_F64: return MDB_FLOAT;
+    default: return MDB_TEXT;
+  }
+}
+
+int64_t mdb_column_int64(const MdbStmt* s, int i) {
+  const RowField* v = column(s, i);
+  if (!v || v->is_null) return 0;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: return v->i32;
+    case VAL_I64: return v->i64;
+    case VAL_F64: return (int64_t)v->f64;
+    case VAL_TEXT: break;
+  }
+
+  char buf[24];
+  uint32_t n = row_field_text(s->db->bp, v, (uint8_t*)buf, sizeof(buf) - 1);
+  buf[n] = 0;
+  return strtoll(buf, NULL, 10);
+}
+
+int32_t mdb_column_int(const MdbStmt* s, int i) {
+  return (int32_t)mdb_column_int64(s, i);
+}
+
+double mdb_column_double(const MdbStmt* s, int i) {
+  const RowField* v = column(s, i);
+  if (!v || v->is_null) return 0;
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: return v->i32;
+    case VAL_I64: return (double)v->i64;
+    case VAL_F64: return v->f64;
+    case VAL_TEXT: break;
+  }
+
+  char buf[64];
+  uint32_t n = row_field_text(s->db->bp, v, (uint8_t*)buf, sizeof(buf) - 1);
+  buf[n] = 0;
+  return strtod(buf, NULL);
+}
+
+const char* mdb_column_text(MdbStmt* s, int i) {
+  const RowField* v = column(s, i);
+  if (!v || v->is_null) return NULL;
+
+  ColumnText* c = &s->text[i];
+  bool text = row_is_text(v->type);
+  uint32_t need = text ? v->text_len + 1 : 40;
+  if (need > c->cap) {
+    uint32_t cap = c->cap ? c->cap : 32;
+    while (cap < need) cap *= 2;
+    char* grown = realloc(c->buf, cap);
+    if (!grown) return NULL;
+    c->buf = grown;
+    c->cap = cap;
+  }
+
+  if (!text) {
+    row_format_value(v, c->buf, c->cap);
+  } else {
+    uint32_t n = row_field_text(s->db->bp, v, (uint8_t*)c->buf, v->text_len);
+    c->buf[n] = 0;
+  }
+  return c->buf;
+}
+
+int mdb_column_bytes(MdbStmt* s, int i) {
+  const RowField* v = column(s, i);
+  if (!v || v->is_null) return 0;
+  if (row_is_text(v->type)) return (int)v->text_len;
+  const char* t = mdb_column_text(s, i);
+  return t ? (int)strlen(t) : 0;
+}
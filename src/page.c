@@ -16,26 +16,90 @@ void page_init(Page* p, uint32_t page_id) {
   p->hdr.next_page_id = 0xFFFFFFFF;
 }
 
+// Bytes between the end of the records and the start of the slot directory.
+static uint16_t contiguous_free(const Page* p) {
+  return (uint16_t)(p->hdr.free_end - p->hdr.free_start);
+}
+
 bool page_has_space(Page* p, uint16_t record_len) {
   uint16_t needed = record_len + sizeof(Slot);
-  return (p->hdr.free_start + needed) <= p->hdr.free_end;
+  return needed <= page_free_space(p);
+}
+
+uint16_t page_free_space(Page* p) {
+  return (uint16_t)(contiguous_free(p) + p->hdr.frag_bytes);
+}
+
+// Returns a deleted slot to reuse, or -1. The flag is cleared once a search
+// comes up empty so that pages without tombstones never pay for the scan.
+static int find_free_slot(Page* p) {
+  if (!(p->hdr.flags & PAGE_FREE_SLOTS)) return -1;
+
+  for (int i = 0; i < p->hdr.slot_count; i++) {
+    if (slot_at(p, i)->deleted) return i;
+  }
+  p->hdr.flags &= ~PAGE_FREE_SLOTS;
+  return -1;
+}
+
+void page_compact(Page* p) {
+  uint8_t tmp[sizeof(p->data)];
+  uint16_t used = 0;
+  bool has_free = false;
+
+  for (int i = 0; i < p->hdr.slot_count; i++) {
+    Slot* s = slot_at(p, i);
+    if (s->deleted) {
+      s->offset = 0;
+      s->len = 0;
+      has_free = true;
+      continue;
+    }
+    memcpy(tmp + used, p->data + s->offset, s->len);
+    s->offset = used;
+    used += s->len;
+  }
+  memcpy(p->data, tmp, used);
+
+  while (p->hdr.slot_count > 0 && slot_at(p, p->hdr.slot_count - 1)->deleted) {
+    p->hdr.slot_count--;
+    p->hdr.free_end += sizeof(Slot);
+  }
+  if (p->hdr.slot_count == 0) has_free = false;
+
+  p->hdr.free_start = used;
+  p->hdr.frag_bytes = 0;
+  if (has_free) p->hdr.flags |= PAGE_FREE_SLOTS;
+  else p->hdr.flags &= ~PAGE_FREE_SLOTS;
 }
 
 int page_insert(Page* p, const uint8_t* rec, uint16_t len) {
-  if (!page_has_space(p, len)) return -1;
+  int slot = find_free_slot(p);
+  uint16_t needed = (uint16_t)(len + (slot < 0 ? sizeof(Slot) : 0));
+
+  if (contiguous_free(p) < needed) {
+    if (page_free_space(p) < needed) return -1;
+    page_compact(p);
+    slot = find_free_slot(p);
+    needed = (uint16_t)(len + (slot < 0 ? sizeof(Slot) : 0));
+    if (contiguous_free(p) < needed) return -1;
+  }
 
   uint16_t off = p->hdr.free_start;
   memcpy(p->data + off, rec, len);
   p->hdr.free_start += len;
 
-  p->hdr.free_end -= sizeof(Slot);
-  Slot* s = (Slot*)(p->data + p->hdr.free_end);
+  if (slot < 0) {
+    p->hdr.free_end -= sizeof(Slot);
+    slot = p->hdr.slot_count++;
+  }
+  Slot* s = slot_at(p, slot);
 
   s->offset = off;
   s->len = len;
   s->deleted = 0;
 
-  return p->hdr.slot_count++;
+  return slot;
 }
 
 bool page_get(Page* p, int slot_id, uint8_t** out, uint16_t* len) {
@@ -53,6 +117,38 @@ bool page_get(Page* p, int slot_id, uint8_t** out, uint16_t* len) {
 bool page_delete(Page* p, int slot_id) {
   if (slot_id < 0 || slot_id >= p->hdr.slot_count) return false;
   Slot* s = slot_at(p, slot_id);
+  if (s->deleted) return false;
   s->deleted = 1;
+  p->hdr.frag_bytes += s->len;
+  p->hdr.flags |= PAGE_FREE_SLOTS;
+  return true;
+}
+
+bool page_update(Page* p, int slot_id, const uint8_t* rec, uint16_t len) {
+  if (slot_id < 0 || slot_id >= p->hdr.slot_count) return false;
+  Slot* s = slot_at(p, slot_id);
+  if (s->deleted) return false;
+
+  if (len <= s->len) {
+    memcpy(p->data + s->offset, rec, len);
+    p->hdr.frag_bytes += s->len - len;
+    s->len = len;
+    return true;
+  }
+
+  if (contiguous_free(p) < len) {
+    if (page_free_space(p) + s->len < len) return false;
+    // Give up the old copy first so compaction reclaims it too.
+    p->hdr.frag_bytes += s->len;
+    s->len = 0;
+    page_compact(p);
+  } else {
+    p->hdr.frag_bytes += s->len;
+  }
+
+  s->offset = p->hdr.free_start;
+  s->len = len;
+  memcpy(p->data + s->offset, rec, len);
+  p->hdr.free_start += len;
   return true;
 }
@@ -0,0 +1,740 @@
+#include "parser.h"
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+
+typedef struct {
+  Lexer lx;
+  Token cur; ///< One token of lookahead
+  Arena* arena;
+  char* err;
+  size_t err_cap;
+  bool failed; ///< Set by the first error; later ones are not reported
+  int nparams; ///< Placeholders seen so far
+} Parser;
+
+// ============================================================================
+// Token helpers
+// ============================================================================
+
+static void advance(Parser* p) {
+  p->cur = lexer_next(&p->lx);
+}
+
+static void fail(Parser* p, const char* what) {
+  if (p->failed) return;
+  p->failed = true;
+  if (p->cur.type == TOK_EOF) {
+    snprintf(p->err, p->err_cap, "Parse error: %s at end of statement.", what);
+  } else {
+    snprintf(p->err, p->err_cap, "Parse error: %s near '%.*s'.", what,
+             p->cur.len > 32 ? 32 : p->cur.len, p->cur.start);
+  }
+}
+
+static bool accept(Parser* p, TokenType type) {
+  if (p->cur.type != type) return false;
+  advance(p);
+  return true;
+}
+
+static bool accept_kw(Parser* p, const char* kw) {
+  if (!token_is(&p->cur, kw)) return false;
+  advance(p);
+  return true;
+}
+
+static bool expect(Parser* p, TokenType type, const char* what) {
+  if (accept(p, type)) return true;
+  fail(p, what);
+  return false;
+}
+
+static bool expect_kw(Parser* p, const char* kw) {
+  if (accept_kw(p, kw)) return true;
+  char what[32];
+  snprintf(what, sizeof(what), "expected %s", kw);
+  fail(p, what);
+  return false;
+}
+
+static void* alloc(Parser* p, size_t n) {
+  void* m = arena_alloc(p->arena, n);
+  if (!m) fail(p, "out of memory");
+  return m;
+}
+
+// Appends to a growable array allocated from the arena.
+static void* push(Parser* p, void* arr, int* n, int* cap, size_t elem) {
+  if (*n == *cap) {
+    int new_cap = *cap ? *cap * 2 : 4;
+    void* grown = alloc(p, elem * (size_t)new_cap);
+    if (!grown) return NULL;
+    if (*n) memcpy(grown, arr, elem * (size_t)*n);
+    arr = grown;
+    *cap = new_cap;
+  }
+  (*n)++;
+  return arr;
+}
+
+// Identifiers longer than max - 1 bytes would not fit catalog names.
+static const char* ident(Parser* p, size_t max, const char* what) {
+  if (p->cur.type != TOK_IDENT) {
+    fail(p, what);
+    return NULL;
+  }
+  if ((size_t)p->cur.len >= max) {
+    fail(p, "name too long");
+    return NULL;
+  }
+  const char* s = arena_strndup(p->arena, p->cur.start, (size_t)p->cur.len);
+  if (!s) fail(p, "out of memory");
+  advance(p);
+  return s;
+}
+
+// ============================================================================
+// Literals and expressions
+// ============================================================================
+
+static bool literal(Parser* p, Literal* out) {
+  memset(out, 0, sizeof(*out));
+
+  if (accept_kw(p, "null")) {
+    out->kind = LIT_NULL;
+    return true;
+  }
+
+  if (accept(p, TOK_PARAM)) {
+    out->kind = LIT_NULL;
+    out->param = ++p->nparams;
+    return true;
+  }
+
+  if (token_is(&p->cur, "true") || token_is(&p->cur, "false")) {
+    out->kind = LIT_BOOL;
+    out->i64 = token_is(&p->cur, "true");
+    out->text = out->i64 ? "true" : "false";
+    out->len = (uint32_t)strlen(out->text);
+    advance(p);
+    return true;
+  }
+
+  if (p->cur.type == TOK_STRING) {
+    // Strip the quotes and collapse doubled quote characters.
+    char q = p->cur.start[0];
+    const char* s = p->cur.start + 1;
+    size_t n = (size_t)p->cur.len - 2;
+    char* text = alloc(p, n + 1);
+    if (!text) return false;
+    size_t w = 0;
+    for (size_t i = 0; i < n; i++) {
+      text[w++] = s[i];
+      if (s[i] == q) i++;
+    }
+    text[w] = 0;
+    out->kind = LIT_TEXT;
+    out->text = text;
+    out->len = (uint32_t)w;
+    advance(p);
+    return true;
+  }
+
+  bool neg = accept(p, TOK_MINUS);
+  if (p->cur.type != TOK_INT && p->cur.type != TOK_FLOAT) {
+    fail(p, "expected a value");
+    return false;
+  }
+
+  char* text = alloc(p, (size_t)p->cur.len + 2);
+  if (!text) return false;
+  out->len = (uint32_t)snprintf(text, (size_t)p->cur.len + 2, "%s%.*s", neg ? "-" : "",
+                                p->cur.len, p->cur.start);
+  out->text = text;
+  if (p->cur.type == TOK_FLOAT) {
+    out->kind = LIT_FLOAT;
+  } else {
+    errno = 0;
+    out->kind = LIT_INT;
+    out->i64 = strtoll(text, NULL, 10);
+    if (errno == ERANGE) {
+      fail(p, "integer out of range");
+      return false;
+    }
+  }
+  advance(p);
+  return true;
+}
+
+static Expr* new_expr(Parser* p, ExprKind kind) {
+  Expr* e = alloc(p, sizeof(Expr));
+  if (e) {
+    e->kind = kind;
+    e->col_idx = -1;
+  }
+  return e;
+}
+
+static Expr* column_ref(Parser* p) {
+  Expr* e = new_expr(p, EXPR_COLUMN);
+  if (!e) return NULL;
+  e->column = ident(p, COL_NAME_MAX, "expected a column");
+  if (!e->column) return NULL;
+
+  if (accept(p, TOK_DOT)) {
+    if (strlen(e->column) >= TABLE_NAME_MAX) {
+      fail(p, "name too long");
+      return NULL;
+    }
+    e->table = e->column;
+    e->column = ident(p, COL_NAME_MAX, "expected a column");
+    if (!e->column) return NULL;
+  }
+  return e;
+}
+
+static Expr* operand(Parser* p) {
+  if (p->cur.type == TOK_IDENT && !token_is(&p->cur, "null") && !token_is(&p->cur, "true") &&
+      !token_is(&p->cur, "false")) {
+    return column_ref(p);
+  }
+
+  Expr* e = new_expr(p, EXPR_LITERAL);
+  if (!e || !literal(p, &e->lit)) return NULL;
+  return e;
+}
+
+static bool cmp_op(TokenType t, CmpOp* op) {
+  switch (t) {
+    case TOK_EQ: *op = CMP_EQ; return true;
+    case TOK_NE: *op = CMP_NE; return true;
+    case TOK_LT: *op = CMP_LT; return true;
+    case TOK_LE: *op = CMP_LE; return true;
+    case TOK_GT: *op = CMP_GT; return true;
+    case TOK_GE: *op = CMP_GE; return true;
+    default: return false;
+  }
+}
+
+static Expr* comparison(Parser* p, Expr* left) {
+  CmpOp op;
+  if (!cmp_op(p->cur.type, &op)) {
+    fail(p, "expected a comparison");
+    return NULL;
+  }
+  advance(p);
+
+  Expr* right = operand(p);
+  Expr* e = right ? new_expr(p, EXPR_CMP) : NULL;
+  if (!e) return NULL;
+  e->op = op;
+  e->left = left;
+  e->right = right;
+  return e;
+}
+
+static Expr* between(Parser* p, Expr* left) {
+  Expr* e = new_expr(p, EXPR_BETWEEN);
+  if (!e) return NULL;
+  e->left = left;
+  e->list = alloc(p, 2 * sizeof(Expr*));
+  if (!e->list) return NULL;
+  e->nlist = 2;
+  if (!(e->list[0] = operand(p)) || !expect_kw(p, "and") || !(e->list[1] = operand(p))) {
+    return NULL;
+  }
+  return e;
+}
+
+static Expr* in_list(Parser* p, Expr* left) {
+  Expr* e = new_expr(p, EXPR_IN);
+  if (!e || !expect(p, TOK_LPAREN, "expected (")) return NULL;
+  e->left = left;
+
+  int cap = 0;
+  do {
+    e->list = push(p, e->list, &e->nlist, &cap, sizeof(Expr*));
+    Expr* v = e->list ? new_expr(p, EXPR_LITERAL) : NULL;
+    if (!v || !literal(p, &v->lit)) return NULL;
+    e->list[e->nlist - 1] = v;
+  } while (accept(p, TOK_COMMA));
+
+  if (!expect(p, TOK_RPAREN, "expected )")) return NULL;
+  return e;
+}
+
+static Expr* like(Parser* p, Expr* left) {
+  if (p->cur.type != TOK_STRING && p->cur.type != TOK_PARAM) {
+    fail(p, "expected a pattern");
+    return NULL;
+  }
+  Expr* e = new_expr(p, EXPR_LIKE);
+  Expr* pat = e ? new_expr(p, EXPR_LITERAL) : NULL;
+  if (!pat || !literal(p, &pat->lit)) return NULL;
+  e->left = left;
+  e->right = pat;
+  return e;
+}
+
+static Expr* expr_or(Parser* p);
+
+static Expr* expr_cmp(Parser* p) {
+  if (accept(p, TOK_LPAREN)) {
+    Expr* e = expr_or(p);
+    if (!e || !expect(p, TOK_RPAREN, "expected )")) return NULL;
+    return e;
+  }
+
+  Expr* left = operand(p);
+  if (!left) return NULL;
+
+  bool negated = accept_kw(p, "not");
+  Expr* e = NULL;
+  if (accept_kw(p, "between")) {
+    e = between(p, left);
+  } else if (accept_kw(p, "in")) {
+    e = in_list(p, left);
+  } else if (accept_kw(p, "like")) {
+    e = like(p, left);
+  } else if (negated) {
+    fail(p, "expected BETWEEN, IN or LIKE");
+    return NULL;
+  } else {
+    return comparison(p, left);
+  }
+
+  if (e && negated) {
+    Expr* n = new_expr(p, EXPR_NOT);
+    if (n) n->left = e;
+    e = n;
+  }
+  return e;
+}
+
+static Expr* expr_not(Parser* p) {
+  if (!accept_kw(p, "not")) return expr_cmp(p);
+
+  Expr* inner = expr_not(p);
+  Expr* e = inner ? new_expr(p, EXPR_NOT) : NULL;
+  if (e) e->left = inner;
+  return e;
+}
+
+static Expr* expr_and(Parser* p) {
+  Expr* left = expr_not(p);
+  while (left && accept_kw(p, "and")) {
+    Expr* right = expr_not(p);
+    Expr* e = right ? new_expr(p, EXPR_AND) : NULL;
+    if (!e) return NULL;
+    e->left = left;
+    e->right = right;
+    left = e;
+  }
+  return left;
+}
+
+static Expr* expr_or(Parser* p) {
+  Expr* left = expr_and(p);
+  while (left && accept_kw(p, "or")) {
+    Expr* right = expr_and(p);
+    Expr* e = right ? new_expr(p, EXPR_OR) : NULL;
+    if (!e) return NULL;
+    e->left = left;
+    e->right = right;
+    left = e;
+  }
+  return left;
+}
+
+// Parses an optional WHERE clause. Returns false only on a syntax error.
+static bool where_clause(Parser* p, Expr** out) {
+  *out = NULL;
+  if (!accept_kw(p, "where")) return true;
+  *out = expr_or(p);
+  return *out != NULL;
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+static ColumnType column_type(const Token* t) {
+  if (token_is(t, "int") || token_is(t, "integer")) return COL_INT;
+  if (token_is(t, "text")) return COL_TEXT;
+  if (token_is(t, "bigint")) return COL_BIGINT;
+  if (token_is(t, "double") || token_is(t, "float") || token_is(t, "real")) return COL_DOUBLE;
+  if (token_is(t, "bool") || token_is(t, "boolean")) return COL_BOOL;
+  if (token_is(t, "timestamp")) return COL_TIMESTAMP;
+  if (token_is(t, "char") || token_is(t, "character")) return COL_CHAR;
+  return 0;
+}
+
+// Parses the rest of a type after its name: PRECISION after DOUBLE, and
+// the length of a CHAR, which is 1 if not given.
+static bool type_suffix(Parser* p, ColumnDef* c) {
+  if (c->type == COL_DOUBLE) {
+    accept_kw(p, "precision");
+    return true;
+  }
+  if (c->type != COL_CHAR) return true;
+
+  c->len = 1;
+  if (!accept(p, TOK_LPAREN)) return true;
+  long long n = p->cur.type == TOK_INT ? strtoll(p->cur.start, NULL, 10) : 0;
+  if (n < 1 || n > ROW_CHAR_MAX) {
+    char what[48];
+    snprintf(what, sizeof(what), "CHAR length must be from 1 to %d", ROW_CHAR_MAX);
+    fail(p, what);
+    return false;
+  }
+  c->len = (uint16_t)n;
+  advance(p);
+  return expect(p, TOK_RPAREN, "expected )");
+}
+
+static bool parse_create_table(Parser* p, CreateTableStmt* st) {
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table || !expect(p, TOK_LPAREN, "expected (")) return false;
+
+  do {
+    if (st->ncols == CATALOG_MAX_COLS) {
+      fail(p, "too many columns");
+      return false;
+    }
+    ColumnDef* c = &st->cols[st->ncols];
+    const char* name = ident(p, COL_NAME_MAX, "expected a column name");
+    if (!name) return false;
+    ColumnType type = column_type(&p->cur);
+    if (!type) {
+      fail(p, "expected a column type");
+      return false;
+    }
+    advance(p);
+    memset(c, 0, sizeof(*c));
+    memcpy(c->col, name, strlen(name));
+    c->type = type;
+    if (!type_suffix(p, c)) return false;
+    st->ncols++;
+  } while (accept(p, TOK_COMMA));
+
+  return expect(p, TOK_RPAREN, "expected )");
+}
+
+static bool parse_create_index(Parser* p, CreateIndexStmt* st) {
+  st->name = ident(p, TABLE_NAME_MAX, "expected an index name");
+  if (!st->name || !expect_kw(p, "on")) return false;
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table || !expect(p, TOK_LPAREN, "expected (")) return false;
+  st->column = ident(p, COL_NAME_MAX, "expected a column name");
+  return st->column && expect(p, TOK_RPAREN, "expected )");
+}
+
+static bool parse_insert(Parser* p, InsertStmt* st) {
+  if (!expect_kw(p, "into")) return false;
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table || !expect_kw(p, "values")) return false;
+
+  int rows_cap = 0;
+  do {
+    st->rows = push(p, st->rows, &st->nrows, &rows_cap, sizeof(InsertRow));
+    if (!st->rows || !expect(p, TOK_LPAREN, "expected (")) return false;
+
+    InsertRow* row = &st->rows[st->nrows - 1];
+    memset(row, 0, sizeof(*row));
+    int vals_cap = 0;
+    do {
+      row->values = push(p, row->values, &row->nvalues, &vals_cap, sizeof(Literal));
+      if (!row->values || !literal(p, &row->values[row->nvalues - 1])) return false;
+    } while (accept(p, TOK_COMMA));
+
+    if (!expect(p, TOK_RPAREN, "expected )")) return false;
+  } while (accept(p, TOK_COMMA));
+
+  return true;
+}
+
+static bool parse_copy(Parser* p, CopyStmt* st) {
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table || !expect_kw(p, "from")) return false;
+
+  Literal path;
+  if (p->cur.type != TOK_STRING) {
+    fail(p, "expected a quoted file name");
+    return false;
+  }
+  if (!literal(p, &path)) return false;
+  st->path = path.text;
+  st->header = accept_kw(p, "header");
+  return true;
+}
+
+static bool agg_func(const Token* t, AggFunc* f) {
+  if (token_is(t, "count")) *f = AGG_COUNT;
+  else if (token_is(t, "sum")) *f = AGG_SUM;
+  else if (token_is(t, "min")) *f = AGG_MIN;
+  else if (token_is(t, "max")) *f = AGG_MAX;
+  else if (token_is(t, "avg")) *f = AGG_AVG;
+  else return false;
+  return true;
+}
+
+// func ( col ) or COUNT(*). The name is only a function when a parenthesis
+// follows, so columns may still be called count or sum.
+static Expr* aggregate(Parser* p) {
+  AggFunc f;
+  Lexer ahead = p->lx;
+  if (!agg_func(&p->cur, &f) || lexer_next(&ahead).type != TOK_LPAREN) return column_ref(p);
+  advance(p);
+  advance(p);
+
+  Expr* e = new_expr(p, EXPR_AGG);
+  if (!e) return NULL;
+  e->agg = f;
+  if (f == AGG_COUNT && accept(p, TOK_STAR)) {
+    e->agg = AGG_COUNT_STAR;
+  } else if (!(e->left = column_ref(p))) {
+    return NULL;
+  }
+  if (!expect(p, TOK_RPAREN, "expected )")) return NULL;
+  return e;
+}
+
+static Expr* select_item(Parser* p) {
+  Expr* e = aggregate(p);
+  if (e && accept_kw(p, "as")) {
+    e->alias = ident(p, COL_NAME_MAX, "expected a column name");
+    if (!e->alias) return NULL;
+  }
+  return e;
+}
+
+static bool parse_select(Parser* p, SelectStmt* st) {
+  st->limit = -1;
+
+  if (!accept(p, TOK_STAR)) {
+    int cap = 0;
+    do {
+      st->items = push(p, st->items, &st->nitems, &cap, sizeof(Expr*));
+      if (!st->items) return false;
+      Expr* e = select_item(p);
+      if (!e) return false;
+      st->items[st->nitems - 1] = e;
+    } while (accept(p, TOK_COMMA));
+  }
+
+  if (!expect_kw(p, "from")) return false;
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table) return false;
+
+  int jcap = 0;
+  while (1) {
+    bool inner = accept_kw(p, "inner");
+    if (!inner && !accept_kw(p, "join")) break;
+    if (inner && !expect_kw(p, "join")) return false;
+    st->joins = push(p, st->joins, &st->njoins, &jcap, sizeof(JoinClause));
+    if (!st->joins) return false;
+    JoinClause* j = &st->joins[st->njoins - 1];
+    j->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+    if (!j->table || !expect_kw(p, "on")) return false;
+    j->on = expr_or(p);
+    if (!j->on) return false;
+  }
+  if (!where_clause(p, &st->where)) return false;
+
+  if (accept_kw(p, "group")) {
+    if (!expect_kw(p, "by")) return false;
+    int cap = 0;
+    do {
+      st->group_by = push(p, st->group_by, &st->ngroup, &cap, sizeof(Expr*));
+      if (!st->group_by) return false;
+      Expr* e = column_ref(p);
+      if (!e) return false;
+      st->group_by[st->ngroup - 1] = e;
+    } while (accept(p, TOK_COMMA));
+  }
+
+  if (accept_kw(p, "order")) {
+    if (!expect_kw(p, "by")) return false;
+    int cap = 0;
+    do {
+      st->order_by = push(p, st->order_by, &st->norder, &cap, sizeof(OrderItem));
+      if (!st->order_by) return false;
+      OrderItem* o = &st->order_by[st->norder - 1];
+      o->column = column_ref(p);
+      if (!o->column) return false;
+      o->desc = accept_kw(p, "desc");
+      if (!o->desc) accept_kw(p, "asc");
+    } while (accept(p, TOK_COMMA));
+  }
+
+  // LIMIT and OFFSET may come in either order.
+  bool has_limit = false, has_offset = false;
+  while (1) {
+    int64_t* dst;
+    if (!has_limit && accept_kw(p, "limit")) {
+      has_limit = true;
+      dst = &st->limit;
+    } else if (!has_offset && accept_kw(p, "offset")) {
+      has_offset = true;
+      dst = &st->offset;
+    } else {
+      break;
+    }
+    if (p->cur.type != TOK_INT) {
+      fail(p, "expected a row count");
+      return false;
+    }
+    *dst = strtoll(p->cur.start, NULL, 10);
+    advance(p);
+  }
+  return true;
+}
+
+static bool parse_update(Parser* p, UpdateStmt* st) {
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table || !expect_kw(p, "set")) return false;
+
+  int cap = 0;
+  do {
+    st->sets = push(p, st->sets, &st->nsets, &cap, sizeof(SetClause));
+    if (!st->sets) return false;
+    SetClause* s = &st->sets[st->nsets - 1];
+    s->column = ident(p, COL_NAME_MAX, "expected a column name");
+    if (!s->column || !expect(p, TOK_EQ, "expected =") || !literal(p, &s->value)) return false;
+  } while (accept(p, TOK_COMMA));
+
+  return where_clause(p, &st->where);
+}
+
+static bool parse_delete(Parser* p, DeleteStmt* st) {
+  if (!expect_kw(p, "from")) return false;
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  return st->table && where_clause(p, &st->where);
+}
+
+static bool parse_vacuum(Parser* p, VacuumStmt* st) {
+  st->table = ident(p, TABLE_NAME_MAX, "expected a table name");
+  if (!st->table) return false;
+
+  // An optional page count runs one bounded step of an incremental pass.
+  if (p->cur.type == TOK_INT) {
+    long long n = strtoll(p->cur.start, NULL, 10);
+    if (n <= 0 || n > UINT32_MAX - 1) {
+      fail(p, "page count must be positive");
+      return false;
+    }
+    st->max_pages = (uint32_t)n;
+    advance(p);
+  }
+  return true;
+}
+
+// ============================================================================
+// Placeholders
+// ============================================================================
+
+static void collect_lit(Stmt* st, Literal* lit) {
+  if (lit->param) st->params[lit->param - 1] = lit;
+}
+
+static void collect_expr(Stmt* st, Expr* e) {
+  if (!e) return;
+  if (e->kind == EXPR_LITERAL) collect_lit(st, &e->lit);
+  collect_expr(st, e->left);
+  collect_expr(st, e->right);
+  for (int i = 0; i < e->nlist; i++) collect_expr(st, e->list[i]);
+}
+
+// Lists the placeholders once the statement is complete, when the arrays
+// holding their literals no longer move.
+static bool collect_params(Parser* p, Stmt* st) {
+  st->nparams = p->nparams;
+  if (p->nparams == 0) return true;
+  st->params = alloc(p, sizeof(Literal*) * (size_t)p->nparams);
+  if (!st->params) return false;
+
+  switch (st->kind) {
+    case STMT_INSERT:
+      for (int r = 0; r < st->insert.nrows; r++) {
+        InsertRow* row = &st->insert.rows[r];
+        for (int i = 0; i < row->nvalues; i++) collect_lit(st, &row->values[i]);
+      }
+      break;
+    case STMT_SELECT:
+      for (int j = 0; j < st->select.njoins; j++) collect_expr(st, st->select.joins[j].on);
+      collect_expr(st, st->select.where);
+      break;
+    case STMT_UPDATE:
+      for (int k = 0; k < st->update.nsets; k++) collect_lit(st, &st->update.sets[k].value);
+      collect_expr(st, st->update.where);
+      break;
+    case STMT_DELETE:
+      collect_expr(st, st->del.where);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+// ============================================================================
+// Entry point
+// ============================================================================
+
+Stmt* parse_statement(Arena* a, const char* sql, char* err, size_t err_cap) {
+  Parser p = { .arena = a, .err = err, .err_cap = err_cap };
+  lexer_init(&p.lx, sql);
+  advance(&p);
+
+  Stmt* st = alloc(&p, sizeof(Stmt));
+  if (!st) return NULL;
+
+  st->explain = accept_kw(&p, "explain");
+
+  bool ok;
+  if (accept_kw(&p, "create")) {
+    if (accept_kw(&p, "table")) {
+      st->kind = STMT_CREATE_TABLE;
+      ok = parse_create_table(&p, &st->create_table);
+    } else if (accept_kw(&p, "index")) {
+      st->kind = STMT_CREATE_INDEX;
+      ok = parse_create_index(&p, &st->create_index);
+    } else {
+      fail(&p, "expected TABLE or INDEX");
+      ok = false;
+    }
+  } else if (accept_kw(&p, "insert")) {
+    st->kind = STMT_INSERT;
+    ok = parse_insert(&p, &st->insert);
+  } else if (accept_kw(&p, "copy")) {
+    st->kind = STMT_COPY;
+    ok = parse_copy(&p, &st->copy);
+  } else if (accept_kw(&p, "select")) {
+    st->kind = STMT_SELECT;
+    ok = parse_select(&p, &st->select);
+  } else if (accept_kw(&p, "update")) {
+    st->kind = STMT_UPDATE;
+    ok = parse_update(&p, &st->update);
+  } else if (accept_kw(&p, "delete")) {
+    st->kind = STMT_DELETE;
+    ok = parse_delete(&p, &st->del);
+  } else if (accept_kw(&p, "vacuum")) {
+    st->kind = STMT_VACUUM;
+    ok = parse_vacuum(&p, &st->vacuum);
+  } else {
+    fail(&p, "unknown statement");
+    ok = false;
+  }
+
+  if (ok) {
+    accept(&p, TOK_SEMI);
+    if (p.cur.type != TOK_EOF) fail(&p, "unexpected input");
+  }
+  if (!p.failed) collect_params(&p, st);
+  return p.failed ? NULL : st;
+}
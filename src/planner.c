@@ -0,0 +1,926 @@
+#include "planner.h"
+#include "agg.h"
+#include "join.h"
+#include "sort.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define MAX_CONJUNCTS 32
+
+// Pages counted at most when estimating the size of a join input.
+#define JOIN_COUNT_PAGES_MAX 4096
+
+TableInfo* plan_open_table(ExecCtx* ctx, const char* name) {
+  TableInfo* t = arena_alloc(ctx->arena, sizeof(TableInfo));
+  if (!t) {
+    snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+    return NULL;
+  }
+
+  int r = table_open(ctx->bp, ctx->cat, name, t);
+  if (r == 0) {
+    snprintf(ctx->err, sizeof(ctx->err), "Table '%s' does not exist.", name);
+    return NULL;
+  }
+  if (r < 0) {
+    snprintf(ctx->err, sizeof(ctx->err), "Schema missing for table '%s'.", name);
+    return NULL;
+  }
+  if (ctx->ntables < EXEC_MAX_TABLES) ctx->tables[ctx->ntables++] = t;
+  ctx->catalog_version = ctx->cat->version;
+  return t;
+}
+
+bool plan_refresh(ExecCtx* ctx) {
+  // Without a change to the catalog only the roots can have moved.
+  if (ctx->catalog_version == ctx->cat->version) {
+    for (int i = 0; i < ctx->ntables; i++) {
+      TableInfo* t = ctx->tables[i];
+      heap_reload(ctx->bp, &t->hf);
+      for (int k = 0; k < t->nix; k++) t->ixs[k].tree = btree_open(ctx->bp, t->ixs[k].entry.meta_pid);
+    }
+    return true;
+  }
+
+  for (int i = 0; i < ctx->ntables; i++) {
+    TableInfo* t = ctx->tables[i];
+    TableInfo now;
+    if (table_open(ctx->bp, ctx->cat, t->name, &now) <= 0 || now.nix != t->nix) return false;
+    for (int k = 0; k < t->nix; k++) {
+      if (now.ixs[k].entry.meta_pid != t->ixs[k].entry.meta_pid) return false;
+    }
+    *t = now;
+  }
+  ctx->catalog_version = ctx->cat->version;
+  return true;
+}
+
+// ============================================================================
+// Binding
+// ============================================================================
+
+static bool bind_column(ExecCtx* ctx, Expr* e, const Operator* input) {
+  int found = -1;
+  for (int i = 0; i < input->ncols; i++) {
+    const ExecColumn* c = &input->cols[i];
+    if (strcasecmp(c->name, e->column) != 0) continue;
+    if (e->table && strcasecmp(c->table, e->table) != 0) continue;
+    if (found >= 0) {
+      snprintf(ctx->err, sizeof(ctx->err), "Ambiguous column '%s'.", e->column);
+      return false;
+    }
+    found = i;
+  }
+
+  if (found < 0) {
+    if (e->table) {
+      snprintf(ctx->err, sizeof(ctx->err), "Unknown column '%s.%s'.", e->table, e->column);
+    } else {
+      snprintf(ctx->err, sizeof(ctx->err), "Unknown column '%s'.", e->column);
+    }
+    return false;
+  }
+  e->col_idx = found;
+  return true;
+}
+
+// Converts a literal to a column type, as a value inserted as text would
+// be. Quoted text that is not a value of the type becomes NULL, so no row
+// matches it; a number or TRUE / FALSE that is not is an error.
+static bool coerce_literal(ExecCtx* ctx, const Literal* lit, ColumnType type, RowField* out) {
+  if (lit->kind != LIT_NULL && row_parse_value(type, lit->text, out) == 0) return true;
+
+  memset(out, 0, sizeof(*out));
+  out->type = type;
+  out->is_null = true;
+  out->toast_pid = INVALID_PID;
+  if (lit->kind == LIT_NULL || lit->kind == LIT_TEXT) return true;
+  snprintf(ctx->err, sizeof(ctx->err), "%s is not a valid %s.", lit->text, row_type_name(type));
+  return false;
+}
+
+static ColumnType natural_type(const Literal* lit) {
+  switch (lit->kind) {
+    case LIT_INT: return lit->i64 >= INT32_MIN && lit->i64 <= INT32_MAX ? COL_INT : COL_BIGINT;
+    case LIT_FLOAT: return COL_DOUBLE;
+    case LIT_BOOL: return COL_BOOL;
+    default: return COL_TEXT;
+  }
+}
+
+// Converts an integer literal to a number of the given type without
+// parsing its text, where the type holds the integer: INT when it is in
+// range, BIGINT and DOUBLE.
+static bool int_literal(const Literal* lit, ColumnType type, RowField* out) {
+  if (lit->kind != LIT_INT || !row_is_numeric(type)) return false;
+  if (type == COL_INT && (lit->i64 < INT32_MIN || lit->i64 > INT32_MAX)) return false;
+
+  memset(out, 0, sizeof(*out));
+  out->type = type;
+  out->toast_pid = INVALID_PID;
+  if (type == COL_INT) out->i32 = (int32_t)lit->i64;
+  else if (type == COL_BIGINT) out->i64 = lit->i64;
+  else out->f64 = (double)lit->i64;
+  return true;
+}
+
+// Binds a literal as a value of the given type, that of the column it is
+// compared with. A number that is not a value of a numeric column's type,
+// such as 2.5 or 9000000000 for an INT, keeps its own type instead and is
+// compared by value.
+static bool bind_literal(ExecCtx* ctx, Expr* e, ColumnType type) {
+  RowField v;
+  e->bind_type = type;
+  if (int_literal(&e->lit, type, &e->value)) return true;
+  if (row_is_numeric(type) && (e->lit.kind == LIT_INT || e->lit.kind == LIT_FLOAT) &&
+      row_parse_value(type, e->lit.text, &v) != 0) {
+    type = natural_type(&e->lit);
+  }
+  return coerce_literal(ctx, &e->lit, type, &e->value);
+}
+
+// Gives a literal compared with a column the column's type. Columns
+// compare only with columns whose values are held the same way, so TEXT
+// goes with CHAR(n), or with other numbers: INT, BIGINT and DOUBLE compare
+// with each other.
+static bool bind_operands(ExecCtx* ctx, Expr* l, Expr* r, const Operator* input) {
+  if (l->kind == EXPR_COLUMN && r->kind == EXPR_LITERAL) {
+    return bind_literal(ctx, r, input->cols[l->col_idx].type);
+  } else if (l->kind == EXPR_LITERAL && r->kind == EXPR_COLUMN) {
+    return bind_literal(ctx, l, input->cols[r->col_idx].type);
+  } else if (l->kind == EXPR_COLUMN && r->kind == EXPR_COLUMN) {
+    ColumnType lt = input->cols[l->col_idx].type;
+    ColumnType rt = input->cols[r->col_idx].type;
+    if (row_value_kind(lt) != row_value_kind(rt) && !(row_is_numeric(lt) && row_is_numeric(rt))) {
+      snprintf(ctx->err, sizeof(ctx->err), "Cannot compare '%s' with '%s'.",
+               l->column, r->column);
+      return false;
+    }
+  }
+  return true;
+}
+
+static int cmp_i32(const void* a, const void* b) {
+  int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+  return (x > y) - (x < y);
+}
+
+// Value of a number as an INT, if it is one: 2.0 is 2, where 2.5 and
+// 9000000000 are no INT value.
+static bool int_value(const RowField* v, int32_t* out) {
+  switch (v->type) {
+    case COL_INT:
+      *out = v->i32;
+      return true;
+    case COL_BIGINT:
+      *out = (int32_t)v->i64;
+      return v->i64 == *out;
+    case COL_DOUBLE:
+      if (!(v->f64 >= INT32_MIN && v->f64 <= INT32_MAX)) return false;
+      *out = (int32_t)v->f64;
+      return v->f64 == *out;
+    default:
+      return false;
+  }
+}
+
+// Collects the values of an IN list on an INT column into a sorted array
+// without duplicates, the form the IN kernels search. Numbers that are no
+// INT value match no row, so they are left out. Re-binding a planned
+// statement reuses the array the planner allocated.
+static bool bind_in_list(ExecCtx* ctx, Expr* e, bool reuse) {
+  e->in_has_null = false;
+  for (int i = 0; i < e->nlist; i++) e->in_has_null |= e->list[i]->value.is_null;
+
+  if (e->left->kind != EXPR_COLUMN || e->list[0]->bind_type != COL_INT) return true;
+
+  if (!reuse) e->in_i32 = arena_alloc(ctx->arena, sizeof(int32_t) * (size_t)e->nlist);
+  if (!e->in_i32) {
+    snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+    return false;
+  }
+  int n = 0;
+  for (int i = 0; i < e->nlist; i++) {
+    const RowField* v = &e->list[i]->value;
+    if (!v->is_null && int_value(v, &e->in_i32[n])) n++;
+  }
+  qsort(e->in_i32, (size_t)n, sizeof(int32_t), cmp_i32);
+
+  int m = 0;
+  for (int i = 0; i < n; i++) {
+    if (m == 0 || e->in_i32[m - 1] != e->in_i32[i]) e->in_i32[m++] = e->in_i32[i];
+  }
+  e->nin_i32 = m;
+  return true;
+}
+
+bool plan_bind_expr(ExecCtx* ctx, Expr* e, const Operator* input) {
+  switch (e->kind) {
+    case EXPR_COLUMN:
+      return bind_column(ctx, e, input);
+
+    case EXPR_LITERAL:
+      return bind_literal(ctx, e, natural_type(&e->lit));
+
+    case EXPR_CMP:
+      return plan_bind_expr(ctx, e->left, input) && plan_bind_expr(ctx, e->right, input) &&
+             bind_operands(ctx, e->left, e->right, input);
+
+    case EXPR_BETWEEN:
+      if (!plan_bind_expr(ctx, e->left, input)) return false;
+      for (int i = 0; i < e->nlist; i++) {
+        if (!plan_bind_expr(ctx, e->list[i], input)) return false;
+        if (!bind_operands(ctx, e->left, e->list[i], input)) return false;
+      }
+      return true;
+
+    case EXPR_IN:
+      if (!plan_bind_expr(ctx, e->left, input)) return false;
+      for (int i = 0; i < e->nlist; i++) {
+        if (!plan_bind_expr(ctx, e->list[i], input)) return false;
+        if (!bind_operands(ctx, e->left, e->list[i], input)) return false;
+      }
+      return bind_in_list(ctx, e, false);
+
+    case EXPR_LIKE:
+      if (!plan_bind_expr(ctx, e->left, input) || !plan_bind_expr(ctx, e->right, input)) {
+        return false;
+      }
+      if (e->left->kind == EXPR_COLUMN && !row_is_text(input->cols[e->left->col_idx].type)) {
+        snprintf(ctx->err, sizeof(ctx->err), "LIKE needs a TEXT or CHAR operand, not '%s'.",
+                 e->left->column);
+        return false;
+      }
+      return true;
+
+    case EXPR_AND:
+    case EXPR_OR:
+      return plan_bind_expr(ctx, e->left, input) && plan_bind_expr(ctx, e->right, input);
+
+    case EXPR_NOT:
+      return plan_bind_expr(ctx, e->left, input);
+
+    case EXPR_AGG:
+      return !e->left || plan_bind_expr(ctx, e->left, input);
+  }
+  return false;
+}
+
+static void find_params(Expr* e, Expr* in, PlanParam* out) {
+  if (!e) return;
+  if (e->kind == EXPR_LITERAL && e->lit.param) out[e->lit.param - 1] = (PlanParam){ e, in };
+  find_params(e->left, NULL, out);
+  find_params(e->right, NULL, out);
+  for (int i = 0; i < e->nlist; i++) find_params(e->list[i], e->kind == EXPR_IN ? e : NULL, out);
+}
+
+void plan_params(SelectStmt* st, PlanParam* out) {
+  for (int j = 0; j < st->njoins; j++) find_params(st->joins[j].on, NULL, out);
+  find_params(st->where, NULL, out);
+}
+
+bool plan_bind_param(ExecCtx* ctx, const PlanParam* p) {
+  if (!p->expr) return true;
+  if (!bind_literal(ctx, p->expr, p->expr->bind_type)) return false;
+  return !p->in || bind_in_list(ctx, p->in, true);
+}
+
+// ============================================================================
+// Access paths
+// ============================================================================
+
+// Collects the conjuncts of e after the n already in out. Returns the new
+// count, which may exceed MAX_CONJUNCTS; only the first MAX_CONJUNCTS are stored.
+static int flatten_and(Expr* e, Expr** out, int n) {
+  if (e->kind == EXPR_AND) {
+    n = flatten_and(e->left, out, n);
+    return flatten_and(e->right, out, n);
+  }
+  if (n < MAX_CONJUNCTS) out[n] = e;
+  return n + 1;
+}
+
+static CmpOp flip(CmpOp op) {
+  switch (op) {
+    case CMP_LT: return CMP_GT;
+    case CMP_LE: return CMP_GE;
+    case CMP_GT: return CMP_LT;
+    case CMP_GE: return CMP_LE;
+    default: return op;
+  }
+}
+
+// Whether a literal may bound an index scan: a placeholder can, as its value
+// is not known until the plan runs. A number of another type than the
+// column, such as 2.5 for an INT, is left to the filter.
+static bool usable_bound(const Expr* e) {
+  return e->lit.param || (!e->value.is_null && e->value.type == e->bind_type);
+}
+
+// Matches "column op literal" in either order on the given column.
+static bool column_bound(const Expr* e, int col_idx, CmpOp* op, const RowField** v) {
+  if (e->kind != EXPR_CMP) return false;
+  const Expr* l = e->left;
+  const Expr* r = e->right;
+  if (l->kind == EXPR_COLUMN && r->kind == EXPR_LITERAL && l->col_idx == col_idx) {
+    *op = e->op;
+    *v = &r->value;
+  } else if (r->kind == EXPR_COLUMN && l->kind == EXPR_LITERAL && r->col_idx == col_idx) {
+    *op = flip(e->op);
+    *v = &l->value;
+    r = l;
+  } else {
+    return false;
+  }
+  return usable_bound(r) && *op != CMP_NE;
+}
+
+// Matches "column BETWEEN literal AND literal" on the given column.
+static bool column_between(const Expr* e, int col_idx, const RowField** lo, const RowField** hi) {
+  if (e->kind != EXPR_BETWEEN || e->left->kind != EXPR_COLUMN || e->left->col_idx != col_idx) {
+    return false;
+  }
+  const Expr* a = e->list[0];
+  const Expr* b = e->list[1];
+  if (a->kind != EXPR_LITERAL || b->kind != EXPR_LITERAL) return false;
+  if (!usable_bound(a) || !usable_bound(b)) return false;
+  *lo = &a->value;
+  *hi = &b->value;
+  return true;
+}
+
+// Finds the bounds the conjuncts put on an index's column and ranks them:
+// 3 for equality, 2 for a range closed on both sides, 1 for a one-sided
+// range and 0 for none.
+static int index_bounds(const TableIndex* ix, Expr** conj, int n, const RowField** lo,
+                        const RowField** hi) {
+  int rank = 0;
+  *lo = *hi = NULL;
+  for (int k = 0; k < n; k++) {
+    CmpOp op;
+    const RowField* v;
+    if (column_between(conj[k], ix->col_idx, lo, hi)) {
+      rank = rank > 2 ? rank : 2;
+      continue;
+    }
+    if (!column_bound(conj[k], ix->col_idx, &op, &v)) continue;
+    if (op == CMP_EQ) {
+      *lo = *hi = v;
+      return 3;
+    }
+    if ((op == CMP_GT || op == CMP_GE) && !*lo) *lo = v;
+    if ((op == CMP_LT || op == CMP_LE) && !*hi) *hi = v;
+    rank = (*lo && *hi) ? 2 : 1;
+  }
+  return rank;
+}
+
+// Picks the index whose column the filter bounds most tightly: equality
+// first, then a range closed on both sides, then any one-sided range.
+static Operator* index_path(ExecCtx* ctx, TableInfo* t, Expr* where) {
+  Expr* conj[MAX_CONJUNCTS];
+  int n = flatten_and(where, conj, 0);
+  if (n > MAX_CONJUNCTS) n = MAX_CONJUNCTS;
+
+  TableIndex* best = NULL;
+  const RowField* best_lo = NULL;
+  const RowField* best_hi = NULL;
+  int best_rank = 0;
+
+  for (int i = 0; i < t->nix; i++) {
+    TableIndex* ix = &t->ixs[i];
+    const RowField* lo;
+    const RowField* hi;
+    int rank = index_bounds(ix, conj, n, &lo, &hi);
+
+    if (rank > best_rank) {
+      best = ix;
+      best_lo = lo;
+      best_hi = hi;
+      best_rank = rank;
+    }
+  }
+
+  if (!best) return NULL;
+  return exec_index_scan(ctx, t, best, best_lo, best_hi);
+}
+
+Operator* plan_scan(ExecCtx* ctx, TableInfo* t, Expr* where) {
+  Operator* scan = exec_seq_scan(ctx, t);
+  if (!scan || !where) return scan;
+
+  if (!plan_bind_expr(ctx, where, scan)) return NULL;
+
+  Operator* ixscan = index_path(ctx, t, where);
+  if (ixscan) scan = ixscan;
+  return exec_filter(ctx, scan, where);
+}
+
+// ============================================================================
+// Aggregation
+// ============================================================================
+
+static const char* agg_func_name(AggFunc f) {
+  switch (f) {
+    case AGG_COUNT_STAR:
+    case AGG_COUNT: return "count";
+    case AGG_SUM: return "sum";
+    case AGG_MIN: return "min";
+    case AGG_MAX: return "max";
+    case AGG_AVG: return "avg";
+  }
+  return "";
+}
+
+static bool has_aggregates(const SelectStmt* st) {
+  for (int i = 0; i < st->nitems; i++) {
+    if (st->items[i]->kind == EXPR_AGG) return true;
+  }
+  return false;
+}
+
+// Binds an aggregate's argument and fills in its spec. The output column is
+// named by the AS alias, or as written, such as "sum(a)".
+static bool bind_aggregate(ExecCtx* ctx, Expr* e, const Operator* input, AggSpec* spec) {
+  memset(spec, 0, sizeof(*spec));
+  spec->func = e->agg;
+  spec->col = -1;
+  if (e->left) {
+    if (!plan_bind_expr(ctx, e->left, input)) return false;
+    spec->col = e->left->col_idx;
+    ColumnType type = input->cols[spec->col].type;
+    if ((e->agg == AGG_SUM || e->agg == AGG_AVG) &&
+        type != COL_INT && type != COL_BIGINT && type != COL_DOUBLE) {
+      snprintf(ctx->err, sizeof(ctx->err), "%s needs an INT, BIGINT or DOUBLE operand, not '%s'.",
+               e->agg == AGG_SUM ? "SUM" : "AVG", e->left->column);
+      return false;
+    }
+  }
+
+  char name[COL_NAME_MAX + 16];
+  if (e->alias) snprintf(name, sizeof(name), "%s", e->alias);
+  else snprintf(name, sizeof(name), "%s(%s)", agg_func_name(e->agg), e->left ? e->left->column : "*");
+  memcpy(spec->name, name, sizeof(spec->name) - 1);
+  return true;
+}
+
+// Plans GROUP BY and aggregates: a HashAgg that outputs the group keys and
+// then the aggregates, and a projection into the order of the select list.
+// Plain columns in the select list must be group keys.
+static Operator* plan_aggregate(ExecCtx* ctx, SelectStmt* st, Operator* op, int* map) {
+  if (st->nitems == 0) {
+    snprintf(ctx->err, sizeof(ctx->err), "SELECT * cannot be used with GROUP BY.");
+    return NULL;
+  }
+  if (st->ngroup > EXEC_MAX_COLS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many GROUP BY columns.");
+    return NULL;
+  }
+
+  int keys[EXEC_MAX_COLS];
+  for (int g = 0; g < st->ngroup; g++) {
+    if (!plan_bind_expr(ctx, st->group_by[g], op)) return NULL;
+    keys[g] = st->group_by[g]->col_idx;
+  }
+
+  AggSpec aggs[EXEC_MAX_COLS];
+  int naggs = 0;
+  for (int i = 0; i < st->nitems; i++) {
+    Expr* e = st->items[i];
+    if (e->kind == EXPR_AGG) {
+      if (st->ngroup + naggs == EXEC_MAX_COLS) {
+        snprintf(ctx->err, sizeof(ctx->err), "Too many columns selected.");
+        return NULL;
+      }
+      if (!bind_aggregate(ctx, e, op, &aggs[naggs])) return NULL;
+      map[i] = st->ngroup + naggs++;
+      continue;
+    }
+
+    if (!plan_bind_expr(ctx, e, op)) return NULL;
+    map[i] = -1;
+    for (int g = 0; g < st->ngroup && map[i] < 0; g++) {
+      if (keys[g] == e->col_idx) map[i] = g;
+    }
+    if (map[i] < 0) {
+      snprintf(ctx->err, sizeof(ctx->err),
+               "Column '%s' must appear in GROUP BY or be used in an aggregate.", e->column);
+      return NULL;
+    }
+  }
+  return exec_hash_agg(ctx, op, keys, st->ngroup, aggs, naggs);
+}
+
+// ============================================================================
+// Joins
+// ============================================================================
+
+// One table of a join with the conjuncts that only refer to it.
+typedef struct {
+  TableInfo* t;
+  Expr* conj[MAX_CONJUNCTS];
+  int nconj;
+  double pages; ///< Estimated pages of rows left after the conjuncts
+} JoinInput;
+
+// The table a column reference names: its index in ts, -1 if none has the
+// column and -2 if more than one does.
+static int column_source(const Expr* e, TableInfo** ts, int nt) {
+  int found = -1;
+  for (int i = 0; i < nt; i++) {
+    if (e->table && strcasecmp(e->table, ts[i]->name) != 0) continue;
+    if (table_find_column(ts[i]->cols, ts[i]->ncols, e->column) < 0) continue;
+    if (found >= 0) return -2;
+    found = i;
+  }
+  return found;
+}
+
+// Sets a bit of *mask for each table an expression refers to. Fails for
+// unknown and ambiguous columns.
+static bool expr_tables(ExecCtx* ctx, const Expr* e, TableInfo** ts, int nt, uint32_t* mask) {
+  if (e->kind == EXPR_COLUMN) {
+    int i = column_source(e, ts, nt);
+    if (i == -2) {
+      snprintf(ctx->err, sizeof(ctx->err), "Ambiguous column '%s'.", e->column);
+      return false;
+    }
+    if (i < 0 && e->table) {
+      snprintf(ctx->err, sizeof(ctx->err), "Unknown column '%s.%s'.", e->table, e->column);
+      return false;
+    }
+    if (i < 0) {
+      snprintf(ctx->err, sizeof(ctx->err), "Unknown column '%s'.", e->column);
+      return false;
+    }
+    *mask |= 1u << i;
+    return true;
+  }
+  if (e->left && !expr_tables(ctx, e->left, ts, nt, mask)) return false;
+  if (e->right && !expr_tables(ctx, e->right, ts, nt, mask)) return false;
+  for (int i = 0; i < e->nlist; i++) {
+    if (!expr_tables(ctx, e->list[i], ts, nt, mask)) return false;
+  }
+  return true;
+}
+
+// Joins conjuncts back into one expression, or NULL for none.
+static Expr* and_of(ExecCtx* ctx, Expr** conj, int n) {
+  Expr* e = n > 0 ? conj[0] : NULL;
+  for (int i = 1; i < n; i++) {
+    Expr* a = arena_alloc(ctx->arena, sizeof(Expr));
+    if (!a) {
+      snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+      return NULL;
+    }
+    a->kind = EXPR_AND;
+    a->left = e;
+    a->right = conj[i];
+    e = a;
+  }
+  return e;
+}
+
+// Rough size of a table after its filter: each equality keeps a tenth of
+// the rows and any other conjunct a third. Only the first
+// JOIN_COUNT_PAGES_MAX pages are counted, so larger tables tie.
+static double estimate_pages(ExecCtx* ctx, const JoinInput* in) {
+  double pages = heap_count_pages(ctx->bp, &in->t->hf, JOIN_COUNT_PAGES_MAX);
+  for (int i = 0; i < in->nconj; i++) {
+    const Expr* e = in->conj[i];
+    pages *= e->kind == EXPR_CMP && e->op == CMP_EQ ? 0.1 : 0.33;
+  }
+  return pages;
+}
+
+// Index on an INT column of a table, if there is one.
+static TableIndex* int_index(TableInfo* t, int col) {
+  if (t->cols[col].type != COL_INT) return NULL;
+  for (int i = 0; i < t->nix; i++) {
+    if (t->ixs[i].col_idx == col) return &t->ixs[i];
+  }
+  return NULL;
+}
+
+// Scans a table in the order of an index, within the bounds the filter
+// puts on the indexed column, and applies the filter on top.
+static Operator* ordered_scan(ExecCtx* ctx, TableInfo* t, TableIndex* ix, Expr* where) {
+  Operator* scan = exec_seq_scan(ctx, t);
+  if (!scan) return NULL;
+  if (!where) return exec_index_scan(ctx, t, ix, NULL, NULL);
+  if (!plan_bind_expr(ctx, where, scan)) return NULL;
+
+  Expr* conj[MAX_CONJUNCTS];
+  int n = flatten_and(where, conj, 0);
+  if (n > MAX_CONJUNCTS) n = MAX_CONJUNCTS;
+  const RowField* lo;
+  const RowField* hi;
+  index_bounds(ix, conj, n, &lo, &hi);
+  scan = exec_index_scan(ctx, t, ix, lo, hi);
+  return scan ? exec_filter(ctx, scan, where) : NULL;
+}
+
+// Binds the equalities between the joined tables and table k as join keys,
+// marking them used. Returns the number of keys.
+static int join_keys(ExecCtx* ctx, Expr** conj, int n, const uint32_t* masks, bool* used,
+                     uint32_t joined, int k, Operator* left, Operator* right, int* lkeys,
+                     int* rkeys, TableInfo** ts) {
+  int nkeys = 0;
+  for (int i = 0; i < n; i++) {
+    Expr* e = conj[i];
+    if (used[i] || e->kind != EXPR_CMP || e->op != CMP_EQ) continue;
+    if (e->left->kind != EXPR_COLUMN || e->right->kind != EXPR_COLUMN) continue;
+    if (!(masks[i] & (1u << k)) || !(masks[i] & joined) || (masks[i] & ~(joined | 1u << k))) {
+      continue;
+    }
+
+    Expr* l = e->left;
+    Expr* r = e->right;
+    if (column_source(l, ts, k + 1) == k) {
+      l = e->right;
+      r = e->left;
+    }
+    if (!plan_bind_expr(ctx, l, left) || !plan_bind_expr(ctx, r, right)) return -1;
+    ColumnType lt = left->cols[l->col_idx].type;
+    ColumnType rt = right->cols[r->col_idx].type;
+    if (row_value_kind(lt) != row_value_kind(rt) && !(row_is_numeric(lt) && row_is_numeric(rt))) {
+      snprintf(ctx->err, sizeof(ctx->err), "Cannot compare '%s' with '%s'.", l->column,
+               r->column);
+      return -1;
+    }
+    lkeys[nkeys] = l->col_idx;
+    rkeys[nkeys] = r->col_idx;
+    nkeys++;
+    used[i] = true;
+  }
+  return nkeys;
+}
+
+// Applies the conjuncts not used yet whose tables are all in `joined`.
+static Operator* filter_joined(ExecCtx* ctx, Operator* op, Expr** conj, int n,
+                               const uint32_t* masks, bool* used, uint32_t joined) {
+  Expr* ready[MAX_CONJUNCTS];
+  int nready = 0;
+  for (int i = 0; i < n; i++) {
+    if (used[i] || (masks[i] & ~joined)) continue;
+    ready[nready++] = conj[i];
+    used[i] = true;
+  }
+  if (nready == 0) return op;
+  Expr* pred = and_of(ctx, ready, nready);
+  if (!pred || !plan_bind_expr(ctx, pred, op)) return NULL;
+  return exec_filter(ctx, op, pred);
+}
+
+// Plans FROM with joins as a left-deep tree. The ON conditions and WHERE
+// are pooled, as an inner join does not care where a condition is written:
+// conjuncts on one table filter its scan, equalities between a table and
+// the ones before it become join keys, and the rest filter the lowest join
+// that has all their tables. A table must be joined by at least one
+// equality, so no join falls back to comparing every pair of rows.
+//
+// Each join is a hash join that builds on the input estimated smaller,
+// except that two INT key columns that both have indexes are merge joined
+// over index scans when the smaller input is not expected to fit in
+// work_mem, which saves partitioning both inputs to disk.
+static Operator* plan_join(ExecCtx* ctx, SelectStmt* st) {
+  int nt = st->njoins + 1;
+  if (nt > EXEC_MAX_TABLES) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many tables in the join.");
+    return NULL;
+  }
+
+  TableInfo* ts[EXEC_MAX_TABLES];
+  for (int i = 0; i < nt; i++) {
+    ts[i] = plan_open_table(ctx, i == 0 ? st->table : st->joins[i - 1].table);
+    if (!ts[i]) return NULL;
+    for (int k = 0; k < i; k++) {
+      if (strcasecmp(ts[k]->name, ts[i]->name) == 0) {
+        snprintf(ctx->err, sizeof(ctx->err), "Table '%s' is joined with itself.", ts[i]->name);
+        return NULL;
+      }
+    }
+  }
+
+  Expr* conj[MAX_CONJUNCTS];
+  int n = 0;
+  for (int i = 0; i < st->njoins; i++) n = flatten_and(st->joins[i].on, conj, n);
+  if (st->where) n = flatten_and(st->where, conj, n);
+  if (n > MAX_CONJUNCTS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many conditions in the join.");
+    return NULL;
+  }
+
+  // Conjuncts without columns have a mask of 0 and filter the first join.
+  uint32_t masks[MAX_CONJUNCTS];
+  bool used[MAX_CONJUNCTS];
+  JoinInput* ins = arena_alloc(ctx->arena, sizeof(JoinInput) * (size_t)nt);
+  if (!ins) {
+    snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+    return NULL;
+  }
+  for (int i = 0; i < nt; i++) ins[i].t = ts[i];
+  for (int i = 0; i < n; i++) {
+    masks[i] = 0;
+    used[i] = false;
+    if (!expr_tables(ctx, conj[i], ts, nt, &masks[i])) return NULL;
+    for (int k = 0; k < nt; k++) {
+      if (masks[i] != 1u << k) continue;
+      ins[k].conj[ins[k].nconj++] = conj[i];
+      used[i] = true;
+    }
+  }
+  for (int i = 0; i < nt; i++) ins[i].pages = estimate_pages(ctx, &ins[i]);
+
+  size_t budget = ctx->work_mem ? ctx->work_mem : EXEC_WORK_MEM_DEFAULT;
+  Operator* op = NULL;
+  double left_pages = ins[0].pages;
+  uint32_t joined = 1;
+  for (int k = 1; k < nt; k++) {
+    Expr* lwhere = k == 1 ? and_of(ctx, ins[0].conj, ins[0].nconj) : NULL;
+    Expr* rwhere = and_of(ctx, ins[k].conj, ins[k].nconj);
+    if ((k == 1 && ins[0].nconj > 0 && !lwhere) || (ins[k].nconj > 0 && !rwhere)) return NULL;
+
+    // Keys are bound against plain scans, which have the same columns as
+    // whatever access path is chosen below.
+    Operator* left = k == 1 ? exec_seq_scan(ctx, ts[0]) : op;
+    Operator* right = exec_seq_scan(ctx, ts[k]);
+    if (!left || !right) return NULL;
+    int lkeys[MAX_CONJUNCTS], rkeys[MAX_CONJUNCTS];
+    int nkeys = join_keys(ctx, conj, n, masks, used, joined, k, left, right, lkeys, rkeys, ts);
+    if (nkeys < 0) return NULL;
+    if (nkeys == 0) {
+      snprintf(ctx->err, sizeof(ctx->err),
+               "JOIN %s needs an equality with a column of the tables before it.", ts[k]->name);
+      return NULL;
+    }
+
+    TableIndex* lix = k == 1 && nkeys == 1 ? int_index(ts[0], lkeys[0]) : NULL;
+    TableIndex* rix = nkeys == 1 ? int_index(ts[k], rkeys[0]) : NULL;
+    double build_pages = left_pages < ins[k].pages ? left_pages : ins[k].pages;
+    if (lix && rix && build_pages * PAGE_SIZE > (double)budget) {
+      left = ordered_scan(ctx, ts[0], lix, lwhere);
+      right = ordered_scan(ctx, ts[k], rix, rwhere);
+      op = left && right ? exec_merge_join(ctx, left, right, lkeys[0], rkeys[0]) : NULL;
+    } else {
+      if (k == 1) left = plan_scan(ctx, ts[0], lwhere);
+      right = plan_scan(ctx, ts[k], rwhere);
+      bool build_left = left_pages < ins[k].pages;
+      op = left && right ? exec_hash_join(ctx, left, right, lkeys, rkeys, nkeys, build_left)
+                         : NULL;
+    }
+    if (!op) return NULL;
+
+    joined |= 1u << k;
+    left_pages = left_pages > ins[k].pages ? left_pages : ins[k].pages;
+    op = filter_joined(ctx, op, conj, n, masks, used, joined);
+    if (!op) return NULL;
+  }
+
+  return op;
+}
+
+// ============================================================================
+// Ordering
+// ============================================================================
+
+// Projects the select items, named by their aliases, followed by the extra
+// input columns in map[nitems..n).
+static Operator* project_items(ExecCtx* ctx, const SelectStmt* st, Operator* op, const int* map,
+                               int n) {
+  op = exec_project(ctx, op, map, n);
+  if (!op) return NULL;
+  for (int i = 0; i < st->nitems; i++) {
+    const char* alias = st->items[i]->alias;
+    if (alias) snprintf(op->cols[i].name, sizeof(op->cols[i].name), "%s", alias);
+  }
+  return op;
+}
+
+// Plans ORDER BY and the projection of the select list. A key may name a
+// select item by its alias or any input column. The rows are narrowed to
+// the select items and the keys before they are sorted, and the keys that
+// are not selected are dropped again after.
+static Operator* plan_order(ExecCtx* ctx, SelectStmt* st, Operator* op, int* map) {
+  if (st->norder > EXEC_MAX_COLS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many ORDER BY columns.");
+    return NULL;
+  }
+
+  SortKey keys[EXEC_MAX_COLS];
+  for (int k = 0; k < st->norder; k++) {
+    Expr* e = st->order_by[k].column;
+    keys[k].desc = st->order_by[k].desc;
+    keys[k].col = -1;
+    for (int i = 0; i < st->nitems && !e->table && keys[k].col < 0; i++) {
+      const char* alias = st->items[i]->alias;
+      if (alias && strcasecmp(alias, e->column) == 0) keys[k].col = map[i];
+    }
+    if (keys[k].col < 0) {
+      if (!plan_bind_expr(ctx, e, op)) return NULL;
+      keys[k].col = e->col_idx;
+    }
+  }
+  // Only the rows up to the end of the LIMIT need to be kept in order.
+  int64_t wanted = st->limit;
+  if (wanted >= 0) wanted = wanted > INT64_MAX - st->offset ? INT64_MAX : wanted + st->offset;
+  if (st->nitems == 0) return exec_sort(ctx, op, keys, st->norder, wanted);
+
+  int n = st->nitems;
+  for (int k = 0; k < st->norder; k++) {
+    int pos = -1;
+    for (int i = 0; i < n && pos < 0; i++) {
+      if (map[i] == keys[k].col) pos = i;
+    }
+    if (pos < 0) {
+      if (n == EXEC_MAX_COLS) {
+        snprintf(ctx->err, sizeof(ctx->err), "Too many columns selected.");
+        return NULL;
+      }
+      pos = n;
+      map[n++] = keys[k].col;
+    }
+    keys[k].col = pos;
+  }
+
+  op = project_items(ctx, st, op, map, n);
+  op = op ? exec_sort(ctx, op, keys, st->norder, wanted) : NULL;
+  if (!op || n == st->nitems) return op;
+  for (int i = 0; i < st->nitems; i++) map[i] = i;
+  return exec_project(ctx, op, map, st->nitems);
+}
+
+// ============================================================================
+// Column pruning
+// ============================================================================
+
+// Marks the columns of a scan that a column reference in e may name. A
+// name is matched loosely, since wanting a column too many only costs
+// decoding it.
+static void want_expr(const Expr* e, const Operator* scan, bool* want) {
+  if (!e) return;
+  if (e->kind == EXPR_COLUMN) {
+    for (int i = 0; i < scan->ncols; i++) {
+      if (e->table && strcasecmp(e->table, scan->cols[i].table) != 0) continue;
+      if (strcasecmp(e->column, scan->cols[i].name) == 0) want[i] = true;
+    }
+    return;
+  }
+  want_expr(e->left, scan, want);
+  want_expr(e->right, scan, want);
+  for (int i = 0; i < e->nlist; i++) want_expr(e->list[i], scan, want);
+}
+
+// Limits every scan under op to the columns the statement names anywhere;
+// SELECT * reads them all. A COUNT(*) alone reads none and only counts rows.
+static void prune_scans(const SelectStmt* st, Operator* op) {
+  if (op->child) prune_scans(st, op->child);
+  if (op->right) prune_scans(st, op->right);
+  if (op->child || op->right) return;
+
+  bool want[EXEC_MAX_COLS];
+  for (int i = 0; i < op->ncols; i++) want[i] = st->nitems == 0;
+  for (int i = 0; i < st->nitems; i++) want_expr(st->items[i], op, want);
+  want_expr(st->where, op, want);
+  for (int i = 0; i < st->njoins; i++) want_expr(st->joins[i].on, op, want);
+  for (int i = 0; i < st->ngroup; i++) want_expr(st->group_by[i], op, want);
+  for (int i = 0; i < st->norder; i++) want_expr(st->order_by[i].column, op, want);
+  exec_scan_columns(op, want);
+}
+
+Operator* plan_select(ExecCtx* ctx, SelectStmt* st) {
+  Operator* op;
+  if (st->njoins > 0) {
+    op = plan_join(ctx, st);
+  } else {
+    TableInfo* t = plan_open_table(ctx, st->table);
+    op = t ? plan_scan(ctx, t, st->where) : NULL;
+  }
+  if (!op) return NULL;
+
+  if (st->nitems > EXEC_MAX_COLS) {
+    snprintf(ctx->err, sizeof(ctx->err), "Too many columns selected.");
+    return NULL;
+  }
+
+  int map[EXEC_MAX_COLS];
+  if (st->ngroup > 0 || has_aggregates(st)) {
+    op = plan_aggregate(ctx, st, op, map);
+    if (!op) return NULL;
+  } else {
+    for (int i = 0; i < st->nitems; i++) {
+      if (!plan_bind_expr(ctx, st->items[i], op)) return NULL;
+      map[i] = st->items[i]->col_idx;
+    }
+  }
+
+  if (st->norder > 0) op = plan_order(ctx, st, op, map);
+  else if (st->nitems > 0) op = project_items(ctx, st, op, map, st->nitems);
+  if (!op) return NULL;
+
+  if (st->limit >= 0 || st->offset > 0) op = exec_limit(ctx, op, st->limit, st->offset);
+  if (op) prune_scans(st, op);
+  return op;
+}
@@ -0,0 +1,143 @@
+#include "recovery.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void apply_ranges(Page* p, const WalRecord* rec, bool redo) {
+  const uint8_t* body = rec->body;
+
+  for (int i = 0; i < rec->nranges; i++) {
+    uint16_t off, len;
+    memcpy(&off, body, sizeof(off));
+    memcpy(&len, body + 2, sizeof(len));
+
+    const uint8_t* before = body + 4;
+    const uint8_t* after = before + len;
+    if ((size_t)off + len <= sizeof(Page)) {
+      memcpy((uint8_t*)p + off, redo ? after : before, len);
+    }
+    body += 4 + 2 * (size_t)len;
+  }
+}
+
+// Logged changes are relative to the page as disk_alloc_page initialized it.
+// If that initial write never reached the disk, start from the same image.
+static Page* fetch_for_replay(BufferPool* bp, uint32_t pid) {
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  if (p && p->hdr.free_end == 0) page_init(p, pid);
+  return p;
+}
+
+void recovery_run(BufferPool* bp, RecoveryStats* out) {
+  memset(out, 0, sizeof(*out));
+  LogManager* lm = bp->wal;
+  if (!lm) return;
+
+  WalReader r;
+  WalRecord rec;
+  wal_reader_open(lm, &r);
+
+  WalRecord* recs = NULL;
+  int n = 0, cap = 0;
+  uint32_t max_txn = 0;
+
+  // Analysis: load the records and find the highest transaction ID.
+  while (wal_reader_next(&r, &rec)) {
+    if (n == cap) {
+      cap = cap ? cap * 2 : 256;
+      recs = realloc(recs, sizeof(WalRecord) * (size_t)cap);
+    }
+    recs[n++] = rec;
+    if (rec.txn > max_txn) max_txn = rec.txn;
+  }
+
+  if (n == 0) {
+    wal_reader_close(&r);
+    return;
+  }
+
+  bool* committed = calloc((size_t)max_txn + 1, sizeof(bool));
+  committed[0] = true;
+  for (int i = 0; i < n; i++) {
+    if (recs[i].type == WAL_COMMIT) committed[recs[i].txn] = true;
+  }
+
+  lm->recovering = true;
+
+  // Redo: repeat history for every change the page has not seen yet.
+  int redone = 0;
+  for (int i = 0; i < n; i++) {
+    if (recs[i].type != WAL_UPDATE) continue;
+
+    Page* p = fetch_for_replay(bp, recs[i].page_id);
+    if (!p) continue;
+
+    bool apply = p->hdr.lsn < recs[i].lsn;
+    if (apply) {
+      apply_ranges(p, &recs[i], true);
+      p->hdr.lsn = recs[i].lsn;
+      redone++;
+    }
+    bp_unpin_page(bp, recs[i].page_id, apply);
+  }
+
+  // Undo: roll back uncommitted transactions, newest change first.
+  int undone = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    if (recs[i].type != WAL_UPDATE || committed[recs[i].txn]) continue;
+
+    Page* p = fetch_for_replay(bp, recs[i].page_id);
+    if (!p) continue;
+
+    apply_ranges(p, &recs[i], false);
+    bp_unpin_page(bp, recs[i].page_id, true);
+    undone++;
+  }
+
+  lm->recovering = false;
+
+  free(committed);
+  free(recs);
+  wal_reader_close(&r);
+
+  bp_checkpoint(bp);
+
+  out->records = n;
+  out->redone = redone;
+  out->undone = undone;
+}
+
+bool recovery_rollback(BufferPool* bp) {
+  LogManager* lm = bp->wal;
+  if (!lm) return false;
+  uint32_t txn = wal_current_txn();
+  if (txn == 0) return true;
+  if (!wal_flush(lm, lm->next_lsn - 1)) return false;
+
+  WalReader r;
+  WalRecord rec;
+  wal_reader_open(lm, &r);
+  WalRecord* recs = NULL;
+  int n = 0, cap = 0;
+  while (wal_reader_next(&r, &rec)) {
+    if (rec.type != WAL_UPDATE || rec.txn != txn) continue;
+    if (n == cap) {
+      cap = cap ? cap * 2 : 64;
+      recs = realloc(recs, sizeof(WalRecord) * (size_t)cap);
+    }
+    recs[n++] = rec;
+  }
+
+  // Unlike recovery, the restores are logged: they are changes of the
+  // transaction like the ones they undo.
+  for (int i = n - 1; i >= 0; i--) {
+    Page* p = bp_fetch_page(bp, recs[i].page_id, LATCH_EXCLUSIVE);
+    if (!p) continue;
+    apply_ranges(p, &recs[i], false);
+    bp_unpin_page(bp, recs[i].page_id, true);
+  }
+
+  free(recs);
+  wal_reader_close(&r);
+  return true;
+}
@@ -1,8 +1,27 @@
 #include "row.h"
+#include "toast.h"
+#include "vector.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
 #include <string.h>
+#include <strings.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#define ROW_MAX_FIELDS 64
+
+// Size of an out-of-line TEXT field in a format 1 row: tagged length
+// prefix, u32 length, u32 page ID.
+#define EXTERNAL_FIELD_LEN 10
+
+// Size of an out-of-line TEXT value in a format 2 row: u32 length, u32
+// page ID. The tag is in its start offset.
+#define EXTERNAL_VALUE_LEN 8
+
+// Longest format 2 row; offsets keep their top bit for the tag.
+#define ROW_MAX_LEN 0x7FFF
+
 static void write_u16(uint8_t* p, uint16_t v) {
   p[0] = (uint8_t)(v & 0xFF);
   p[1] = (uint8_t)(v >> 8);
@@ -10,163 +29,760 @@ static void write_u16(uint8_t* p, uint16_t v) {
 static uint16_t read_u16(const uint8_t* p) {
   return (uint16_t)(p[0] | (p[1] << 8));
 }
+static void write_u32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v & 0xFF);
+  p[1] = (uint8_t)((v >> 8) & 0xFF);
+  p[2] = (uint8_t)((v >> 16) & 0xFF);
+  p[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+static uint32_t read_u32(const uint8_t* p) {
+  return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 static int32_t read_i32_le(const uint8_t* p) {
-  return (int32_t)(((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+  return (int32_t)read_u32(p);
+}
+static void write_u64(uint8_t* p, uint64_t v) {
+  write_u32(p, (uint32_t)v);
+  write_u32(p + 4, (uint32_t)(v >> 32));
+}
+static uint64_t read_u64(const uint8_t* p) {
+  return (uint64_t)read_u32(p) | ((uint64_t)read_u32(p + 4) << 32);
 }
 
-int row_encode(const ColumnDef* cols, int ncols,
-               const char** values, int nvalues,
-               uint8_t* out, int out_cap) {
-  if (nvalues != ncols) return -1;
+// Bytes a column takes in the fixed-width part of a format 2 row, or 0
+// for TEXT, the one variable-length type.
+static int fixed_width(const ColumnDef* col) {
+  switch (col->type) {
+    case COL_INT: return 4;
+    case COL_BIGINT:
+    case COL_TIMESTAMP:
+    case COL_DOUBLE: return 8;
+    case COL_BOOL: return 1;
+    case COL_CHAR: return col->len;
+    default: return 0;
+  }
+}
+
+// Length of a CHAR(n) value of n bytes without its padding.
+static uint32_t char_len(const uint8_t* p, uint32_t n) {
+  while (n > 0 && p[n - 1] == ' ') n--;
+  return n;
+}
+
+// ============================================================================
+// Values
+// ============================================================================
+
+// Whether only white space is left.
+static bool at_end(const char* p) {
+  while (isspace((unsigned char)*p)) p++;
+  return *p == 0;
+}
+
+// Days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+static int64_t days_from_civil(int64_t y, int m, int d) {
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+
+// The date days after 1970-01-01.
+static void civil_from_days(int64_t days, int64_t* y, int* m, int* d) {
+  days += 719468;
+  int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  int64_t doe = days - era * 146097;
+  int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  int64_t mp = (5 * doy + 2) / 153;
+  *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+  *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+  *y = yoe + era * 400 + (*m <= 2);
+}
+
+// Reads exactly n digits.
+static bool read_digits(const char** p, int n, int* out) {
+  int v = 0;
+  for (int i = 0; i < n; i++) {
+    if (!isdigit((unsigned char)(*p)[i])) return false;
+    v = v * 10 + ((*p)[i] - '0');
+  }
+  *p += n;
+  *out = v;
+  return true;
+}
+
+static bool parse_timestamp(const char* s, int64_t* out) {
+  static const int mdays[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  const char* p = s;
+  while (isspace((unsigned char)*p)) p++;
+
+  int y, mo, d, h = 0, mi = 0, sec = 0, us = 0;
+  if (!read_digits(&p, 4, &y) || *p++ != '-' || !read_digits(&p, 2, &mo) || *p++ != '-' ||
+      !read_digits(&p, 2, &d)) {
+    return false;
+  }
+  if (mo < 1 || mo > 12 || d < 1 || d > mdays[mo - 1]) return false;
+  if (mo == 2 && d == 29 && !(y % 4 == 0 && (y % 100 != 0 || y % 400 == 0))) return false;
+
+  if ((*p == ' ' || *p == 'T') && isdigit((unsigned char)p[1])) {
+    p++;
+    if (!read_digits(&p, 2, &h) || *p++ != ':' || !read_digits(&p, 2, &mi)) return false;
+    if (*p == ':') {
+      p++;
+      if (!read_digits(&p, 2, &sec)) return false;
+      if (*p == '.') {
+        p++;
+        int n = 0;
+        for (; isdigit((unsigned char)*p); p++, n++) {
+          if (n < 6) us = us * 10 + (*p - '0');
+        }
+        if (n == 0) return false;
+        for (; n < 6; n++) us *= 10;
+      }
+    }
+    if (h > 23 || mi > 59 || sec > 59) return false;
+  }
+  if (*p == 'Z') p++;
+  if (!at_end(p)) return false;
+
+  int64_t secs = days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec;
+  *out = secs * 1000000 + us;
+  return true;
+}
+
+static int format_timestamp(int64_t ts, char* out, size_t cap) {
+  int64_t secs = ts / 1000000;
+  int64_t us = ts % 1000000;
+  if (us < 0) {
+    us += 1000000;
+    secs--;
+  }
+  int64_t days = secs / 86400;
+  int64_t rem = secs % 86400;
+  if (rem < 0) {
+    rem += 86400;
+    days--;
+  }
+  int64_t y;
+  int m, d;
+  civil_from_days(days, &y, &m, &d);
+
+  int n = snprintf(out, cap, "%04lld-%02d-%02d %02d:%02d:%02d", (long long)y, m, d,
+                   (int)(rem / 3600), (int)(rem / 60 % 60), (int)(rem % 60));
+  if (us) {
+    n += snprintf(cap > (size_t)n ? out + n : NULL, cap > (size_t)n ? cap - (size_t)n : 0,
+                  ".%06d", (int)us);
+  }
+  return n;
+}
+
+const char* row_type_name(ColumnType type) {
+  switch (type) {
+    case COL_INT: return "INT";
+    case COL_TEXT: return "TEXT";
+    case COL_BIGINT: return "BIGINT";
+    case COL_DOUBLE: return "DOUBLE";
+    case COL_BOOL: return "BOOL";
+    case COL_TIMESTAMP: return "TIMESTAMP";
+    case COL_CHAR: return "CHAR";
+  }
+  return "?";
+}
+
+int row_parse_value(ColumnType type, const char* v, RowField* out) {
+  memset(out, 0, sizeof(*out));
+  out->type = type;
+  out->toast_pid = INVALID_PID;
+
+  char* end;
+  errno = 0;
+  switch (type) {
+    case COL_INT:
+    case COL_BIGINT:
+    case COL_TIMESTAMP: {
+      if (type == COL_TIMESTAMP && parse_timestamp(v, &out->i64)) return 0;
+      long long n = strtoll(v, &end, 10);
+      if (end == v || !at_end(end) || errno == ERANGE) return -1;
+      if (type != COL_INT) {
+        out->i64 = n;
+      } else {
+        if (n < INT32_MIN || n > INT32_MAX) return -1;
+        out->i32 = (int32_t)n;
+      }
+      return 0;
+    }
+    case COL_DOUBLE:
+      out->f64 = strtod(v, &end);
+      if (end == v || !at_end(end) || isnan(out->f64)) return -1;
+      return 0;
+    case COL_BOOL: {
+      while (isspace((unsigned char)*v)) v++;
+      size_t n = strcspn(v, " \t\r\n");
+      if (!at_end(v + n)) return -1;
+      if ((n == 4 && strncasecmp(v, "true", 4) == 0) || (n == 1 && strchr("tT1", *v))) {
+        out->i32 = 1;
+      } else if (!(n == 5 && strncasecmp(v, "false", 5) == 0) && !(n == 1 && strchr("fF0", *v))) {
+        return -1;
+      }
+      return 0;
+    }
+    case COL_TEXT:
+    case COL_CHAR:
+      out->text = (const uint8_t*)v;
+      out->text_len = (uint32_t)strlen(v);
+      if (type == COL_CHAR) out->text_len = char_len(out->text, out->text_len);
+      return 0;
+  }
+  return -1;
+}
+
+int row_format_value(const RowField* v, char* out, size_t cap) {
+  switch (v->type) {
+    case COL_INT:
+      return snprintf(out, cap, "%d", v->i32);
+    case COL_BIGINT:
+      return snprintf(out, cap, "%lld", (long long)v->i64);
+    case COL_BOOL:
+      return snprintf(out, cap, "%s", v->i32 ? "true" : "false");
+    case COL_TIMESTAMP:
+      return format_timestamp(v->i64, out, cap);
+    case COL_DOUBLE: {
+      // The shortest of the usual precisions that reads back exactly.
+      char buf[32];
+      snprintf(buf, sizeof(buf), "%.15g", v->f64);
+      if (strtod(buf, NULL) != v->f64) snprintf(buf, sizeof(buf), "%.17g", v->f64);
+      return snprintf(out, cap, "%s", buf);
+    }
+    default:
+      return snprintf(out, cap, "%s", "");
+  }
+}
+
+// Computes where each column lives in a format 2 row: a fixed-width value,
+// or the entry of a variable-length one in the offset array. Returns the
+// start of the offset array, and the number of variable-length columns in
+// *nvar.
+static int layout_offsets(const ColumnDef* cols, int ncols, uint16_t* off, int* nvar) {
+  int fixed = 0;
+  *nvar = 0;
+  for (int i = 0; i < ncols; i++) {
+    if (cols[i].type == COL_TEXT) (*nvar)++;
+    else fixed += fixed_width(&cols[i]);
+  }
+
+  int pos = 2 + (ncols + 7) / 8;
+  int offsets = pos + fixed;
+  int var = 0;
+  for (int i = 0; i < ncols; i++) {
+    if (cols[i].type == COL_TEXT) {
+      off[i] = (uint16_t)(offsets + 2 * var++);
+    } else {
+      off[i] = (uint16_t)pos;
+      pos += fixed_width(&cols[i]);
+    }
+  }
+  return offsets;
+}
+
+void row_layout(ColumnDef* cols, int ncols) {
+  uint16_t off[ROW_MAX_FIELDS];
+  int nvar;
+  if (ncols > ROW_MAX_FIELDS) return;
+  layout_offsets(cols, ncols, off, &nvar);
+  for (int i = 0; i < ncols; i++) cols[i].row_off = off[i];
+}
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+/**
+ * One column's value on its way into an encoded row.
+ */
+typedef struct {
+  int is_null;
+  union {
+    int32_t i32;
+    int64_t i64;
+    double f64;
+  };
+  const uint8_t* text; ///< Inline bytes, or NULL for an existing chain
+  uint32_t len;
+  uint32_t pid; ///< Existing overflow chain, or INVALID_PID
+  int toast; ///< Set when the value is to be moved out of line
+} FieldSrc;
+
+// Takes a value that is known to suit its column.
+static void field_from(const RowField* v, FieldSrc* f) {
+  memset(f, 0, sizeof(*f));
+  f->is_null = v->is_null;
+  f->pid = INVALID_PID;
+  if (v->is_null) return;
+
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: f->i32 = v->i32; break;
+    case VAL_I64: f->i64 = v->i64; break;
+    case VAL_F64: f->f64 = v->f64; break;
+    case VAL_TEXT:
+      f->text = v->text;
+      f->len = v->text_len;
+      f->pid = v->toast_pid;
+      break;
+  }
+}
+
+static int parse_value(const ColumnDef* col, const char* v, FieldSrc* f) {
+  RowField r;
+  if (v == NULL || strcasecmp(v, "null") == 0) {
+    r.is_null = true;
+  } else if (row_parse_value(col->type, v, &r) < 0) {
+    return -1;
+  } else if (col->type == COL_CHAR && r.text_len > col->len) {
+    return -1;
+  }
+  field_from(&r, f);
+  return 0;
+}
+
+static int is_external(const FieldSrc* f) {
+  return f->pid != INVALID_PID || f->toast;
+}
+
+// Bytes a value takes in the variable-length part of a format 2 row.
+static int var_size(const ColumnDef* col, const FieldSrc* f) {
+  if (f->is_null || col->type != COL_TEXT) return 0;
+  return is_external(f) ? EXTERNAL_VALUE_LEN : (int)f->len;
+}
+
+// Writes a fixed-width value, or zeros for NULL.
+static void write_fixed(const ColumnDef* col, const FieldSrc* f, uint8_t* p) {
+  int w = fixed_width(col);
+  if (f->is_null) {
+    memset(p, 0, (size_t)w);
+    return;
+  }
+  switch (col->type) {
+    case COL_INT:
+      write_u32(p, (uint32_t)f->i32);
+      break;
+    case COL_BIGINT:
+    case COL_TIMESTAMP:
+      write_u64(p, (uint64_t)f->i64);
+      break;
+    case COL_DOUBLE: {
+      uint64_t bits;
+      memcpy(&bits, &f->f64, sizeof(bits));
+      write_u64(p, bits);
+      break;
+    }
+    case COL_BOOL:
+      p[0] = f->i32 != 0;
+      break;
+    default:
+      memcpy(p, f->text, f->len);
+      memset(p + f->len, ' ', (size_t)w - f->len);
+      break;
+  }
+}
 
-  int pos = 0;
-  if (out_cap < 2) return -1;
-  write_u16(out + pos, (uint16_t)ncols);
-  pos += 2;
+// Writes a format 2 row: the header and null bitmap, the fixed-width
+// values, with zeros for NULL, then the start offset of each
+// variable-length value followed by the end of the last one, then those
+// values back to back.
+static int encode_fields(BufferPool* bp, const ColumnDef* cols, int ncols,
+                         FieldSrc* f, uint8_t* out, int out_cap) {
+  uint16_t off[ROW_MAX_FIELDS];
+  int nvar;
+  int offsets = layout_offsets(cols, ncols, off, &nvar);
+  int var_start = offsets + (nvar ? 2 * (nvar + 1) : 0);
+  long total = var_start;
+  for (int i = 0; i < ncols; i++) total += var_size(&cols[i], &f[i]);
+
+  // Move the largest inline values out until the row is small enough.
+  while (bp && total > ROW_TOAST_TARGET) {
+    int best = -1;
+    for (int i = 0; i < ncols; i++) {
+      if (cols[i].type != COL_TEXT || f[i].is_null || is_external(&f[i])) continue;
+      if (f[i].len <= EXTERNAL_VALUE_LEN) continue;
+      if (best < 0 || f[i].len > f[best].len) best = i;
+    }
+    if (best < 0) break;
+    f[best].toast = 1;
+    total -= (long)f[best].len - EXTERNAL_VALUE_LEN;
+  }
+  if (total > ROW_MAX_LEN || total > out_cap) return -1;
 
-  int null_bytes = (ncols + 7) / 8;
-  if (pos + null_bytes > out_cap) return -1;
-  memset(out + pos, 0, null_bytes);
-  uint8_t* nullmap = out + pos;
-  pos += null_bytes;
+  write_u16(out, (uint16_t)(ncols | ROW_FORMAT_V2));
+  uint8_t* nullmap = out + 2;
+  memset(nullmap, 0, (size_t)(ncols + 7) / 8);
 
+  int pos = var_start;
   for (int i = 0; i < ncols; i++) {
-    const char* v = values[i];
-    int is_null = (v == NULL) || (strcasecmp(v, "null") == 0);
+    if (f[i].is_null) nullmap[i / 8] |= (1u << (i % 8));
 
-    if (is_null) {
-      nullmap[i / 8] |= (1u << (i % 8));
+    if (cols[i].type != COL_TEXT) {
+      write_fixed(&cols[i], &f[i], out + off[i]);
       continue;
     }
 
-    if (cols[i].type == COL_INT) {
-      long v = strtol(values[i], NULL, 10);
-      if (pos + 4 > out_cap) return -1;
-      out[pos+0] = (uint8_t)(v & 0xFF);
-      out[pos+1] = (uint8_t)((v >> 8) & 0xFF);
-      out[pos+2] = (uint8_t)((v >> 16) & 0xFF);
-      out[pos+3] = (uint8_t)((v >> 24) & 0xFF);
-      pos += 4;
-    } else if (cols[i].type == COL_TEXT) {
-      uint16_t L = (uint16_t)strlen(values[i]);
-      if (pos + 2 + L > out_cap) return -1;
-      write_u16(out + pos, L);
-      pos += 2;
-      memcpy(out + pos, values[i], L);
-      pos += L;
-    } else {
-      return -1;
+    // A NULL is empty, so the next value starts at the same offset.
+    uint16_t tag = 0;
+    int start = pos;
+    if (is_external(&f[i])) {
+      uint32_t pid = f[i].toast ? toast_store(bp, f[i].text, f[i].len) : f[i].pid;
+      write_u32(out + pos, f[i].len);
+      write_u32(out + pos + 4, pid);
+      pos += EXTERNAL_VALUE_LEN;
+      tag = ROW_TEXT_EXTERNAL;
+    } else if (!f[i].is_null) {
+      memcpy(out + pos, f[i].text, f[i].len);
+      pos += (int)f[i].len;
     }
+    write_u16(out + off[i], (uint16_t)(start | tag));
   }
+  if (nvar) write_u16(out + offsets + 2 * nvar, (uint16_t)pos);
 
   return pos;
 }
 
-int row_decode(const ColumnDef* cols, int ncols,
+int row_encode(BufferPool* bp, const ColumnDef* cols, int ncols,
+               const char** values, int nvalues,
+               uint8_t* out, int out_cap) {
+  if (nvalues != ncols || ncols > ROW_MAX_FIELDS) return -1;
+
+  FieldSrc f[ROW_MAX_FIELDS];
+  for (int i = 0; i < ncols; i++) {
+    if (parse_value(&cols[i], values[i], &f[i]) < 0) return -1;
+  }
+  return encode_fields(bp, cols, ncols, f, out, out_cap);
+}
+
+int row_invalid_value(const ColumnDef* cols, const char** values, int nvalues) {
+  FieldSrc f;
+  for (int i = 0; i < nvalues; i++) {
+    if (parse_value(&cols[i], values[i], &f) < 0) return i;
+  }
+  return -1;
+}
+
+int row_set_fields(BufferPool* bp, const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len,
+                   const int* idx, const char** values, int nset,
+                   uint8_t* out, int out_cap) {
+  if (ncols > ROW_MAX_FIELDS) return -1;
+
+  RowField v[ROW_MAX_FIELDS];
+  if (row_get_fields(cols, ncols, row, row_len, v) < 0) return -1;
+
+  FieldSrc f[ROW_MAX_FIELDS];
+  for (int i = 0; i < ncols; i++) field_from(&v[i], &f[i]);
+
+  for (int k = 0; k < nset; k++) {
+    if (idx[k] < 0 || idx[k] >= ncols) return -1;
+    if (parse_value(&cols[idx[k]], values[k], &f[idx[k]]) < 0) return -1;
+  }
+
+  return encode_fields(bp, cols, ncols, f, out, out_cap);
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+// Appends up to n bytes while there is room and counts all of them, so the
+// caller learns the full length even when the output is truncated.
+static void append(char* out, int cap, int* written, const char* s, size_t n) {
+  if (*written < cap - 1) {
+    size_t room = (size_t)(cap - 1 - *written);
+    memcpy(out + *written, s, n < room ? n : room);
+  }
+  *written += (int)n;
+}
+
+int row_decode(BufferPool* bp, const ColumnDef* cols, int ncols,
                const uint8_t* row, int row_len,
                char* out_text, int out_cap) {
-  int pos = 0;
-  if (row_len < 2) return -1;
-
-  uint16_t stored = read_u16(row);
-  pos += 2;
-  if (stored != ncols) return -1;
+  if (out_cap < 1 || ncols > ROW_MAX_FIELDS) return -1;
 
-  int null_bytes = (ncols + 7) / 8;
-  if (pos + null_bytes > row_len) return -1;
-  const uint8_t* nullmap = row + pos;
-  pos += null_bytes;
+  RowField fields[ROW_MAX_FIELDS];
+  if (row_get_fields(cols, ncols, row, row_len, fields) < 0) return -1;
 
   int written = 0;
   for (int i = 0; i < ncols; i++) {
-    if (written + 4 >= out_cap) return -1;
+    const RowField v = fields[i];
+    append(out_text, out_cap, &written, cols[i].col, strlen(cols[i].col));
+    append(out_text, out_cap, &written, "=", 1);
 
-    int is_null = (nullmap[i / 8] >> (i % 8)) & 1u;
-
-    if (is_null) {
-      written += snprintf(out_text + written, out_cap - written,
-                          "%s=NULL%s",
-                          cols[i].col, (i==ncols-1?"":" | "));
-      continue;
+    if (v.is_null) {
+      append(out_text, out_cap, &written, "NULL", 4);
+    } else if (!row_is_text(v.type)) {
+      char num[40];
+      int n = row_format_value(&v, num, sizeof(num));
+      append(out_text, out_cap, &written, num, (size_t)n);
+    } else if (v.toast_pid == INVALID_PID) {
+      append(out_text, out_cap, &written, (const char*)v.text, v.text_len);
+    } else {
+      char* buf = malloc(v.text_len);
+      if (!buf) return -1;
+      uint32_t n = toast_fetch(bp, v.toast_pid, (uint8_t*)buf, v.text_len);
+      append(out_text, out_cap, &written, buf, n);
+      free(buf);
     }
 
-    if (cols[i].type == COL_INT) {
-      if (pos + 4 > row_len) return -1;
-      int32_t v =
-        (int32_t)(row[pos] |
-                 (row[pos+1] << 8) |
-                 (row[pos+2] << 16) |
-                 (row[pos+3] << 24));
-      pos += 4;
-      written += snprintf(out_text + written, out_cap - written,
-                          "%s=%d%s",
-                          cols[i].col, v, (i==ncols-1?"":" | "));
-    } else if (cols[i].type == COL_TEXT) {
-      if (pos + 2 > row_len) return -1;
-      uint16_t L = read_u16(row + pos);
-      pos += 2;
-      if (pos + L > row_len) return -1;
-
-      char buf[256];
-      int cpy = (L < sizeof(buf)-1)? L : (int)sizeof(buf)-1;
-      memcpy(buf, row + pos, cpy);
-      buf[cpy] = 0;
-      pos += L;
-
-      written += snprintf(out_text + written, out_cap - written,
-                          "%s=%s%s",
-                          cols[i].col, buf, (i==ncols-1?"":" | "));
-    }
+    if (i != ncols - 1) append(out_text, out_cap, &written, " | ", 3);
   }
 
+  out_text[written < out_cap ? written : out_cap - 1] = 0;
   return written;
 }
 
-int row_decode_values(const ColumnDef* cols, int ncols,
-                      const uint8_t* row, int row_len,
-                      DecodedValue* out_vals,
-                      char* text_scratch, int scratch_cap) {
-  int pos = 0;
-  if (row_len < 2) return -1;
+// ============================================================================
+// Field access
+// ============================================================================
 
-  uint16_t stored = read_u16(row);
-  pos += 2;
-  if (stored != ncols) return -1;
+// One encoded row being decoded. A format 1 row is walked in column
+// order; a format 2 row needs no position, as every column is found from
+// its row_off.
+typedef struct {
+  const uint8_t* row;
+  int len;
+  bool v2; ///< Format 2 row; otherwise format 1
+  const uint8_t* nullmap;
+  int pos; ///< Format 1: next stored field
+} RowCursor;
 
-  int null_bytes = (ncols + 7) / 8;
-  if (pos + null_bytes > row_len) return -1;
-  const uint8_t* nullmap = row + pos;
-  pos += null_bytes;
+static int cursor_init(RowCursor* c, int ncols, const uint8_t* row, int row_len) {
+  if (ncols > ROW_MAX_FIELDS || row_len < 2) return -1;
+  uint16_t head = read_u16(row);
+  if ((head & ~ROW_FORMAT_V2) != ncols) return -1;
 
-  int scratch_off = 0;
+  c->row = row;
+  c->len = row_len;
+  c->v2 = (head & ROW_FORMAT_V2) != 0;
+  c->nullmap = row + 2;
+  c->pos = 2 + (ncols + 7) / 8;
+  return c->pos > row_len ? -1 : 0;
+}
 
-  for (int i = 0; i < ncols; i++) {
-    out_vals[i].type = cols[i].type;
-    out_vals[i].is_null = (nullmap[i/8] >> (i%8)) & 1u;
-
-    if (out_vals[i].is_null) continue;
-
-    if (cols[i].type == COL_INT) {
-      if (pos + 4 > row_len) return -1;
-      out_vals[i].i32 = read_i32_le(row + pos);
-      pos += 4;
-    } else if (cols[i].type == COL_TEXT) {
-      if (pos + 2 > row_len) return -1;
-      uint16_t L = read_u16(row + pos);
-      pos += 2;
-      if (pos + L > row_len) return -1;
-
-      if (scratch_off + L + 1 > scratch_cap) return -1;
-      memcpy(text_scratch + scratch_off, row + pos, L);
-      text_scratch[scratch_off + L] = 0;
-
-      out_vals[i].text = text_scratch + scratch_off;
-      scratch_off += L + 1;
-      pos += L;
-    } else {
+static bool cursor_is_null(const RowCursor* c, int i) {
+  return (c->nullmap[i / 8] >> (i % 8)) & 1u;
+}
+
+// Reads a TEXT value of n bytes at p, inline or out of line.
+static void read_text(const uint8_t* p, uint32_t n, bool external, RowField* out) {
+  if (external) {
+    out->text = NULL;
+    out->text_len = read_u32(p);
+    out->toast_pid = read_u32(p + 4);
+  } else {
+    out->text = p;
+    out->text_len = n;
+    out->toast_pid = INVALID_PID;
+  }
+}
+
+// Reads a non-NULL column of a format 2 row straight from where the
+// schema puts it.
+static inline int read_v2(const RowCursor* c, const ColumnDef* col, RowField* out) {
+  int at = col->row_off;
+  if (at == 0) return -1; // The schema was not laid out with row_layout.
+
+  if (col->type == COL_INT) {
+    if (at + 4 > c->len) return -1;
+    out->i32 = read_i32_le(c->row + at);
+    return 1;
+  }
+  if (col->type != COL_TEXT) {
+    int w = fixed_width(col);
+    if (at + w > c->len) return -1;
+    const uint8_t* p = c->row + at;
+    switch (col->type) {
+      case COL_BIGINT:
+      case COL_TIMESTAMP:
+        out->i64 = (int64_t)read_u64(p);
+        break;
+      case COL_DOUBLE: {
+        uint64_t bits = read_u64(p);
+        memcpy(&out->f64, &bits, sizeof(bits));
+        break;
+      }
+      case COL_BOOL:
+        out->i32 = p[0] != 0;
+        break;
+      default:
+        read_text(p, char_len(p, (uint32_t)w), false, out);
+        break;
+    }
+    return 1;
+  }
+  if (at + 4 > c->len) return -1;
+  uint16_t start = read_u16(c->row + at);
+  int end = read_u16(c->row + at + 2) & ~ROW_TEXT_EXTERNAL;
+  bool external = (start & ROW_TEXT_EXTERNAL) != 0;
+  start &= ~ROW_TEXT_EXTERNAL;
+  if (end < start || end > c->len) return -1;
+  if (external && end - start != EXTERNAL_VALUE_LEN) return -1;
+  read_text(c->row + start, (uint32_t)(end - start), external, out);
+  return 1;
+}
+
+// Reads the next stored field of a format 1 row into out, or only steps
+// over it with out NULL. NULL columns are not stored, so the caller skips
+// them. Returns 0 on success, -1 if the row is malformed.
+static int walk_v1(RowCursor* c, ColumnType type, RowField* out) {
+  if (type == COL_INT) {
+    if (c->pos + 4 > c->len) return -1;
+    if (out) out->i32 = read_i32_le(c->row + c->pos);
+    c->pos += 4;
+  } else if (type == COL_TEXT) {
+    if (c->pos + 2 > c->len) return -1;
+    uint16_t L = read_u16(c->row + c->pos);
+    bool external = (L & ROW_TEXT_EXTERNAL) != 0;
+    int n = external ? EXTERNAL_FIELD_LEN : 2 + L;
+    if (c->pos + n > c->len) return -1;
+    if (out) read_text(c->row + c->pos + 2, L, external, out);
+    c->pos += n;
+  } else {
+    return -1;
+  }
+  return 0;
+}
+
+int row_get_field(const ColumnDef* cols, int ncols,
+                  const uint8_t* row, int row_len,
+                  int idx, RowField* out) {
+  RowCursor c;
+  if (idx < 0 || idx >= ncols || cursor_init(&c, ncols, row, row_len) < 0) return -1;
+
+  out->type = cols[idx].type;
+  out->is_null = cursor_is_null(&c, idx);
+  if (out->is_null) return 0;
+  if (c.v2) return read_v2(&c, &cols[idx], out);
+
+  // Skip the non-NULL fields stored ahead of the requested column.
+  for (int i = 0; i < idx; i++) {
+    if (!cursor_is_null(&c, i) && walk_v1(&c, cols[i].type, NULL) < 0) return -1;
+  }
+  return walk_v1(&c, cols[idx].type, out) < 0 ? -1 : 1;
+}
+
+int row_get_fields(const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len, RowField* out) {
+  return row_get_wanted(cols, ncols, row, row_len, NULL, ncols, out);
+}
+
+int row_get_wanted(const ColumnDef* cols, int ncols,
+                   const uint8_t* row, int row_len,
+                   const bool* want, int nread, RowField* out) {
+  RowCursor c;
+  if (cursor_init(&c, ncols, row, row_len) < 0) return -1;
+
+  for (int i = nread; i < ncols; i++) {
+    out[i].type = cols[i].type;
+    out[i].is_null = true;
+  }
+  for (int i = 0; i < nread; i++) {
+    RowField* f = &out[i];
+    f->type = cols[i].type;
+    f->is_null = cursor_is_null(&c, i);
+    if (f->is_null) continue;
+
+    bool wanted = !want || want[i];
+    if (c.v2) {
+      if (wanted && read_v2(&c, &cols[i], f) < 0) return -1;
+    } else if (walk_v1(&c, cols[i].type, wanted ? f : NULL) < 0) {
       return -1;
     }
+    if (!wanted) f->is_null = true;
+  }
+  return 0;
+}
+
+int row_gather_column(const ColumnDef* cols, int ncols, int col,
+                      uint8_t* const* rows, const uint16_t* lens, const uint16_t* idx, int n,
+                      ColumnVector* v, int pos) {
+  if (col < 0 || col >= ncols || ncols > ROW_MAX_FIELDS) return -1;
+
+  // An INT or the bounds of a TEXT are at the same offset in every format
+  // 2 row, so those rows are copied in a tight loop; format 1 rows, other
+  // types and out-of-line TEXT go through row_get_field.
+  const ColumnDef* cd = &cols[col];
+  bool fast = (cd->type == COL_INT || cd->type == COL_TEXT) && cd->row_off != 0;
+  int at = cd->row_off;
+  uint16_t v2_head = (uint16_t)(ncols | ROW_FORMAT_V2);
+  int null_byte = 2 + col / 8;
+  uint8_t null_bit = (uint8_t)(1u << (col % 8));
+
+  for (int k = 0; k < n; k++) {
+    int i = idx ? idx[k] : k;
+    const uint8_t* row = rows[i];
+    int p = pos + k;
+    if (fast && lens[i] >= at + 4 && read_u16(row) == v2_head) {
+      if (row[null_byte] & null_bit) {
+        RowField f = { .type = cd->type, .is_null = true };
+        vector_set(v, p, &f);
+        continue;
+      }
+      if (v->has_nulls) v->nulls[p >> 6] &= ~(1ull << (p & 63));
+      if (cd->type == COL_INT) {
+        v->i32[p] = read_i32_le(row + at);
+        continue;
+      }
+      uint16_t start = read_u16(row + at);
+      int end = read_u16(row + at + 2) & ~ROW_TEXT_EXTERNAL;
+      if (!(start & ROW_TEXT_EXTERNAL)) {
+        if (end < start || end > lens[i]) return -1;
+        uint32_t len = (uint32_t)(end - start);
+        if (v->text_used + len > VECTOR_TEXT_BYTES) return k;
+        memcpy(v->text + v->text_used, row + start, len);
+        v->text_off[p] = v->text_used;
+        v->text_len[p] = len;
+        v->toast_pid[p] = INVALID_PID;
+        v->text_used += len;
+        continue;
+      }
+    }
+
+    RowField f;
+    if (row_get_field(cols, ncols, row, lens[i], col, &f) < 0) return -1;
+    if (!vector_set(v, p, &f)) return k;
   }
+  return n;
+}
 
-  return ncols;
+uint32_t row_field_text(BufferPool* bp, const RowField* f, uint8_t* out, uint32_t n) {
+  if (n > f->text_len) n = f->text_len;
+  if (f->toast_pid != INVALID_PID) return toast_fetch(bp, f->toast_pid, out, n);
+  memcpy(out, f->text, n);
+  return n;
+}
+
+// ============================================================================
+// Overflow chains
+// ============================================================================
+
+static int row_references(const ColumnDef* cols, int ncols,
+                          const uint8_t* row, int row_len, uint32_t pid) {
+  for (int i = 0; i < ncols; i++) {
+    RowField v;
+    if (cols[i].type != COL_TEXT) continue;
+    if (row_get_field(cols, ncols, row, row_len, i, &v) > 0 && v.toast_pid == pid) return 1;
+  }
+  return 0;
+}
+
+void row_release(BufferPool* bp, const ColumnDef* cols, int ncols,
+                 const uint8_t* row, int row_len,
+                 const uint8_t* keep, int keep_len) {
+  for (int i = 0; i < ncols; i++) {
+    RowField v;
+    if (cols[i].type != COL_TEXT) continue;
+    if (row_get_field(cols, ncols, row, row_len, i, &v) <= 0) continue;
+    if (v.toast_pid == INVALID_PID) continue;
+    if (keep && row_references(cols, ncols, keep, keep_len, v.toast_pid)) continue;
+    toast_release(bp, v.toast_pid);
+  }
 }
@@ -0,0 +1,618 @@
+#include "sort.h"
+#include "spill.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ranges this short are finished by insertion sort.
+#define SORT_INSERTION_MAX 16
+
+// A row held in memory. The prefix orders rows by their first key as far
+// as its leading bytes go, so only rows with equal prefixes compare values.
+typedef struct {
+  uint64_t prefix;
+  RowField* vals; ///< Values of the row, followed by its inline TEXT bytes
+} SortEntry;
+
+// A run being merged, with its current row.
+typedef struct {
+  SpillReader r;
+  Batch b;
+  int pos; ///< Row of b that cur holds
+  bool done;
+  SortEntry cur;
+  RowField row[EXEC_MAX_COLS]; ///< Values cur points to
+} MergeSource;
+
+typedef struct {
+  Operator base;
+  int nkeys;
+  SortKey keys[EXEC_MAX_COLS];
+  bool prefix_exact; ///< Equal prefixes mean equal first keys, so compare skips them
+  int64_t limit;
+  size_t budget;
+  int fanin;
+  BatchReader reader;
+
+  // Rows in memory
+  Arena mem; ///< Copies of the rows
+  size_t mem_used; ///< Bytes of row copies and of the entries array
+  size_t live; ///< Bytes of the copies still in the heap, for top-N
+  SortEntry* entries;
+  size_t nentries;
+  size_t cap;
+  bool top_n; ///< entries is a heap of the best rows, worst at the root
+
+  // Runs
+  FILE** runs;
+  int nruns;
+  int runs_cap;
+  MergeSource* src; ///< fanin sources, allocated at the first merge
+  int nsrc;
+  int* tree; ///< tree[0] is the source with the next row, tree[1..nsrc) the losers
+  bool advance; ///< The winner's row has been handed out
+
+  bool sorted; ///< The input has been consumed
+  bool merging; ///< Output comes from merging runs rather than from entries
+  size_t emit_pos;
+  int64_t emitted;
+
+  SortStats stats;
+} SortOp;
+
+static bool out_of_memory(SortOp* s) {
+  snprintf(s->base.ctx->err, sizeof(s->base.ctx->err), "Out of memory.");
+  return false;
+}
+
+// ============================================================================
+// Comparison
+// ============================================================================
+
+// Maps the first key to an unsigned number in the same order, NULLs last.
+// Numbers map whole: integers with their sign bit flipped, and doubles
+// with it flipped when positive or every bit flipped when negative. Text
+// maps its first 8 bytes.
+static uint64_t key_prefix(SortOp* s, const RowField* v) {
+  uint64_t p = 0;
+  if (v->is_null) {
+    p = UINT64_MAX;
+  } else if (row_value_kind(v->type) == VAL_I32) {
+    p = (uint32_t)v->i32 ^ 0x80000000u;
+  } else if (row_value_kind(v->type) == VAL_I64) {
+    p = (uint64_t)v->i64 ^ (1ull << 63);
+  } else if (row_value_kind(v->type) == VAL_F64) {
+    double d = v->f64 == 0 ? 0 : v->f64;
+    memcpy(&p, &d, sizeof(p));
+    p = p >> 63 ? ~p : p ^ (1ull << 63);
+  } else {
+    uint8_t b[8] = { 0 };
+    if (v->toast_pid == INVALID_PID) memcpy(b, v->text, v->text_len < 8 ? v->text_len : 8);
+    else row_field_text(s->base.ctx->bp, v, b, 8);
+    for (int i = 0; i < 8; i++) p = p << 8 | b[i];
+  }
+  return s->keys[0].desc ? ~p : p;
+}
+
+static int compare(SortOp* s, const SortEntry* a, const SortEntry* b) {
+  if (a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+
+  for (int k = s->prefix_exact; k < s->nkeys; k++) {
+    const RowField* x = &a->vals[s->keys[k].col];
+    const RowField* y = &b->vals[s->keys[k].col];
+    int c;
+    if (x->is_null || y->is_null) c = (int)x->is_null - (int)y->is_null;
+    else c = exec_compare(s->base.ctx->bp, x, y);
+    if (c) return s->keys[k].desc ? -c : c;
+  }
+  return 0;
+}
+
+static void swap(SortEntry* a, SortEntry* b) {
+  SortEntry t = *a;
+  *a = *b;
+  *b = t;
+}
+
+// Quicksort with a median-of-three pivot, recursing into the smaller side.
+static void sort_entries(SortOp* s, SortEntry* e, size_t n) {
+  while (n > SORT_INSERTION_MAX) {
+    size_t m = n / 2;
+    if (compare(s, &e[m], &e[0]) < 0) swap(&e[m], &e[0]);
+    if (compare(s, &e[n - 1], &e[0]) < 0) swap(&e[n - 1], &e[0]);
+    if (compare(s, &e[n - 1], &e[m]) < 0) swap(&e[n - 1], &e[m]);
+    SortEntry pivot = e[m];
+
+    size_t i = 0, j = n - 1;
+    while (1) {
+      while (compare(s, &e[i], &pivot) < 0) i++;
+      while (compare(s, &pivot, &e[j]) < 0) j--;
+      if (i >= j) break;
+      swap(&e[i++], &e[j--]);
+    }
+
+    size_t left = j + 1;
+    if (left < n - left) {
+      sort_entries(s, e, left);
+      e += left;
+      n -= left;
+    } else {
+      sort_entries(s, e + left, n - left);
+      n = left;
+    }
+  }
+
+  for (size_t i = 1; i < n; i++) {
+    SortEntry x = e[i];
+    size_t j = i;
+    for (; j > 0 && compare(s, &x, &e[j - 1]) < 0; j--) e[j] = e[j - 1];
+    e[j] = x;
+  }
+}
+
+// ============================================================================
+// Rows in memory
+// ============================================================================
+
+static size_t row_bytes(const SortOp* s, const RowField* vals) {
+  size_t n = sizeof(RowField) * (size_t)s->base.ncols;
+  for (int c = 0; c < s->base.ncols; c++) {
+    const RowField* v = &vals[c];
+    if (!v->is_null && row_is_text(v->type) && v->toast_pid == INVALID_PID) n += v->text_len;
+  }
+  return (n + 15) & ~(size_t)15;
+}
+
+// Copies a row into mem. Out-of-line values keep their overflow pages,
+// which stay valid for the whole statement.
+static RowField* copy_row(SortOp* s, const RowField* vals, size_t* bytes) {
+  *bytes = row_bytes(s, vals);
+  RowField* out = arena_alloc(&s->mem, *bytes);
+  if (!out) return NULL;
+
+  uint8_t* text = (uint8_t*)(out + s->base.ncols);
+  for (int c = 0; c < s->base.ncols; c++) {
+    out[c] = vals[c];
+    const RowField* v = &vals[c];
+    if (!v->is_null && row_is_text(v->type) && v->toast_pid == INVALID_PID) {
+      memcpy(text, v->text, v->text_len);
+      out[c].text = text;
+      text += v->text_len;
+    }
+  }
+  s->mem_used += *bytes;
+  return out;
+}
+
+static bool push_entry(SortOp* s, const SortEntry* e, size_t* bytes) {
+  if (s->nentries == s->cap) {
+    size_t cap = s->cap ? s->cap * 2 : 64;
+    SortEntry* grown = realloc(s->entries, sizeof(SortEntry) * cap);
+    if (!grown) return out_of_memory(s);
+    s->mem_used += sizeof(SortEntry) * (cap - s->cap);
+    s->entries = grown;
+    s->cap = cap;
+  }
+  RowField* vals = copy_row(s, e->vals, bytes);
+  if (!vals) return out_of_memory(s);
+  s->entries[s->nentries++] = (SortEntry){ e->prefix, vals };
+  return true;
+}
+
+static void clear_rows(SortOp* s) {
+  arena_free(&s->mem);
+  s->nentries = 0;
+  s->live = 0;
+  s->mem_used = sizeof(SortEntry) * s->cap;
+}
+
+// Sorts the rows in memory and writes them to a new run. Only the first
+// `limit` rows of a run can ever be output, so no more are written.
+static bool write_run(SortOp* s) {
+  ExecCtx* ctx = s->base.ctx;
+  sort_entries(s, s->entries, s->nentries);
+
+  if (s->nruns == s->runs_cap) {
+    int cap = s->runs_cap ? s->runs_cap * 2 : 16;
+    FILE** grown = realloc(s->runs, sizeof(FILE*) * (size_t)cap);
+    if (!grown) return out_of_memory(s);
+    s->runs = grown;
+    s->runs_cap = cap;
+  }
+  FILE* f = spill_create(ctx);
+  if (!f) return false;
+  s->runs[s->nruns++] = f;
+
+  size_t n = s->nentries;
+  if (s->limit >= 0 && (uint64_t)s->limit < n) n = (size_t)s->limit;
+  for (size_t i = 0; i < n; i++) {
+    if (!spill_write(ctx, f, s->entries[i].vals, s->base.ncols)) return false;
+  }
+  s->stats.runs++;
+  clear_rows(s);
+  return true;
+}
+
+static bool merge_pass(SortOp* s);
+
+// Runs are merged as they pile up, which bounds the files open at once.
+static bool add_run(SortOp* s) {
+  if (!write_run(s)) return false;
+  return s->nruns < 2 * s->fanin || merge_pass(s);
+}
+
+// ============================================================================
+// Top-N
+// ============================================================================
+
+static void sift_up(SortOp* s, size_t i) {
+  SortEntry* h = s->entries;
+  while (i > 0) {
+    size_t parent = (i - 1) / 2;
+    if (compare(s, &h[parent], &h[i]) >= 0) break;
+    swap(&h[parent], &h[i]);
+    i = parent;
+  }
+}
+
+static void sift_down(SortOp* s, size_t i) {
+  SortEntry* h = s->entries;
+  size_t n = s->nentries;
+  while (1) {
+    size_t worst = i, l = 2 * i + 1, r = l + 1;
+    if (l < n && compare(s, &h[l], &h[worst]) > 0) worst = l;
+    if (r < n && compare(s, &h[r], &h[worst]) > 0) worst = r;
+    if (worst == i) break;
+    swap(&h[i], &h[worst]);
+    i = worst;
+  }
+}
+
+// Rows replaced in the heap stay in mem until it is copied afresh, which
+// keeps the heap's memory within twice its live rows.
+static bool compact(SortOp* s) {
+  Arena old = s->mem;
+  arena_init(&s->mem);
+  s->mem_used = sizeof(SortEntry) * s->cap;
+  for (size_t i = 0; i < s->nentries; i++) {
+    size_t bytes;
+    s->entries[i].vals = copy_row(s, s->entries[i].vals, &bytes);
+    if (!s->entries[i].vals) {
+      arena_free(&old);
+      return out_of_memory(s);
+    }
+  }
+  arena_free(&old);
+  return true;
+}
+
+static bool offer(SortOp* s, const SortEntry* e) {
+  size_t bytes;
+  if (s->nentries < (uint64_t)s->limit) {
+    if (!push_entry(s, e, &bytes)) return false;
+    s->live += bytes;
+    sift_up(s, s->nentries - 1);
+  } else {
+    if (compare(s, e, &s->entries[0]) >= 0) return true;
+    RowField* vals = copy_row(s, e->vals, &bytes);
+    if (!vals) return out_of_memory(s);
+    s->live += bytes;
+    s->live -= row_bytes(s, s->entries[0].vals);
+    s->entries[0] = (SortEntry){ e->prefix, vals };
+    sift_down(s, 0);
+  }
+  if (s->mem_used <= s->budget) return true;
+
+  size_t heap = s->live + sizeof(SortEntry) * s->cap;
+  if (heap <= s->budget / 2) return compact(s);
+
+  // The best rows do not fit: sort them as a run like any other rows.
+  s->top_n = false;
+  return add_run(s);
+}
+
+// ============================================================================
+// Input
+// ============================================================================
+
+static bool consume(SortOp* s, const Batch* b) {
+  int first = s->keys[0].col;
+  for (int i = 0; i < b->nsel; i++) {
+    int row = b->sel ? b->sel[i] : i;
+    RowField vals[EXEC_MAX_COLS];
+    vector_get(b->cols[first], row, &vals[first]);
+    SortEntry e = { key_prefix(s, &vals[first]), vals };
+    s->stats.rows++;
+
+    // A full heap rejects most rows on the prefix alone.
+    if (s->top_n && s->nentries == (uint64_t)s->limit && e.prefix > s->entries[0].prefix) continue;
+
+    for (int c = 0; c < s->base.ncols; c++) {
+      if (c != first) vector_get(b->cols[c], row, &vals[c]);
+    }
+    if (s->top_n) {
+      if (!offer(s, &e)) return false;
+      continue;
+    }
+    size_t bytes;
+    if (!push_entry(s, &e, &bytes)) return false;
+    if (s->mem_used > s->budget && !add_run(s)) return false;
+  }
+  return true;
+}
+
+// ============================================================================
+// Merging
+// ============================================================================
+
+static bool source_advance(SortOp* s, MergeSource* m) {
+  if (++m->pos >= m->b.count) {
+    int r = spill_reader_next(s->base.ctx, &m->r, &m->b);
+    if (r < 0) return false;
+    if (r == 0) {
+      m->done = true;
+      return true;
+    }
+    m->pos = 0;
+  }
+  for (int c = 0; c < s->base.ncols; c++) vector_get(m->b.cols[c], m->pos, &m->row[c]);
+  m->cur.prefix = key_prefix(s, &m->row[s->keys[0].col]);
+  return true;
+}
+
+// Whether source a's row comes before source b's. A finished source loses.
+static bool beats(SortOp* s, int a, int b) {
+  if (s->src[a].done) return false;
+  if (s->src[b].done) return true;
+  return compare(s, &s->src[a].cur, &s->src[b].cur) < 0;
+}
+
+// Leaves are nodes nsrc..2*nsrc-1 of the tree, so source i plays its
+// first match at node (nsrc + i) / 2. Each node keeps the loser of its
+// match and sends the winner up.
+static void build_tree(SortOp* s) {
+  int k = s->nsrc;
+  int win[2 * SORT_MAX_FANIN];
+  for (int i = 0; i < k; i++) win[k + i] = i;
+  for (int node = k - 1; node >= 1; node--) {
+    int a = win[2 * node], b = win[2 * node + 1];
+    bool b_wins = beats(s, b, a);
+    win[node] = b_wins ? b : a;
+    s->tree[node] = b_wins ? a : b;
+  }
+  s->tree[0] = k > 1 ? win[1] : 0;
+}
+
+// Plays the matches on the path of a source whose row changed.
+static void replay(SortOp* s, int src) {
+  int winner = src;
+  for (int node = (src + s->nsrc) / 2; node > 0; node /= 2) {
+    if (beats(s, s->tree[node], winner)) {
+      int loser = winner;
+      winner = s->tree[node];
+      s->tree[node] = loser;
+    }
+  }
+  s->tree[0] = winner;
+}
+
+static void close_sources(SortOp* s) {
+  for (int i = 0; i < s->nsrc; i++) spill_reader_close(&s->src[i].r);
+  s->nsrc = 0;
+}
+
+// Starts merging the first k runs, which the sources take over.
+static bool merge_open(SortOp* s, int k) {
+  ExecCtx* ctx = s->base.ctx;
+  if (!s->src) {
+    s->src = arena_alloc(ctx->arena, sizeof(MergeSource) * (size_t)s->fanin);
+    s->tree = arena_alloc(ctx->arena, sizeof(int) * (size_t)s->fanin);
+    if (!s->src || !s->tree) return out_of_memory(s);
+    int cols[EXEC_MAX_COLS];
+    for (int c = 0; c < s->base.ncols; c++) cols[c] = c;
+    for (int i = 0; i < s->fanin; i++) {
+      spill_reader_init(&s->src[i].r, s->base.cols, s->base.ncols, cols, s->base.ncols);
+    }
+  }
+
+  FILE* files[SORT_MAX_FANIN];
+  memcpy(files, s->runs, sizeof(FILE*) * (size_t)k);
+  s->nruns -= k;
+  memmove(s->runs, s->runs + k, sizeof(FILE*) * (size_t)s->nruns);
+
+  s->nsrc = k;
+  s->advance = false;
+  for (int i = 0; i < k; i++) {
+    MergeSource* m = &s->src[i];
+    if (!spill_reader_open(ctx, &m->r, files[i])) {
+      for (int j = i + 1; j < k; j++) fclose(files[j]);
+      return false;
+    }
+    m->b.count = 0;
+    m->pos = -1;
+    m->done = false;
+    m->cur.vals = m->row;
+  }
+  for (int i = 0; i < k; i++) {
+    if (!source_advance(s, &s->src[i])) return false;
+  }
+  build_tree(s);
+  return true;
+}
+
+// Hands out the next row of the merge, valid until the next call.
+static int merge_next(SortOp* s, const RowField** out) {
+  if (s->advance) {
+    int w = s->tree[0];
+    if (!source_advance(s, &s->src[w])) return -1;
+    replay(s, w);
+  }
+  MergeSource* m = &s->src[s->tree[0]];
+  if (m->done) return 0;
+  s->advance = true;
+  *out = m->row;
+  return 1;
+}
+
+// Merges the first fanin runs into one longer run at the end of the list.
+static bool merge_pass(SortOp* s) {
+  ExecCtx* ctx = s->base.ctx;
+  FILE* f = spill_create(ctx);
+  if (!f) return false;
+  bool ok = merge_open(s, s->fanin);
+
+  const RowField* vals;
+  int r = 0;
+  int64_t n = 0;
+  while (ok && (s->limit < 0 || n < s->limit) && (r = merge_next(s, &vals)) > 0) {
+    ok = spill_write(ctx, f, vals, s->base.ncols);
+    n++;
+  }
+  close_sources(s);
+  if (!ok || r < 0) {
+    fclose(f);
+    return false;
+  }
+  s->runs[s->nruns++] = f;
+  s->stats.merge_passes++;
+  return true;
+}
+
+// ============================================================================
+// Operator
+// ============================================================================
+
+static bool sort_input(SortOp* s) {
+  s->sorted = true;
+  if (s->limit != 0) {
+    Batch b;
+    int r;
+    while ((r = exec_reader_next(&s->reader, &b)) > 0) {
+      if (!consume(s, &b)) return false;
+    }
+    if (r < 0) return false;
+  }
+  s->stats.top_n = s->top_n && s->nruns == 0;
+
+  if (s->nruns == 0) {
+    sort_entries(s, s->entries, s->nentries);
+    return true;
+  }
+  if (s->nentries > 0 && !write_run(s)) return false;
+  while (s->nruns > s->fanin) {
+    if (!merge_pass(s)) return false;
+  }
+  s->merging = true;
+  return merge_open(s, s->nruns);
+}
+
+static void release(SortOp* s) {
+  close_sources(s);
+  for (int i = 0; i < s->nruns; i++) fclose(s->runs[i]);
+  s->nruns = 0;
+  arena_free(&s->mem);
+  free(s->entries);
+  s->entries = NULL;
+  s->nentries = 0;
+  s->cap = 0;
+}
+
+static bool sort_open(Operator* op) {
+  SortOp* s = (SortOp*)op;
+  release(s);
+  memset(&s->stats, 0, sizeof(s->stats));
+  s->mem_used = 0;
+  s->live = 0;
+  s->top_n = s->limit >= 0;
+  s->sorted = false;
+  s->merging = false;
+  s->emit_pos = 0;
+  s->emitted = 0;
+  exec_reader_init(&s->reader, op->child);
+  return exec_open_child(op);
+}
+
+static int sort_next(Operator* op, Tuple* out) {
+  SortOp* s = (SortOp*)op;
+  if (!s->sorted && !sort_input(s)) return -1;
+  if (s->limit >= 0 && s->emitted >= s->limit) return 0;
+
+  const RowField* vals;
+  if (s->merging) {
+    int r = merge_next(s, &vals);
+    if (r <= 0) return r;
+  } else {
+    if (s->emit_pos == s->nentries) return 0;
+    vals = s->entries[s->emit_pos++].vals;
+  }
+  s->emitted++;
+  memcpy(out->vals, vals, sizeof(RowField) * (size_t)op->ncols);
+  out->ncols = op->ncols;
+  out->rid = (RID){ INVALID_PID, 0 };
+  return 1;
+}
+
+static void sort_close(Operator* op) {
+  SortOp* s = (SortOp*)op;
+  exec_close_child(op);
+  release(s);
+  free(s->runs);
+  s->runs = NULL;
+  s->runs_cap = 0;
+}
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+// Memory of one merge source: its reader, read buffer and vectors.
+static size_t source_bytes(const Operator* child) {
+  size_t n = sizeof(MergeSource) + SPILL_READ_BUF;
+  for (int c = 0; c < child->ncols; c++) {
+    switch (row_value_kind(child->cols[c].type)) {
+      case VAL_I32: n += sizeof(int32_t) * VECTOR_SIZE; break;
+      case VAL_I64:
+      case VAL_F64: n += sizeof(int64_t) * VECTOR_SIZE; break;
+      case VAL_TEXT: n += VECTOR_TEXT_BYTES + 3 * sizeof(uint32_t) * VECTOR_SIZE; break;
+    }
+  }
+  return n;
+}
+
+Operator* exec_sort(ExecCtx* ctx, Operator* child, const SortKey* keys, int nkeys,
+                    int64_t limit) {
+  SortOp* s = exec_new_op(ctx, sizeof(SortOp), child);
+  if (!s) return NULL;
+  s->nkeys = nkeys;
+  s->limit = limit;
+  s->budget = ctx->work_mem ? ctx->work_mem : EXEC_WORK_MEM_DEFAULT;
+  size_t fanin = s->budget / source_bytes(child);
+  if (fanin < SORT_MIN_FANIN) fanin = SORT_MIN_FANIN;
+  if (fanin > SORT_MAX_FANIN) fanin = SORT_MAX_FANIN;
+  s->fanin = (int)fanin;
+  // The prefix decides the first key unless it can tie with NULL's, which
+  // only the largest BIGINT does.
+  ValueKind first = row_value_kind(child->cols[keys[0].col].type);
+  s->prefix_exact = first == VAL_I32 || first == VAL_F64;
+  arena_init(&s->mem);
+
+  char by[96] = "";
+  size_t used = 0;
+  for (int k = 0; k < nkeys; k++) {
+    s->keys[k] = keys[k];
+    int w = snprintf(by + used, sizeof(by) - used, "%s%s%s", k ? ", " : " by ",
+                     child->cols[keys[k].col].name, keys[k].desc ? " DESC" : "");
+    if (w > 0) used = used + (size_t)w < sizeof(by) ? used + (size_t)w : sizeof(by) - 1;
+  }
+  if (limit >= 0) s->base.label = exec_label(ctx, "Sort%s (top %lld)", by, (long long)limit);
+  else s->base.label = exec_label(ctx, "Sort%s", by);
+  s->base.open = sort_open;
+  s->base.next = sort_next;
+  s->base.close = sort_close;
+  return &s->base;
+}
+
+void exec_sort_stats(const Operator* op, SortStats* out) {
+  *out = ((const SortOp*)op)->stats;
+}
@@ -0,0 +1,208 @@
+#include "spill.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Tags of values in temporary files.
+#define SPILL_NULL 0
+#define SPILL_INLINE 1
+#define SPILL_EXTERNAL 2
+
+FILE* spill_create(ExecCtx* ctx) {
+  FILE* f = tmpfile();
+  if (!f) snprintf(ctx->err, sizeof(ctx->err), "Cannot create a temporary file.");
+  return f;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+// A row is staged here and written with one fwrite, unless a TEXT value is
+// too long for the buffer.
+typedef struct {
+  FILE* f;
+  bool ok;
+  size_t n;
+  uint8_t buf[512];
+} SpillWriter;
+
+static void put(SpillWriter* w, const void* p, size_t len) {
+  if (w->n + len > sizeof(w->buf)) {
+    w->ok &= fwrite(w->buf, 1, w->n, w->f) == w->n;
+    w->n = 0;
+    if (len > sizeof(w->buf)) {
+      w->ok &= fwrite(p, 1, len, w->f) == len;
+      return;
+    }
+  }
+  memcpy(w->buf + w->n, p, len);
+  w->n += len;
+}
+
+static void put_value(SpillWriter* w, const RowField* v) {
+  uint8_t tag = SPILL_NULL;
+  if (v->is_null) {
+    put(w, &tag, 1);
+    return;
+  }
+  if (!row_is_text(v->type)) {
+    tag = SPILL_INLINE;
+    put(w, &tag, 1);
+    put(w, &v->i32, row_value_kind(v->type) == VAL_I32 ? 4 : 8);
+    return;
+  }
+
+  bool external = v->toast_pid != INVALID_PID;
+  tag = external ? SPILL_EXTERNAL : SPILL_INLINE;
+  put(w, &tag, 1);
+  put(w, &v->text_len, 4);
+  if (external) put(w, &v->toast_pid, 4);
+  else put(w, v->text, v->text_len);
+}
+
+static bool finish(ExecCtx* ctx, SpillWriter* w) {
+  w->ok &= fwrite(w->buf, 1, w->n, w->f) == w->n;
+  if (!w->ok) snprintf(ctx->err, sizeof(ctx->err), "Cannot write a temporary file.");
+  return w->ok;
+}
+
+bool spill_write(ExecCtx* ctx, FILE* f, const RowField* vals, int n) {
+  SpillWriter w = { .f = f, .ok = true };
+  for (int c = 0; c < n; c++) put_value(&w, &vals[c]);
+  return finish(ctx, &w);
+}
+
+bool spill_write_row(ExecCtx* ctx, FILE* f, const Batch* b, int row, const int* cols, int n) {
+  SpillWriter w = { .f = f, .ok = true };
+  for (int c = 0; c < n; c++) {
+    RowField v;
+    vector_get(b->cols[cols[c]], row, &v);
+    put_value(&w, &v);
+  }
+  return finish(ctx, &w);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+void spill_reader_init(SpillReader* r, const ExecColumn* layout, int ncols, const int* cols,
+                       int n) {
+  r->f = NULL;
+  r->buf = NULL;
+  r->ncols = ncols;
+  r->nread = n;
+  r->vecs_ready = false;
+  for (int c = 0; c < ncols; c++) r->types[c] = layout[c].type;
+  memcpy(r->cols, cols, sizeof(int) * (size_t)n);
+}
+
+bool spill_reader_open(ExecCtx* ctx, SpillReader* r, FILE* f) {
+  if (r->f) fclose(r->f);
+  r->f = f;
+  r->pos = r->len = 0;
+  rewind(f);
+  if (!r->buf && !(r->buf = malloc(SPILL_READ_BUF))) {
+    snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+    return false;
+  }
+  if (r->vecs_ready) return true;
+
+  for (int c = 0; c < r->nread; c++) {
+    int col = r->cols[c];
+    if (!vector_init(&r->vecs[col], r->types[col], ctx->arena)) {
+      snprintf(ctx->err, sizeof(ctx->err), "Out of memory.");
+      return false;
+    }
+  }
+  r->vecs_ready = true;
+  return true;
+}
+
+// Files are read through a buffer of their own, so a value costs a memcpy
+// rather than a stdio call.
+static bool get(SpillReader* r, void* dst, size_t n) {
+  uint8_t* d = dst;
+  while (n > 0) {
+    if (r->pos == r->len) {
+      r->len = fread(r->buf, 1, SPILL_READ_BUF, r->f);
+      r->pos = 0;
+      if (r->len == 0) return false;
+    }
+    size_t k = r->len - r->pos < n ? r->len - r->pos : n;
+    memcpy(d, r->buf + r->pos, k);
+    r->pos += k;
+    d += k;
+    n -= k;
+  }
+  return true;
+}
+
+// Reads one value into row `row` of v. Returns 1, 0 at the end of the
+// file, or -1 if the file is damaged.
+static int read_value(SpillReader* r, ColumnVector* v, int row) {
+  uint8_t tag;
+  if (!get(r, &tag, 1)) return 0;
+  RowField field = { .type = v->type, .toast_pid = INVALID_PID };
+
+  if (tag == SPILL_NULL) {
+    field.is_null = true;
+  } else if (!row_is_text(v->type)) {
+    if (!get(r, &field.i32, row_value_kind(v->type) == VAL_I32 ? 4 : 8)) return -1;
+  } else if (tag == SPILL_EXTERNAL) {
+    if (!get(r, &field.text_len, 4) || !get(r, &field.toast_pid, 4)) return -1;
+  } else {
+    if (!get(r, &field.text_len, 4) || field.text_len > PAGE_SIZE ||
+        !get(r, r->text, field.text_len)) {
+      return -1;
+    }
+    field.text = r->text;
+  }
+  return vector_set(v, row, &field) ? 1 : -1;
+}
+
+int spill_reader_next(ExecCtx* ctx, SpillReader* r, Batch* out) {
+  memset(out, 0, sizeof(*out));
+  out->ncols = r->ncols;
+  if (!r->f) return 0;
+  for (int c = 0; c < r->nread; c++) {
+    int col = r->cols[c];
+    vector_reset(&r->vecs[col]);
+    out->cols[col] = &r->vecs[col];
+  }
+
+  // Inline values are shorter than a page, so a row always fits while
+  // every TEXT vector has a page to spare.
+  int n = 0;
+  while (n < VECTOR_SIZE) {
+    bool room = true;
+    for (int c = 0; c < r->nread; c++) {
+      const ColumnVector* v = &r->vecs[r->cols[c]];
+      if (row_is_text(v->type) && v->text_used + PAGE_SIZE > VECTOR_TEXT_BYTES) room = false;
+    }
+    if (!room) break;
+
+    int res = 1;
+    for (int c = 0; c < r->nread && res > 0; c++) {
+      res = read_value(r, &r->vecs[r->cols[c]], n);
+      if (res == 0 && c > 0) res = -1;
+    }
+    if (res < 0) {
+      snprintf(ctx->err, sizeof(ctx->err), "Cannot read a temporary file.");
+      return -1;
+    }
+    if (res == 0) break;
+    n++;
+  }
+
+  out->count = n;
+  out->nsel = n;
+  return n > 0;
+}
+
+void spill_reader_close(SpillReader* r) {
+  if (r->f) fclose(r->f);
+  r->f = NULL;
+  free(r->buf);
+  r->buf = NULL;
+}
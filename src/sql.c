@@ -2,10 +2,15 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include "catalog.h"
 #include "heap.h"
 #include "buffer.h"
 #include "row.h"
+#include "btree.h"
+#include "toast.h"
+#include "planner.h"
+#include "recovery.h"
 #include "sql.h"
 
 // ============================================================================
@@ -20,566 +25,523 @@ void sql_trim(char* s) {
   while (n > 0 && isspace((unsigned char)s[n-1])) s[--n] = 0;
 }
 
-int sql_starts_with(const char* s, const char* pref) {
-  return strncasecmp(s, pref, strlen(pref)) == 0;
+// ============================================================================
+// Result Output
+// ============================================================================
+
+// Prints a tuple as "col=value | col=value". Out-of-line values are read
+// here, the only place that needs all of their bytes.
+static void print_tuple(ExecCtx* ctx, const Operator* op, const Tuple* t) {
+  for (int i = 0; i < t->ncols; i++) {
+    const RowField* v = &t->vals[i];
+    printf("%s%s=", i ? " | " : "", op->cols[i].name);
+
+    if (v->is_null) {
+      fputs("NULL", stdout);
+    } else if (!row_is_text(v->type)) {
+      char buf[40];
+      row_format_value(v, buf, sizeof(buf));
+      fputs(buf, stdout);
+    } else if (v->toast_pid == INVALID_PID) {
+      fwrite(v->text, 1, v->text_len, stdout);
+    } else {
+      uint8_t* buf = malloc(v->text_len);
+      if (!buf) continue;
+      uint32_t n = toast_fetch(ctx->bp, v->toast_pid, buf, v->text_len);
+      fwrite(buf, 1, n, stdout);
+      free(buf);
+    }
+  }
+  putchar('\n');
 }
 
 // ============================================================================
-// SQL Parsing Functions
+// SQL Command Execution Functions
 // ============================================================================
 
-int sql_parse_ident_after(const char* line, const char* kw, char* out, size_t out_sz) {
-  const char* p = strcasestr(line, kw);
-  if (!p) return 0;
-  p += strlen(kw);
-  while (*p && isspace((unsigned char)*p)) p++;
-  size_t i = 0;
-  while (*p && (isalnum((unsigned char)*p) || *p == '_' )) {
-    if (i + 1 >= out_sz) break;
-    out[i++] = *p++;
-  }
-  out[i] = 0;
-  return i > 0;
+// Prints the failure described in ctx->err, unless the caller reports it.
+static void report_error(ExecCtx* ctx) {
+  if (!ctx->quiet) printf("%s\n", ctx->err);
 }
 
-static ColumnType parse_type(const char* t) {
-  if (strcasecmp(t, "int") == 0) return COL_INT;
-  if (strcasecmp(t, "text") == 0) return COL_TEXT;
-  return 0;
+// Records a failure in ctx->err and reports it.
+static void fail(ExecCtx* ctx, const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(ctx->err, sizeof(ctx->err), fmt, ap);
+  va_end(ap);
+  report_error(ctx);
 }
 
-int sql_parse_create_columns(const char* line, ColumnDef* cols, int max_cols) {
-  const char* lpar = strchr(line, '(');
-  const char* rpar = strrchr(line, ')');
-  if (!lpar || !rpar || rpar <= lpar) return 0;
-
-  char inside[256];
-  size_t len = (size_t)(rpar - lpar - 1);
-  if (len >= sizeof(inside)) len = sizeof(inside)-1;
-  memcpy(inside, lpar+1, len);
-  inside[len] = 0;
-
-  int n = 0;
-  char* tok = strtok(inside, ",");
-  while (tok && n < max_cols) {
-    sql_trim(tok);
-    char col[COL_NAME_MAX], typ[16];
-    if (sscanf(tok, "%31s %15s", col, typ) != 2) return 0;
-
-    ColumnType ct = parse_type(typ);
-    if (!ct) return 0;
-
-    memset(&cols[n], 0, sizeof(ColumnDef));
-    strncpy(cols[n].col, col, COL_NAME_MAX-1);
-    cols[n].type = ct;
-    n++;
+// Prints a statement's outcome, unless the caller asked for quiet.
+static void note(ExecCtx* ctx, const char* fmt, ...) {
+  if (ctx->quiet) return;
+  va_list ap;
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+  putchar('\n');
+}
 
-    tok = strtok(NULL, ",");
+int sql_exec_create_table(ExecCtx* ctx, const CreateTableStmt* st) {
+  uint32_t heap_h;
+  if (catalog_create_table(ctx->bp, ctx->cat, st->table, st->cols, st->ncols, &heap_h)) {
+    note(ctx, "Table '%s' created successfully.", st->table);
+    return 1;
+  } else {
+    fail(ctx, "Table '%s' already exists.", st->table);
+    return 0;
   }
-  return n;
 }
 
-int sql_parse_insert_values(const char* line, char values[][128], int max_vals) {
-  char* vals_kw = strcasestr((char*)line, "values");
-  if (!vals_kw) return 0;
-
-  char* lpar = strchr(vals_kw, '(');
-  char* rpar = strrchr(vals_kw, ')');
-  if (!lpar || !rpar || rpar <= lpar) return 0;
-
-  char inside[256];
-  size_t len = (size_t)(rpar - lpar - 1);
-  if (len >= sizeof(inside)) len = sizeof(inside) - 1;
-  memcpy(inside, lpar + 1, len);
-  inside[len] = 0;
-
-  int n = 0;
-  char* tok = strtok(inside, ",");
-  while (tok && n < max_vals) {
-    sql_trim(tok);
-
-    if (tok[0] == '\'' || tok[0] == '"') {
-      size_t m = strlen(tok);
-      if (m >= 2) {
-        tok[m - 1] = 0;
-        tok++;
-      }
-    }
+int sql_exec_create_index(ExecCtx* ctx, const CreateIndexStmt* st) {
+  BufferPool* bp = ctx->bp;
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
+    return 0;
+  }
 
-    strncpy(values[n], tok, 127);
-    values[n][127] = 0;
-    n++;
-    tok = strtok(NULL, ",");
+  int col_idx = table_find_column(t->cols, t->ncols, st->column);
+  if (col_idx < 0) {
+    fail(ctx, "Unknown column '%s'.", st->column);
+    return 0;
   }
-  return n;
-}
 
-int sql_parse_where_clause(const char* line, Filter* f) {
-  const char* p = strcasestr(line, "where");
-  if (!p) return 0;
+  IndexEntry e;
+  memset(&e, 0, sizeof(e));
+  strncpy(e.name, st->name, TABLE_NAME_MAX - 1);
+  strncpy(e.table, st->table, TABLE_NAME_MAX - 1);
+  memcpy(e.col, t->cols[col_idx].col, COL_NAME_MAX);
 
-  p += 5;
-  while (*p && isspace((unsigned char)*p)) p++;
+  // Checked before the tree is built, whose pages would otherwise be lost.
+  if (catalog_find_index(bp, ctx->cat, e.name)) {
+    fail(ctx, "Index '%s' already exists.", e.name);
+    return 0;
+  }
 
-  char col[COL_NAME_MAX], op[4], val[128];
-  if (sscanf(p, "%31s %3s %127[^\n]", col, op, val) != 3) return -1;
+  TableIndex ix = { .col_idx = col_idx };
+  e.meta_pid = btree_create(bp, t->cols[col_idx].type);
+  ix.entry = e;
+  ix.tree = btree_open(bp, e.meta_pid);
 
-  memset(f, 0, sizeof(Filter));
-  strncpy(f->col, col, COL_NAME_MAX - 1);
+  HeapScan scan;
+  uint8_t* out;
+  uint16_t len;
+  int indexed = 0;
 
-  if (strcmp(op, "=") == 0) f->op = OP_EQ;
-  else if (strcmp(op, ">") == 0) f->op = OP_GT;
-  else if (strcmp(op, "<") == 0) f->op = OP_LT;
-  else return -1;
+  heap_scan_begin(bp, &t->hf, &scan);
+  while (heap_scan_step(bp, &scan, &out, &len)) {
+    table_index_insert(bp, &ix, t->cols, t->ncols, out, len, scan.cur);
+    indexed++;
+  }
+  heap_scan_end(bp, &scan);
 
-  char* v = val;
-  sql_trim(v);
-  size_t L = strlen(v);
-  if (L > 0 && v[L-1] == ';') v[L-1] = 0;
-  
-  L = strlen(v);
-  if ((v[0] == '\'' || v[0] == '"') && L >= 2) {
-    v[L - 1] = 0;
-    v++;
+  if (!catalog_create_index(bp, ctx->cat, &e)) {
+    fail(ctx, "Index '%s' already exists.", e.name);
+    return 0;
   }
-  strncpy(f->value, v, sizeof(f->value) - 1);
 
+  note(ctx, "Index '%s' created (%d row%s).", e.name, indexed, indexed == 1 ? "" : "s");
   return 1;
 }
 
-int sql_filter_match(const Filter* f, const char linebuf[]) {
-  char target[128];
-  snprintf(target, sizeof(target), "%s=", f->col);
+int sql_exec_insert(ExecCtx* ctx, const InsertStmt* st) {
+  BufferPool* bp = ctx->bp;
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
+    return 0;
+  }
 
-  const char* p = strstr(linebuf, target);
-  if (!p) return 0;
+  int inserted = 0;
+  uint8_t enc[PAGE_SIZE];
 
-  p += strlen(target);
+  for (int r = 0; r < st->nrows; r++) {
+    const InsertRow* row = &st->rows[r];
+    if (row->nvalues != t->ncols) {
+      fail(ctx, "Value count mismatch (expected %d, got %d).", t->ncols, row->nvalues);
+      break;
+    }
 
-  char actual[128];
-  int i = 0;
-  while (*p && *p != '|' && *p != ' ' && i < 127) actual[i++] = *p++;
-  actual[i] = 0;
+    const char* vals[CATALOG_MAX_COLS];
+    for (int i = 0; i < row->nvalues; i++) {
+      vals[i] = row->values[i].kind == LIT_NULL ? NULL : row->values[i].text;
+    }
 
-  switch (f->op) {
-    case OP_EQ: return strcmp(actual, f->value) == 0;
-    case OP_GT: return atoi(actual) > atoi(f->value);
-    case OP_LT: return atoi(actual) < atoi(f->value);
+    int bad = row_invalid_value(t->cols, vals, t->ncols);
+    if (bad >= 0) {
+      fail(ctx, "'%s' is not a valid %s for column '%s'.", vals[bad],
+           row_type_name(t->cols[bad].type), t->cols[bad].col);
+      break;
+    }
+
+    int enc_len = row_encode(bp, t->cols, t->ncols, vals, row->nvalues, enc, sizeof(enc));
+    if (enc_len < 0) {
+      fail(ctx, "Failed to encode row.");
+      break;
+    }
+
+    RID rid = heap_insert(bp, &t->hf, enc, (uint16_t)enc_len);
+    if (rid.page_id == INVALID_PID) {
+      row_release(bp, t->cols, t->ncols, enc, enc_len, NULL, 0);
+      fail(ctx, "Row too large.");
+      break;
+    }
+
+    for (int i = 0; i < t->nix; i++) {
+      table_index_insert(bp, &t->ixs[i], t->cols, t->ncols, enc, (uint16_t)enc_len, rid);
+    }
+    inserted++;
   }
-  
-  return 0;
+
+  if (inserted > 0) note(ctx, "%d row%s inserted.", inserted, inserted == 1 ? "" : "s");
+  return inserted;
 }
 
-// ============================================================================
-// SQL Command Execution Functions
-// ============================================================================
+// Splits one CSV record in place. Fields are comma separated; a field in
+// double quotes may contain commas, and "" inside it stands for one quote.
+// An empty unquoted field is NULL. Returns the number of fields, or -1 if
+// there are more than max_fields.
+static int csv_split(char* line, const char** fields, int max_fields) {
+  size_t n = strlen(line);
+  while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r')) line[--n] = 0;
 
-int sql_exec_create_table(BufferPool* bp, Catalog* cat, const char* line) {
-  char tname[TABLE_NAME_MAX];
-  if (!sql_parse_ident_after(line, "create table", tname, sizeof(tname))) {
-    printf("Parse error.\n");
-    return 0;
+  int nf = 0;
+  char* p = line;
+  while (1) {
+    if (nf == max_fields) return -1;
+
+    if (*p == '"') {
+      char* start = ++p;
+      char* w = start;
+      while (*p) {
+        if (*p == '"' && p[1] == '"') {
+          *w++ = '"';
+          p += 2;
+        } else if (*p == '"') {
+          p++;
+          break;
+        } else {
+          *w++ = *p++;
+        }
+      }
+      char* comma = strchr(p, ',');
+      *w = 0;
+      fields[nf++] = start;
+      if (!comma) break;
+      p = comma + 1;
+    } else {
+      char* comma = strchr(p, ',');
+      if (comma) *comma = 0;
+      fields[nf++] = *p ? p : NULL;
+      if (!comma) break;
+      p = comma + 1;
+    }
   }
+  return nf;
+}
 
-  ColumnDef cols[16];
-  int ncols = sql_parse_create_columns(line, cols, 16);
-  if (ncols <= 0) {
-    printf("Parse error. Example: CREATE TABLE t (id INT, name TEXT);\n");
-    return 0;
-  }
+typedef struct {
+  BufferPool* bp;
+  TableInfo* table;
+} CopyIndexCtx;
 
-  uint32_t heap_h;
-  if (catalog_create_table(bp, cat, tname, cols, ncols, &heap_h)) {
-    printf("Table '%s' created successfully.\n", tname);
-    return 1;
-  } else {
-    printf("Table '%s' already exists.\n", tname);
-    return 0;
+static void copy_index_row(void* arg, const uint8_t* rec, uint16_t len, RID rid) {
+  CopyIndexCtx* c = arg;
+  TableInfo* t = c->table;
+  for (int i = 0; i < t->nix; i++) {
+    table_index_insert(c->bp, &t->ixs[i], t->cols, t->ncols, rec, len, rid);
   }
 }
 
-int sql_exec_insert(BufferPool* bp, Catalog* cat, const char* line) {
-  char tname[TABLE_NAME_MAX];
-  if (!sql_parse_ident_after(line, "insert into", tname, sizeof(tname))) {
-    printf("Parse error.\n");
-    return 0;
-  }
+#define COPY_MAX_ERRORS 5
 
-  uint32_t heap_h_pid;
-  if (!catalog_find_table(bp, cat, tname, &heap_h_pid)) {
-    printf("Table '%s' does not exist.\n", tname);
+int sql_exec_copy(ExecCtx* ctx, const CopyStmt* st) {
+  BufferPool* bp = ctx->bp;
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
     return 0;
   }
 
-  ColumnDef cols[16];
-  int ncols = catalog_load_schema(bp, cat, tname, cols, 16);
-  if (ncols <= 0) {
-    printf("Schema missing for table '%s'.\n", tname);
+  FILE* f = fopen(st->path, "r");
+  if (!f) {
+    fail(ctx, "Cannot open '%s'.", st->path);
     return 0;
   }
 
-  char vals_raw[16][128];
-  int nvals = sql_parse_insert_values(line, vals_raw, 16);
-  if (nvals != ncols) {
-    printf("Value count mismatch (expected %d, got %d).\n", ncols, nvals);
+  CopyIndexCtx ictx = { .bp = bp, .table = t };
+  HeapBulkLoad bl;
+  if (!heap_bulk_begin(&t->hf, &bl, t->nix > 0 ? copy_index_row : NULL, &ictx)) {
+    fclose(f);
+    fail(ctx, "Out of memory.");
     return 0;
   }
 
-  const char* vals[16];
-  for (int i = 0; i < nvals; i++) vals[i] = vals_raw[i];
+  char* buf = NULL;
+  size_t buf_cap = 0;
+  long lineno = 0;
+  long skipped = 0;
+  uint8_t enc[PAGE_SIZE];
+
+  while (getline(&buf, &buf_cap, f) >= 0) {
+    lineno++;
+    if (st->header && lineno == 1) continue;
+
+    const char* vals[CATALOG_MAX_COLS];
+    int nvals = csv_split(buf, vals, CATALOG_MAX_COLS);
+    if (nvals == 1 && vals[0] == NULL) continue;
+
+    const char* err = NULL;
+    int enc_len = -1;
+    if (nvals != t->ncols) {
+      err = "wrong number of fields";
+    } else if (row_invalid_value(t->cols, vals, nvals) >= 0) {
+      err = "invalid value";
+    } else if ((enc_len = row_encode(bp, t->cols, t->ncols, vals, nvals, enc, sizeof(enc))) < 0) {
+      err = "row too large";
+    } else if (!heap_bulk_insert(bp, &bl, enc, (uint16_t)enc_len)) {
+      row_release(bp, t->cols, t->ncols, enc, enc_len, NULL, 0);
+      err = "row too large";
+    }
+
+    if (err) {
+      if (skipped < COPY_MAX_ERRORS) note(ctx, "Line %ld: %s, skipped.", lineno, err);
+      skipped++;
+    }
+  }
 
-  uint8_t enc[512];
-  int enc_len = row_encode(cols, ncols, vals, nvals, enc, sizeof(enc));
-  if (enc_len < 0) {
-    printf("Failed to encode row.\n");
+  bool synced = heap_bulk_end(bp, &bl);
+  free(buf);
+  fclose(f);
+  if (!synced) {
+    fail(ctx, "COPY failed: the database file could not be written (%s).",
+         strerror(bp->dm->io_error));
     return 0;
   }
 
-  HeapFile hf = heap_open(bp, heap_h_pid);
-  heap_insert(bp, &hf, enc, (uint16_t)enc_len);
-
-  printf("1 row inserted.\n");
+  char skipped_note[32] = "";
+  if (skipped > 0) snprintf(skipped_note, sizeof(skipped_note), ", %ld skipped", skipped);
+  note(ctx, "%llu row%s copied%s.", (unsigned long long)bl.rows, bl.rows == 1 ? "" : "s",
+       skipped_note);
   return 1;
 }
 
-int sql_exec_select(BufferPool* bp, Catalog* cat, const char* line) {
-  char tname[TABLE_NAME_MAX];
-  if (!sql_parse_ident_after(line, "from", tname, sizeof(tname))) {
-    printf("Parse error.\n");
-    return -1;
-  }
-
-  uint32_t heap_h_pid;
-  if (!catalog_find_table(bp, cat, tname, &heap_h_pid)) {
-    printf("Table '%s' does not exist.\n", tname);
+int sql_exec_select(ExecCtx* ctx, SelectStmt* st) {
+  Operator* plan = plan_select(ctx, st);
+  if (!plan || !plan->open(plan)) {
+    report_error(ctx);
     return -1;
   }
 
-  ColumnDef cols[16];
-  int ncols = catalog_load_schema(bp, cat, tname, cols, 16);
-  if (ncols <= 0) {
-    printf("Schema missing for table '%s'.\n", tname);
-    return -1;
+  Tuple t;
+  int count = 0;
+  int r;
+  while ((r = plan->next(plan, &t)) > 0) {
+    print_tuple(ctx, plan, &t);
+    count++;
   }
+  plan->close(plan);
 
-  Filter flt;
-  int has_filter = sql_parse_where_clause(line, &flt);
-  if (has_filter < 0) {
-    printf("WHERE clause parse error.\n");
+  if (r < 0) {
+    report_error(ctx);
     return -1;
   }
-
-  HeapFile hf = heap_open(bp, heap_h_pid);
-  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
-  uint8_t* out;
-  uint16_t len;
-  int count = 0;
-
-  while (heap_scan_next(bp, &hf, &cur, &out, &len)) {
-    char linebuf[512];
-    if (row_decode(cols, ncols, out, len, linebuf, sizeof(linebuf)) >= 0) {
-      if (has_filter == 1 && !sql_filter_match(&flt, linebuf)) {
-        bp_unpin_page(bp, cur.page_id, false);
-        continue;
-      }
-
-      puts(linebuf);
-      count++;
-    }
-
-    bp_unpin_page(bp, cur.page_id, false);
-  }
-
   printf("(%d row%s)\n", count, count == 1 ? "" : "s");
   return count;
 }
 
-// ============================================================================
-// Update statement parsing
-// ============================================================================
-
-int sql_parse_update(const char* line, UpdateStmt* st) {
-  memset(st, 0, sizeof(*st));
-
-  if (!sql_parse_ident_after(line, "update", st->table, sizeof(st->table))) {
-    return -1;
-  }
-
-  const char* set_kw = strcasestr(line, "set");
-  if (!set_kw) return -1;
-  const char* p = set_kw + 3;
-
-  while (*p && isspace((unsigned char)*p)) p++;
-
-  const char* where_kw = strcasestr(p, "where");
-  size_t set_len = where_kw ? (size_t)(where_kw - p) : strlen(p);
-
-  char set_part[256];
-  if (set_len >= sizeof(set_part)) set_len = sizeof(set_part) - 1;
-  memcpy(set_part, p, set_len);
-  set_part[set_len] = 0;
-  sql_trim(set_part);
-
-  char col[COL_NAME_MAX] = {0};
-  char val[128] = {0};
-  if (sscanf(set_part, "%31s = %127[^\n]", col, val) != 2) return -1;
-
-  sql_trim(col);
-  sql_trim(val);
-
-  size_t L = strlen(val);
-  if (L > 0 && val[L - 1] == ';') val[L - 1] = 0;
-  sql_trim(val);
-
-  L = strlen(val);
-  if ((val[0] == '\'' || val[0] == '"') && L >= 2) {
-    val[L - 1] = 0;
-    memmove(val, val + 1, L);
+// Runs a plan to completion and collects the RIDs of its rows. Returns the
+// number of RIDs, or -1 on failure.
+static int collect_rids(ExecCtx* ctx, Operator* plan, RID** out) {
+  RID* rids = NULL;
+  int n = 0, cap = 0;
+  Tuple t;
+  int r = -1;
+
+  if (plan->open(plan)) {
+    while ((r = plan->next(plan, &t)) > 0) {
+      if (n == cap) {
+        int new_cap = cap ? cap * 2 : 64;
+        RID* grown = realloc(rids, sizeof(RID) * (size_t)new_cap);
+        if (!grown) {
+          snprintf(ctx->err, sizeof(ctx->err), "Memory allocation failed.");
+          r = -1;
+          break;
+        }
+        rids = grown;
+        cap = new_cap;
+      }
+      rids[n++] = t.rid;
+    }
   }
+  plan->close(plan);
 
-  strncpy(st->set_col, col, COL_NAME_MAX - 1);
-  strncpy(st->set_value, val, sizeof(st->set_value) - 1);
-
-  Filter f;
-  int hw = sql_parse_where_clause(line, &f);
-  if (hw < 0) return -1;
-  if (hw == 1) {
-    st->has_where = 1;
-    st->where = f;
+  if (r < 0) {
+    free(rids);
+    return -1;
   }
-
-  return 1;
+  *out = rids;
+  return n;
 }
 
-int sql_exec_update(BufferPool* bp, Catalog* cat, const char* line) {
-  UpdateStmt st;
-  if (sql_parse_update(line, &st) < 0) {
-    printf("UPDATE parse error.\n");
+int sql_exec_update(ExecCtx* ctx, UpdateStmt* st) {
+  BufferPool* bp = ctx->bp;
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
     return -1;
   }
 
-  uint32_t heap_h_pid;
-  if (!catalog_find_table(bp, cat, st.table, &heap_h_pid)) {
-    printf("Table '%s' does not exist.\n", st.table);
+  int set_idx[CATALOG_MAX_COLS];
+  const char* set_vals[CATALOG_MAX_COLS];
+  if (st->nsets > CATALOG_MAX_COLS) {
+    fail(ctx, "Too many assignments.");
     return -1;
   }
-
-  ColumnDef cols[16];
-  int ncols = catalog_load_schema(bp, cat, st.table, cols, 16);
-  if (ncols <= 0) {
-    printf("Schema missing for table '%s'.\n", st.table);
-    return -1;
+  for (int k = 0; k < st->nsets; k++) {
+    set_idx[k] = table_find_column(t->cols, t->ncols, st->sets[k].column);
+    if (set_idx[k] < 0) {
+      fail(ctx, "Unknown column '%s' in SET.", st->sets[k].column);
+      return -1;
+    }
+    set_vals[k] = st->sets[k].value.kind == LIT_NULL ? NULL : st->sets[k].value.text;
+    const ColumnDef* col = &t->cols[set_idx[k]];
+    if (row_invalid_value(col, &set_vals[k], 1) == 0) {
+      fail(ctx, "'%s' is not a valid %s for column '%s'.", set_vals[k],
+           row_type_name(col->type), col->col);
+      return -1;
+    }
   }
 
-  int set_idx = -1;
-  for (int i = 0; i < ncols; i++) {
-    if (strcasecmp(cols[i].col, st.set_col) == 0) { set_idx = i; break; }
-  }
-  if (set_idx < 0) {
-    printf("Unknown column in SET.\n");
+  Operator* plan = plan_scan(ctx, t, st->where);
+  RID* rids = NULL;
+  int nrids = plan ? collect_rids(ctx, plan, &rids) : -1;
+  if (nrids < 0) {
+    report_error(ctx);
     return -1;
   }
 
-  HeapFile hf = heap_open(bp, heap_h_pid);
-  
-  typedef struct RIDNode {
-    RID rid;
-    struct RIDNode* next;
-  } RIDNode;
-  
-  RIDNode* head = NULL;
-  RIDNode* tail = NULL;
-  
-  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
   uint8_t* out;
   uint16_t len;
+  int updated = 0;
+  bool failed = false;
 
-  while (heap_scan_next(bp, &hf, &cur, &out, &len)) {
-    int pass = 1;
-    if (st.has_where) {
-      char linebuf[512];
-      if (row_decode(cols, ncols, out, len, linebuf, sizeof(linebuf)) < 0) {
-        pass = 0;
-      } else if (!sql_filter_match(&st.where, linebuf)) {
-        pass = 0;
-      }
-    }
-
-    if (pass) {
-      RIDNode* node = malloc(sizeof(RIDNode));
-      if (!node) {
-        bp_unpin_page(bp, cur.page_id, false);
-        while (head) {
-          RIDNode* tmp = head;
-          head = head->next;
-          free(tmp);
-        }
-        printf("Memory allocation failed.\n");
-        return -1;
-      }
-      node->rid = cur;
-      node->next = NULL;
-      
-      if (!head) {
-        head = tail = node;
-      } else {
-        tail->next = node;
-        tail = node;
-      }
-    }
-    
-    bp_unpin_page(bp, cur.page_id, false);
-  }
+  for (int r = 0; r < nrids; r++) {
+    RID rid = rids[r];
 
-  int updated = 0;
-  RIDNode* current = head;
-  
-  while (current) {
-    RID rid = current->rid;
-    
-    if (!heap_get(bp, rid, &out, &len)) {
-      current = current->next;
-      continue;
-    }
-    
-    DecodedValue vals[16];
-    char scratch[256];
-    if (row_decode_values(cols, ncols, out, len, vals, scratch, sizeof(scratch)) < 0) {
-      current = current->next;
-      continue;
-    }
+    if (!heap_get(bp, rid, &out, &len)) continue;
 
-    const char* new_vals[16];
-    char buf_vals[16][128];
-
-    for (int i = 0; i < ncols; i++) {
-      if (i == set_idx) {
-        strncpy(buf_vals[i], st.set_value, 127);
-        buf_vals[i][127] = 0;
-      } else if (vals[i].is_null) {
-        strcpy(buf_vals[i], "NULL");
-      } else if (cols[i].type == COL_INT) {
-        snprintf(buf_vals[i], sizeof(buf_vals[i]), "%d", vals[i].i32);
-      } else {
-        strncpy(buf_vals[i], vals[i].text, 127);
-        buf_vals[i][127] = 0;
-      }
-      new_vals[i] = buf_vals[i];
-    }
+    uint8_t old_row[PAGE_SIZE];
+    uint16_t old_len = len;
+    memcpy(old_row, out, len);
 
-    uint8_t enc[512];
-    int enc_len = row_encode(cols, ncols, new_vals, ncols, enc, sizeof(enc));
+    // Columns other than the ones being set are copied as stored, so their
+    // out-of-line values keep their overflow pages.
+    uint8_t enc[PAGE_SIZE];
+    int enc_len = row_set_fields(bp, t->cols, t->ncols, old_row, old_len,
+                                 set_idx, set_vals, st->nsets, enc, sizeof(enc));
     if (enc_len < 0) {
-      current = current->next;
-      continue;
+      snprintf(ctx->err, sizeof(ctx->err), "Updated row too large for table '%s'.", t->name);
+      failed = true;
+      break;
     }
 
-    if (enc_len <= len) {
-      if (heap_update_in_place(bp, rid, enc, (uint16_t)enc_len) == 0) {
-        updated++;
+    // Rows keep their RID unless they grow past what their page can hold.
+    if (heap_update_in_place(bp, &t->hf, rid, enc, (uint16_t)enc_len) == 0) {
+      for (int i = 0; i < t->nix; i++) {
+        TableIndex* ix = &t->ixs[i];
+        bool changed = false;
+        for (int k = 0; k < st->nsets; k++) changed |= set_idx[k] == ix->col_idx;
+        if (!changed) continue;
+        table_index_delete(bp, ix, t->cols, t->ncols, old_row, old_len, rid);
+        table_index_insert(bp, ix, t->cols, t->ncols, enc, (uint16_t)enc_len, rid);
       }
-      current = current->next;
+      row_release(bp, t->cols, t->ncols, old_row, old_len, enc, enc_len);
+      updated++;
       continue;
     }
 
-    heap_insert(bp, &hf, enc, (uint16_t)enc_len);
-    
-    Page* p = bp_fetch_page(bp, rid.page_id);
-    if (p && page_delete(p, rid.slot_id)) {
-      updated++;
-      bp_unpin_page(bp, rid.page_id, true);
-    } else {
-      bp_unpin_page(bp, rid.page_id, false);
+    RID new_rid = heap_insert(bp, &t->hf, enc, (uint16_t)enc_len);
+    if (new_rid.page_id == INVALID_PID) {
+      row_release(bp, t->cols, t->ncols, enc, enc_len, old_row, old_len);
+      snprintf(ctx->err, sizeof(ctx->err), "Cannot store the updated row in table '%s'.",
+               t->name);
+      failed = true;
+      break;
+    }
+    if (heap_delete(bp, &t->hf, rid) != 0) {
+      snprintf(ctx->err, sizeof(ctx->err), "Cannot remove the old row from table '%s'.",
+               t->name);
+      failed = true;
+      break;
     }
-    
-    current = current->next;
-  }
 
-  while (head) {
-    RIDNode* tmp = head;
-    head = head->next;
-    free(tmp);
+    for (int i = 0; i < t->nix; i++) {
+      table_index_delete(bp, &t->ixs[i], t->cols, t->ncols, old_row, old_len, rid);
+      table_index_insert(bp, &t->ixs[i], t->cols, t->ncols, enc, (uint16_t)enc_len, new_rid);
+    }
+    row_release(bp, t->cols, t->ncols, old_row, old_len, enc, enc_len);
+    updated++;
   }
 
-  printf("%d row%s updated.\n", updated, updated == 1 ? "" : "s");
-  return updated;
-}
-
-// ============================================================================
-// Delete statement parsing
-// ============================================================================
-
-int sql_parse_delete(const char* line, DeleteStmt* st) {
-  memset(st, 0, sizeof(*st));
+  free(rids);
 
-  if (!sql_parse_ident_after(line, "delete from", st->table, sizeof(st->table))) {
+  // A row that cannot be updated fails the whole statement: the rows
+  // already changed are restored before the statement commits.
+  if (failed) {
+    if (!recovery_rollback(bp)) {
+      snprintf(ctx->err + strlen(ctx->err), sizeof(ctx->err) - strlen(ctx->err),
+               " The rows already updated could not be restored.");
+    }
+    report_error(ctx);
     return -1;
   }
 
-  Filter f;
-  int hw = sql_parse_where_clause(line, &f);
-  if (hw < 0) return -1;
-  if (hw == 1) {
-    st->has_where = 1;
-    st->where = f;
-  }
-
-  return 1;
+  note(ctx, "%d row%s updated.", updated, updated == 1 ? "" : "s");
+  return updated;
 }
 
-int sql_exec_delete(BufferPool* bp, Catalog* cat, const char* line) {
-  DeleteStmt st;
-  if (sql_parse_delete(line, &st) < 0) {
-    printf("DELETE parse error.\n");
+int sql_exec_delete(ExecCtx* ctx, DeleteStmt* st) {
+  BufferPool* bp = ctx->bp;
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
     return -1;
   }
 
-  if (!st.has_where) {
-    printf("DELETE without WHERE not supported yet.\n");
-    return 0;
-  }
-
-  uint32_t heap_h_pid;
-  if (!catalog_find_table(bp, cat, st.table, &heap_h_pid)) {
-    printf("Table '%s' does not exist.\n", st.table);
+  Operator* plan = plan_scan(ctx, t, st->where);
+  RID* rids = NULL;
+  int nrids = plan ? collect_rids(ctx, plan, &rids) : -1;
+  if (nrids < 0) {
+    report_error(ctx);
     return -1;
   }
 
-  ColumnDef cols[16];
-  int ncols = catalog_load_schema(bp, cat, st.table, cols, 16);
-  if (ncols <= 0) {
-    printf("Schema missing for table '%s'.\n", st.table);
-    return -1;
-  }
-
-  HeapFile hf = heap_open(bp, heap_h_pid);
-  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
   uint8_t* out;
   uint16_t len;
   int deleted = 0;
 
-  while (heap_scan_next(bp, &hf, &cur, &out, &len)) {
-    char linebuf[512];
-    int ok = row_decode(cols, ncols, out, len, linebuf, sizeof(linebuf)) >= 0;
+  for (int r = 0; r < nrids; r++) {
+    if (!heap_get(bp, rids[r], &out, &len)) continue;
 
-    int pass = ok && sql_filter_match(&st.where, linebuf);
+    uint8_t old_row[PAGE_SIZE];
+    uint16_t old_len = len;
+    memcpy(old_row, out, len);
 
-    if (pass) {
-      Page* p = bp_fetch_page(bp, cur.page_id);
-      if (p) {
-        if (page_delete(p, cur.slot_id)) {
-          deleted++;
-          bp_unpin_page(bp, cur.page_id, true);
-        } else {
-          bp_unpin_page(bp, cur.page_id, false);
-        }
+    if (heap_delete(bp, &t->hf, rids[r]) == 0) {
+      for (int i = 0; i < t->nix; i++) {
+        table_index_delete(bp, &t->ixs[i], t->cols, t->ncols, old_row, old_len, rids[r]);
       }
+      row_release(bp, t->cols, t->ncols, old_row, old_len, NULL, 0);
+      deleted++;
     }
-
-    bp_unpin_page(bp, cur.page_id, false);
   }
 
-  printf("%d row%s deleted.\n", deleted, deleted == 1 ? "" : "s");
+  free(rids);
+
+  note(ctx, "%d row%s deleted.", deleted, deleted == 1 ? "" : "s");
   return deleted;
 }
 
@@ -587,70 +549,131 @@ int sql_exec_delete(BufferPool* bp, Catalog* cat, const char* line) {
 // Vacuum command execution
 // ============================================================================
 
-int sql_exec_vacuum(BufferPool* bp, Catalog* cat, const char* line) {
-  char tname[TABLE_NAME_MAX];
-  if (!sql_parse_ident_after(line, "vacuum", tname, sizeof(tname))) {
-    printf("Parse error.\nmarqdb> ");
+int sql_exec_vacuum(ExecCtx* ctx, const VacuumStmt* st) {
+  TableInfo* t = plan_open_table(ctx, st->table);
+  if (!t) {
+    report_error(ctx);
     return 0;
   }
 
-  uint32_t old_heap_h;
-  if (!catalog_find_table(bp, cat, tname, &old_heap_h)) {
-    printf("No such table.\nmarqdb> ");
-    return 0;
-  }
+  // A page count runs one bounded step of an incremental pass; without it
+  // the whole table is vacuumed from the start.
+  bool incremental = st->max_pages > 0;
+  if (!incremental) t->hf.vacuum_pid = 0;
 
-  ColumnDef cols[16];
-  int ncols = catalog_load_schema(bp, cat, tname, cols, 16);
-  if (ncols <= 0) {
-    printf("Schema missing.\nmarqdb> ");
-    return 0;
-  }
+  HeapVacuumStats vs;
+  bool done = heap_vacuum(ctx->bp, &t->hf, incremental ? st->max_pages : UINT32_MAX, &vs);
 
-  HeapFile old_hf = heap_open(bp, old_heap_h);
+  note(ctx, "Vacuumed %u page%s: %u compacted, %u freed, %llu bytes reclaimed%s.",
+         vs.pages_scanned, vs.pages_scanned == 1 ? "" : "s", vs.pages_compacted,
+         vs.pages_freed, (unsigned long long)vs.bytes_reclaimed,
+         done ? "" : " (more to do)");
+  return 1;
+}
 
-  uint32_t new_heap_h;
-  HeapFile new_hf = heap_create(bp, &new_heap_h);
+// ============================================================================
+// Statement dispatch
+// ============================================================================
 
-  RID cur = { .page_id = INVALID_PID, .slot_id = 0 };
-  uint8_t* out;
-  uint16_t len;
-  int moved = 0;
+static int explain(ExecCtx* ctx, Stmt* st) {
+  Operator* plan;
+  if (st->kind == STMT_SELECT) {
+    plan = plan_select(ctx, &st->select);
+  } else if (st->kind == STMT_UPDATE || st->kind == STMT_DELETE) {
+    const char* name = st->kind == STMT_UPDATE ? st->update.table : st->del.table;
+    Expr* where = st->kind == STMT_UPDATE ? st->update.where : st->del.where;
+    TableInfo* t = plan_open_table(ctx, name);
+    plan = t ? plan_scan(ctx, t, where) : NULL;
+  } else {
+    printf("EXPLAIN supports SELECT, UPDATE and DELETE.\n");
+    return -1;
+  }
 
-  while (heap_scan_next(bp, &old_hf, &cur, &out, &len)) {
-    heap_insert(bp, &new_hf, out, len);
-    moved++;
-    bp_unpin_page(bp, cur.page_id, false);
+  if (!plan) {
+    printf("%s\n", ctx->err);
+    return -1;
   }
+  exec_explain(plan);
+  return 0;
+}
 
-  if (!catalog_update_table_heap(bp, cat, tname, new_heap_h)) {
-    printf("VACUUM failed to update catalog.\nmarqdb> ");
-    return 0;
+int sql_exec(BufferPool* bp, Catalog* cat, const char* sql) {
+  Arena arena;
+  arena_init(&arena);
+  ExecCtx ctx = { .bp = bp, .cat = cat, .arena = &arena };
+
+  Stmt* st = parse_statement(&arena, sql, ctx.err, sizeof(ctx.err));
+  if (!st) {
+    printf("%s\n", ctx.err);
+    arena_free(&arena);
+    return -1;
   }
 
-  printf("OK (vacuumed %d rows into new heap)\nmarqdb> ", moved);
-  return moved;
+  int r;
+  if (st->nparams > 0) {
+    printf("Placeholders need a statement prepared through the library.\n");
+    r = -1;
+  } else if (st->explain) {
+    r = explain(&ctx, st);
+  } else {
+    switch (st->kind) {
+      case STMT_CREATE_TABLE: r = sql_exec_create_table(&ctx, &st->create_table); break;
+      case STMT_CREATE_INDEX: r = sql_exec_create_index(&ctx, &st->create_index); break;
+      case STMT_INSERT: r = sql_exec_insert(&ctx, &st->insert); break;
+      case STMT_COPY: r = sql_exec_copy(&ctx, &st->copy); break;
+      case STMT_SELECT: r = sql_exec_select(&ctx, &st->select); break;
+      case STMT_UPDATE: r = sql_exec_update(&ctx, &st->update); break;
+      case STMT_DELETE: r = sql_exec_delete(&ctx, &st->del); break;
+      case STMT_VACUUM: r = sql_exec_vacuum(&ctx, &st->vacuum); break;
+      default: r = -1; break;
+    }
+  }
+
+  arena_free(&arena);
+  return r;
 }
 
 // ============================================================================
 // REPL
 // ============================================================================
 
+// Every statement runs as its own transaction when a log is attached.
+void sql_statement_begin(BufferPool* bp) {
+  if (bp->wal) wal_begin(bp->wal);
+}
+
+bool sql_statement_end(BufferPool* bp, char* err, size_t err_cap) {
+  if (!bp->wal) return true;
+  if (!wal_commit(bp->wal)) {
+    snprintf(err, err_cap, "Commit failed: the log could not be written (%s).",
+             strerror(bp->wal->io_error));
+    return false;
+  }
+  if (wal_needs_checkpoint(bp->wal)) bp_checkpoint(bp);
+  return true;
+}
+
 void repl(BufferPool* bp) {
   Catalog cat = catalog_open(bp);
   if (cat.catalog_heap_header_pid == INVALID_PID) {
     fprintf(stderr, "Failed to open catalog.\n");
     return;
   }
+  if (cat.recovery.records > 0) {
+    fprintf(stderr, "Recovery: replayed %d log records, redid %d, undid %d.\n",
+            cat.recovery.records, cat.recovery.redone, cat.recovery.undone);
+  }
 
   printf("MarqDB - Type .help for commands\n");
-  char line[512];
+  char* line = NULL;
+  size_t line_cap = 0;
+  bool file_failed = false;
 
   while (1) {
     printf("marqdb> ");
-    
-    if (!fgets(line, sizeof(line), stdin)) break;
-    
+
+    if (getline(&line, &line_cap, stdin) < 0) break;
+
     sql_trim(line);
     if (line[0] == 0) continue;
 
@@ -659,35 +682,54 @@ void repl(BufferPool* bp) {
       printf("Goodbye!\n");
       break;
     }
-    
+
     if (strcmp(line, ".help") == 0) {
       printf("Commands:\n");
       printf("  CREATE TABLE <name> (col1 TYPE1, col2 TYPE2, ...);\n");
-      printf("  INSERT INTO <name> VALUES (val1, val2, ...);\n");
-      printf("  SELECT * FROM <name> [WHERE col = value];\n");
-      printf("  UPDATE <name> SET col = value [WHERE col = value];\n");
-      printf("  DELETE FROM <name> WHERE col = value;\n");
-      printf("  VACUUM <name>;\n");
+      printf("  CREATE INDEX <name> ON <table>(col);\n");
+      printf("  INSERT INTO <name> VALUES (val1, val2, ...)[, (...)];\n");
+      printf("  COPY <name> FROM 'file.csv' [HEADER];\n");
+      printf("  SELECT * | item, ... FROM <name> [JOIN <name> ON cond ...] [WHERE cond]\n");
+      printf("         [GROUP BY col, ...] [ORDER BY col [ASC|DESC], ...]\n");
+      printf("         [LIMIT n] [OFFSET m];\n");
+      printf("  UPDATE <name> SET col = value, ... [WHERE cond];\n");
+      printf("  DELETE FROM <name> [WHERE cond];\n");
+      printf("  VACUUM <name> [pages];\n");
+      printf("  EXPLAIN <select|update|delete>\n");
+      printf("    cond: col op value (op: = <> < <= > >=), col [NOT] BETWEEN a AND b,\n");
+      printf("          col [NOT] IN (v, ...), col [NOT] LIKE 'pat', AND, OR, NOT, ( )\n");
+      printf("    col: name or table.name\n");
+      printf("    item: col or COUNT(*) | COUNT|SUM|MIN|MAX|AVG(col), optionally AS name\n");
+      printf("  .stats         - Show buffer pool hit ratio\n");
       printf("  .exit / .quit  - Exit the database\n");
       printf("  .help          - Show this help message\n");
       continue;
     }
 
+    if (strcmp(line, ".stats") == 0) {
+      BufferStats st;
+      bp_stats(bp, &st);
+      uint64_t total = st.hits + st.misses;
+      printf("Buffer pool: %llu hits, %llu misses (%.1f%% hit ratio), %llu ring reuses\n",
+             (unsigned long long)st.hits, (unsigned long long)st.misses,
+             total ? 100.0 * (double)st.hits / (double)total : 0.0,
+             (unsigned long long)st.ring_reuses);
+      continue;
+    }
+
     // SQL commands
-    if (sql_starts_with(line, "create table")) {
-      sql_exec_create_table(bp, &cat, line);
-    } else if (sql_starts_with(line, "insert into")) {
-      sql_exec_insert(bp, &cat, line);
-    } else if (sql_starts_with(line, "select *")) {
-      sql_exec_select(bp, &cat, line);
-    } else if (sql_starts_with(line, "update")) {
-      sql_exec_update(bp, &cat, line);
-    } else if (sql_starts_with(line, "delete")) {
-      sql_exec_delete(bp, &cat, line);
-    } else if (sql_starts_with(line, "vacuum")) {
-      sql_exec_vacuum(bp, &cat, line);
-    } else {
-      printf("Unknown command. Type .help for available commands.\n");
+    sql_statement_begin(bp);
+    sql_exec(bp, &cat, line);
+    char err[256];
+    if (!sql_statement_end(bp, err, sizeof(err))) printf("%s\n", err);
+    // The library only records this; checkpoints keep failing from here on.
+    if (bp->dm->io_error && !file_failed) {
+      printf("The database file could not be written (%s); changes stay in the log.\n",
+             strerror(bp->dm->io_error));
+      file_failed = true;
     }
   }
+
+  free(line);
+  catalog_close(&cat);
 }
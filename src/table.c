@@ -0,0 +1,78 @@
+#include "table.h"
+#include "row.h"
+#include <string.h>
+#include <strings.h>
+
+int table_open(BufferPool* bp, Catalog* cat, const char* name, TableInfo* out) {
+  memset(out, 0, sizeof(*out));
+  strncpy(out->name, name, TABLE_NAME_MAX - 1);
+
+  uint32_t heap_h_pid;
+  if (!catalog_find_table(bp, cat, name, &heap_h_pid)) return 0;
+
+  out->ncols = catalog_load_schema(bp, cat, name, out->cols, CATALOG_MAX_COLS);
+  if (out->ncols <= 0) return -1;
+  row_layout(out->cols, out->ncols);
+
+  out->hf = heap_open(bp, heap_h_pid);
+
+  IndexEntry entries[TABLE_MAX_INDEXES];
+  int n = catalog_load_indexes(bp, cat, name, entries, TABLE_MAX_INDEXES);
+  for (int i = 0; i < n; i++) {
+    int ci = table_find_column(out->cols, out->ncols, entries[i].col);
+    if (ci < 0) continue;
+    TableIndex* ix = &out->ixs[out->nix++];
+    ix->entry = entries[i];
+    ix->tree = btree_open(bp, entries[i].meta_pid);
+    ix->col_idx = ci;
+  }
+  return 1;
+}
+
+int table_find_column(const ColumnDef* cols, int ncols, const char* name) {
+  for (int i = 0; i < ncols; i++) {
+    if (strcasecmp(cols[i].col, name) == 0) return i;
+  }
+  return -1;
+}
+
+void table_index_key(BufferPool* bp, const TableIndex* ix, const RowField* v, uint8_t* key) {
+  switch (row_value_kind(v->type)) {
+    case VAL_I32:
+      btree_key_int(&ix->tree, v->i32, key);
+      break;
+    case VAL_I64:
+      btree_key_i64(&ix->tree, v->i64, key);
+      break;
+    case VAL_F64:
+      btree_key_f64(&ix->tree, v->f64, key);
+      break;
+    case VAL_TEXT: {
+      char text[BTREE_TEXT_KEY_MAX];
+      uint32_t n = row_field_text(bp, v, (uint8_t*)text, BTREE_TEXT_KEY_MAX);
+      btree_key_text(&ix->tree, text, n, key);
+      break;
+    }
+  }
+}
+
+// Builds an index key from an encoded row. NULLs are not indexed.
+static int index_key_for_row(BufferPool* bp, const TableIndex* ix, const ColumnDef* cols,
+                             int ncols, const uint8_t* row, uint16_t len, uint8_t* key) {
+  RowField v;
+  if (row_get_field(cols, ncols, row, len, ix->col_idx, &v) <= 0) return 0;
+  table_index_key(bp, ix, &v, key);
+  return 1;
+}
+
+void table_index_insert(BufferPool* bp, TableIndex* ix, const ColumnDef* cols, int ncols,
+                        const uint8_t* row, uint16_t len, RID rid) {
+  uint8_t key[BTREE_KEY_MAX];
+  if (index_key_for_row(bp, ix, cols, ncols, row, len, key)) btree_insert(bp, &ix->tree, key, rid);
+}
+
+void table_index_delete(BufferPool* bp, TableIndex* ix, const ColumnDef* cols, int ncols,
+                        const uint8_t* row, uint16_t len, RID rid) {
+  uint8_t key[BTREE_KEY_MAX];
+  if (index_key_for_row(bp, ix, cols, ncols, row, len, key)) btree_delete(bp, &ix->tree, key, rid);
+}
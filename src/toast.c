@@ -0,0 +1,61 @@
+#include "toast.h"
+#include "freelist.h"
+#include "catalog.h"
+#include <string.h>
+
+uint32_t toast_store(BufferPool* bp, const uint8_t* data, uint32_t len) {
+  // A private run keeps the chain physically contiguous, so reading a
+  // value back is one sequential sweep.
+  PageRun run = {0};
+  uint32_t first = INVALID_PID;
+  uint32_t prev = INVALID_PID;
+  Page* pp = NULL;
+
+  for (uint32_t off = 0; off < len; off += TOAST_PAGE_BYTES) {
+    uint32_t pid = freelist_alloc_run(bp, &run);
+    Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+    uint32_t n = len - off < TOAST_PAGE_BYTES ? len - off : TOAST_PAGE_BYTES;
+    memcpy(p->data, data + off, n);
+    p->hdr.free_start = (uint16_t)n;
+    p->hdr.next_page_id = INVALID_PID;
+
+    if (pp) {
+      pp->hdr.next_page_id = pid;
+      bp_unpin_page(bp, prev, true);
+    } else {
+      first = pid;
+    }
+    pp = p;
+    prev = pid;
+  }
+  if (pp) bp_unpin_page(bp, prev, true);
+
+  // Reserved pages the value did not need go back to the free list.
+  while (run.next < run.end) freelist_push(bp, run.next++);
+  return first;
+}
+
+uint32_t toast_fetch(BufferPool* bp, uint32_t pid, uint8_t* out, uint32_t n) {
+  uint32_t got = 0;
+  while (got < n && pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint32_t avail = p->hdr.free_start;
+    uint32_t take = n - got < avail ? n - got : avail;
+    memcpy(out + got, p->data, take);
+    got += take;
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+    pid = next;
+  }
+  return got;
+}
+
+void toast_release(BufferPool* bp, uint32_t pid) {
+  while (pid != INVALID_PID) {
+    Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+    uint32_t next = p->hdr.next_page_id;
+    bp_unpin_page(bp, pid, false);
+    freelist_push(bp, pid);
+    pid = next;
+  }
+}
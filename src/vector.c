@@ -0,0 +1,111 @@
+#include "vector.h"
+#include "kernels.h"
+#include <string.h>
+
+bool vector_init(ColumnVector* v, ColumnType type, Arena* a) {
+  memset(v, 0, sizeof(*v));
+  v->type = type;
+  switch (row_value_kind(type)) {
+    case VAL_I32:
+      v->i32 = arena_alloc(a, sizeof(int32_t) * VECTOR_SIZE);
+      return v->i32 != NULL;
+    case VAL_I64:
+      v->i64 = arena_alloc(a, sizeof(int64_t) * VECTOR_SIZE);
+      return v->i64 != NULL;
+    case VAL_F64:
+      v->f64 = arena_alloc(a, sizeof(double) * VECTOR_SIZE);
+      return v->f64 != NULL;
+    case VAL_TEXT:
+      break;
+  }
+  v->text_off = arena_alloc(a, sizeof(uint32_t) * VECTOR_SIZE);
+  v->text_len = arena_alloc(a, sizeof(uint32_t) * VECTOR_SIZE);
+  v->toast_pid = arena_alloc(a, sizeof(uint32_t) * VECTOR_SIZE);
+  v->text = arena_alloc(a, VECTOR_TEXT_BYTES + KERNEL_TEXT_PAD);
+  return v->text_off && v->text_len && v->toast_pid && v->text;
+}
+
+// Backing arrays of every all-NULL vector, so code that indexes a
+// vector's arrays before checking for NULL still reads zeros.
+static int32_t null_i32[VECTOR_SIZE];
+static int64_t null_i64[VECTOR_SIZE];
+static double null_f64[VECTOR_SIZE];
+static uint32_t null_u32[VECTOR_SIZE];
+static uint8_t null_text[KERNEL_TEXT_PAD];
+
+void vector_init_null(ColumnVector* v, ColumnType type) {
+  memset(v, 0, sizeof(*v));
+  v->type = type;
+  v->has_nulls = true;
+  memset(v->nulls, 0xff, sizeof(v->nulls));
+  switch (row_value_kind(type)) {
+    case VAL_I64: v->i64 = null_i64; break;
+    case VAL_F64: v->f64 = null_f64; break;
+    default: v->i32 = null_i32; break;
+  }
+  v->text_off = null_u32;
+  v->text_len = null_u32;
+  v->toast_pid = null_u32;
+  v->text = null_text;
+}
+
+void vector_reset(ColumnVector* v) {
+  if (v->has_nulls) memset(v->nulls, 0, sizeof(v->nulls));
+  v->has_nulls = false;
+  v->has_external = false;
+  v->text_used = 0;
+}
+
+void vector_get(const ColumnVector* v, int i, RowField* out) {
+  out->type = v->type;
+  out->is_null = vector_is_null(v, i);
+  if (out->is_null) return;
+
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: out->i32 = v->i32[i]; return;
+    case VAL_I64: out->i64 = v->i64[i]; return;
+    case VAL_F64: out->f64 = v->f64[i]; return;
+    case VAL_TEXT: break;
+  }
+  out->text_len = v->text_len[i];
+  out->toast_pid = v->toast_pid[i];
+  out->text = out->toast_pid == INVALID_PID ? v->text + v->text_off[i] : NULL;
+}
+
+bool vector_set(ColumnVector* v, int i, const RowField* f) {
+  if (f->is_null) {
+    v->nulls[i >> 6] |= 1ull << (i & 63);
+    v->has_nulls = true;
+    switch (row_value_kind(v->type)) {
+      case VAL_I32: v->i32[i] = 0; break;
+      case VAL_I64: v->i64[i] = 0; break;
+      case VAL_F64: v->f64[i] = 0; break;
+      case VAL_TEXT:
+        v->text_off[i] = 0;
+        v->text_len[i] = 0;
+        v->toast_pid[i] = INVALID_PID;
+        break;
+    }
+    return true;
+  }
+  if (v->has_nulls) v->nulls[i >> 6] &= ~(1ull << (i & 63));
+
+  switch (row_value_kind(v->type)) {
+    case VAL_I32: v->i32[i] = f->i32; return true;
+    case VAL_I64: v->i64[i] = f->i64; return true;
+    case VAL_F64: v->f64[i] = f->f64; return true;
+    case VAL_TEXT: break;
+  }
+  if (f->toast_pid != INVALID_PID) {
+    v->text_off[i] = 0;
+    v->has_external = true;
+  } else {
+    if (v->text_used + f->text_len > VECTOR_TEXT_BYTES) return false;
+    memcpy(v->text + v->text_used, f->text, f->text_len);
+    v->text_off[i] = v->text_used;
+    v->text_used += f->text_len;
+  }
+  v->text_len[i] = f->text_len;
+  v->toast_pid[i] = f->toast_pid;
+  return true;
+}
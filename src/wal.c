@@ -0,0 +1,361 @@
+#include "wal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define WAL_HEADER_SIZE 16
+#define WAL_RECORD_HEADER 20
+#define WAL_CHECKPOINT_BYTES (16u * 1024 * 1024)
+
+static _Thread_local uint32_t tls_txn;
+static _Thread_local bool tls_txn_logged; // tls_txn has written an update record
+
+// ============================================================================
+// Encoding helpers
+// ============================================================================
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    crc_table[i] = c;
+  }
+}
+
+static uint32_t crc32(const uint8_t* p, size_t n) {
+  uint32_t c = 0xFFFFFFFFu;
+  for (size_t i = 0; i < n; i++) c = crc_table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+static void put_u16(uint8_t* p, uint16_t v) { memcpy(p, &v, sizeof(v)); }
+static void put_u32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+static uint16_t get_u16(const uint8_t* p) { uint16_t v; memcpy(&v, p, sizeof(v)); return v; }
+static uint32_t get_u32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+// Returns 0, or the errno of the failed write.
+static int write_all(int fd, const uint8_t* p, size_t n, off_t off) {
+  while (n > 0) {
+    ssize_t w = pwrite(fd, p, n, off);
+    if (w < 0 && errno == EINTR) continue;
+    if (w <= 0) return w < 0 ? errno : EIO;
+    p += w;
+    n -= (size_t)w;
+    off += w;
+  }
+  return 0;
+}
+
+static int write_file_header(LogManager* lm) {
+  uint8_t hdr[WAL_HEADER_SIZE] = {0};
+  memcpy(hdr, WAL_MAGIC, 8);
+  put_u32(hdr + 8, lm->base_lsn);
+  return write_all(lm->fd, hdr, sizeof(hdr), 0);
+}
+
+// Reserves room for n more bytes in the append buffer. Caller holds lm->mu.
+static uint8_t* reserve(LogManager* lm, size_t n) {
+  if (lm->buf_len + n > lm->buf_cap) {
+    size_t cap = lm->buf_cap ? lm->buf_cap : 64 * 1024;
+    while (cap < lm->buf_len + n) cap *= 2;
+    lm->buf = realloc(lm->buf, cap);
+    lm->buf_cap = cap;
+  }
+  uint8_t* p = lm->buf + lm->buf_len;
+  lm->buf_len += n;
+  return p;
+}
+
+// Appends a record with the given body and returns its LSN. Caller holds lm->mu.
+static uint32_t append_record(LogManager* lm, uint8_t type, uint32_t txn,
+                              uint32_t page_id, uint16_t nranges, size_t body_len,
+                              uint8_t** body_out) {
+  size_t total = WAL_RECORD_HEADER + body_len + sizeof(uint32_t);
+  uint8_t* p = reserve(lm, total);
+  uint32_t lsn = lm->next_lsn++;
+
+  put_u32(p + 0, (uint32_t)total);
+  put_u32(p + 4, lsn);
+  put_u32(p + 8, txn);
+  p[12] = type;
+  p[13] = 0;
+  put_u16(p + 14, nranges);
+  put_u32(p + 16, page_id);
+
+  *body_out = p + WAL_RECORD_HEADER;
+  return lsn;
+}
+
+static void seal_record(uint8_t* rec) {
+  uint32_t total = get_u32(rec);
+  put_u32(rec + total - sizeof(uint32_t), crc32(rec, total - sizeof(uint32_t)));
+}
+
+// ============================================================================
+// Open / close
+// ============================================================================
+
+LogManager* wal_open(const char* path) {
+  pthread_once(&crc_once, crc_init);
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return NULL;
+
+  LogManager* lm = calloc(1, sizeof(*lm));
+  if (!lm) {
+    close(fd);
+    errno = ENOMEM;
+    return NULL;
+  }
+  lm->fd = fd;
+  lm->base_lsn = 1;
+  lm->next_txn = 1;
+  lm->group_commit_size = 1;
+  pthread_mutex_init(&lm->mu, NULL);
+  pthread_cond_init(&lm->flushed, NULL);
+
+  uint8_t hdr[WAL_HEADER_SIZE];
+  if (pread(fd, hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+      memcmp(hdr, WAL_MAGIC, 8) == 0) {
+    lm->base_lsn = get_u32(hdr + 8);
+  } else {
+    lm->io_error = ftruncate(fd, 0) != 0 ? errno : write_file_header(lm);
+  }
+
+  // Find the end of the valid log and the highest LSN/transaction in it.
+  lm->next_lsn = lm->base_lsn;
+  lm->file_end = WAL_HEADER_SIZE;
+
+  WalReader r;
+  WalRecord rec;
+  wal_reader_open(lm, &r);
+  while (wal_reader_next(&r, &rec)) {
+    lm->next_lsn = rec.lsn + 1;
+    if (rec.txn >= lm->next_txn) lm->next_txn = rec.txn + 1;
+  }
+  lm->file_end = WAL_HEADER_SIZE + (off_t)r.pos;
+  wal_reader_close(&r);
+
+  // Cut off a torn tail so new records follow the last valid one.
+  if (ftruncate(fd, lm->file_end) != 0 && !lm->io_error) lm->io_error = errno;
+
+  lm->flushed_lsn = lm->next_lsn - 1;
+  return lm;
+}
+
+void wal_close(LogManager* lm) {
+  if (!lm) return;
+  wal_flush(lm, lm->next_lsn - 1);
+  close(lm->fd);
+  pthread_cond_destroy(&lm->flushed);
+  pthread_mutex_destroy(&lm->mu);
+  free(lm->buf);
+  free(lm->flush_buf);
+  free(lm);
+}
+
+// ============================================================================
+// Transactions
+// ============================================================================
+
+uint32_t wal_begin(LogManager* lm) {
+  pthread_mutex_lock(&lm->mu);
+  tls_txn = lm->next_txn++;
+  pthread_mutex_unlock(&lm->mu);
+  tls_txn_logged = false;
+  return tls_txn;
+}
+
+uint32_t wal_current_txn(void) {
+  return tls_txn;
+}
+
+bool wal_commit(LogManager* lm) {
+  if (tls_txn == 0) return true;
+
+  // Read-only transactions have nothing to make durable.
+  if (!tls_txn_logged) {
+    tls_txn = 0;
+    return true;
+  }
+
+  pthread_mutex_lock(&lm->mu);
+  uint8_t* body;
+  uint32_t lsn = append_record(lm, WAL_COMMIT, tls_txn, 0, 0, 0, &body);
+  seal_record(body - WAL_RECORD_HEADER);
+  lm->commits++;
+  lm->pending_commits++;
+  bool must_sync = lm->pending_commits >= lm->group_commit_size;
+  bool failed = lm->io_error != 0;
+  pthread_mutex_unlock(&lm->mu);
+
+  tls_txn = 0;
+  if (must_sync) return wal_flush(lm, lsn);
+  return !failed;
+}
+
+uint32_t wal_log_update(LogManager* lm, uint32_t page_id,
+                        const uint8_t* before, const uint8_t* after,
+                        const WalRange* ranges, int nranges) {
+  size_t body_len = 0;
+  for (int i = 0; i < nranges; i++) body_len += 4 + 2 * (size_t)ranges[i].len;
+
+  pthread_mutex_lock(&lm->mu);
+  uint8_t* body;
+  uint32_t lsn = append_record(lm, WAL_UPDATE, tls_txn, page_id,
+                               (uint16_t)nranges, body_len, &body);
+  uint8_t* p = body;
+  for (int i = 0; i < nranges; i++) {
+    put_u16(p, ranges[i].offset);
+    put_u16(p + 2, ranges[i].len);
+    memcpy(p + 4, before + ranges[i].offset, ranges[i].len);
+    memcpy(p + 4 + ranges[i].len, after + ranges[i].offset, ranges[i].len);
+    p += 4 + 2 * (size_t)ranges[i].len;
+  }
+  seal_record(body - WAL_RECORD_HEADER);
+  pthread_mutex_unlock(&lm->mu);
+
+  if (tls_txn != 0) tls_txn_logged = true;
+  return lsn;
+}
+
+// ============================================================================
+// Flushing (group commit)
+// ============================================================================
+
+bool wal_flush(LogManager* lm, uint32_t lsn) {
+  pthread_mutex_lock(&lm->mu);
+
+  while (lm->flushed_lsn < lsn && !lm->io_error) {
+    if (lm->flushing) {
+      // Follower: the current leader's fsync (or the next one) covers us.
+      lm->waiters++;
+      pthread_cond_wait(&lm->flushed, &lm->mu);
+      lm->waiters--;
+      continue;
+    }
+
+    // Leader: optionally give concurrent committers a moment to append their
+    // commit records, then write and sync everything buffered so far.
+    lm->flushing = true;
+    if (lm->commit_delay_us > 0 && lm->waiters > 0) {
+      pthread_mutex_unlock(&lm->mu);
+      usleep((useconds_t)lm->commit_delay_us);
+      pthread_mutex_lock(&lm->mu);
+    }
+
+    uint8_t* data = lm->buf;
+    size_t len = lm->buf_len;
+    size_t cap = lm->buf_cap;
+    uint32_t target = lm->next_lsn - 1;
+    off_t off = lm->file_end;
+
+    // Swap in the spare buffer so appends continue while we write.
+    lm->buf = lm->flush_buf;
+    lm->buf_cap = lm->flush_cap;
+    lm->buf_len = 0;
+    lm->flush_buf = NULL;
+    lm->flush_cap = 0;
+    lm->file_end += (off_t)len;
+    lm->pending_commits = 0;
+    pthread_mutex_unlock(&lm->mu);
+
+    int err = len > 0 ? write_all(lm->fd, data, len, off) : 0;
+    if (!err && fdatasync(lm->fd) != 0) err = errno;
+
+    // After a failure nothing past flushed_lsn is known to be on disk, and
+    // a later write could not fill the hole, so the error sticks.
+    pthread_mutex_lock(&lm->mu);
+    lm->flush_buf = data;
+    lm->flush_cap = cap;
+    if (err) lm->io_error = err;
+    else lm->flushed_lsn = target;
+    lm->flushing = false;
+    lm->fsyncs++;
+    pthread_cond_broadcast(&lm->flushed);
+  }
+
+  bool ok = lm->flushed_lsn >= lsn;
+  pthread_mutex_unlock(&lm->mu);
+  return ok;
+}
+
+bool wal_failed(LogManager* lm) {
+  pthread_mutex_lock(&lm->mu);
+  bool failed = lm->io_error != 0;
+  pthread_mutex_unlock(&lm->mu);
+  return failed;
+}
+
+bool wal_needs_checkpoint(LogManager* lm) {
+  pthread_mutex_lock(&lm->mu);
+  bool big = (size_t)lm->file_end + lm->buf_len > WAL_CHECKPOINT_BYTES;
+  pthread_mutex_unlock(&lm->mu);
+  return big;
+}
+
+void wal_reset(LogManager* lm) {
+  if (!wal_flush(lm, lm->next_lsn - 1)) return;
+
+  pthread_mutex_lock(&lm->mu);
+  lm->base_lsn = lm->next_lsn;
+  lm->file_end = WAL_HEADER_SIZE;
+  int err = ftruncate(lm->fd, 0) != 0 ? errno : write_file_header(lm);
+  if (!err && fdatasync(lm->fd) != 0) err = errno;
+  if (err) lm->io_error = err;
+  pthread_mutex_unlock(&lm->mu);
+}
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+void wal_reader_open(LogManager* lm, WalReader* r) {
+  memset(r, 0, sizeof(*r));
+
+  struct stat st;
+  if (fstat(lm->fd, &st) != 0 || st.st_size <= WAL_HEADER_SIZE) return;
+
+  r->len = (size_t)st.st_size - WAL_HEADER_SIZE;
+  r->data = malloc(r->len);
+
+  size_t done = 0;
+  while (done < r->len) {
+    ssize_t n = pread(lm->fd, r->data + done, r->len - done, WAL_HEADER_SIZE + (off_t)done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += (size_t)n;
+  }
+  r->len = done;
+}
+
+bool wal_reader_next(WalReader* r, WalRecord* out) {
+  if (r->pos + WAL_RECORD_HEADER + sizeof(uint32_t) > r->len) return false;
+
+  const uint8_t* p = r->data + r->pos;
+  uint32_t total = get_u32(p);
+  if (total < WAL_RECORD_HEADER + sizeof(uint32_t) || r->pos + total > r->len) return false;
+  if (get_u32(p + total - sizeof(uint32_t)) != crc32(p, total - sizeof(uint32_t))) return false;
+
+  out->lsn = get_u32(p + 4);
+  out->txn = get_u32(p + 8);
+  out->type = p[12];
+  out->nranges = get_u16(p + 14);
+  out->page_id = get_u32(p + 16);
+  out->body = p + WAL_RECORD_HEADER;
+
+  r->pos += total;
+  return true;
+}
+
+void wal_reader_close(WalReader* r) {
+  free(r->data);
+  memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,309 @@
+#include "check.h"
+#include "agg.h"
+#include "query.h"
+#include <unistd.h>
+
+// Runs GROUP BY queries and aggregates without groups, and checks their
+// rows against the same aggregates computed in C: NULL keys form a group,
+// COUNT of a column skips NULLs, AVG keeps its fraction and an empty input
+// gives one row of NULLs. Each GROUP BY runs once in memory and once with
+// a work_mem small enough that groups spill to partition files.
+
+#define TEST_PATH "agg_test.db"
+#define POOL_FRAMES 16384
+#define SMALL_WORK_MEM (16 * 1024)
+#define NROWS 30000
+#define G_GROUPS 3000
+#define K_GROUPS 9000
+#define S_GROUPS 500
+#define LONG_TEXT 3000
+
+static const char* COLS[] = { "id", "g", "k", "v", "d", "s" };
+static const ColumnType TYPES[] = { COL_INT, COL_INT, COL_INT, COL_BIGINT, COL_DOUBLE, COL_TEXT };
+
+typedef struct {
+  int id;
+  bool g_null;
+  int g;
+  int k;
+  long long v;
+  double d;
+  bool s_null;
+  int s; ///< Text is "s<s>", padded with 'x' when long
+  bool s_long;
+} Row;
+
+static uint32_t mix(int i, uint32_t salt) {
+  uint32_t x = (uint32_t)i * 2654435761u ^ salt * 0x9e3779b9u;
+  x ^= x >> 15;
+  x *= 0x85ebca6bu;
+  return x ^ (x >> 13);
+}
+
+static void make_row(int i, Row* r) {
+  r->id = i;
+  r->g_null = i % 97 == 0;
+  r->g = (int)(mix(i, 1) % G_GROUPS);
+  r->k = (int)(mix(i, 2) % K_GROUPS);
+  r->v = (long long)(mix(i, 3) % 2000000) * 1000003LL - 1000000000000LL;
+  r->d = (double)(mix(i, 4) % 4000) / 4;
+  r->s_null = i % 89 == 0;
+  r->s = (int)(mix(i, 5) % S_GROUPS);
+  // Every 200th value is long enough to be stored out of line.
+  r->s_long = i % 200 == 0;
+}
+
+static int row_text(const Row* r, char* out) {
+  int n = sprintf(out, "s%03d", r->s);
+  if (!r->s_long) return n;
+  memset(out + n, 'x', LONG_TEXT - (size_t)n);
+  out[LONG_TEXT] = 0;
+  return LONG_TEXT;
+}
+
+static void fill(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  Row r;
+  make_row(i, &r);
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", r.id);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", r.g);
+  snprintf(vals[2], QUERY_VALUE_LEN, "%d", r.k);
+  snprintf(vals[3], QUERY_VALUE_LEN, "%lld", r.v);
+  snprintf(vals[4], QUERY_VALUE_LEN, "%.2f", r.d);
+  row_text(&r, vals[5]);
+  for (int c = 0; c < 6; c++) out[c] = vals[c];
+  if (r.g_null) out[1] = NULL;
+  if (r.s_null) out[5] = NULL;
+}
+
+// ============================================================================
+// Reference aggregates
+// ============================================================================
+
+typedef struct {
+  long long count; ///< Rows in the group
+  long long count_s; ///< Rows whose s is not NULL
+  long long sum_v;
+  long long max_v;
+  double min_d;
+  double max_d;
+  long long sum_id;
+  int min_s; ///< Row with the smallest s, or -1
+  int max_s; ///< Row with the largest s, or -1
+} Group;
+
+static Row rows[NROWS];
+
+static int cmp_text(const Row* a, const Row* b) {
+  static char x[LONG_TEXT + 1], y[LONG_TEXT + 1];
+  row_text(a, x);
+  row_text(b, y);
+  return strcmp(x, y);
+}
+
+static void group_add(Group* g, const Row* r) {
+  if (g->count == 0) {
+    g->max_v = r->v;
+    g->min_d = g->max_d = r->d;
+    g->min_s = g->max_s = -1;
+  }
+  g->count++;
+  g->sum_v += r->v;
+  if (r->v > g->max_v) g->max_v = r->v;
+  if (r->d < g->min_d) g->min_d = r->d;
+  if (r->d > g->max_d) g->max_d = r->d;
+  g->sum_id += r->id;
+  if (r->s_null) return;
+  g->count_s++;
+  if (g->min_s < 0 || cmp_text(r, &rows[g->min_s]) < 0) g->min_s = r->id;
+  if (g->max_s < 0 || cmp_text(r, &rows[g->max_s]) > 0) g->max_s = r->id;
+}
+
+// Appends a value formatted the way query_run formats it.
+static void put(char* line, ColumnType type, bool is_null, long long i, double d) {
+  RowField f = { .type = type, .is_null = is_null };
+  if (type == COL_INT) f.i32 = (int32_t)i;
+  else if (type == COL_BIGINT) f.i64 = i;
+  else f.f64 = d;
+  char text[64];
+  query_format(NULL, &f, text, sizeof(text));
+  if (*line) strcat(line, "|");
+  strcat(line, text);
+}
+
+static void put_text(char* line, int row) {
+  if (*line) strcat(line, "|");
+  if (row < 0) strcat(line, "NULL");
+  else row_text(&rows[row], line + strlen(line));
+}
+
+// SELECT g, count(*), count(s), sum(v), min(d), max(d), avg(id) FROM a GROUP BY g
+static void ref_by_g(Result* out) {
+  static Group groups[G_GROUPS + 1];
+  memset(groups, 0, sizeof(groups));
+  for (int i = 0; i < NROWS; i++) group_add(&groups[rows[i].g_null ? G_GROUPS : rows[i].g], &rows[i]);
+  char line[256];
+  for (int g = 0; g <= G_GROUPS; g++) {
+    const Group* x = &groups[g];
+    if (!x->count) continue;
+    line[0] = 0;
+    put(line, COL_INT, g == G_GROUPS, g, 0);
+    put(line, COL_INT, false, x->count, 0);
+    put(line, COL_INT, false, x->count_s, 0);
+    put(line, COL_BIGINT, false, x->sum_v, 0);
+    put(line, COL_DOUBLE, false, 0, x->min_d);
+    put(line, COL_DOUBLE, false, 0, x->max_d);
+    put(line, COL_DOUBLE, false, 0, (double)x->sum_id / (double)x->count);
+    result_add(out, line);
+  }
+}
+
+// SELECT k, count(s), min(s), max(v) FROM a GROUP BY k
+static void ref_by_k(Result* out) {
+  static Group groups[K_GROUPS];
+  memset(groups, 0, sizeof(groups));
+  for (int i = 0; i < NROWS; i++) group_add(&groups[rows[i].k], &rows[i]);
+  static char line[QUERY_LINE_LEN];
+  for (int k = 0; k < K_GROUPS; k++) {
+    const Group* x = &groups[k];
+    if (!x->count) continue;
+    line[0] = 0;
+    put(line, COL_INT, false, k, 0);
+    put(line, COL_INT, false, x->count_s, 0);
+    put_text(line, x->min_s);
+    put(line, COL_BIGINT, false, x->max_v, 0);
+    result_add(out, line);
+  }
+}
+
+// SELECT s, count(*), sum(id) FROM a GROUP BY s
+static void ref_by_s(Result* out) {
+  static Group groups[2 * S_GROUPS + 1];
+  static int first[2 * S_GROUPS + 1];
+  memset(groups, 0, sizeof(groups));
+  for (int i = 0; i < NROWS; i++) {
+    const Row* r = &rows[i];
+    int g = r->s_null ? 2 * S_GROUPS : r->s * 2 + r->s_long;
+    if (!groups[g].count) first[g] = i;
+    group_add(&groups[g], r);
+  }
+  static char line[QUERY_LINE_LEN];
+  for (int g = 0; g <= 2 * S_GROUPS; g++) {
+    const Group* x = &groups[g];
+    if (!x->count) continue;
+    line[0] = 0;
+    put_text(line, g == 2 * S_GROUPS ? -1 : first[g]);
+    put(line, COL_INT, false, x->count, 0);
+    put(line, COL_INT, false, x->sum_id, 0);
+    result_add(out, line);
+  }
+}
+
+typedef struct {
+  const char* sql;
+  void (*ref)(Result* out);
+} Query;
+
+static const Query QUERIES[] = {
+  { "SELECT g, count(*), count(s), sum(v), min(d), max(d), avg(id) FROM a GROUP BY g", ref_by_g },
+  { "SELECT k, count(s), min(s), max(v) FROM a GROUP BY k", ref_by_k },
+  { "SELECT s, count(*), sum(id) FROM a GROUP BY s", ref_by_s },
+};
+
+static void read_stats(const Operator* plan, void* arg) {
+  for (const Operator* op = plan; op; op = op->child) {
+    if (strncmp(op->label, "HashAgg", 7) == 0) exec_hash_agg_stats(op, arg);
+  }
+}
+
+static void test_group_by(BufferPool* bp, Catalog* cat) {
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    Result ref = {0};
+    QUERIES[q].ref(&ref);
+    result_sort(&ref);
+    const size_t work_mem[2] = { 0, SMALL_WORK_MEM };
+    for (int w = 0; w < 2; w++) {
+      Result got = {0};
+      HashAggStats st = {0};
+      CHECK(query_run(bp, cat, QUERIES[q].sql, work_mem[w], &got, read_stats, &st));
+      CHECK(st.groups == (uint64_t)ref.n);
+      CHECK(w == 0 ? st.spilled_rows == 0 : st.spilled_rows > 0);
+      result_sort(&got);
+      CHECK(result_equal(QUERIES[q].sql, &got, &ref));
+      result_free(&got);
+    }
+    result_free(&ref);
+  }
+}
+
+// Runs a query that returns one row and compares it with want.
+static void check_row(BufferPool* bp, Catalog* cat, const char* sql, const char* want) {
+  Result got = {0};
+  CHECK(query_run(bp, cat, sql, 0, &got, NULL, NULL));
+  Result ref = {0};
+  result_add(&ref, want);
+  CHECK(result_equal(sql, &got, &ref));
+  result_free(&got);
+  result_free(&ref);
+}
+
+static void test_single_group(BufferPool* bp, Catalog* cat) {
+  // Without GROUP BY, an empty input still gives a row.
+  check_row(bp, cat, "SELECT count(*), count(g), sum(v), min(s), avg(d) FROM a WHERE id < 0",
+            "0|0|NULL|NULL|NULL");
+  check_row(bp, cat, "SELECT avg(id), sum(id) FROM a WHERE id < 2", "0.5|1");
+
+  long long count_g = 0, sum_id = 0;
+  for (int i = 0; i < NROWS; i++) {
+    count_g += !rows[i].g_null;
+    sum_id += rows[i].id;
+  }
+  char want[64];
+  snprintf(want, sizeof(want), "%d|%lld|%lld", NROWS, count_g, sum_id);
+  check_row(bp, cat, "SELECT count(*), count(g), sum(id) FROM a", want);
+  // A GROUP BY over no rows gives no groups.
+  Result got = {0};
+  CHECK(query_run(bp, cat, "SELECT g, count(*) FROM a WHERE id < 0 GROUP BY g", 0, &got, NULL,
+                  NULL));
+  CHECK(got.n == 0);
+  result_free(&got);
+}
+
+static void fill_big(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  (void)i;
+  snprintf(vals[0], QUERY_VALUE_LEN, "4000000000000000000");
+  out[0] = vals[0];
+}
+
+// A SUM outside the range of its type fails the query.
+static void test_overflow(BufferPool* bp, Catalog* cat) {
+  static const char* names[] = { "v" };
+  static const ColumnType types[] = { COL_BIGINT };
+  query_load(bp, cat, "big", names, types, 1, 3, fill_big);
+  char err[256];
+  Cursor* c = cursor_open(bp, cat, "SELECT sum(v) FROM big", 0, err, sizeof(err));
+  CHECK(c != NULL);
+  if (!c) return;
+  Batch b;
+  CHECK(cursor_fetch_batch(c, &b) < 0);
+  CHECK(strstr(cursor_error(c), "range") != NULL);
+  cursor_close(c);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  for (int i = 0; i < NROWS; i++) make_row(i, &rows[i]);
+  query_load(bp, &cat, "a", COLS, TYPES, 6, NROWS, fill);
+
+  test_group_by(bp, &cat);
+  test_single_group(bp, &cat);
+  test_overflow(bp, &cat);
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("agg_test");
+}
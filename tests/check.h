@@ -0,0 +1,22 @@
+#pragma once
+#include <stdio.h>
+
+// Assertions shared by the programs in tests/. A failed CHECK reports
+// where it failed and lets the test go on, so one run shows every failure;
+// check_done then gives the program's exit status.
+
+static int check_failures;
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      check_failures++;                                                        \
+    }                                                                          \
+  } while (0)
+
+// Prints the outcome of the test and returns its exit status.
+static inline int check_done(const char* name) {
+  printf("%s: %s\n", name, check_failures ? "FAILED" : "ok");
+  return check_failures ? 1 : 0;
+}
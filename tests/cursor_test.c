@@ -0,0 +1,148 @@
+#include "check.h"
+#include "query.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+// Pulls SELECT results a batch at a time through a cursor: LIMIT and
+// OFFSET return the right rows wherever they fall among the batches, a
+// LIMIT reads only the pages it needs, and pages are unpinned as soon as
+// the rows run out or the cursor is closed part way.
+
+#define TEST_PATH "cursor_test.db"
+#define POOL_FRAMES 1024
+#define NROWS 10000
+
+static const char* COLS[] = { "id", "v", "s" };
+static const ColumnType TYPES[] = { COL_INT, COL_INT, COL_TEXT };
+
+static void fill(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", i);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", i % 10);
+  snprintf(vals[2], QUERY_VALUE_LEN, "row %d of the table", i);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+}
+
+static int pinned(BufferPool* bp) {
+  int n = 0;
+  for (int i = 0; i < bp->capacity; i++) n += atomic_load(&bp->frames[i].pin_count);
+  return n;
+}
+
+static uint64_t fetches(BufferPool* bp) {
+  BufferStats st;
+  bp_stats(bp, &st);
+  return st.hits + st.misses;
+}
+
+typedef struct {
+  const char* sql;
+  int first; ///< id of the first row
+  int step; ///< Difference between the ids of consecutive rows
+  int n; ///< Number of rows
+} Query;
+
+static const Query QUERIES[] = {
+  { "SELECT id FROM t LIMIT 5", 0, 1, 5 },
+  { "SELECT id FROM t LIMIT 0", 0, 1, 0 },
+  { "SELECT id FROM t OFFSET 9995", 9995, 1, 5 },
+  { "SELECT id FROM t OFFSET 20000", 0, 1, 0 },
+  { "SELECT id FROM t LIMIT 10 OFFSET 2000", 2000, 1, 10 },
+  { "SELECT id FROM t OFFSET 5 LIMIT 3", 5, 1, 3 },
+  // Past the end of the first batch, and across several.
+  { "SELECT id FROM t LIMIT 2500 OFFSET 1000", 1000, 1, 2500 },
+  { "SELECT id FROM t LIMIT 20000", 0, 1, NROWS },
+  { "SELECT id FROM t WHERE v = 3 LIMIT 7 OFFSET 100", 1003, 10, 7 },
+  { "SELECT id FROM t WHERE v = 3 OFFSET 990", 9903, 10, 10 },
+  { "SELECT id FROM t WHERE id >= 4000 AND v < 5 LIMIT 3", 4000, 1, 3 },
+};
+
+static void test_limits(BufferPool* bp, Catalog* cat) {
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* query = &QUERIES[q];
+    Result got = {0}, want = {0};
+    CHECK(query_run(bp, cat, query->sql, 0, &got, NULL, NULL));
+    for (int i = 0; i < query->n; i++) {
+      char line[16];
+      snprintf(line, sizeof(line), "%d", query->first + i * query->step);
+      result_add(&want, line);
+    }
+    CHECK(result_equal(query->sql, &got, &want));
+    CHECK(pinned(bp) == 0);
+    result_free(&got);
+    result_free(&want);
+  }
+}
+
+// A LIMIT stops the scan once it has its rows; a full scan reads every page.
+static void test_early_stop(BufferPool* bp, Catalog* cat) {
+  uint64_t before = fetches(bp);
+  Result got = {0};
+  CHECK(query_run(bp, cat, "SELECT id, s FROM t LIMIT 5", 0, &got, NULL, NULL));
+  uint64_t limited = fetches(bp) - before;
+  result_free(&got);
+
+  before = fetches(bp);
+  CHECK(query_run(bp, cat, "SELECT id, s FROM t", 0, &got, NULL, NULL));
+  uint64_t full = fetches(bp) - before;
+  CHECK(got.n == NROWS);
+  result_free(&got);
+  CHECK(limited * 10 < full);
+}
+
+static void test_cursor(BufferPool* bp, Catalog* cat) {
+  char err[256];
+  Cursor* c = cursor_open(bp, cat, "SELECT s, id FROM t WHERE v = 1", 0, err, sizeof(err));
+  CHECK(c != NULL);
+  if (!c) return;
+  CHECK(cursor_ncols(c) == 2);
+  CHECK(strcmp(cursor_column(c, 0)->name, "s") == 0 && cursor_column(c, 0)->type == COL_TEXT);
+  CHECK(strcmp(cursor_column(c, 1)->name, "id") == 0 && cursor_column(c, 1)->type == COL_INT);
+
+  // Batches hold at least one row, in order, and the end is sticky.
+  Batch b;
+  int r, rows = 0;
+  bool ordered = true;
+  while ((r = cursor_fetch_batch(c, &b)) > 0) {
+    CHECK(b.nsel > 0 && b.nsel <= VECTOR_SIZE && b.ncols == 2);
+    for (int i = 0; i < b.nsel; i++) {
+      RowField id;
+      vector_get(b.cols[1], b.sel ? b.sel[i] : i, &id);
+      ordered &= id.i32 == rows * 10 + 1;
+      rows++;
+    }
+  }
+  CHECK(r == 0 && ordered && rows == NROWS / 10);
+  CHECK(pinned(bp) == 0);
+  CHECK(cursor_fetch_batch(c, &b) == 0);
+  cursor_close(c);
+
+  // Closing part way releases the scan's page.
+  c = cursor_open(bp, cat, "SELECT id FROM t", 0, err, sizeof(err));
+  CHECK(c && cursor_fetch_batch(c, &b) == 1);
+  cursor_close(c);
+  CHECK(pinned(bp) == 0);
+
+  CHECK(cursor_open(bp, cat, "SELECT nope FROM t", 0, err, sizeof(err)) == NULL);
+  CHECK(strstr(err, "nope") != NULL);
+  CHECK(cursor_open(bp, cat, "DELETE FROM t", 0, err, sizeof(err)) == NULL);
+  CHECK(strstr(err, "SELECT") != NULL);
+  CHECK(pinned(bp) == 0);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  query_load(bp, &cat, "t", COLS, TYPES, 3, NROWS, fill);
+
+  test_limits(bp, &cat);
+  test_early_stop(bp, &cat);
+  test_cursor(bp, &cat);
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("cursor_test");
+}
@@ -0,0 +1,123 @@
+#include "check.h"
+#include "catalog.h"
+#include "freelist.h"
+#include <string.h>
+#include <unistd.h>
+
+// Hands pages back to the free list and checks they are reused before the
+// file grows, that the list survives reopening the file, and that runs
+// reserved for growing structures are consecutive pages of doubling size.
+
+#define TEST_PATH "freelist_test.db"
+#define POOL_FRAMES 64
+#define NPAGES 8
+#define RUN_PAGES 400
+
+typedef struct {
+  DiskManager* dm;
+  BufferPool* bp;
+  Catalog cat;
+} Db;
+
+static void db_open(Db* db) {
+  db->dm = disk_open(TEST_PATH);
+  db->bp = bp_create(db->dm, POOL_FRAMES);
+  db->cat = catalog_open(db->bp);
+}
+
+static void db_close(Db* db) {
+  catalog_close(&db->cat);
+  bp_destroy(db->bp);
+  disk_close(db->dm);
+}
+
+// Fills a page with rows, as a structure would before giving it up.
+static void scribble(BufferPool* bp, uint32_t pid) {
+  Page* p = bp_fetch_page(bp, pid, LATCH_EXCLUSIVE);
+  uint8_t rec[100];
+  memset(rec, 'x', sizeof(rec));
+  while (page_insert(p, rec, sizeof(rec)) >= 0) {}
+  bp_unpin_page(bp, pid, true);
+}
+
+static bool is_fresh(BufferPool* bp, uint32_t pid) {
+  Page* p = bp_fetch_page(bp, pid, LATCH_SHARED);
+  bool fresh = p->hdr.page_id == pid && p->hdr.slot_count == 0 &&
+               p->hdr.next_page_id == INVALID_PID && page_free_space(p) == sizeof(p->data);
+  bp_unpin_page(bp, pid, false);
+  return fresh;
+}
+
+static void test_reuse(Db* db) {
+  BufferPool* bp = db->bp;
+  CHECK(freelist_pop(bp) == INVALID_PID);
+  CHECK(!freelist_push(bp, CATALOG_PID));
+
+  uint32_t pids[NPAGES];
+  for (int i = 0; i < NPAGES; i++) {
+    pids[i] = freelist_alloc(bp);
+    CHECK(i == 0 || pids[i] > pids[i - 1]);
+    scribble(bp, pids[i]);
+  }
+  long size = disk_file_size(db->dm);
+
+  for (int i = 0; i < NPAGES; i++) CHECK(freelist_push(bp, pids[i]));
+  // Newest first, initialized again, and without growing the file.
+  for (int i = NPAGES - 1; i >= NPAGES / 2; i--) {
+    uint32_t pid = freelist_alloc(bp);
+    CHECK(pid == pids[i]);
+    CHECK(is_fresh(bp, pid));
+  }
+  CHECK(disk_file_size(db->dm) == size);
+
+  // The rest of the list is still there after the file is reopened.
+  db_close(db);
+  db_open(db);
+  bp = db->bp;
+  for (int i = NPAGES / 2 - 1; i >= 0; i--) CHECK(freelist_pop(bp) == pids[i]);
+  CHECK(freelist_pop(bp) == INVALID_PID);
+  CHECK(freelist_alloc(bp) > pids[NPAGES - 1]);
+}
+
+// Runs grow 1, 2, 4, ... pages up to FREELIST_RUN_MAX, each a block of
+// consecutive page IDs; a page on the free list is used when a run ends.
+static void test_runs(Db* db) {
+  BufferPool* bp = db->bp;
+  PageRun run = {0};
+  uint32_t prev = freelist_alloc_run(bp, &run);
+  CHECK(run.size == 1 && run.end == prev + 1);
+  int nruns = 1;
+  for (int i = 1; i < RUN_PAGES; i++) {
+    PageRun before = run;
+    uint32_t pid = freelist_alloc_run(bp, &run);
+    if (before.next < before.end) {
+      CHECK(pid == prev + 1);
+      CHECK(run.end == before.end && run.size == before.size);
+    } else {
+      uint32_t want = before.size * 2 > FREELIST_RUN_MAX ? FREELIST_RUN_MAX : before.size * 2;
+      CHECK(run.size == want);
+      CHECK(pid >= before.end && run.end == pid + want);
+      nruns++;
+    }
+    prev = pid;
+  }
+  CHECK(nruns > 7);
+  CHECK(disk_file_size(db->dm) >= (long)run.end * PAGE_SIZE);
+
+  uint32_t freed = freelist_alloc(bp);
+  CHECK(freelist_push(bp, freed));
+  while (run.next < run.end) CHECK(freelist_alloc_run(bp, &run) != freed);
+  CHECK(freelist_alloc_run(bp, &run) == freed);
+  CHECK(run.next == run.end);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  Db db;
+  db_open(&db);
+  test_reuse(&db);
+  test_runs(&db);
+  db_close(&db);
+  unlink(TEST_PATH);
+  return check_done("freelist_test");
+}
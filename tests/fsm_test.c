@@ -0,0 +1,139 @@
+#include "check.h"
+#include "catalog.h"
+#include "fsm.h"
+#include "heap.h"
+#include <string.h>
+#include <unistd.h>
+
+// Checks the free-space map on its own, with pages spread over several
+// leaves, then through a heap: space freed by deletes is used again instead
+// of growing the file, and rows of every size up to a full page go in.
+
+#define TEST_PATH "fsm_test.db"
+#define POOL_FRAMES 256
+#define NROWS 4000
+#define ROW_LEN 200
+#define ROUNDS 5
+
+static void test_map(BufferPool* bp) {
+  uint32_t fsm = fsm_create(bp);
+  CHECK(fsm_find(bp, fsm, 1) == INVALID_PID);
+
+  // Pages far apart land in different leaves.
+  const uint32_t far = 3 * (uint32_t)FSM_LEAF_PAGES + 17;
+  fsm_set(bp, fsm, 5, 100);
+  fsm_set(bp, fsm, 9, 4000);
+  fsm_set(bp, fsm, far, 8000);
+
+  uint32_t pid = fsm_find(bp, fsm, 64);
+  CHECK(pid == 5 || pid == 9 || pid == far);
+  pid = fsm_find(bp, fsm, 3000);
+  CHECK(pid == 9 || pid == far);
+  CHECK(fsm_find(bp, fsm, 7000) == far);
+  // Categories round down, so a page never promises more than it has.
+  CHECK(fsm_find(bp, fsm, 8001) == INVALID_PID);
+  CHECK(fsm_find(bp, fsm, UINT16_MAX) == INVALID_PID);
+
+  fsm_remove(bp, fsm, far);
+  CHECK(fsm_find(bp, fsm, 7000) == INVALID_PID);
+  CHECK(fsm_find(bp, fsm, 3000) == 9);
+  fsm_set(bp, fsm, 9, 0);
+  CHECK(fsm_find(bp, fsm, 3000) == INVALID_PID);
+  // A page that gains space is found again, even in a leaf searched in vain.
+  fsm_set(bp, fsm, far, 5000);
+  CHECK(fsm_find(bp, fsm, 3000) == far);
+  CHECK(fsm_find(bp, fsm, 64) != INVALID_PID);
+}
+
+static void make_row(int i, uint8_t* rec, uint16_t len) {
+  memset(rec, 'a' + i % 26, len);
+  memcpy(rec, &i, sizeof(i));
+}
+
+static int count_rows(BufferPool* bp, HeapFile* hf) {
+  int n = 0;
+  RID cur = { INVALID_PID, 0 };
+  uint8_t* out;
+  uint16_t len;
+  while (heap_scan_next(bp, hf, &cur, &out, &len)) {
+    bp_unpin_page(bp, cur.page_id, false);
+    n++;
+  }
+  return n;
+}
+
+// Deletes and re-inserts every row several times; the heap keeps the size
+// it had after the first load.
+static void test_churn(BufferPool* bp) {
+  uint32_t header_pid;
+  HeapFile hf = heap_create(bp, &header_pid);
+  static RID rids[NROWS];
+  uint8_t rec[ROW_LEN];
+  for (int i = 0; i < NROWS; i++) {
+    make_row(i, rec, ROW_LEN);
+    rids[i] = heap_insert(bp, &hf, rec, ROW_LEN);
+    CHECK(rids[i].page_id != INVALID_PID);
+  }
+  uint32_t pages = heap_count_pages(bp, &hf, UINT32_MAX);
+  long size = disk_file_size(bp->dm);
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < NROWS; i++) CHECK(heap_delete(bp, &hf, rids[i]) == 0);
+    for (int i = 0; i < NROWS; i++) {
+      make_row(i, rec, ROW_LEN);
+      rids[i] = heap_insert(bp, &hf, rec, ROW_LEN);
+    }
+  }
+  CHECK(heap_count_pages(bp, &hf, UINT32_MAX) == pages);
+  CHECK(disk_file_size(bp->dm) == size);
+  CHECK(count_rows(bp, &hf) == NROWS);
+  for (int i = 0; i < NROWS; i += 97) {
+    uint8_t* out;
+    uint16_t len;
+    make_row(i, rec, ROW_LEN);
+    CHECK(heap_get(bp, rids[i], &out, &len) && len == ROW_LEN && memcmp(out, rec, len) == 0);
+  }
+}
+
+// Inserts rows of every size up to the largest a page holds into a heap
+// whose pages are part full, so each one either finds room or a new page.
+static void test_sizes(BufferPool* bp) {
+  uint32_t header_pid;
+  HeapFile hf = heap_create(bp, &header_pid);
+  static uint8_t rec[PAGE_SIZE];
+  uint16_t max = (uint16_t)(sizeof(((Page*)0)->data) - sizeof(Slot));
+  int n = 0;
+  for (uint32_t len = sizeof(int); len <= max; len = len * 3 / 2 + 1) {
+    make_row(n, rec, (uint16_t)len);
+    CHECK(heap_insert(bp, &hf, rec, (uint16_t)len).page_id != INVALID_PID);
+    n++;
+  }
+  for (uint16_t len = max - 40; len <= max; len += 8) {
+    make_row(n, rec, len);
+    CHECK(heap_insert(bp, &hf, rec, len).page_id != INVALID_PID);
+    n++;
+  }
+  make_row(n, rec, max);
+  CHECK(heap_insert(bp, &hf, rec, max).page_id != INVALID_PID);
+  n++;
+  CHECK(heap_insert(bp, &hf, rec, (uint16_t)(max + 1)).page_id == INVALID_PID);
+  CHECK(count_rows(bp, &hf) == n);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  // The catalog root holds the free list the map's pages come from.
+  Catalog cat = catalog_open(bp);
+
+  test_map(bp);
+  test_churn(bp);
+  test_sizes(bp);
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("fsm_test");
+}
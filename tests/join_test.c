@@ -0,0 +1,285 @@
+#include "check.h"
+#include "join.h"
+#include "query.h"
+#include "sql.h"
+#include <unistd.h>
+
+// Runs joins on single and multiple keys, across INT, BIGINT and DOUBLE
+// keys and over three tables, and checks their rows against the same join
+// computed in C: NULL keys match nothing, and a DOUBLE with a fraction
+// matches no integer. Each query runs once in memory and once with a
+// work_mem small enough that the hash join spills partitions to files,
+// or that the planner turns to a merge join over two indexes.
+
+#define TEST_PATH "join_test.db"
+#define POOL_FRAMES 16384
+#define SMALL_WORK_MEM (16 * 1024)
+#define AROWS 20000
+#define BROWS 6000
+#define CROWS 30000
+#define BKEYS (BROWS / 2)
+#define AKEYS (BKEYS + 1000)
+#define LONG_TEXT 3000
+
+static const char* ACOLS[] = { "id", "k", "g", "d", "s" };
+static const ColumnType ATYPES[] = { COL_INT, COL_INT, COL_INT, COL_DOUBLE, COL_TEXT };
+static const char* BCOLS[] = { "k", "g", "w" };
+static const ColumnType BTYPES[] = { COL_BIGINT, COL_INT, COL_TEXT };
+static const char* CCOLS[] = { "ak", "x" };
+static const ColumnType CTYPES[] = { COL_INT, COL_INT };
+
+typedef struct {
+  bool k_null;
+  int k;
+  int g;
+  double d;
+} ARow;
+
+typedef struct {
+  bool k_null;
+  int k;
+  int g;
+} BRow;
+
+typedef struct {
+  bool ak_null;
+  int ak;
+  int x;
+} CRow;
+
+static ARow arows[AROWS];
+static BRow brows[BROWS];
+static CRow crows[CROWS];
+
+static uint32_t mix(int i, uint32_t salt) {
+  uint32_t x = (uint32_t)i * 2654435761u ^ salt * 0x9e3779b9u;
+  x ^= x >> 15;
+  x *= 0x85ebca6bu;
+  return x ^ (x >> 13);
+}
+
+static void make_rows(void) {
+  for (int i = 0; i < AROWS; i++) {
+    arows[i].k_null = i % 101 == 0;
+    arows[i].k = (int)(mix(i, 1) % AKEYS);
+    arows[i].g = i % 7;
+    // Half the values have a fraction and match no key.
+    arows[i].d = (double)(mix(i, 2) % (2 * AKEYS)) / 2;
+  }
+  for (int i = 0; i < BROWS; i++) {
+    brows[i].k_null = i % 97 == 0;
+    brows[i].k = i % BKEYS;
+    brows[i].g = i % 5;
+  }
+  // Some rows point past the last row of a.
+  for (int i = 0; i < CROWS; i++) {
+    crows[i].ak_null = i % 50 == 0;
+    crows[i].ak = (int)(mix(i, 3) % (AROWS + 2000));
+    crows[i].x = (int)(mix(i, 4) % 1000);
+  }
+}
+
+// Text of a.s, long enough to be stored out of line for every 200th row.
+static int a_text(int id, char* out) {
+  int n = sprintf(out, "s%d", id);
+  if (id % 200 != 0) return n;
+  memset(out + n, 'x', LONG_TEXT - (size_t)n);
+  out[LONG_TEXT] = 0;
+  return LONG_TEXT;
+}
+
+static void fill_a(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", i);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", arows[i].k);
+  snprintf(vals[2], QUERY_VALUE_LEN, "%d", arows[i].g);
+  snprintf(vals[3], QUERY_VALUE_LEN, "%.1f", arows[i].d);
+  a_text(i, vals[4]);
+  for (int c = 0; c < 5; c++) out[c] = vals[c];
+  if (arows[i].k_null) out[1] = NULL;
+}
+
+static void fill_b(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", brows[i].k);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", brows[i].g);
+  snprintf(vals[2], QUERY_VALUE_LEN, "w%d", i);
+  for (int c = 0; c < 3; c++) out[c] = vals[c];
+  if (brows[i].k_null) out[0] = NULL;
+}
+
+static void fill_c(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", crows[i].ak);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", crows[i].x);
+  for (int c = 0; c < 2; c++) out[c] = vals[c];
+  if (crows[i].ak_null) out[0] = NULL;
+}
+
+// ============================================================================
+// Reference joins
+// ============================================================================
+
+// Rows of b by key: those with key k are by_key[key_start[k] .. key_start[k + 1]).
+static int key_start[BKEYS + 1];
+static int by_key[BROWS];
+
+static void index_b(void) {
+  int count[BKEYS] = {0};
+  for (int i = 0; i < BROWS; i++) count[brows[i].k] += !brows[i].k_null;
+  key_start[0] = 0;
+  for (int k = 0; k < BKEYS; k++) key_start[k + 1] = key_start[k] + count[k];
+  int pos[BKEYS];
+  memcpy(pos, key_start, sizeof(pos));
+  for (int i = 0; i < BROWS; i++) {
+    if (!brows[i].k_null) by_key[pos[brows[i].k]++] = i;
+  }
+}
+
+// SELECT a.id, b.w, a.s FROM a JOIN b ON a.k = b.k
+static void ref_int_key(Result* out) {
+  static char line[QUERY_LINE_LEN];
+  for (int i = 0; i < AROWS; i++) {
+    int k = arows[i].k;
+    if (arows[i].k_null || k >= BKEYS) continue;
+    for (int j = key_start[k]; j < key_start[k + 1]; j++) {
+      int n = sprintf(line, "%d|w%d|", i, by_key[j]);
+      a_text(i, line + n);
+      result_add(out, line);
+    }
+  }
+}
+
+// SELECT a.id, b.w FROM a JOIN b ON a.d = b.k WHERE a.id < 5000
+static void ref_double_key(Result* out) {
+  char line[64];
+  for (int i = 0; i < 5000; i++) {
+    double d = arows[i].d;
+    if (d != (int)d || d >= BKEYS) continue;
+    for (int j = key_start[(int)d]; j < key_start[(int)d + 1]; j++) {
+      snprintf(line, sizeof(line), "%d|w%d", i, by_key[j]);
+      result_add(out, line);
+    }
+  }
+}
+
+// SELECT a.id, b.w FROM a JOIN b ON a.k = b.k AND a.g = b.g
+static void ref_two_keys(Result* out) {
+  char line[64];
+  for (int i = 0; i < AROWS; i++) {
+    int k = arows[i].k;
+    if (arows[i].k_null || k >= BKEYS) continue;
+    for (int j = key_start[k]; j < key_start[k + 1]; j++) {
+      if (brows[by_key[j]].g != arows[i].g) continue;
+      snprintf(line, sizeof(line), "%d|w%d", i, by_key[j]);
+      result_add(out, line);
+    }
+  }
+}
+
+// SELECT a.id, c.x FROM a JOIN c ON a.id = c.ak
+static void ref_indexed(Result* out) {
+  char line[64];
+  for (int i = 0; i < CROWS; i++) {
+    if (crows[i].ak_null || crows[i].ak >= AROWS) continue;
+    snprintf(line, sizeof(line), "%d|%d", crows[i].ak, crows[i].x);
+    result_add(out, line);
+  }
+}
+
+// SELECT a.id, b.w, c.x FROM a JOIN b ON a.k = b.k JOIN c ON c.ak = a.id WHERE c.x < 100
+static void ref_three_way(Result* out) {
+  char line[64];
+  for (int i = 0; i < CROWS; i++) {
+    int id = crows[i].ak;
+    if (crows[i].ak_null || id >= AROWS || crows[i].x >= 100) continue;
+    int k = arows[id].k;
+    if (arows[id].k_null || k >= BKEYS) continue;
+    for (int j = key_start[k]; j < key_start[k + 1]; j++) {
+      snprintf(line, sizeof(line), "%d|w%d|%d", id, by_key[j], crows[i].x);
+      result_add(out, line);
+    }
+  }
+}
+
+typedef struct {
+  const char* sql;
+  void (*ref)(Result* out);
+  bool merge; ///< Whether a small work_mem makes it a merge join
+} Query;
+
+static const Query QUERIES[] = {
+  { "SELECT a.id, b.w, a.s FROM a JOIN b ON a.k = b.k", ref_int_key, false },
+  { "SELECT a.id, b.w FROM a JOIN b ON a.d = b.k WHERE a.id < 5000", ref_double_key, false },
+  { "SELECT a.id, b.w FROM a JOIN b ON a.k = b.k AND a.g = b.g", ref_two_keys, false },
+  { "SELECT a.id, c.x FROM a JOIN c ON a.id = c.ak", ref_indexed, true },
+  { "SELECT a.id, b.w, c.x FROM a JOIN b ON a.k = b.k JOIN c ON c.ak = a.id WHERE c.x < 100",
+    ref_three_way, false },
+};
+
+typedef struct {
+  bool spilled; ///< Whether a HashJoin wrote partitions to files
+  bool merge; ///< Whether the plan has a MergeJoin
+} JoinSeen;
+
+static void inspect(const Operator* op, void* arg) {
+  JoinSeen* seen = arg;
+  for (; op; op = op->child) {
+    if (strncmp(op->label, "HashJoin", 8) == 0) {
+      HashJoinStats st;
+      exec_hash_join_stats(op, &st);
+      seen->spilled |= st.spilled_rows > 0;
+    }
+    seen->merge |= strncmp(op->label, "MergeJoin", 9) == 0;
+    if (op->right) inspect(op->right, arg);
+  }
+}
+
+static void create_index(BufferPool* bp, Catalog* cat, const char* sql) {
+  Arena arena;
+  arena_init(&arena);
+  ExecCtx ctx = { .bp = bp, .cat = cat, .arena = &arena, .quiet = true };
+  Stmt* s = parse_statement(&arena, sql, ctx.err, sizeof(ctx.err));
+  CHECK(s && s->kind == STMT_CREATE_INDEX && sql_exec_create_index(&ctx, &s->create_index));
+  arena_free(&arena);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  make_rows();
+  index_b();
+  query_load(bp, &cat, "a", ACOLS, ATYPES, 5, AROWS, fill_a);
+  query_load(bp, &cat, "b", BCOLS, BTYPES, 3, BROWS, fill_b);
+  query_load(bp, &cat, "c", CCOLS, CTYPES, 2, CROWS, fill_c);
+  create_index(bp, &cat, "CREATE INDEX a_id ON a (id)");
+  create_index(bp, &cat, "CREATE INDEX c_ak ON c (ak)");
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* query = &QUERIES[q];
+    Result ref = {0};
+    query->ref(&ref);
+    CHECK(ref.n > 0);
+    result_sort(&ref);
+    const size_t work_mem[2] = { 0, SMALL_WORK_MEM };
+    for (int w = 0; w < 2; w++) {
+      Result got = {0};
+      JoinSeen seen = {0};
+      CHECK(query_run(bp, &cat, query->sql, work_mem[w], &got, inspect, &seen));
+      if (w == 0) {
+        CHECK(!seen.spilled && !seen.merge);
+      } else {
+        CHECK(query->merge ? seen.merge : seen.spilled);
+      }
+      result_sort(&got);
+      CHECK(result_equal(query->sql, &got, &ref));
+      result_free(&got);
+    }
+    result_free(&ref);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("join_test");
+}
@@ -0,0 +1,180 @@
+#include "check.h"
+#include "catalog.h"
+#include "kernels.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Checks every predicate kernel of every instruction set this CPU has
+// against the predicate written in plain C, over columns whose lengths are
+// not multiples of the vector width, at selectivities from none to all,
+// and with values at the ends of the INT range. Also checks that mask bits
+// past the last row are cleared and that masks become the right selection
+// vectors.
+
+#define MAX_ROWS 5000
+#define MASK_WORDS ((MAX_ROWS + 63) / 64)
+#define MAX_TEXT 40
+#define ROUNDS 20
+
+static const int SIZES[] = { 0, 1, 7, 8, 31, 63, 64, 65, 200, 1023, 1024, MAX_ROWS };
+#define NSIZES ((int)(sizeof(SIZES) / sizeof(SIZES[0])))
+
+static bool mask_bit(const uint64_t* mask, int i) {
+  return (mask[i / 64] >> (i % 64)) & 1u;
+}
+
+// Whether mask matches want over rows 0..n-1 and has no bits set past n.
+static bool mask_equal(const uint64_t* mask, const bool* want, int n) {
+  for (int i = 0; i < n; i++) {
+    if (mask_bit(mask, i) != want[i]) return false;
+  }
+  int words = (n + 63) / 64;
+  for (int i = n; i < words * 64; i++) {
+    if (mask_bit(mask, i)) return false;
+  }
+  return true;
+}
+
+// A value from a domain of the given size, sometimes one of the extremes.
+static int32_t random_i32(int domain) {
+  switch (rand() % 50) {
+    case 0: return INT32_MIN;
+    case 1: return INT32_MAX;
+    default: return rand() % domain - domain / 2;
+  }
+}
+
+static void test_i32(const Kernels* k) {
+  static int32_t v[MAX_ROWS];
+  static bool want[MAX_ROWS];
+  static uint64_t mask[MASK_WORDS];
+  // Small domains match many rows, large ones almost none.
+  static const int DOMAINS[] = { 1, 4, 100, 100000 };
+
+  for (int round = 0; round < ROUNDS; round++) {
+    int domain = DOMAINS[round % 4];
+    for (int s = 0; s < NSIZES; s++) {
+      int n = SIZES[s];
+      for (int i = 0; i < n; i++) v[i] = random_i32(domain);
+
+      int32_t c = random_i32(domain);
+      memset(mask, 0xff, sizeof(mask));
+      k->i32_eq(v, n, c, mask);
+      for (int i = 0; i < n; i++) want[i] = v[i] == c;
+      CHECK(mask_equal(mask, want, n));
+
+      int32_t lo = random_i32(domain), hi = random_i32(domain);
+      if (round % 5 == 1) lo = INT32_MIN;
+      if (round % 5 == 2) hi = INT32_MAX;
+      memset(mask, 0xff, sizeof(mask));
+      k->i32_range(v, n, lo, hi, mask);
+      for (int i = 0; i < n; i++) want[i] = v[i] >= lo && v[i] <= hi;
+      CHECK(mask_equal(mask, want, n));
+
+      // A sorted list without duplicates of 1 to 20 values.
+      int32_t list[20];
+      int nlist = 0;
+      int32_t next = -domain / 2 - 2;
+      int len = 1 + rand() % 20;
+      for (int i = 0; i < len; i++) {
+        next += 1 + rand() % (domain / 8 + 1);
+        list[nlist++] = next;
+      }
+      memset(mask, 0xff, sizeof(mask));
+      k->i32_in(v, n, list, nlist, mask);
+      for (int i = 0; i < n; i++) {
+        want[i] = false;
+        for (int j = 0; j < nlist; j++) want[i] |= v[i] == list[j];
+      }
+      CHECK(mask_equal(mask, want, n));
+    }
+  }
+}
+
+static void test_text(const Kernels* k) {
+  static uint8_t text[MAX_ROWS * MAX_TEXT + KERNEL_TEXT_PAD];
+  static uint32_t off[MAX_ROWS], len[MAX_ROWS], toast[MAX_ROWS];
+  static bool want[MAX_ROWS];
+  static uint64_t mask[MASK_WORDS];
+
+  for (int round = 0; round < ROUNDS; round++) {
+    // Few letters make shared prefixes common.
+    int letters = 1 + round % 4;
+    for (int s = 0; s < NSIZES; s++) {
+      int n = SIZES[s];
+      uint32_t used = 0;
+      for (int i = 0; i < n; i++) {
+        off[i] = used;
+        len[i] = (uint32_t)(rand() % MAX_TEXT);
+        toast[i] = rand() % 30 == 0 ? 7 : INVALID_PID;
+        for (uint32_t j = 0; j < len[i]; j++) text[used++] = (uint8_t)('a' + rand() % letters);
+      }
+      // Bytes past the last value must not change the outcome.
+      memset(text + used, 'a', KERNEL_TEXT_PAD);
+
+      uint8_t prefix[MAX_TEXT];
+      uint32_t plen = (uint32_t)(rand() % 36);
+      for (uint32_t j = 0; j < plen; j++) prefix[j] = (uint8_t)('a' + rand() % letters);
+      for (int exact = 0; exact < 2; exact++) {
+        memset(mask, 0xff, sizeof(mask));
+        k->text_prefix(text, off, len, toast, n, prefix, plen, exact, mask);
+        for (int i = 0; i < n; i++) {
+          want[i] = toast[i] == INVALID_PID && len[i] >= plen &&
+                    (!exact || len[i] == plen) && memcmp(text + off[i], prefix, plen) == 0;
+        }
+        CHECK(mask_equal(mask, want, n));
+      }
+    }
+  }
+}
+
+static void test_select(void) {
+  static uint64_t mask[MASK_WORDS];
+  static uint16_t sel[MAX_ROWS], out[MAX_ROWS];
+  for (int s = 0; s < NSIZES; s++) {
+    int n = SIZES[s];
+    memset(mask, 0, sizeof(mask));
+    int want = 0;
+    for (int i = 0; i < n; i++) {
+      if (rand() % 3 == 0) {
+        mask[i / 64] |= 1ull << (i % 64);
+        want++;
+      }
+    }
+    int got = kernel_mask_to_sel(mask, n, out);
+    CHECK(got == want);
+    bool ok = true;
+    for (int i = 0; i < got; i++) ok &= mask_bit(mask, out[i]) && (i == 0 || out[i] > out[i - 1]);
+    CHECK(ok);
+
+    // Every other row, filtered by the same mask.
+    int nsel = 0;
+    for (int i = 0; i < n; i += 2) sel[nsel++] = (uint16_t)i;
+    got = kernel_mask_select(mask, sel, nsel, out);
+    want = 0;
+    ok = true;
+    for (int i = 0; i < nsel; i++) {
+      if (!mask_bit(mask, sel[i])) continue;
+      ok &= want < got && out[want] == sel[i];
+      want++;
+    }
+    CHECK(ok && got == want);
+  }
+}
+
+int main(void) {
+  srand(17);
+  CHECK(kernels_for(KERNEL_SCALAR) != NULL);
+  CHECK(kernels_best() != NULL);
+  for (KernelIsa isa = KERNEL_SCALAR; isa <= KERNEL_AVX2; isa++) {
+    const Kernels* k = kernels_for(isa);
+    if (!k) {
+      printf("kernels_test: no %s kernels on this CPU\n", isa == KERNEL_SSE42 ? "sse4.2" : "avx2");
+      continue;
+    }
+    test_i32(k);
+    test_text(k);
+  }
+  test_select();
+  return check_done("kernels_test");
+}
@@ -0,0 +1,237 @@
+#include "check.h"
+#include "marqdb.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Drives libmarqdb the way an embedding application does: prepares
+// statements with placeholders, binds values of every kind, steps through
+// the results, re-runs statements with new values and reopens the file.
+
+#define TEST_PATH "marqdb_test.db"
+#define TEST_WAL TEST_PATH ".wal"
+#define NROWS 100
+#define SCAN_ROWS 5000
+
+static void test_insert(Mdb* db) {
+  CHECK(mdb_exec(db, "CREATE TABLE t (id INT, big BIGINT, x DOUBLE, name TEXT)") == MDB_OK);
+
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "INSERT INTO t VALUES (?, ?, ?, ?)", &s) == MDB_OK);
+  if (!s) return;
+  CHECK(mdb_bind_count(s) == 4);
+  CHECK(mdb_column_count(s) == 0);
+  CHECK(mdb_bind_int(s, 0, 1) == MDB_RANGE);
+  CHECK(mdb_bind_int(s, 5, 1) == MDB_RANGE);
+
+  for (int i = 0; i < NROWS; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "name %d", i);
+    CHECK(mdb_bind_int(s, 1, i) == MDB_OK);
+    CHECK(mdb_bind_int64(s, 2, (int64_t)i * 10000000000LL) == MDB_OK);
+    CHECK(mdb_bind_double(s, 3, i + 0.5) == MDB_OK);
+    if (i % 10 == 0) CHECK(mdb_bind_null(s, 4) == MDB_OK);
+    else CHECK(mdb_bind_text(s, 4, name, -1) == MDB_OK);
+    CHECK(mdb_step(s) == MDB_DONE);
+    CHECK(mdb_changes(s) == 1);
+  }
+  mdb_finalize(s);
+}
+
+static void test_select(Mdb* db) {
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "SELECT id, big, x, name FROM t WHERE id >= ? AND id < ?", &s) ==
+        MDB_OK);
+  if (!s) return;
+  CHECK(mdb_bind_count(s) == 2);
+  CHECK(mdb_column_count(s) == 4);
+  CHECK(strcmp(mdb_column_name(s, 0), "id") == 0);
+  CHECK(strcmp(mdb_column_name(s, 3), "name") == 0);
+  CHECK(mdb_column_name(s, 4) == NULL);
+
+  // The same statement runs again with new values, without re-preparing.
+  for (int from = 0; from < NROWS; from += 25) {
+    mdb_bind_int(s, 1, from);
+    mdb_bind_int(s, 2, from + 25);
+    int n = 0;
+    int r;
+    while ((r = mdb_step(s)) == MDB_ROW) {
+      int id = mdb_column_int(s, 0);
+      CHECK(id >= from && id < from + 25);
+      CHECK(mdb_column_type(s, 0) == MDB_INT);
+      CHECK(mdb_column_int64(s, 1) == (int64_t)id * 10000000000LL);
+      CHECK(mdb_column_type(s, 2) == MDB_FLOAT);
+      CHECK(mdb_column_double(s, 2) == id + 0.5);
+      if (id % 10 == 0) {
+        CHECK(mdb_column_type(s, 3) == MDB_NULL);
+        CHECK(mdb_column_text(s, 3) == NULL);
+      } else {
+        char name[32];
+        snprintf(name, sizeof(name), "name %d", id);
+        CHECK(mdb_column_type(s, 3) == MDB_TEXT);
+        CHECK(mdb_column_text(s, 3) && strcmp(mdb_column_text(s, 3), name) == 0);
+        CHECK(mdb_column_bytes(s, 3) == (int)strlen(name));
+      }
+      n++;
+    }
+    CHECK(r == MDB_DONE);
+    CHECK(n == 25);
+  }
+
+  // Reset part way through keeps the bindings; the next step starts over.
+  mdb_bind_int(s, 1, 0);
+  mdb_bind_int(s, 2, NROWS);
+  CHECK(mdb_step(s) == MDB_ROW);
+  mdb_reset(s);
+  int n = 0;
+  while (mdb_step(s) == MDB_ROW) n++;
+  CHECK(n == NROWS);
+  mdb_finalize(s);
+}
+
+static void test_update_and_errors(Mdb* db) {
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "UPDATE t SET name = ? WHERE id < ?", &s) == MDB_OK);
+  if (s) {
+    mdb_bind_text(s, 1, "renamed", 7);
+    mdb_bind_int(s, 2, 5);
+    CHECK(mdb_step(s) == MDB_DONE);
+    CHECK(mdb_changes(s) == 5);
+    mdb_finalize(s);
+  }
+
+  CHECK(mdb_prepare(db, "SELECT count(*) FROM t WHERE name = ?", &s) == MDB_OK);
+  if (s) {
+    mdb_bind_text(s, 1, "renamed", -1);
+    CHECK(mdb_step(s) == MDB_ROW);
+    CHECK(mdb_column_int(s, 0) == 5);
+    CHECK(mdb_step(s) == MDB_DONE);
+    mdb_finalize(s);
+  }
+
+  MdbStmt* bad = NULL;
+  CHECK(mdb_prepare(db, "SELECT nope FROM t", &bad) == MDB_ERROR);
+  CHECK(bad == NULL);
+  CHECK(strstr(mdb_errmsg(db), "nope") != NULL);
+  CHECK(mdb_exec(db, "INSERT INTO t VALUES ('x', 1, 1.0, 'y')") == MDB_ERROR);
+}
+
+static int count_rows(MdbStmt* s) {
+  int n = 0;
+  while (mdb_step(s) == MDB_ROW) n++;
+  return n;
+}
+
+// Re-runs a prepared SELECT as values are bound one at a time, as rows
+// are added and after an index it could use appears.
+static void test_rebind(Mdb* db) {
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "SELECT id FROM t WHERE id IN (?, ?, 7) AND big >= ?", &s) == MDB_OK);
+  if (!s) return;
+  mdb_bind_int(s, 1, 3);
+  mdb_bind_int(s, 2, 3);
+  mdb_bind_int64(s, 3, 0);
+  CHECK(count_rows(s) == 2);
+  // Only the second value changes; the first is kept as it was converted.
+  mdb_bind_int(s, 2, 50);
+  CHECK(count_rows(s) == 3);
+  mdb_bind_double(s, 3, 30000000000.5);
+  CHECK(count_rows(s) == 2);
+  mdb_bind_text(s, 3, "70000000000", -1);
+  CHECK(count_rows(s) == 2);
+  mdb_bind_null(s, 3);
+  CHECK(count_rows(s) == 0);
+
+  MdbStmt* by_id;
+  CHECK(mdb_prepare(db, "SELECT name FROM t WHERE id = ?", &by_id) == MDB_OK);
+  if (!by_id) return;
+  mdb_bind_int(by_id, 1, NROWS + 1);
+  CHECK(count_rows(by_id) == 0);
+  CHECK(mdb_exec(db, "INSERT INTO t VALUES (101, 0, 0.0, 'late')") == MDB_OK);
+  CHECK(count_rows(by_id) == 1);
+  CHECK(mdb_exec(db, "CREATE INDEX t_id ON t (id)") == MDB_OK);
+  CHECK(mdb_exec(db, "INSERT INTO t VALUES (101, 0, 0.0, 'later')") == MDB_OK);
+  CHECK(count_rows(by_id) == 2);
+  mdb_bind_int(s, 1, NROWS + 1);
+  mdb_bind_int(s, 2, 7);
+  mdb_bind_int(s, 3, 0);
+  CHECK(count_rows(s) == 3);
+  CHECK(mdb_exec(db, "DELETE FROM t WHERE id = 101") == MDB_OK);
+  mdb_finalize(by_id);
+  mdb_finalize(s);
+}
+
+// Updates every row a SELECT returns while the SELECT is still open, which
+// must not wait on a page the scan holds.
+static void test_write_during_select(Mdb* db) {
+  CHECK(mdb_exec(db, "CREATE TABLE w (id INT, v INT)") == MDB_OK);
+  MdbStmt* ins;
+  CHECK(mdb_prepare(db, "INSERT INTO w VALUES (?, 0)", &ins) == MDB_OK);
+  if (!ins) return;
+  for (int i = 0; i < SCAN_ROWS; i++) {
+    mdb_bind_int(ins, 1, i);
+    CHECK(mdb_step(ins) == MDB_DONE);
+  }
+  mdb_finalize(ins);
+
+  MdbStmt *sel, *upd;
+  CHECK(mdb_prepare(db, "SELECT id FROM w", &sel) == MDB_OK);
+  CHECK(mdb_prepare(db, "UPDATE w SET v = 9 WHERE id = ?", &upd) == MDB_OK);
+  if (!sel || !upd) return;
+  int n = 0;
+  while (mdb_step(sel) == MDB_ROW) {
+    mdb_bind_int(upd, 1, mdb_column_int(sel, 0));
+    CHECK(mdb_step(upd) == MDB_DONE);
+    n++;
+  }
+  CHECK(n == SCAN_ROWS);
+  mdb_finalize(sel);
+  mdb_finalize(upd);
+
+  CHECK(mdb_prepare(db, "SELECT count(*) FROM w WHERE v = 9", &sel) == MDB_OK);
+  if (!sel) return;
+  CHECK(mdb_step(sel) == MDB_ROW);
+  CHECK(mdb_column_int(sel, 0) == SCAN_ROWS);
+  mdb_finalize(sel);
+}
+
+// Reopens the file and checks the rows are still there.
+static void test_reopen(void) {
+  Mdb* db;
+  CHECK(mdb_open(TEST_PATH, &db) == MDB_OK);
+  if (!db) return;
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "SELECT count(*), sum(id) FROM t", &s) == MDB_OK);
+  if (s) {
+    CHECK(mdb_step(s) == MDB_ROW);
+    CHECK(mdb_column_int(s, 0) == NROWS);
+    CHECK(mdb_column_int(s, 1) == NROWS * (NROWS - 1) / 2);
+    mdb_finalize(s);
+  }
+  mdb_close(db);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+
+  // A failed open has no handle; mdb_errmsg(NULL) says why.
+  Mdb* db;
+  CHECK(mdb_open("no/such/dir/" TEST_PATH, &db) == MDB_ERROR);
+  CHECK(db == NULL);
+  CHECK(strstr(mdb_errmsg(NULL), "no/such/dir") != NULL);
+
+  CHECK(mdb_open(TEST_PATH, &db) == MDB_OK);
+  if (!db) return check_done("marqdb_test");
+  test_insert(db);
+  test_select(db);
+  test_update_and_errors(db);
+  test_rebind(db);
+  test_write_during_select(db);
+  mdb_close(db);
+  test_reopen();
+
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+  return check_done("marqdb_test");
+}
@@ -0,0 +1,196 @@
+#include "check.h"
+#include "query.h"
+#include <unistd.h>
+
+// Checks that scans decode only the columns a statement reads: each query
+// returns the same values as picking its columns out of SELECT *, the scan
+// reads as many columns as the statement names anywhere, and
+// row_get_wanted reads the wanted columns of a row exactly as
+// row_get_fields does and leaves the others NULL.
+
+#define TEST_PATH "project_test.db"
+#define POOL_FRAMES 1024
+#define NROWS 3000
+#define NCOLS 8
+#define LONG_TEXT 3000
+
+static const char* COLS[NCOLS] = { "c0", "c1", "c2", "c3", "c4", "c5", "c6", "c7" };
+static const ColumnType TYPES[NCOLS] = { COL_INT,  COL_TEXT, COL_BIGINT, COL_DOUBLE,
+                                         COL_TEXT, COL_INT,  COL_TEXT,   COL_INT };
+
+static void fill(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", i);
+  snprintf(vals[1], QUERY_VALUE_LEN, "one %d", i);
+  snprintf(vals[2], QUERY_VALUE_LEN, "%lld", (long long)(NROWS - i) * 3000000000LL);
+  snprintf(vals[3], QUERY_VALUE_LEN, "%d.5", i % 100);
+  // Every 100th value is long enough to be stored out of line.
+  int n = snprintf(vals[4], QUERY_VALUE_LEN, "four %d", i);
+  if (i % 100 == 0) {
+    memset(vals[4] + n, 'x', LONG_TEXT - (size_t)n);
+    vals[4][LONG_TEXT] = 0;
+  }
+  snprintf(vals[5], QUERY_VALUE_LEN, "%d", i % 7);
+  snprintf(vals[6], QUERY_VALUE_LEN, "six %d", i);
+  snprintf(vals[7], QUERY_VALUE_LEN, "%d", -i);
+  for (int c = 0; c < NCOLS; c++) out[c] = vals[c];
+  if (i % 5 == 0) out[5] = NULL;
+  if (i % 9 == 0) out[6] = NULL;
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+typedef struct {
+  const char* sql;
+  int cols[4]; ///< Output columns of the table, ended by -1
+  int where_col; ///< Column that must equal where_val, or -1
+  const char* where_val;
+  bool ordered; ///< Whether rows come in reverse order of c0 rather than any order
+  int read; ///< Columns the scan should read
+} Query;
+
+static const Query QUERIES[] = {
+  { "SELECT c7 FROM w", { 7, -1 }, -1, NULL, false, 1 },
+  { "SELECT c4, c0 FROM w", { 4, 0, -1 }, -1, NULL, false, 2 },
+  { "SELECT c3, c0 FROM w WHERE c5 = 2", { 3, 0, -1 }, 5, "2", false, 3 },
+  { "SELECT c1 FROM w ORDER BY c2", { 1, -1 }, -1, NULL, true, 2 },
+  { "SELECT c6, c2, c6 FROM w WHERE c1 = 'one 77'", { 6, 2, 6, -1 }, 1, "one 77", false, 3 },
+  { "SELECT c5 FROM w WHERE c5 = 3", { 5, -1 }, 5, "3", false, 1 },
+};
+
+// Splits a line of SELECT * into its fields, in place.
+static void split(char* line, char** fields) {
+  for (int c = 0; c < NCOLS; c++) {
+    fields[c] = line;
+    char* bar = strchr(line, '|');
+    if (bar) *bar = 0;
+    line = bar ? bar + 1 : line + strlen(line);
+  }
+}
+
+// Columns read by the first scan of a plan, from its EXPLAIN label.
+static void scan_columns(const Operator* plan, void* arg) {
+  const Operator* op = plan;
+  while (op->child) op = op->child;
+  const char* of = strstr(op->label, " of ");
+  const char* open = of ? strrchr(op->label, '(') : NULL;
+  *(int*)arg = open ? atoi(open + 1) : NCOLS;
+}
+
+static void test_queries(BufferPool* bp, Catalog* cat) {
+  Result star = {0};
+  CHECK(query_run(bp, cat, "SELECT * FROM w", 0, &star, NULL, NULL));
+  CHECK(star.n == NROWS);
+
+  static char line[QUERY_LINE_LEN];
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* query = &QUERIES[q];
+    Result want = {0}, got = {0};
+    for (int r = 0; r < star.n; r++) {
+      // Rows come in c0 order; reversed, they come in c2 order.
+      char* copy = strdup(star.rows[query->ordered ? star.n - 1 - r : r]);
+      char* fields[NCOLS];
+      split(copy, fields);
+      if (query->where_col < 0 || strcmp(fields[query->where_col], query->where_val) == 0) {
+        line[0] = 0;
+        for (int k = 0; query->cols[k] >= 0; k++) {
+          if (k) strcat(line, "|");
+          strcat(line, fields[query->cols[k]]);
+        }
+        result_add(&want, line);
+      }
+      free(copy);
+    }
+    CHECK(want.n > 0);
+
+    int read = -1;
+    CHECK(query_run(bp, cat, query->sql, 0, &got, scan_columns, &read));
+    CHECK(read == query->read);
+    if (!query->ordered) {
+      result_sort(&want);
+      result_sort(&got);
+    }
+    CHECK(result_equal(query->sql, &got, &want));
+    result_free(&want);
+    result_free(&got);
+  }
+  result_free(&star);
+
+  // Counting rows reads no column at all.
+  Result got = {0};
+  int read = -1;
+  CHECK(query_run(bp, cat, "SELECT count(*) FROM w", 0, &got, scan_columns, &read));
+  CHECK(read == 0 && got.n == 1 && atoi(got.rows[0]) == NROWS);
+  result_free(&got);
+}
+
+// ============================================================================
+// Row access
+// ============================================================================
+
+static bool same_field(const RowField* a, const RowField* b) {
+  if (a->is_null || b->is_null) return a->is_null == b->is_null;
+  switch (row_value_kind(a->type)) {
+    case VAL_I32: return a->i32 == b->i32;
+    case VAL_I64: return a->i64 == b->i64;
+    case VAL_F64: return a->f64 == b->f64;
+    case VAL_TEXT: break;
+  }
+  return a->text_len == b->text_len && a->toast_pid == b->toast_pid &&
+         (a->toast_pid != INVALID_PID || memcmp(a->text, b->text, a->text_len) == 0);
+}
+
+static void test_row_get_wanted(BufferPool* bp) {
+  ColumnDef cols[NCOLS];
+  for (int c = 0; c < NCOLS; c++) {
+    memset(&cols[c], 0, sizeof(cols[c]));
+    snprintf(cols[c].col, sizeof(cols[c].col), "%s", COLS[c]);
+    cols[c].type = TYPES[c];
+  }
+  row_layout(cols, NCOLS);
+
+  static char vals[NCOLS][QUERY_VALUE_LEN];
+  const char* ptrs[NCOLS];
+  for (int i = 0; i < 200; i += 9) {
+    fill(i, vals, ptrs);
+    uint8_t row[PAGE_SIZE];
+    int len = row_encode(bp, cols, NCOLS, ptrs, NCOLS, row, sizeof(row));
+    CHECK(len > 0);
+    RowField all[NCOLS];
+    CHECK(row_get_fields(cols, NCOLS, row, len, all) == 0);
+
+    // Every mask of wanted columns, read as far as each last column.
+    for (int mask = 0; mask < 1 << NCOLS; mask += 7) {
+      bool want[NCOLS];
+      for (int c = 0; c < NCOLS; c++) want[c] = (mask >> c) & 1;
+      int nread = 1 + mask % NCOLS;
+      RowField got[NCOLS];
+      CHECK(row_get_wanted(cols, NCOLS, row, len, want, nread, got) == 0);
+      bool ok = true;
+      for (int c = 0; c < NCOLS; c++) {
+        RowField null = { .type = cols[c].type, .is_null = true };
+        ok &= got[c].type == cols[c].type;
+        ok &= same_field(&got[c], want[c] && c < nread ? &all[c] : &null);
+      }
+      CHECK(ok);
+    }
+  }
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  query_load(bp, &cat, "w", COLS, TYPES, NCOLS, NROWS, fill);
+
+  test_queries(bp, &cat);
+  test_row_get_wanted(bp);
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("project_test");
+}
@@ -0,0 +1,143 @@
+#pragma once
+#include "check.h"
+#include "catalog.h"
+#include "cursor.h"
+#include "heap.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Helpers shared by the programs in tests/ that check query results: a
+// loader for tables of generated rows and a runner that collects the rows
+// of a query as lines of text, so two ways of computing a result can be
+// compared line by line.
+
+#define QUERY_VALUE_LEN 4096
+#define QUERY_LINE_LEN 65536
+
+/** @brief Writes the values of row i into vals and points out at them, or at NULL. */
+typedef void (*QueryFill)(int i, char vals[][QUERY_VALUE_LEN], const char** out);
+
+/** @brief Called on a plan that ran to its end, before it is closed. */
+typedef void (*QueryInspect)(const Operator* plan, void* arg);
+
+/**
+ * @brief The rows of a query, each formatted as its values joined by '|'.
+ */
+typedef struct {
+  char** rows; ///< One line per row, in the order the query returned them
+  int n; ///< Number of rows
+  int cap; ///< Capacity of rows
+} Result;
+
+// Creates a table and bulk loads nrows rows written by fill.
+static inline void query_load(BufferPool* bp, Catalog* cat, const char* name,
+                              const char** names, const ColumnType* types, int ncols, int nrows,
+                              QueryFill fill) {
+  ColumnDef cols[CATALOG_MAX_COLS];
+  for (int c = 0; c < ncols; c++) {
+    memset(&cols[c], 0, sizeof(cols[c]));
+    snprintf(cols[c].col, sizeof(cols[c].col), "%s", names[c]);
+    cols[c].type = types[c];
+  }
+  uint32_t heap_h;
+  CHECK(catalog_create_table(bp, cat, name, cols, ncols, &heap_h));
+  HeapFile hf = heap_open(bp, heap_h);
+
+  HeapBulkLoad bl;
+  heap_bulk_begin(&hf, &bl, NULL, NULL);
+  static char buf[CATALOG_MAX_COLS][QUERY_VALUE_LEN];
+  const char* vals[CATALOG_MAX_COLS];
+  for (int i = 0; i < nrows; i++) {
+    fill(i, buf, vals);
+    uint8_t enc[PAGE_SIZE];
+    int len = row_encode(bp, cols, ncols, vals, ncols, enc, sizeof(enc));
+    CHECK(len > 0);
+    if (len > 0) heap_bulk_insert(bp, &bl, enc, (uint16_t)len);
+  }
+  heap_bulk_end(bp, &bl);
+}
+
+static inline void result_add(Result* r, const char* line) {
+  if (r->n == r->cap) {
+    r->cap = r->cap ? r->cap * 2 : 1024;
+    r->rows = realloc(r->rows, sizeof(char*) * (size_t)r->cap);
+  }
+  r->rows[r->n++] = strdup(line);
+}
+
+static inline void result_free(Result* r) {
+  for (int i = 0; i < r->n; i++) free(r->rows[i]);
+  free(r->rows);
+  memset(r, 0, sizeof(*r));
+}
+
+static inline int result_cmp_rows(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Sorts the rows, for comparing queries whose order is not defined.
+static inline void result_sort(Result* r) {
+  qsort(r->rows, (size_t)r->n, sizeof(char*), result_cmp_rows);
+}
+
+// Whether two results hold the same rows in the same order; reports the
+// first difference under the given name.
+static inline bool result_equal(const char* name, const Result* a, const Result* b) {
+  for (int i = 0; i < a->n && i < b->n; i++) {
+    if (strcmp(a->rows[i], b->rows[i]) != 0) {
+      fprintf(stderr, "%s: row %d is '%.60s', not '%.60s'\n", name, i, a->rows[i], b->rows[i]);
+      return false;
+    }
+  }
+  if (a->n != b->n) fprintf(stderr, "%s: %d rows, not %d\n", name, a->n, b->n);
+  return a->n == b->n;
+}
+
+// Formats one value; out-of-line TEXT is read in full, up to cap - 1 bytes.
+static inline void query_format(BufferPool* bp, const RowField* v, char* text, size_t cap) {
+  if (v->is_null) {
+    snprintf(text, cap, "NULL");
+  } else if (row_is_text(v->type)) {
+    uint32_t n = row_field_text(bp, v, (uint8_t*)text, (uint32_t)cap - 1);
+    text[n] = 0;
+  } else {
+    row_format_value(v, text, cap);
+  }
+}
+
+// Runs a query to its end through a cursor, adding each row to out.
+// inspect, if not NULL, sees the plan at the end. Returns false on failure.
+static inline bool query_run(BufferPool* bp, Catalog* cat, const char* sql, size_t work_mem,
+                             Result* out, QueryInspect inspect, void* arg) {
+  char err[256];
+  Cursor* c = cursor_open(bp, cat, sql, work_mem, err, sizeof(err));
+  if (!c) {
+    fprintf(stderr, "%s: %s\n", sql, err);
+    return false;
+  }
+
+  Batch b;
+  int r;
+  char* line = malloc(QUERY_LINE_LEN);
+  char* text = malloc(QUERY_VALUE_LEN);
+  while ((r = cursor_fetch_batch(c, &b)) > 0) {
+    for (int i = 0; i < b.nsel; i++) {
+      int row = b.sel ? b.sel[i] : i;
+      size_t used = 0;
+      for (int col = 0; col < b.ncols; col++) {
+        RowField v;
+        vector_get(b.cols[col], row, &v);
+        query_format(bp, &v, text, QUERY_VALUE_LEN);
+        used += (size_t)snprintf(line + used, QUERY_LINE_LEN - used, "%s%s", col ? "|" : "",
+                                 text);
+      }
+      result_add(out, line);
+    }
+  }
+  free(line);
+  free(text);
+  if (r < 0) fprintf(stderr, "%s: %s\n", sql, cursor_error(c));
+  if (inspect) inspect(c->plan, arg);
+  cursor_close(c);
+  return r == 0;
+}
@@ -0,0 +1,122 @@
+#include "check.h"
+#include "catalog.h"
+#include "heap.h"
+#include "recovery.h"
+#include <string.h>
+#include <unistd.h>
+
+// Changes a heap in every way a failing UPDATE can before it fails, rolls
+// the transaction back and checks the heap reads as it did before, both
+// right away and after the file is reopened and recovered.
+
+#define TEST_PATH "rollback_test.db"
+#define TEST_WAL TEST_PATH ".wal"
+#define POOL_FRAMES 64
+#define NROWS 2000
+
+typedef struct {
+  DiskManager* dm;
+  LogManager* lm;
+  BufferPool* bp;
+} Db;
+
+static void db_open(Db* db) {
+  db->dm = disk_open(TEST_PATH);
+  db->lm = wal_open(TEST_WAL);
+  db->bp = bp_create(db->dm, POOL_FRAMES);
+  bp_attach_wal(db->bp, db->lm);
+  RecoveryStats st;
+  recovery_run(db->bp, &st);
+}
+
+static void db_close(Db* db) {
+  bp_destroy(db->bp);
+  wal_close(db->lm);
+  disk_close(db->dm);
+}
+
+static uint16_t make_row(int i, int version, uint8_t* rec) {
+  uint16_t len = (uint16_t)(16 + (i * 7 + version * 13) % 90);
+  memset(rec, 'a' + version, len);
+  memcpy(rec, &i, sizeof(i));
+  return len;
+}
+
+// Hash of every row and its RID, in scan order.
+static uint64_t heap_hash(BufferPool* bp, HeapFile* hf, int* nrows) {
+  uint64_t h = 1469598103934665603ull;
+  RID cur = { INVALID_PID, 0 };
+  uint8_t* out;
+  uint16_t len;
+  *nrows = 0;
+  while (heap_scan_next(bp, hf, &cur, &out, &len)) {
+    const uint8_t* parts[] = { (const uint8_t*)&cur.page_id, (const uint8_t*)&cur.slot_id, out };
+    const size_t lens[] = { sizeof(cur.page_id), sizeof(cur.slot_id), len };
+    for (int k = 0; k < 3; k++) {
+      for (size_t b = 0; b < lens[k]; b++) h = (h ^ parts[k][b]) * 1099511628211ull;
+    }
+    bp_unpin_page(bp, cur.page_id, false);
+    (*nrows)++;
+  }
+  return h;
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+
+  Db db;
+  db_open(&db);
+  BufferPool* bp = db.bp;
+  static RID rids[NROWS];
+  uint8_t rec[PAGE_SIZE];
+
+  wal_begin(db.lm);
+  uint32_t header_pid;
+  HeapFile hf = heap_create(bp, &header_pid);
+  for (int i = 0; i < NROWS; i++) rids[i] = heap_insert(bp, &hf, rec, make_row(i, 0, rec));
+  CHECK(wal_commit(db.lm));
+  int before_rows;
+  uint64_t before = heap_hash(bp, &hf, &before_rows);
+  CHECK(before_rows == NROWS);
+
+  // Updates rows in place, deletes others, and appends enough rows to add
+  // pages, with the pool small enough that changed pages are written back
+  // before the rollback. Rows that grow past a full page stay as they are.
+  wal_begin(db.lm);
+  int updated = 0;
+  for (int i = 0; i < NROWS; i += 3) {
+    updated += heap_update_in_place(bp, &hf, rids[i], rec, make_row(i, 1, rec)) == 0;
+  }
+  CHECK(updated > NROWS / 6);
+  for (int i = 1; i < NROWS; i += 5) CHECK(heap_delete(bp, &hf, rids[i]) == 0);
+  for (int i = 0; i < NROWS; i++) heap_insert(bp, &hf, rec, make_row(NROWS + i, 2, rec));
+  int changed_rows;
+  CHECK(heap_hash(bp, &hf, &changed_rows) != before);
+  CHECK(changed_rows != NROWS);
+
+  CHECK(recovery_rollback(bp));
+  CHECK(wal_commit(db.lm));
+  int rows;
+  hf = heap_open(bp, header_pid);
+  CHECK(heap_hash(bp, &hf, &rows) == before);
+  CHECK(rows == NROWS);
+
+  // Rows inserted after the rollback still go in.
+  wal_begin(db.lm);
+  RID extra = heap_insert(bp, &hf, rec, make_row(-1, 3, rec));
+  CHECK(extra.page_id != INVALID_PID);
+  CHECK(heap_delete(bp, &hf, extra) == 0);
+  CHECK(wal_commit(db.lm));
+  db_close(&db);
+
+  db_open(&db);
+  hf = heap_open(db.bp, header_pid);
+  heap_hash(db.bp, &hf, &rows);
+  CHECK(rows == NROWS);
+  db_close(&db);
+
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+  return check_done("rollback_test");
+}
@@ -0,0 +1,274 @@
+#include "check.h"
+#include "catalog.h"
+#include "toast.h"
+#include "vector.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Encodes and decodes rows: where format 2 puts each column, every mix of
+// NULLs in a row of every type, format 1 rows as older files hold them
+// read by every accessor and moved to format 2 when updated, and rows too
+// short for their schema rejected.
+
+#define TEST_PATH "row_test.db"
+#define POOL_FRAMES 64
+#define NCOLS 7
+#define LONG_TEXT 3000
+
+static ColumnDef cols[NCOLS] = {
+  { .col = "a", .type = COL_INT },    { .col = "t", .type = COL_TEXT },
+  { .col = "b", .type = COL_BIGINT }, { .col = "d", .type = COL_DOUBLE },
+  { .col = "u", .type = COL_TEXT },   { .col = "f", .type = COL_BOOL },
+  { .col = "c", .type = COL_CHAR, .len = 5 },
+};
+static const char* VALUES[NCOLS] = { "-7", "tee", "-9000000000", "2.25", "", "true", "ab" };
+
+static uint16_t read_u16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Fixed-width columns come first in column order, then one offset per TEXT
+// column and the end of the last value.
+static void test_layout(void) {
+  row_layout(cols, NCOLS);
+  const uint16_t want[NCOLS] = { 3, 29, 7, 15, 31, 23, 24 };
+  for (int c = 0; c < NCOLS; c++) CHECK(cols[c].row_off == want[c]);
+
+  const char* nulls[NCOLS] = {0};
+  uint8_t row[PAGE_SIZE];
+  int len = row_encode(NULL, cols, NCOLS, nulls, NCOLS, row, sizeof(row));
+  CHECK(len == 35);
+  CHECK(read_u16(row) == (NCOLS | ROW_FORMAT_V2));
+  CHECK(row[2] == (1u << NCOLS) - 1);
+}
+
+static bool same_text(const RowField* f, const char* text) {
+  return f->toast_pid == INVALID_PID && f->text_len == strlen(text) &&
+         memcmp(f->text, text, f->text_len) == 0;
+}
+
+// Whether a field holds the value text parses to in its column.
+static bool field_is(const RowField* f, const char* text) {
+  if (!text) return f->is_null;
+  if (f->is_null) return false;
+  if (row_is_text(f->type)) return same_text(f, text);
+  RowField want;
+  if (row_parse_value(f->type, text, &want) != 0) return false;
+  switch (row_value_kind(f->type)) {
+    case VAL_I32: return f->i32 == want.i32;
+    case VAL_I64: return f->i64 == want.i64;
+    default: return f->f64 == want.f64;
+  }
+}
+
+// Every mix of NULLs reads back column by column, all at once and as text.
+static void test_nulls(void) {
+  for (int mask = 0; mask < 1 << NCOLS; mask++) {
+    const char* vals[NCOLS];
+    char want[512] = "";
+    for (int c = 0; c < NCOLS; c++) {
+      vals[c] = (mask >> c) & 1 ? NULL : VALUES[c];
+      snprintf(want + strlen(want), sizeof(want) - strlen(want), "%s%s=%s", c ? " | " : "",
+               cols[c].col, vals[c] ? vals[c] : "NULL");
+    }
+    uint8_t row[PAGE_SIZE];
+    int len = row_encode(NULL, cols, NCOLS, vals, NCOLS, row, sizeof(row));
+    CHECK(len > 0);
+
+    RowField all[NCOLS];
+    CHECK(row_get_fields(cols, NCOLS, row, len, all) == 0);
+    bool ok = true;
+    for (int c = 0; c < NCOLS; c++) {
+      RowField f;
+      ok &= row_get_field(cols, NCOLS, row, len, c, &f) == (vals[c] ? 1 : 0);
+      ok &= f.type == cols[c].type && field_is(&f, vals[c]) && field_is(&all[c], vals[c]);
+    }
+    CHECK(ok);
+    char text[512];
+    CHECK(row_decode(NULL, cols, NCOLS, row, len, text, sizeof(text)) == (int)strlen(want));
+    CHECK(strcmp(text, want) == 0);
+  }
+}
+
+// ============================================================================
+// Format 1
+// ============================================================================
+
+// The schema of format 1 rows, which only held INT and TEXT.
+static ColumnDef v1_cols[4] = {
+  { .col = "id", .type = COL_INT },
+  { .col = "name", .type = COL_TEXT },
+  { .col = "n", .type = COL_INT },
+  { .col = "doc", .type = COL_TEXT },
+};
+
+static void write_u16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void write_u32(uint8_t* p, uint32_t v) {
+  write_u16(p, (uint16_t)v);
+  write_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+// Writes a format 1 row: the column count, the NULL bitmap, then each
+// non-NULL value in column order, TEXT behind its length. A doc of
+// doc_len bytes in the chain at doc_pid is written as out of line.
+static int encode_v1(const char** vals, uint32_t doc_pid, uint32_t doc_len, uint8_t* out) {
+  write_u16(out, 4);
+  out[2] = 0;
+  int pos = 3;
+  for (int c = 0; c < 4; c++) {
+    bool external = c == 3 && doc_pid != INVALID_PID;
+    if (!vals[c] && !external) {
+      out[2] |= (uint8_t)(1u << c);
+    } else if (external) {
+      write_u16(out + pos, ROW_TEXT_EXTERNAL);
+      write_u32(out + pos + 2, doc_len);
+      write_u32(out + pos + 6, doc_pid);
+      pos += 10;
+    } else if (v1_cols[c].type == COL_INT) {
+      write_u32(out + pos, (uint32_t)atoi(vals[c]));
+      pos += 4;
+    } else {
+      uint16_t n = (uint16_t)strlen(vals[c]);
+      write_u16(out + pos, n);
+      memcpy(out + pos + 2, vals[c], n);
+      pos += 2 + n;
+    }
+  }
+  return pos;
+}
+
+#define V1_ROWS 6
+
+static void test_v1(BufferPool* bp) {
+  row_layout(v1_cols, 4);
+  static char doc[LONG_TEXT + 1];
+  memset(doc, 'd', LONG_TEXT);
+  uint32_t doc_pid = toast_store(bp, (const uint8_t*)doc, LONG_TEXT);
+
+  // Rows of both formats side by side, as a table written before and
+  // after the upgrade holds them.
+  const char* vals[V1_ROWS][4] = {
+    { "1", "one", "10", "first" }, { "2", NULL, "20", NULL },  { "3", "", NULL, "third" },
+    { NULL, "four", "40", NULL },  { "5", "five", "50", doc }, { "6", "six", "-60", "sixth" },
+  };
+  static uint8_t bytes[V1_ROWS][PAGE_SIZE];
+  uint8_t* rows[V1_ROWS];
+  uint16_t lens[V1_ROWS];
+  for (int r = 0; r < V1_ROWS; r++) {
+    rows[r] = bytes[r];
+    int len = r % 2 == 0 || vals[r][3] == doc
+                  ? encode_v1(vals[r], vals[r][3] == doc ? doc_pid : INVALID_PID, LONG_TEXT,
+                              rows[r])
+                  : row_encode(bp, v1_cols, 4, vals[r], 4, rows[r], PAGE_SIZE);
+    CHECK(len > 0);
+    lens[r] = (uint16_t)len;
+  }
+
+  for (int r = 0; r < V1_ROWS; r++) {
+    bool ok = true;
+    RowField all[4];
+    CHECK(row_get_fields(v1_cols, 4, rows[r], lens[r], all) == 0);
+    for (int c = 0; c < 4; c++) {
+      RowField f;
+      ok &= row_get_field(v1_cols, 4, rows[r], lens[r], c, &f) >= 0;
+      if (c == 3 && vals[r][3] == doc) {
+        ok &= f.toast_pid == doc_pid && f.text_len == LONG_TEXT && all[3].toast_pid == doc_pid;
+      } else {
+        ok &= field_is(&f, vals[r][c]) && field_is(&all[c], vals[r][c]);
+      }
+      // Only this column, read past the ones before it.
+      bool want[4] = {0};
+      want[c] = true;
+      RowField one[4];
+      ok &= row_get_wanted(v1_cols, 4, rows[r], lens[r], want, c + 1, one) == 0;
+      ok &= one[c].is_null == f.is_null && (f.is_null || row_is_text(f.type) ||
+                                           one[c].i32 == f.i32);
+      for (int k = 0; k < 4; k++) ok &= k == c || one[k].is_null;
+    }
+    CHECK(ok);
+  }
+
+  // A column at a time into vectors, the way a scan reads a page.
+  Arena arena;
+  arena_init(&arena);
+  for (int c = 0; c < 4; c++) {
+    ColumnVector v;
+    CHECK(vector_init(&v, v1_cols[c].type, &arena));
+    CHECK(row_gather_column(v1_cols, 4, c, rows, lens, NULL, V1_ROWS, &v, 0) == V1_ROWS);
+    bool ok = true;
+    for (int r = 0; r < V1_ROWS; r++) {
+      RowField f;
+      vector_get(&v, r, &f);
+      if (c == 3 && vals[r][3] == doc) ok &= f.toast_pid == doc_pid && f.text_len == LONG_TEXT;
+      else ok &= field_is(&f, vals[r][c]);
+    }
+    CHECK(ok);
+  }
+  arena_free(&arena);
+
+  // Updating a format 1 row writes it in format 2, keeping its chain.
+  char text[LONG_TEXT + 64];
+  int n = row_decode(bp, v1_cols, 4, rows[4], lens[4], text, sizeof(text));
+  CHECK(n > LONG_TEXT && strncmp(text, "id=5 | name=five | n=50 | doc=ddd", 33) == 0);
+  uint8_t updated[PAGE_SIZE];
+  int idx = 2;
+  const char* fifty_five = "55";
+  int len = row_set_fields(bp, v1_cols, 4, rows[4], lens[4], &idx, &fifty_five, 1, updated,
+                           sizeof(updated));
+  CHECK(len > 0 && (read_u16(updated) & ROW_FORMAT_V2));
+  RowField f;
+  CHECK(row_get_field(v1_cols, 4, updated, len, 2, &f) == 1 && f.i32 == 55);
+  CHECK(row_get_field(v1_cols, 4, updated, len, 1, &f) == 1 && same_text(&f, "five"));
+  CHECK(row_get_field(v1_cols, 4, updated, len, 3, &f) == 1 && f.toast_pid == doc_pid);
+}
+
+// Rows cut short, or written for another number of columns, are rejected.
+static void test_malformed(void) {
+  const char* vals[NCOLS];
+  for (int c = 0; c < NCOLS; c++) vals[c] = VALUES[c];
+  uint8_t row[PAGE_SIZE];
+  int len = row_encode(NULL, cols, NCOLS, vals, NCOLS, row, sizeof(row));
+  RowField f, all[NCOLS];
+  char text[256];
+  CHECK(row_get_field(cols, NCOLS - 1, row, len, 0, &f) < 0);
+  CHECK(row_get_fields(cols, NCOLS, row, 1, all) < 0);
+  bool ok = true;
+  for (int cut = 2; cut < len; cut++) {
+    // Either the value still fits, or the row is rejected; it never reads past cut.
+    for (int c = 0; c < NCOLS; c++) {
+      int r = row_get_field(cols, NCOLS, row, cut, c, &f);
+      ok &= r < 0 || (row_is_text(f.type) ? f.text + f.text_len <= row + cut : r == 1);
+    }
+  }
+  CHECK(ok);
+  CHECK(row_decode(NULL, cols, NCOLS, row, 4, text, sizeof(text)) < 0);
+
+  uint8_t v1[64];
+  const char* v1_vals[4] = { "1", "abc", "2", "def" };
+  len = encode_v1(v1_vals, INVALID_PID, 0, v1);
+  CHECK(row_get_field(v1_cols, 4, v1, len - 1, 3, &f) < 0);
+  CHECK(row_get_fields(v1_cols, 4, v1, len - 1, all) < 0);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+
+  test_layout();
+  test_nulls();
+  test_v1(bp);
+  test_malformed();
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("row_test");
+}
@@ -0,0 +1,239 @@
+#include "check.h"
+#include "query.h"
+#include "sort.h"
+#include <unistd.h>
+
+// Runs ORDER BY queries on INT, BIGINT, DOUBLE and TEXT keys, ascending
+// and descending, with and without LIMIT and OFFSET, and checks their rows
+// against the same order computed in C: NULL sorts after every value
+// ascending and before them descending, and TEXT compares byte-wise, so
+// out-of-line values are ordered by their full text. Each query runs once
+// in memory and once with a work_mem small enough that the sort writes
+// runs to files, except for a small LIMIT, which keeps a bounded heap.
+
+#define TEST_PATH "sort_test.db"
+#define POOL_FRAMES 16384
+#define SMALL_WORK_MEM (16 * 1024)
+#define NROWS 30000
+#define LONG_TEXT 3000
+#define MAX_TEXT 12
+
+static const char* COLS[] = { "id", "g", "v", "d", "s" };
+static const ColumnType TYPES[] = { COL_INT, COL_INT, COL_BIGINT, COL_DOUBLE, COL_TEXT };
+
+typedef struct {
+  int id;
+  bool g_null;
+  int g;
+  long long v;
+  bool d_null;
+  double d;
+  bool s_null;
+  char s[MAX_TEXT + 1]; ///< Text, followed by 'x' up to LONG_TEXT bytes when long
+  bool s_long;
+} Row;
+
+static Row rows[NROWS];
+
+static uint32_t mix(int i, uint32_t salt) {
+  uint32_t x = (uint32_t)i * 2654435761u ^ salt * 0x9e3779b9u;
+  x ^= x >> 15;
+  x *= 0x85ebca6bu;
+  return x ^ (x >> 13);
+}
+
+static void make_row(int i, Row* r) {
+  r->id = i;
+  r->g_null = i % 97 == 0;
+  r->g = (int)(mix(i, 1) % 50);
+  r->v = (long long)mix(i, 2) * 4099 - (1LL << 44);
+  r->d_null = i % 89 == 0;
+  r->d = (double)((int)(mix(i, 3) % 20000) - 10000) / 4;
+  r->s_null = i % 83 == 0;
+  // Few letters and short values make common prefixes and equal values.
+  int len = (int)(mix(i, 4) % (MAX_TEXT + 1));
+  for (int c = 0; c < len; c++) r->s[c] = (char)('a' + mix(i, 5 + (uint32_t)c) % 3);
+  r->s[len] = 0;
+  // Every 200th value is long enough to be stored out of line.
+  r->s_long = i % 200 == 0;
+}
+
+static int row_text(const Row* r, char* out) {
+  int n = sprintf(out, "%s", r->s);
+  if (!r->s_long) return n;
+  memset(out + n, 'x', LONG_TEXT - (size_t)n);
+  out[LONG_TEXT] = 0;
+  return LONG_TEXT;
+}
+
+static void fill(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  const Row* r = &rows[i];
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", r->id);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", r->g);
+  snprintf(vals[2], QUERY_VALUE_LEN, "%lld", r->v);
+  snprintf(vals[3], QUERY_VALUE_LEN, "%.2f", r->d);
+  row_text(r, vals[4]);
+  for (int c = 0; c < 5; c++) out[c] = vals[c];
+  if (r->g_null) out[1] = NULL;
+  if (r->d_null) out[3] = NULL;
+  if (r->s_null) out[4] = NULL;
+}
+
+// ============================================================================
+// Reference order
+// ============================================================================
+
+// NULL compares greater than every value.
+static int cmp_nulls(bool a_null, bool b_null) {
+  return a_null != b_null ? (a_null ? 1 : -1) : 0;
+}
+
+static int cmp_col(const Row* a, const Row* b, char col) {
+  switch (col) {
+    case 'g':
+      if (a->g_null || b->g_null) return cmp_nulls(a->g_null, b->g_null);
+      return (a->g > b->g) - (a->g < b->g);
+    case 'v':
+      return (a->v > b->v) - (a->v < b->v);
+    case 'd':
+      if (a->d_null || b->d_null) return cmp_nulls(a->d_null, b->d_null);
+      return (a->d > b->d) - (a->d < b->d);
+    case 's': {
+      if (a->s_null || b->s_null) return cmp_nulls(a->s_null, b->s_null);
+      static char x[LONG_TEXT + 1], y[LONG_TEXT + 1];
+      row_text(a, x);
+      row_text(b, y);
+      return strcmp(x, y);
+    }
+    default:
+      return (a->id > b->id) - (a->id < b->id);
+  }
+}
+
+typedef struct {
+  const char* sql;
+  const char* keys; ///< Key columns by letter, upper case for descending
+  const char* cols; ///< Output columns by letter
+  int g; ///< Only rows with this g, or -1 for all
+  int limit; ///< Rows returned, or -1 for all
+  int offset; ///< Rows skipped first
+  bool top_n; ///< Whether the sort keeps a bounded heap even with a small work_mem
+} Query;
+
+static const Query* cur_query;
+
+static int cmp_rows(const void* pa, const void* pb) {
+  const Row* a = &rows[*(const int*)pa];
+  const Row* b = &rows[*(const int*)pb];
+  for (const char* k = cur_query->keys; *k; k++) {
+    bool desc = *k >= 'A' && *k <= 'Z';
+    int c = cmp_col(a, b, (char)(desc ? *k - 'A' + 'a' : *k));
+    if (c) return desc ? -c : c;
+  }
+  return 0;
+}
+
+static void put(char* line, const RowField* f) {
+  if (*line) strcat(line, "|");
+  query_format(NULL, f, line + strlen(line), 64);
+}
+
+static void ref_rows(const Query* q, Result* out) {
+  static int idx[NROWS];
+  int n = 0;
+  for (int i = 0; i < NROWS; i++) {
+    if (q->g < 0 || (!rows[i].g_null && rows[i].g == q->g)) idx[n++] = i;
+  }
+  cur_query = q;
+  qsort(idx, (size_t)n, sizeof(int), cmp_rows);
+  int end = q->limit < 0 || q->offset + q->limit > n ? n : q->offset + q->limit;
+
+  static char line[QUERY_LINE_LEN];
+  for (int i = q->offset; i < end; i++) {
+    const Row* r = &rows[idx[i]];
+    line[0] = 0;
+    for (const char* c = q->cols; *c; c++) {
+      RowField f = { .type = COL_INT };
+      switch (*c) {
+        case 'g':
+          f.is_null = r->g_null;
+          f.i32 = r->g;
+          break;
+        case 'v':
+          f.type = COL_BIGINT;
+          f.i64 = r->v;
+          break;
+        case 'd':
+          f.type = COL_DOUBLE;
+          f.is_null = r->d_null;
+          f.f64 = r->d;
+          break;
+        case 's':
+          if (*line) strcat(line, "|");
+          if (r->s_null) strcat(line, "NULL");
+          else row_text(r, line + strlen(line));
+          continue;
+        default:
+          f.i32 = r->id;
+      }
+      put(line, &f);
+    }
+    result_add(out, line);
+  }
+}
+
+static const Query QUERIES[] = {
+  { "SELECT id, s FROM a ORDER BY s, id", "si", "is", -1, -1, 0, false },
+  { "SELECT id, d FROM a ORDER BY d DESC, id", "Di", "id", -1, -1, 0, false },
+  { "SELECT id, g, v FROM a ORDER BY g, v DESC, id", "gVi", "igv", -1, -1, 0, false },
+  { "SELECT v, id FROM a ORDER BY v, id", "vi", "vi", -1, -1, 0, false },
+  { "SELECT id, d FROM a WHERE g = 3 ORDER BY d, id", "di", "id", 3, -1, 0, false },
+  { "SELECT id, d FROM a ORDER BY d DESC, id LIMIT 40", "Di", "id", -1, 40, 0, true },
+  { "SELECT id, g FROM a ORDER BY g, id LIMIT 20 OFFSET 30", "gi", "ig", -1, 20, 30, true },
+  // Out-of-line values outgrow the heap, so the sort falls back to runs.
+  { "SELECT id, s FROM a ORDER BY s DESC, id LIMIT 100", "Si", "is", -1, 100, 0, false },
+  { "SELECT id, s FROM a ORDER BY s, id LIMIT 20000", "si", "is", -1, 20000, 0, false },
+};
+
+static void read_stats(const Operator* plan, void* arg) {
+  for (const Operator* op = plan; op; op = op->child) {
+    if (strncmp(op->label, "Sort", 4) == 0) exec_sort_stats(op, arg);
+  }
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  for (int i = 0; i < NROWS; i++) make_row(i, &rows[i]);
+  query_load(bp, &cat, "a", COLS, TYPES, 5, NROWS, fill);
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    const Query* query = &QUERIES[q];
+    Result ref = {0};
+    ref_rows(query, &ref);
+    const size_t work_mem[2] = { 0, SMALL_WORK_MEM };
+    for (int w = 0; w < 2; w++) {
+      Result got = {0};
+      SortStats st = {0};
+      CHECK(query_run(bp, &cat, query->sql, work_mem[w], &got, read_stats, &st));
+      CHECK(st.rows > 0);
+      if (w == 0 || query->top_n) {
+        CHECK(st.runs == 0);
+        CHECK(st.top_n == (query->limit >= 0));
+      } else {
+        CHECK(st.runs > 0 && !st.top_n);
+      }
+      CHECK(result_equal(query->sql, &got, &ref));
+      result_free(&got);
+    }
+    result_free(&ref);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("sort_test");
+}
@@ -0,0 +1,215 @@
+#include "check.h"
+#include "catalog.h"
+#include "freelist.h"
+#include "marqdb.h"
+#include "row.h"
+#include "toast.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Stores TEXT values too large for a row in overflow chains and reads them
+// back whole and by prefix: first the chains themselves, then rows that
+// point at them, then documents written and queried through the library.
+
+#define TEST_PATH "toast_test.db"
+#define TEST_WAL TEST_PATH ".wal"
+#define POOL_FRAMES 256
+#define DOC_MAX 200000
+#define NDOCS 12
+
+// Text of document i, len bytes long, that differs from the others early.
+static char* make_doc(int i, uint32_t len) {
+  char* doc = malloc(len + 1);
+  for (uint32_t k = 0; k < len; k++) doc[k] = (char)('a' + (k * 7 + (uint32_t)i) % 26);
+  int n = snprintf(doc, len + 1, "doc %d:", i);
+  if ((uint32_t)n < len) doc[n] = ' ';
+  doc[len] = 0;
+  return doc;
+}
+
+static uint32_t chain_pages(uint32_t len) {
+  return (len + TOAST_PAGE_BYTES - 1) / TOAST_PAGE_BYTES;
+}
+
+// Pops every page on the free list; returns how many there were.
+static uint32_t drain_free_list(BufferPool* bp) {
+  uint32_t n = 0;
+  while (freelist_pop(bp) != INVALID_PID) n++;
+  return n;
+}
+
+static void test_chain(BufferPool* bp) {
+  uint32_t len = 3 * TOAST_PAGE_BYTES + 123;
+  char* doc = make_doc(1, len);
+  uint32_t pid = toast_store(bp, (const uint8_t*)doc, len);
+  CHECK(pid != INVALID_PID);
+  // The chain takes its pages from a run; what the run has left over is
+  // handed back to the free list.
+  drain_free_list(bp);
+
+  uint8_t* out = malloc(len + 10);
+  CHECK(toast_fetch(bp, pid, out, len + 10) == len);
+  CHECK(memcmp(out, doc, len) == 0);
+  CHECK(toast_fetch(bp, pid, out, 10) == 10);
+  CHECK(memcmp(out, doc, 10) == 0);
+
+  // Released pages go to the free list and are handed out again.
+  toast_release(bp, pid);
+  CHECK(drain_free_list(bp) == chain_pages(len));
+  free(out);
+  free(doc);
+}
+
+static void test_row(BufferPool* bp) {
+  ColumnDef cols[3] = { { .col = "id", .type = COL_INT },
+                        { .col = "doc", .type = COL_TEXT },
+                        { .col = "note", .type = COL_TEXT } };
+  row_layout(cols, 3);
+  uint32_t len = 50000;
+  char* doc = make_doc(2, len);
+  const char* vals[3] = { "7", doc, "short" };
+  static uint8_t row[PAGE_SIZE];
+  int row_len = row_encode(bp, cols, 3, vals, 3, row, sizeof(row));
+  CHECK(row_len > 0 && row_len <= ROW_TOAST_TARGET);
+  drain_free_list(bp);
+
+  RowField f;
+  CHECK(row_get_field(cols, 3, row, row_len, 1, &f) == 1);
+  CHECK(f.toast_pid != INVALID_PID && f.text == NULL && f.text_len == len);
+  char* text = malloc(len + 1);
+  CHECK(row_field_text(bp, &f, (uint8_t*)text, len) == len);
+  CHECK(memcmp(text, doc, len) == 0);
+  CHECK(row_field_text(bp, &f, (uint8_t*)text, 6) == 6 && memcmp(text, "doc 2:", 6) == 0);
+  CHECK(row_get_field(cols, 3, row, row_len, 2, &f) == 1);
+  CHECK(f.toast_pid == INVALID_PID && f.text_len == 5 && memcmp(f.text, "short", 5) == 0);
+
+  char* decoded = malloc(len + 64);
+  int n = row_decode(bp, cols, 3, row, row_len, decoded, (int)len + 64);
+  CHECK(n > (int)len && strstr(decoded, doc) != NULL);
+
+  // Replacing the other column keeps the chain; releasing the old row
+  // against the new one leaves it alone.
+  static uint8_t updated[PAGE_SIZE];
+  int idx = 2;
+  const char* note = "longer note";
+  int upd_len = row_set_fields(bp, cols, 3, row, row_len, &idx, &note, 1, updated,
+                               sizeof(updated));
+  CHECK(upd_len > 0);
+  RowField g;
+  CHECK(row_get_field(cols, 3, updated, upd_len, 1, &g) == 1);
+  CHECK(row_get_field(cols, 3, row, row_len, 1, &f) == 1);
+  CHECK(g.toast_pid == f.toast_pid);
+  row_release(bp, cols, 3, row, row_len, updated, upd_len);
+  CHECK(freelist_pop(bp) == INVALID_PID);
+  CHECK(row_field_text(bp, &g, (uint8_t*)text, len) == len && memcmp(text, doc, len) == 0);
+  row_release(bp, cols, 3, updated, upd_len, NULL, 0);
+  CHECK(drain_free_list(bp) == chain_pages(len));
+
+  free(decoded);
+  free(text);
+  free(doc);
+}
+
+static uint32_t doc_len(int i) {
+  return i == 0 ? 1 : (uint32_t)((uint64_t)DOC_MAX * (uint64_t)(i * i) / (NDOCS * NDOCS)) + 1;
+}
+
+static void insert_docs(Mdb* db) {
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "INSERT INTO d VALUES (?, ?)", &s) == MDB_OK);
+  if (!s) return;
+  for (int i = 0; i < NDOCS; i++) {
+    char* doc = make_doc(i, doc_len(i));
+    mdb_bind_int(s, 1, i);
+    mdb_bind_text(s, 2, doc, -1);
+    CHECK(mdb_step(s) == MDB_DONE);
+    free(doc);
+  }
+  mdb_finalize(s);
+}
+
+static int query_int(Mdb* db, const char* sql, const char* text) {
+  MdbStmt* s;
+  if (mdb_prepare(db, sql, &s) != MDB_OK) return -1;
+  if (text) mdb_bind_text(s, 1, text, -1);
+  int n = mdb_step(s) == MDB_ROW ? mdb_column_int(s, 0) : -1;
+  mdb_finalize(s);
+  return n;
+}
+
+static void test_sql(void) {
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+  Mdb* db;
+  CHECK(mdb_open(TEST_PATH, &db) == MDB_OK);
+  if (!db) return;
+  CHECK(mdb_exec(db, "CREATE TABLE d (id INT, doc TEXT)") == MDB_OK);
+  insert_docs(db);
+
+  MdbStmt* s;
+  CHECK(mdb_prepare(db, "SELECT doc FROM d WHERE id = ?", &s) == MDB_OK);
+  if (s) {
+    for (int i = 0; i < NDOCS; i++) {
+      char* doc = make_doc(i, doc_len(i));
+      mdb_bind_int(s, 1, i);
+      CHECK(mdb_step(s) == MDB_ROW);
+      CHECK(mdb_column_bytes(s, 0) == (int)doc_len(i));
+      CHECK(mdb_column_text(s, 0) && strcmp(mdb_column_text(s, 0), doc) == 0);
+      CHECK(mdb_step(s) == MDB_DONE);
+      free(doc);
+    }
+    mdb_finalize(s);
+  }
+
+  // Comparisons read out-of-line values as far as they need to.
+  char* big = make_doc(NDOCS - 1, doc_len(NDOCS - 1));
+  CHECK(query_int(db, "SELECT count(*) FROM d WHERE doc = ?", big) == 1);
+  big[doc_len(NDOCS - 1) - 1] = '!';
+  CHECK(query_int(db, "SELECT count(*) FROM d WHERE doc = ?", big) == 0);
+  CHECK(query_int(db, "SELECT count(*) FROM d WHERE doc LIKE 'doc 1%'", NULL) == 3);
+  CHECK(query_int(db, "SELECT count(*) FROM d WHERE doc > 'doc 5'", NULL) == 5);
+  CHECK(query_int(db, "SELECT id FROM d ORDER BY doc DESC LIMIT 1", NULL) == 9);
+  free(big);
+
+  // Deleting the rows frees their chains for the next documents.
+  CHECK(mdb_exec(db, "DELETE FROM d WHERE id >= 0") == MDB_OK);
+  CHECK(mdb_exec(db, "VACUUM d") == MDB_OK);
+  insert_docs(db);
+  long size = 0;
+  FILE* f = fopen(TEST_PATH, "rb");
+  if (f) {
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fclose(f);
+  }
+  CHECK(mdb_exec(db, "DELETE FROM d WHERE id >= 0") == MDB_OK);
+  CHECK(mdb_exec(db, "VACUUM d") == MDB_OK);
+  insert_docs(db);
+  f = fopen(TEST_PATH, "rb");
+  if (f) {
+    fseek(f, 0, SEEK_END);
+    CHECK(ftell(f) == size);
+    fclose(f);
+  }
+  CHECK(query_int(db, "SELECT count(*) FROM d", NULL) == NDOCS);
+  mdb_close(db);
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  test_chain(bp);
+  test_row(bp);
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+
+  test_sql();
+  unlink(TEST_PATH);
+  return check_done("toast_test");
+}
@@ -0,0 +1,405 @@
+#include "check.h"
+#include "exec.h"
+#include "marqdb.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Checks every column type: values parse strictly and format back to text
+// that parses to the same value, compare in the order of the type rather
+// than of their text, and go through INSERT, WHERE and ORDER BY the same
+// way. INT, BIGINT and DOUBLE columns and literals compare with each other
+// exactly by value, whether a scan, an index or a join evaluates them.
+
+#define TEST_PATH "types_test.db"
+#define TEST_WAL TEST_PATH ".wal"
+#define MIXED_ROWS 400
+
+// ============================================================================
+// Parsing and formatting
+// ============================================================================
+
+typedef struct {
+  ColumnType type;
+  const char* text;
+  const char* formatted; ///< How the value prints, or NULL if it is invalid
+} ParseCase;
+
+static const ParseCase PARSES[] = {
+  { COL_INT, "42", "42" },
+  { COL_INT, " -2147483648", "-2147483648" },
+  { COL_INT, "2147483647", "2147483647" },
+  { COL_INT, "2147483648", NULL },
+  { COL_INT, "12abc", NULL },
+  { COL_INT, "1.5", NULL },
+  { COL_INT, "", NULL },
+  { COL_BIGINT, "-9223372036854775808", "-9223372036854775808" },
+  { COL_BIGINT, "9223372036854775807", "9223372036854775807" },
+  { COL_BIGINT, "9223372036854775808", NULL },
+  { COL_BIGINT, "5 5", NULL },
+  { COL_DOUBLE, "0.1", "0.1" },
+  { COL_DOUBLE, "-2.5", "-2.5" },
+  { COL_DOUBLE, "1e300", "1e+300" },
+  { COL_DOUBLE, "7", "7" },
+  { COL_DOUBLE, "0.30000000000000004", "0.30000000000000004" },
+  { COL_DOUBLE, "nan", NULL },
+  { COL_DOUBLE, "1.5x", NULL },
+  { COL_BOOL, "TRUE", "true" },
+  { COL_BOOL, "t", "true" },
+  { COL_BOOL, "1", "true" },
+  { COL_BOOL, "False", "false" },
+  { COL_BOOL, "0", "false" },
+  { COL_BOOL, "yes", NULL },
+  { COL_BOOL, "tru", NULL },
+  { COL_BOOL, "2", NULL },
+  { COL_TIMESTAMP, "2024-02-29 12:34:56.5", "2024-02-29 12:34:56.500000" },
+  { COL_TIMESTAMP, "1969-12-31T23:59:59", "1969-12-31 23:59:59" },
+  { COL_TIMESTAMP, "2000-01-01", "2000-01-01 00:00:00" },
+  { COL_TIMESTAMP, "2000-01-01 08:05", "2000-01-01 08:05:00" },
+  { COL_TIMESTAMP, "0", "1970-01-01 00:00:00" },
+  { COL_TIMESTAMP, "-1", "1969-12-31 23:59:59.999999" },
+  { COL_TIMESTAMP, "2023-02-29", NULL },
+  { COL_TIMESTAMP, "2024-13-01", NULL },
+  { COL_TIMESTAMP, "2024-01-01 24:00", NULL },
+  { COL_TIMESTAMP, "2024-01-01 10:00:00.", NULL },
+  { COL_TIMESTAMP, "yesterday", NULL },
+};
+
+static void test_parse(void) {
+  for (size_t i = 0; i < sizeof(PARSES) / sizeof(PARSES[0]); i++) {
+    const ParseCase* pc = &PARSES[i];
+    RowField v;
+    int r = row_parse_value(pc->type, pc->text, &v);
+    CHECK(r == (pc->formatted ? 0 : -1));
+    if (r != 0 || !pc->formatted) continue;
+
+    char text[64];
+    CHECK(row_format_value(&v, text, sizeof(text)) == (int)strlen(pc->formatted));
+    if (strcmp(text, pc->formatted) != 0) {
+      fprintf(stderr, "%s '%s' formats as '%s', want '%s'\n", row_type_name(pc->type), pc->text,
+              text, pc->formatted);
+      CHECK(false);
+    }
+
+    // What it prints reads back as the same value, as does the stored row.
+    RowField back;
+    CHECK(row_parse_value(pc->type, text, &back) == 0);
+    CHECK(exec_compare(NULL, &v, &back) == 0);
+    ColumnDef col = { .col = "x", .type = pc->type };
+    row_layout(&col, 1);
+    uint8_t row[64];
+    const char* vals[1] = { pc->text };
+    int len = row_encode(NULL, &col, 1, vals, 1, row, sizeof(row));
+    CHECK(len > 0 && row_get_field(&col, 1, row, len, 0, &back) == 1);
+    CHECK(exec_compare(NULL, &v, &back) == 0);
+  }
+
+  // CHAR(n) drops trailing spaces and takes at most n bytes.
+  ColumnDef col = { .col = "c", .type = COL_CHAR, .len = 4 };
+  row_layout(&col, 1);
+  const char* fits[] = { "abcd", "ab  ", "" };
+  const char* too_long[] = { "abcde", "abcd  x" };
+  for (int i = 0; i < 3; i++) CHECK(row_invalid_value(&col, &fits[i], 1) < 0);
+  for (int i = 0; i < 2; i++) CHECK(row_invalid_value(&col, &too_long[i], 1) == 0);
+  RowField v;
+  CHECK(row_parse_value(COL_CHAR, "ab  ", &v) == 0 && v.text_len == 2);
+}
+
+// ============================================================================
+// Ordering
+// ============================================================================
+
+typedef struct {
+  ColumnType type;
+  const char* values[8]; ///< In ascending order, ended by NULL; equal neighbours marked by '='
+} OrderCase;
+
+// A value written "=x" is equal to the one before it.
+static const OrderCase ORDERS[] = {
+  { COL_INT, { "-2147483648", "-10", "-9", "0", "9", "10", "2147483647" } },
+  { COL_BIGINT, { "-9223372036854775808", "-4294967296", "-1", "2", "10", "4294967296" } },
+  { COL_DOUBLE, { "-inf", "-1e300", "-0.5", "0", "=-0", "1e-300", "2.5", "inf" } },
+  { COL_BOOL, { "false", "=0", "true", "=t" } },
+  { COL_TIMESTAMP,
+    { "1969-12-31 23:59:59", "1970-01-01", "1970-01-01 00:00:00.000001", "1999-12-31 23:59",
+      "2000-01-01", "=946684800000000", "10000000000000000" } },
+  { COL_CHAR, { "", "A", "a", "=a  ", "ab", "b" } },
+  { COL_TEXT, { "", " ", "A", "a", "a ", "ab", "b" } },
+};
+
+static void test_order(void) {
+  for (size_t i = 0; i < sizeof(ORDERS) / sizeof(ORDERS[0]); i++) {
+    const OrderCase* oc = &ORDERS[i];
+    RowField v[8];
+    int rank[8];
+    int n = 0;
+    for (; n < 8 && oc->values[n]; n++) {
+      const char* text = oc->values[n];
+      bool equal = text[0] == '=';
+      CHECK(row_parse_value(oc->type, text + equal, &v[n]) == 0);
+      rank[n] = n == 0 ? 0 : rank[n - 1] + !equal;
+    }
+    bool ok = true;
+    for (int a = 0; a < n; a++) {
+      for (int b = 0; b < n; b++) {
+        int c = exec_compare(NULL, &v[a], &v[b]);
+        int want = (rank[a] > rank[b]) - (rank[a] < rank[b]);
+        ok &= (c > 0) - (c < 0) == want;
+      }
+    }
+    if (!ok) fprintf(stderr, "%s values compare out of order\n", row_type_name(oc->type));
+    CHECK(ok);
+  }
+}
+
+// ============================================================================
+// SQL
+// ============================================================================
+
+static int count(Mdb* db, const char* sql) {
+  MdbStmt* s;
+  if (mdb_prepare(db, sql, &s) != MDB_OK) {
+    fprintf(stderr, "%s: %s\n", sql, mdb_errmsg(db));
+    return -1;
+  }
+  int n = -1;
+  if (mdb_step(s) == MDB_ROW) n = mdb_column_int(s, 0);
+  mdb_finalize(s);
+  return n;
+}
+
+// Returns column 0 of every row joined by ',', NULL printed as NULL.
+static const char* column(Mdb* db, const char* sql) {
+  static char out[1024];
+  out[0] = 0;
+  MdbStmt* s;
+  if (mdb_prepare(db, sql, &s) != MDB_OK) {
+    fprintf(stderr, "%s: %s\n", sql, mdb_errmsg(db));
+    return "";
+  }
+  for (int n = 0; mdb_step(s) == MDB_ROW; n++) {
+    const char* text = mdb_column_text(s, 0);
+    if (n) strcat(out, ",");
+    strcat(out, text ? text : "NULL");
+  }
+  mdb_finalize(s);
+  return out;
+}
+
+typedef struct {
+  const char* sql;
+  const char* want;
+} ColumnCase;
+
+static const ColumnCase SELECTS[] = {
+  { "SELECT i FROM v ORDER BY i", "-2147483648,-3,0,7,2147483647,NULL" },
+  { "SELECT b FROM v ORDER BY b DESC", "NULL,9223372036854775807,4294967296,5,-1,-9000000000" },
+  { "SELECT d FROM v ORDER BY d", "-1e+300,-0.25,0.1,2,1e+300,NULL" },
+  { "SELECT f FROM v WHERE f = true ORDER BY i", "true,true" },
+  { "SELECT f FROM v WHERE f <> true ORDER BY i", "false,false,false" },
+  { "SELECT ts FROM v ORDER BY ts",
+    "1969-07-20 20:17:40,1970-01-01 00:00:00.000001,2000-02-29 00:00:00,"
+    "2024-02-29 23:59:59.999999,2024-03-01 00:00:00,NULL" },
+  { "SELECT c FROM v ORDER BY c", "a,ab,abcd,b,zz,NULL" },
+  { "SELECT t FROM v ORDER BY t", ",a,a b,aa,b,NULL" },
+  { "SELECT i FROM v WHERE ts >= '2000-02-29' AND ts < '2024-03-01' ORDER BY i",
+    "-3,7" },
+  { "SELECT i FROM v WHERE ts < 0 ORDER BY i", "0" },
+  { "SELECT i FROM v WHERE c = 'ab  ' ORDER BY i", "7" },
+  { "SELECT i FROM v WHERE c > 'ab' AND c < 'b' ORDER BY i", "-3" },
+  { "SELECT i FROM v WHERE b > 4294967295 ORDER BY i", "0,7" },
+  { "SELECT i FROM v WHERE d < 0.1 ORDER BY i", "-2147483648,-3" },
+  { "SELECT i FROM v WHERE f = false ORDER BY i", "-2147483648,0,7" },
+  { "SELECT t FROM v WHERE t < 'aa' ORDER BY t", ",a,a b" },
+};
+
+static void test_sql(Mdb* db) {
+  CHECK(mdb_exec(db, "CREATE TABLE v (i INT, b BIGINT, d DOUBLE, f BOOL, ts TIMESTAMP, "
+                     "c CHAR(4), t TEXT)") == MDB_OK);
+  CHECK(mdb_exec(db, "INSERT INTO v VALUES "
+                     "(7, 9223372036854775807, 2, 'false', '2000-02-29', 'ab', 'a'), "
+                     "(-3, 5, -0.25, 't', '2024-02-29 23:59:59.999999', 'abcd', 'a b'), "
+                     "(-2147483648, -9000000000, -1e300, '0', '2024-03-01', 'a', ''), "
+                     "(0, 4294967296, 0.1, 'FALSE', '1969-07-20T20:17:40', 'zz  ', 'b'), "
+                     "(2147483647, -1, 1e300, 'TRUE', 1, 'b', 'aa'), "
+                     "(NULL, NULL, NULL, NULL, NULL, NULL, NULL)") == MDB_OK);
+  for (size_t i = 0; i < sizeof(SELECTS) / sizeof(SELECTS[0]); i++) {
+    const char* got = column(db, SELECTS[i].sql);
+    if (strcmp(got, SELECTS[i].want) != 0) {
+      fprintf(stderr, "%s: got '%s', want '%s'\n", SELECTS[i].sql, got, SELECTS[i].want);
+      CHECK(false);
+    }
+  }
+
+  // An index orders and bounds each type as a scan does.
+  const char* indexes[] = { "i", "b", "d", "ts", "c" };
+  for (int k = 0; k < 5; k++) {
+    char sql[128];
+    snprintf(sql, sizeof(sql), "CREATE INDEX v_%s ON v (%s)", indexes[k], indexes[k]);
+    CHECK(mdb_exec(db, sql) == MDB_OK);
+  }
+  for (size_t i = 0; i < sizeof(SELECTS) / sizeof(SELECTS[0]); i++) {
+    CHECK(strcmp(column(db, SELECTS[i].sql), SELECTS[i].want) == 0);
+  }
+
+  // Each invalid value is rejected, and names its column.
+  const struct {
+    const char* values;
+    const char* col;
+  } bad[] = {
+    { "'x', 1, 1, true, 0, 'a', 'a'", "'i'" },
+    { "2147483648, 1, 1, true, 0, 'a', 'a'", "'i'" },
+    { "1, '9223372036854775808', 1, true, 0, 'a', 'a'", "'b'" },
+    { "1, 1, '1.5x', true, 0, 'a', 'a'", "'d'" },
+    { "1, 1, 1, 'yes', 0, 'a', 'a'", "'f'" },
+    { "1, 1, 1, true, '2023-02-29', 'a', 'a'", "'ts'" },
+    { "1, 1, 1, true, 0, 'abcde', 'a'", "'c'" },
+  };
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+    char sql[128];
+    snprintf(sql, sizeof(sql), "INSERT INTO v VALUES (%s)", bad[i].values);
+    CHECK(mdb_exec(db, sql) == MDB_ERROR);
+    CHECK(strstr(mdb_errmsg(db), bad[i].col) != NULL);
+  }
+  CHECK(mdb_exec(db, "UPDATE v SET i = 2.5") == MDB_ERROR);
+  CHECK(strstr(mdb_errmsg(db), "'i'") != NULL);
+  CHECK(mdb_exec(db, "UPDATE v SET ts = 'noon'") == MDB_ERROR);
+  CHECK(strstr(mdb_errmsg(db), "'ts'") != NULL);
+  CHECK(count(db, "SELECT count(*) FROM v") == 6);
+}
+
+// ============================================================================
+// Mixed numeric compares
+// ============================================================================
+
+typedef struct {
+  int32_t i;
+  int64_t b;
+  double d;
+} MixedRow;
+
+static MixedRow mixed[MIXED_ROWS];
+
+static void make_mixed(void) {
+  for (int k = 0; k < MIXED_ROWS; k++) {
+    int v = k - MIXED_ROWS / 2;
+    mixed[k].i = v;
+    // b equals i on even rows and is far outside INT on the others.
+    mixed[k].b = k % 2 == 0 ? v : (int64_t)v * 3000000000LL;
+    // d equals i on every third row, and is half way to the next on the others.
+    mixed[k].d = k % 3 == 0 ? v : v + 0.5;
+  }
+}
+
+// Holds for the rows where two numbers compare as op, all values here
+// being small enough that double holds them exactly.
+static bool holds(double x, const char* op, double y) {
+  if (strcmp(op, "=") == 0) return x == y;
+  if (strcmp(op, "<") == 0) return x < y;
+  if (strcmp(op, "<=") == 0) return x <= y;
+  if (strcmp(op, ">") == 0) return x > y;
+  return x >= y;
+}
+
+static double operand(const MixedRow* r, const char* name) {
+  if (strcmp(name, "i") == 0) return r->i;
+  if (strcmp(name, "b") == 0) return (double)r->b;
+  if (strcmp(name, "d") == 0) return r->d;
+  return strtod(name, NULL);
+}
+
+static void test_mixed(Mdb* db) {
+  make_mixed();
+  // n holds the same rows as m, to join with.
+  CHECK(mdb_exec(db, "CREATE TABLE m (i INT, b BIGINT, d DOUBLE)") == MDB_OK);
+  CHECK(mdb_exec(db, "CREATE TABLE n (i INT, b BIGINT, d DOUBLE)") == MDB_OK);
+  const char* inserts[] = { "INSERT INTO m VALUES (?, ?, ?)", "INSERT INTO n VALUES (?, ?, ?)" };
+  for (int t = 0; t < 2; t++) {
+    MdbStmt* ins;
+    CHECK(mdb_prepare(db, inserts[t], &ins) == MDB_OK);
+    if (!ins) return;
+    for (int k = 0; k < MIXED_ROWS; k++) {
+      mdb_bind_int(ins, 1, mixed[k].i);
+      mdb_bind_int64(ins, 2, mixed[k].b);
+      mdb_bind_double(ins, 3, mixed[k].d);
+      CHECK(mdb_step(ins) == MDB_DONE);
+    }
+    mdb_finalize(ins);
+  }
+
+  // Columns against columns, and against literals of the other types,
+  // including fractions and integers no INT holds.
+  const char* sides[][2] = {
+    { "i", "b" },   { "i", "d" },    { "b", "d" },          { "d", "i" },
+    { "i", "2.5" }, { "i", "-7.0" }, { "i", "9000000000" }, { "i", "-9000000000" },
+    { "b", "2.5" }, { "d", "3" },    { "b", "-150" },       { "d", "9000000000" },
+  };
+  const char* ops[] = { "=", "<", "<=", ">", ">=" };
+  for (int pass = 0; pass < 2; pass++) {
+    // The second pass has indexes on every column to bound the scans.
+    if (pass == 1) {
+      CHECK(mdb_exec(db, "CREATE INDEX m_i ON m (i)") == MDB_OK);
+      CHECK(mdb_exec(db, "CREATE INDEX m_b ON m (b)") == MDB_OK);
+      CHECK(mdb_exec(db, "CREATE INDEX m_d ON m (d)") == MDB_OK);
+    }
+    for (size_t s = 0; s < sizeof(sides) / sizeof(sides[0]); s++) {
+      for (int o = 0; o < 5; o++) {
+        int want = 0;
+        for (int k = 0; k < MIXED_ROWS; k++) {
+          want += holds(operand(&mixed[k], sides[s][0]), ops[o], operand(&mixed[k], sides[s][1]));
+        }
+        char sql[128];
+        snprintf(sql, sizeof(sql), "SELECT count(*) FROM m WHERE %s %s %s", sides[s][0], ops[o],
+                 sides[s][1]);
+        int got = count(db, sql);
+        if (got != want) fprintf(stderr, "%s: got %d, want %d\n", sql, got, want);
+        CHECK(got == want);
+      }
+    }
+  }
+
+  // Only whole numbers in INT's range can equal an INT.
+  CHECK(count(db, "SELECT count(*) FROM m WHERE i IN (2, 2.5, 9000000000, -4.0)") == 2);
+  CHECK(count(db, "SELECT count(*) FROM m WHERE i IN (2.5, 9000000000)") == 0);
+
+  // Joins match by value: every d that is whole meets the i it equals,
+  // and every b equal to its i meets it.
+  int want_d = 0, want_b = 0;
+  for (int k = 0; k < MIXED_ROWS; k++) {
+    want_d += mixed[k].d == (int)mixed[k].d;
+    want_b += mixed[k].b >= -MIXED_ROWS && mixed[k].b < MIXED_ROWS;
+  }
+  CHECK(count(db, "SELECT count(*) FROM m JOIN n ON m.i = n.d") == want_d);
+  CHECK(count(db, "SELECT count(*) FROM m JOIN n ON m.b = n.i") == want_b);
+
+  // Past 2^53 a double no longer holds every integer; the compare is still exact.
+  CHECK(mdb_exec(db, "CREATE TABLE big (b BIGINT, d DOUBLE)") == MDB_OK);
+  CHECK(mdb_exec(db, "INSERT INTO big VALUES (9007199254740993, 9007199254740992), "
+                     "(9223372036854775807, 9223372036854775807), "
+                     "(-9223372036854775808, -9223372036854775808)") == MDB_OK);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b = d") == 1);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b > d") == 1);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b < d") == 1);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b = 9007199254740992.0") == 0);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b > 1e19") == 0);
+  CHECK(count(db, "SELECT count(*) FROM big WHERE b >= -1e19") == 3);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+
+  test_parse();
+  test_order();
+
+  Mdb* db;
+  CHECK(mdb_open(TEST_PATH, &db) == MDB_OK);
+  if (!db) return check_done("types_test");
+  test_sql(db);
+  test_mixed(db);
+  mdb_close(db);
+
+  unlink(TEST_PATH);
+  unlink(TEST_WAL);
+  return check_done("types_test");
+}
@@ -0,0 +1,90 @@
+#include "check.h"
+#include "catalog.h"
+#include "heap.h"
+#include <string.h>
+#include <unistd.h>
+
+// Deletes rows from a heap, vacuums it and checks what the vacuum reports
+// against the bytes that were deleted, then that the live rows are intact.
+
+#define TEST_PATH "vacuum_test.db"
+#define POOL_FRAMES 256
+#define NROWS 3000
+
+static uint16_t row_len(int i) {
+  return (uint16_t)(20 + i % 50);
+}
+
+static void make_row(int i, uint8_t* rec) {
+  memset(rec, 0, row_len(i));
+  memcpy(rec, &i, sizeof(i));
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  uint32_t header_pid;
+  HeapFile hf = heap_create(bp, &header_pid);
+
+  static RID rids[NROWS];
+  uint8_t rec[PAGE_SIZE];
+  for (int i = 0; i < NROWS; i++) {
+    make_row(i, rec);
+    rids[i] = heap_insert(bp, &hf, rec, row_len(i));
+  }
+
+  // Deletes every odd slot but the last of each page, whose slot would be
+  // given back too, and every row of the third page, which is freed.
+  uint32_t third = INVALID_PID;
+  for (int i = 0, pages = 0; i < NROWS; i++) {
+    if (i == 0 || rids[i].page_id != rids[i - 1].page_id) pages++;
+    if (pages == 3) third = rids[i].page_id;
+  }
+  uint64_t deleted_bytes = 0;
+  int deleted = 0;
+  bool is_deleted[NROWS] = { false };
+  for (int i = 0; i < NROWS; i++) {
+    bool last = i + 1 == NROWS || rids[i + 1].page_id != rids[i].page_id;
+    if (rids[i].page_id != third && (rids[i].slot_id % 2 == 0 || last)) continue;
+    CHECK(heap_delete(bp, &hf, rids[i]) == 0);
+    deleted_bytes += row_len(i);
+    deleted++;
+    is_deleted[i] = true;
+  }
+
+  HeapVacuumStats st;
+  CHECK(heap_vacuum(bp, &hf, UINT32_MAX, &st));
+  CHECK(st.pages_freed == 1);
+  CHECK(st.pages_compacted == st.pages_scanned - 1);
+  CHECK(st.bytes_reclaimed == deleted_bytes);
+
+  // A second pass finds nothing left to do.
+  CHECK(heap_vacuum(bp, &hf, UINT32_MAX, &st));
+  CHECK(st.pages_compacted == 0 && st.pages_freed == 0 && st.bytes_reclaimed == 0);
+
+  // Live rows keep their RIDs; the freed page now belongs to the free list.
+  for (int i = 0; i < NROWS; i++) {
+    if (rids[i].page_id == third) continue;
+    uint8_t* out;
+    uint16_t len;
+    bool found = heap_get(bp, rids[i], &out, &len);
+    CHECK(found == !is_deleted[i]);
+    make_row(i, rec);
+    if (found) CHECK(len == row_len(i) && memcmp(out, rec, len) == 0);
+  }
+  int live = 0;
+  RID cur = { INVALID_PID, 0 };
+  uint8_t* out;
+  uint16_t len;
+  while (heap_scan_next(bp, &hf, &cur, &out, &len)) {
+    bp_unpin_page(bp, cur.page_id, false);
+    live++;
+  }
+  CHECK(live == NROWS - deleted);
+
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("vacuum_test");
+}
@@ -0,0 +1,184 @@
+#include "check.h"
+#include "planner.h"
+#include "query.h"
+#include <unistd.h>
+
+// Runs filters through the vectorized scan, which evaluates them a column
+// at a time over each batch, and checks they select the same rows as
+// exec_eval testing each row on its own, and as the predicate written in
+// C. The table spans several batches and pages, and holds NULLs,
+// out-of-line TEXT and every numeric type.
+
+#define TEST_PATH "vector_test.db"
+#define POOL_FRAMES 1024
+#define NROWS 5000
+#define LONG_TEXT 3000
+
+typedef struct {
+  int id;
+  bool v_null;
+  int v;
+  long long b;
+  bool d_null;
+  double d;
+  bool s_null;
+  char s[LONG_TEXT + 1];
+} Row;
+
+typedef struct {
+  const char* where;
+  bool (*ref)(const Row* r);
+} Query;
+
+static const char* COLS[] = { "id", "v", "b", "d", "s" };
+static const ColumnType TYPES[] = { COL_INT, COL_INT, COL_BIGINT, COL_DOUBLE, COL_TEXT };
+
+static void make_row(int i, Row* r) {
+  r->id = i;
+  r->v_null = i % 7 == 0;
+  r->v = r->v_null ? 0 : i * 37 % 1000;
+  r->b = (long long)(i - NROWS / 2) * 1000000007LL;
+  r->d_null = i % 13 == 0;
+  r->d = r->d_null ? 0 : i / 4.0;
+  r->s_null = i % 11 == 0;
+  r->s[0] = 0;
+  if (r->s_null) return;
+  int n = snprintf(r->s, sizeof(r->s), "s%04d", i * 7919 % NROWS);
+  // Every 50th value is long enough to be stored out of line.
+  if (i % 50 == 1) {
+    memset(r->s + n, 'x', LONG_TEXT - (size_t)n);
+    r->s[LONG_TEXT] = 0;
+  }
+}
+
+static void fill(int i, char vals[][QUERY_VALUE_LEN], const char** out) {
+  Row r;
+  make_row(i, &r);
+  snprintf(vals[0], QUERY_VALUE_LEN, "%d", r.id);
+  snprintf(vals[1], QUERY_VALUE_LEN, "%d", r.v);
+  snprintf(vals[2], QUERY_VALUE_LEN, "%lld", r.b);
+  snprintf(vals[3], QUERY_VALUE_LEN, "%.2f", r.d);
+  snprintf(vals[4], QUERY_VALUE_LEN, "%s", r.s);
+  for (int c = 0; c < 5; c++) out[c] = vals[c];
+  if (r.v_null) out[1] = NULL;
+  if (r.d_null) out[3] = NULL;
+  if (r.s_null) out[4] = NULL;
+}
+
+static bool v_lt_500(const Row* r) { return !r->v_null && r->v < 500; }
+static bool v_ge_500(const Row* r) { return !r->v_null && r->v >= 500; }
+static bool v_between(const Row* r) { return !r->v_null && r->v >= 250 && r->v <= 259; }
+static bool v_in(const Row* r) {
+  return !r->v_null && (r->v == 3 || r->v == 37 || r->v == 74 || r->v == 999);
+}
+static bool v_not_in(const Row* r) { return !r->v_null && r->v != 3 && r->v != 37; }
+static bool v_eq_or_id(const Row* r) { return (!r->v_null && r->v == 3) || r->id < 10; }
+static bool not_or(const Row* r) {
+  return !r->v_null && r->v != 3 && !r->d_null && r->d <= 100;
+}
+static bool d_or_s(const Row* r) {
+  return (!r->d_null && r->d > 100) || (!r->s_null && strncmp(r->s, "s1", 2) == 0);
+}
+static bool b_and_d(const Row* r) { return r->b > 0 && !r->d_null && r->d < 1000.5; }
+static bool b_big(const Row* r) { return r->b > 3000000000LL; }
+static bool s_prefix(const Row* r) { return !r->s_null && strncmp(r->s, "s1", 2) == 0; }
+static bool s_suffix(const Row* r) {
+  return !r->s_null && r->s[0] && r->s[strlen(r->s) - 1] == 'x';
+}
+static bool s_contains(const Row* r) { return !r->s_null && strstr(r->s, "12") != NULL; }
+static bool s_gt(const Row* r) { return !r->s_null && strcmp(r->s, "s4000") > 0; }
+static bool s_eq(const Row* r) { return !r->s_null && strcmp(r->s, "s0077") == 0; }
+static bool v_and_long(const Row* r) { return v_lt_500(r) && s_suffix(r); }
+static bool v_lt_d(const Row* r) { return !r->v_null && !r->d_null && r->v < r->d; }
+static bool b_ge_v(const Row* r) { return !r->v_null && r->b >= r->v; }
+static bool none(const Row* r) { return r->id < 0; }
+static bool all(const Row* r) { return r->id >= 0; }
+
+static const Query QUERIES[] = {
+  { "v < 500", v_lt_500 },
+  { "NOT (v < 500)", v_ge_500 },
+  { "v BETWEEN 250 AND 259", v_between },
+  { "v IN (3, 37, 74, 999)", v_in },
+  { "NOT (v IN (3, 37))", v_not_in },
+  { "v = 3 OR id < 10", v_eq_or_id },
+  { "NOT (v = 3 OR d > 100)", not_or },
+  { "d > 100 OR s LIKE 's1%'", d_or_s },
+  { "b > 0 AND d < 1000.5", b_and_d },
+  { "b > 3000000000", b_big },
+  { "s LIKE 's1%'", s_prefix },
+  { "s LIKE '%x'", s_suffix },
+  { "s LIKE '%12%'", s_contains },
+  { "s > 's4000'", s_gt },
+  { "s = 's0077'", s_eq },
+  { "v < 500 AND s LIKE '%x'", v_and_long },
+  { "v < d", v_lt_d },
+  { "b >= v", b_ge_v },
+  { "id < 0", none },
+  { "id >= 0", all },
+};
+
+static void check_vectorized(const Operator* plan, void* arg) {
+  (void)arg;
+  CHECK(plan->next_batch != NULL);
+}
+
+// Ids of the rows for which exec_eval finds the bound predicate true,
+// testing them one at a time as a plain scan hands them out.
+static void eval_rows(BufferPool* bp, Catalog* cat, const char* sql, Result* out) {
+  Arena arena;
+  arena_init(&arena);
+  ExecCtx ctx = { .bp = bp, .cat = cat, .arena = &arena, .quiet = true };
+  Stmt* s = parse_statement(&arena, sql, ctx.err, sizeof(ctx.err));
+  TableInfo* t = s ? plan_open_table(&ctx, "t") : NULL;
+  Operator* scan = t ? exec_seq_scan(&ctx, t) : NULL;
+  bool bound = scan && plan_bind_expr(&ctx, s->select.where, scan);
+  CHECK(bound);
+  if (bound && scan->open(scan)) {
+    Tuple tup;
+    char line[16];
+    while (scan->next(scan, &tup) > 0) {
+      if (exec_eval(&ctx, s->select.where, &tup) != 1) continue;
+      snprintf(line, sizeof(line), "%d", tup.vals[0].i32);
+      result_add(out, line);
+    }
+  }
+  if (scan) scan->close(scan);
+  arena_free(&arena);
+}
+
+int main(void) {
+  unlink(TEST_PATH);
+  DiskManager* dm = disk_open(TEST_PATH);
+  BufferPool* bp = bp_create(dm, POOL_FRAMES);
+  Catalog cat = catalog_open(bp);
+  query_load(bp, &cat, "t", COLS, TYPES, 5, NROWS, fill);
+
+  static Row rows[NROWS];
+  for (int i = 0; i < NROWS; i++) make_row(i, &rows[i]);
+
+  for (size_t q = 0; q < sizeof(QUERIES) / sizeof(QUERIES[0]); q++) {
+    char sql[256];
+    snprintf(sql, sizeof(sql), "SELECT id FROM t WHERE %s", QUERIES[q].where);
+    Result vec = {0}, row = {0}, ref = {0};
+    CHECK(query_run(bp, &cat, sql, 0, &vec, check_vectorized, NULL));
+    eval_rows(bp, &cat, sql, &row);
+    for (int i = 0; i < NROWS; i++) {
+      if (!QUERIES[q].ref(&rows[i])) continue;
+      char line[16];
+      snprintf(line, sizeof(line), "%d", i);
+      result_add(&ref, line);
+    }
+    // Rows come in scan order, which is the order they were loaded in.
+    CHECK(result_equal(sql, &vec, &ref));
+    CHECK(result_equal(sql, &row, &ref));
+    result_free(&vec);
+    result_free(&row);
+    result_free(&ref);
+  }
+
+  catalog_close(&cat);
+  bp_destroy(bp);
+  disk_close(dm);
+  unlink(TEST_PATH);
+  return check_done("vector_test");
+}